@@ -542,6 +542,519 @@ void ldl_mprove_pm (
 }
 
 
+/*
+ * LDL_DCMP_PM_SKY  -  Solves the partitioned matrix equations of ldl_dcmp_pm
+ *
+ *           [A_qq]{x_q} + [A_qr]{x_r} = {b_q}
+ *           [A_rq]{x_q} + [A_rr]{x_r} = {b_r}+{c_r}
+ *
+ * where the symmetric matrix [A] is stored in skyline (active column) form.
+ * The upper triangle of column j of [A], from the diagonal up to the first
+ * structurally non-zero term, is stored in A[maxa[j]] ... A[maxa[j+1]-1], so
+ *	A[i][j] = A[ maxa[j] + j - i ]	for  j-i < maxa[j+1]-maxa[j]
+ * The terms of [A_qq] are replaced by the upper triangle L' of its L D L'
+ * reduction.  The terms of [A_qr] and [A_rr] are not changed.
+ * The diagonal of D is returned in the vector {d}.
+ *
+ * usage: double *A, *d, *b, *x, *c;
+ *	int   *maxa, n, *q, *r, reduce, solve, pd;
+ *	ldl_dcmp_pm_sky ( A, maxa, n, d, b, x, c, q, r, reduce, solve, &pd );
+ *
+ * Bathe, Finite Element Procecures in Engineering Analysis, Prentice Hall, 1982
+ */
+void ldl_dcmp_pm_sky (
+	double *A,	/**< the skyline matrix, and L' of the L D L' decomp.*/
+	int *maxa,	/**< index of each diagonal term of A, [1..n+1]	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	int reduce,	/**< 1: do a forward reduction of A; 0: don't   */
+	int solve,	/**< 1: do a back substitution for {x}; 0: don't */
+	int *pd		/**< 1: definite matrix and successful L D L' decomp'n*/
+){
+	double	*Aj;
+	int	i, j, mj;
+
+	*pd = 0;	/* number of negative elements on the diagonal of D */
+
+	/* forward column-wise reduction of [A]	*/
+	if ( reduce && !ldl_reduce_pm_sky ( A, maxa, n, d, q, 1, pd ) )  return;
+
+	if ( solve ) {		/* back substitution to solve for {x}   */
+
+	    /*  {x_q} = {b_q} - [A_qr]{x_r}, sweeping the columns of [A]  */
+	    for (i=1; i <= n; i++)	if ( q[i] )	x[i] = b[i];
+	    for (j=1; j <= n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		for (i=mj; i < j; i++) {
+			if ( q[i] && r[j] )	x[i] -= Aj[-i]*x[j];
+			if ( r[i] && q[j] )	x[j] -= Aj[-i]*x[i];
+		}
+	    }
+
+		/* {x} is run through the same forward reduction as was [A] */
+	    for (j=1; j <= n; j++) {
+		if ( q[j] ) {
+			Aj = A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			for (i=mj; i < j; i++) if ( q[i] ) x[j] -= Aj[-i]*x[i];
+		}
+	    }
+
+	    for (i=1; i <= n; i++)	if ( q[i] )	x[i] /= d[i];
+
+	    /* now back substitution is conducted on {x};  [A] is preserved */
+
+	    for (j=n; j > 1; j--) {
+		if ( q[j] ) {
+			Aj = A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			for (i=mj; i < j; i++) if ( q[i] ) x[i] -= Aj[-i]*x[j];
+		}
+	    }
+
+	    /* finally, evaluate c_r = [A_rq]{x_q} + [A_rr]{x_r} - {b_r} */
+
+	    for (i=1; i<=n; i++) {
+		c[i] = 0.0;
+		if ( r[i] )	c[i] = A[maxa[i]]*x[i] - b[i];
+	    }
+	    for (j=1; j <= n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		for (i=mj; i < j; i++) {
+			if ( r[i] )	c[i] += Aj[-i]*x[j];
+			if ( r[j] )	c[j] += Aj[-i]*x[i];
+		}
+	    }
+	}
+	return;
+}
+
+
+/*
+ * LDL_REDUCE_PM_SKY
+ * The forward column-wise reduction of [A_qq] by ldl_dcmp_pm_sky(), from
+ * column j0 on.  Columns 1 to j0-1 of [A] and of {d} are already reduced,
+ * so after a change to the terms of [A] in columns j0 to n only those 
+ * columns are reduced again.  *pd is the number of negative terms of D.
+ * Returns 0 if a zero is found on the diagonal of D, 1 otherwise.
+ */
+int ldl_reduce_pm_sky (
+	double *A, int *maxa, int n, double *d, int *q, int j0, int *pd
+){
+	double	*Aj, *Ai, s;
+	int	i, j, k, mi, mj, k0;
+
+	*pd = 0;
+	for (j=1; j < j0; j++)	if ( q[j] && d[j] < 0.0 ) (*pd)--;
+
+	for (j=j0; j<=n; j++) {
+
+		d[j] = 0.0;
+		if ( !q[j] ) continue;	/* columns of A_qr are not reduced */
+
+		Aj = A + maxa[j] + j;	/* Aj[-i] is A[i][j]	*/
+		mj = j - (maxa[j+1] - maxa[j]) + 1;	/* top of the sky-line */
+
+		for (i=mj; i < j; i++) {
+		    if ( q[i] ) {
+			Ai = A + maxa[i] + i;
+			mi = i - (maxa[i+1] - maxa[i]) + 1;
+			k0 = ( mi > mj ) ? mi : mj;
+			s = 0.0;
+			for (k=k0; k < i; k++)
+				if ( q[k] )	s += Aj[-k]*Ai[-k];
+			Aj[-i] -= s;
+		    }
+		}
+
+		d[j] = Aj[-j];
+		for (i=mj; i < j; i++) if ( q[i] ) d[j] -= Aj[-i]*Aj[-i]/d[i];
+		for (i=mj; i < j; i++) if ( q[i] ) Aj[-i] /= d[i];
+
+		if ( d[j] == 0.0 ) {
+		 fprintf(stderr," ldl_dcmp_pm_sky(): zero found on diagonal ...\n");
+		 fprintf(stderr," d[%d] = %11.4e\n", j, d[j] );
+		 return 0;
+		}
+		if ( d[j] < 0.0 ) (*pd)--;
+	}
+	return 1;
+}
+
+
+/*
+ * LDL_MPROVE_PM_SKY
+ * Improves a solution vector x[1..n] of the partitioned set of linear
+ * equations solved by ldl_dcmp_pm_sky(), as ldl_mprove_pm() does for [A]
+ * stored as a full matrix.  The residual is computed with the un-factored
+ * skyline matrix [K], and the correction is solved with its L D L'
+ * decomposition, [A] and {d}, as returned by ldl_dcmp_pm_sky().
+ * On output, only {x} and {c} are modified to an improved set of values.
+ *
+ * usage: double *K, *A, *d, *b, *x, *c, rms_resid;
+ * 	int   *maxa, n, ok, *q, *r;
+ *	ldl_mprove_pm_sky ( K, A, maxa, n, d, b, x, c, q, r, &rms_resid, &ok );
+ */
+void ldl_mprove_pm_sky (
+	double *K,	/**< the skyline matrix, not factored		*/
+	double *A,	/**< L D L' decomposition of K, ldl_dcmp_pm_sky()*/
+	int *maxa,	/**< index of each diagonal term of K and A	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	double *rms_resid, /**< root-mean-square of residual error	*/
+	int *ok		/**< 1: >10% reduction in rms_resid; 0: not	*/
+){
+	double  *dx,		// the residual error
+		*dc,		// update to partial r.h.s. vector, c
+		rms_resid_new=0.0; // the RMS error of the mprvd solution
+	int	i, pd;
+
+	dx  = dvector(1,n);
+	dc  = dvector(1,n);
+
+	// calculate the r.h.s. of ...
+	//  [A_qq]{dx_q} = {b_q} - [A_qq]*{x_q} - [A_qr]*{x_r}
+	//  {dx_r} is left unchanged at 0.0;
+	prodAx_sky ( K, maxa, n, x, dx );
+	for (i=1;i<=n;i++) {
+		if ( q[i] )	dx[i] = b[i] - dx[i];
+		else		dx[i] = 0.0;
+	}
+
+	// solve for the residual error term, A is already factored
+	ldl_dcmp_pm_sky ( A, maxa, n, d, dx, dx, dc, q,r, 0, 1, &pd );
+
+	for (i=1;i<=n;i++) if ( q[i] )	rms_resid_new += dx[i]*dx[i];
+
+	rms_resid_new = sqrt ( rms_resid_new / (double) n );
+
+	*ok = 0;
+	if ( rms_resid_new / *rms_resid < 0.90 ) { /*  enough improvement    */
+		for (i=1;i<=n;i++) {	/*  update the solution */
+		    	if ( q[i] )	x[i] += dx[i];
+			if ( r[i] )	c[i] += dc[i];
+		}
+		*rms_resid = rms_resid_new;	/* return the new residual   */
+		*ok = 1;			/* the solution has improved */
+	}
+
+	free_dvector(dx,1,n);
+	free_dvector(dc,1,n);
+	return;
+}
+
+/*
+ * LDL_SOLVE_PM_SKY_BLOCK
+ * The back substitution of ldl_dcmp_pm_sky() for nb right hand sides at
+ * once.  Row i of B[1..n][1..nb], X and C holds term i of each of them, so
+ * each term of the decomposition [A] is loaded once for all nb solutions,
+ * and the inner loops run along the rows of the panels.  The terms of
+ * each solution are computed in the order of ldl_dcmp_pm_sky(), so the
+ * solutions are the same.  X may be B.
+ *
+ * usage: double *A, *d, **B, **X, **C;
+ *	int   *maxa, n, nb, *q, *r;
+ *	ldl_solve_pm_sky_block ( A, maxa, n, d, B, X, C, nb, q, r );
+ */
+void ldl_solve_pm_sky_block (
+	double *A, int *maxa, int n, double *d,
+	double **B, double **X, double **C, int nb, int *q, int *r
+){
+	double	*Aj, a, *xi, *xj, *ci, *cj;
+	int	i, j, k, mj;
+
+	/*  {x_q} = {b_q} - [A_qr]{x_r}, sweeping the columns of [A]  */
+	for (i=1; i <= n; i++)
+		if ( q[i] )	for (k=1; k <= nb; k++)	X[i][k] = B[i][k];
+	for (j=1; j <= n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		xj = X[j];
+		for (i=mj; i < j; i++) {
+			a = Aj[-i];	xi = X[i];
+			if ( q[i] && r[j] )
+				for (k=1; k <= nb; k++)	xi[k] -= a*xj[k];
+			if ( r[i] && q[j] )
+				for (k=1; k <= nb; k++)	xj[k] -= a*xi[k];
+		}
+	}
+
+	/* {x} is run through the same forward reduction as was [A] */
+	for (j=1; j <= n; j++) {
+		if ( !q[j] )	continue;
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		xj = X[j];
+		for (i=mj; i < j; i++) {
+			if ( !q[i] )	continue;
+			a = Aj[-i];	xi = X[i];
+			for (k=1; k <= nb; k++)	xj[k] -= a*xi[k];
+		}
+	}
+
+	for (i=1; i <= n; i++)
+		if ( q[i] )	for (k=1; k <= nb; k++)	X[i][k] /= d[i];
+
+	/* back substitution on {x};  [A] is preserved */
+	for (j=n; j > 1; j--) {
+		if ( !q[j] )	continue;
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		xj = X[j];
+		for (i=mj; i < j; i++) {
+			if ( !q[i] )	continue;
+			a = Aj[-i];	xi = X[i];
+			for (k=1; k <= nb; k++)	xi[k] -= a*xj[k];
+		}
+	}
+
+	/* finally, evaluate c_r = [A_rq]{x_q} + [A_rr]{x_r} - {b_r} */
+	for (i=1; i <= n; i++) {
+		for (k=1; k <= nb; k++)	C[i][k] = 0.0;
+		if ( r[i] )
+			for (k=1; k <= nb; k++)
+				C[i][k] = A[maxa[i]]*X[i][k] - B[i][k];
+	}
+	for (j=1; j <= n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		xj = X[j];	cj = C[j];
+		for (i=mj; i < j; i++) {
+			a = Aj[-i];	xi = X[i];	ci = C[i];
+			if ( r[i] )	for (k=1; k <= nb; k++)	ci[k] += a*xj[k];
+			if ( r[j] )	for (k=1; k <= nb; k++)	cj[k] += a*xi[k];
+		}
+	}
+}
+
+
+/*
+ * LDL_MPROVE_PM_SKY_BLOCK
+ * One refinement of each of the nb solutions of ldl_solve_pm_sky_block(),
+ * as ldl_mprove_pm_sky() does for one solution, with the residuals
+ * computed by prodAX_sky() and solved by ldl_solve_pm_sky_block() for all
+ * of them at once.  Only the solutions with ok[k] = 1 on input are
+ * improved;  ok[k] is set to 0 if solution k did not improve by 10%.
+ * Returns the number of solutions improved.
+ *
+ * usage: double *K, *A, *d, **B, **X, **C, *rms_resid;
+ * 	int   *maxa, n, nb, *ok, *q, *r, more;
+ *	more = ldl_mprove_pm_sky_block ( K, A, maxa, n, d, B, X, C, nb, q, r,
+ *						rms_resid, ok );
+ */
+int ldl_mprove_pm_sky_block (
+	double *K, double *A, int *maxa, int n, double *d,
+	double **B, double **X, double **C, int nb, int *q, int *r,
+	double *rms_resid, int *ok
+){
+	double	**dX,		// the residual errors
+		**dC,		// updates to the partial r.h.s. vectors, C
+		*rms;		// the RMS error of each improved solution
+	int	i, k, more = 0;
+
+	dX  = dmatrix(1,n,1,nb);
+	dC  = dmatrix(1,n,1,nb);
+	rms = dvector(1,nb);
+
+	prodAX_sky ( K, maxa, n, X, dX, nb );
+	for (i=1; i <= n; i++)
+		for (k=1; k <= nb; k++)
+			dX[i][k] = q[i] ? B[i][k] - dX[i][k] : 0.0;
+
+	ldl_solve_pm_sky_block ( A, maxa, n, d, dX, dX, dC, nb, q, r );
+
+	for (k=1; k <= nb; k++)	rms[k] = 0.0;
+	for (i=1; i <= n; i++)
+		if ( q[i] )	for (k=1; k <= nb; k++)	rms[k] += dX[i][k]*dX[i][k];
+
+	for (k=1; k <= nb; k++) {
+		rms[k] = sqrt ( rms[k] / (double) n );
+		if ( ok[k] && rms[k] / rms_resid[k] < 0.90 ) {	/* improved */
+			for (i=1; i <= n; i++) {
+				if ( q[i] )	X[i][k] += dX[i][k];
+				if ( r[i] )	C[i][k] += dC[i][k];
+			}
+			rms_resid[k] = rms[k];
+			++more;
+		} else	ok[k] = 0;
+	}
+
+	free_dmatrix(dX,1,n,1,nb);
+	free_dmatrix(dC,1,n,1,nb);
+	free_dvector(rms,1,nb);
+
+	return more;
+}
+
+
+/*
+ * LDL_DCMP_SKY_F
+ * single-precision L D L' decomposition of a symmetric matrix [A] stored in
+ * skyline form, as in ldl_dcmp_pm_sky(), but without partitions;  
+ * [A] is replaced by the upper triangle L' of its L D L' decomposition, 
+ * with half the memory of the double-precision decomposition.  
+ * *pd is the number of negative terms of D, or -(n+1) if one is zero.
+ * The inner products have no branches, so they may be vectorized.
+ *
+ * Bathe, Finite Element Procecures in Engineering Analysis, Prentice Hall, 1982
+ */
+void ldl_dcmp_sky_f ( float *A, int *maxa, int n, float *d, int *pd )
+{
+	float	*Aj, *Ai, s;
+	int	i, j, k, mi, mj, k0;
+
+	*pd = 0;	/* number of negative elements on the diagonal of D */
+
+	for (j=1; j<=n; j++) {
+
+		Aj = A + maxa[j] + j;	/* Aj[-i] is A[i][j]	*/
+		mj = j - (maxa[j+1] - maxa[j]) + 1;	/* top of the sky-line */
+
+		for (i=mj; i < j; i++) {
+			Ai = A + maxa[i] + i;
+			mi = i - (maxa[i+1] - maxa[i]) + 1;
+			k0 = ( mi > mj ) ? mi : mj;
+			s = 0.0f;
+			for (k=k0; k < i; k++)	s += Aj[-k]*Ai[-k];
+			Aj[-i] -= s;
+		}
+
+		d[j] = Aj[-j];
+		for (i=mj; i < j; i++) {
+			s = Aj[-i] / d[i];
+			d[j] -= Aj[-i]*s;
+			Aj[-i] = s;
+		}
+
+		if ( d[j] == 0.0f ) {
+			*pd = -(n+1);
+			return;
+		}
+		if ( d[j] < 0.0f ) (*pd)--;
+	}
+	return;
+}
+
+
+/*
+ * LDL_SOLVE_SKY_F
+ * solve [A]{x} = {b} in place, {x} = {b} on input, with the single-precision
+ * L D L' decomposition of [A] from ldl_dcmp_sky_f().  
+ * The solution is accumulated in double precision.
+ */
+void ldl_solve_sky_f ( float *A, int *maxa, int n, float *d, double *x )
+{
+	float	*Aj;
+	double	s;
+	int	i, j, mj;
+
+	for (j=1; j <= n; j++) {	/* forward reduction	*/
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		s = 0.0;
+		for (i=mj; i < j; i++)	s += Aj[-i]*x[i];
+		x[j] -= s;
+	}
+
+	for (i=1; i <= n; i++)	x[i] /= d[i];
+
+	for (j=n; j > 1; j--) {		/* back substitution	*/
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		for (i=mj; i < j; i++)	x[i] -= Aj[-i]*x[j];
+	}
+	return;
+}
+
+
+/*
+ * PRODAX_SKY  -  matrix-vector multiplication  {y} = [A]{x}
+ * for a symmetric matrix [A] stored in skyline form, as in ldl_dcmp_pm_sky()
+ */
+void prodAx_sky ( double *A, int *maxa, int n, double *x, double *y )
+{
+	double	*Aj, yj;
+	int	i, j, mj;
+
+	for (j=1; j<=n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		yj = Aj[-j]*x[j];
+		for (i=mj; i < j; i++) {
+			yj   += Aj[-i]*x[i];	/* upper triangle, column j */
+			y[i] += Aj[-i]*x[j];	/* lower triangle, row j    */
+		}
+		y[j] = yj;
+	}
+	return;
+}
+
+
+/*
+ * PRODAX_SKY  -  matrix-matrix multiplication  [Y] = [A][X]  for nb vectors,
+ * the rows of X[1..n][1..nb] and Y, as prodAx_sky() for each of them
+ */
+void prodAX_sky ( double *A, int *maxa, int n, double **X, double **Y, int nb )
+{
+	double	*Aj, a, *xi, *xj, *yi, *yj;
+	int	i, j, k, mj;
+
+	for (j=1; j<=n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		xj = X[j];	yj = Y[j];
+		for (k=1; k<=nb; k++)	yj[k] = Aj[-j]*xj[k];
+		for (i=mj; i < j; i++) {
+			a = Aj[-i];	xi = X[i];	yi = Y[i];
+			for (k=1; k<=nb; k++) {
+				yj[k] += a*xi[k];	/* upper triangle, column j */
+				yi[k] += a*xj[k];	/* lower triangle, row j    */
+			}
+		}
+	}
+	return;
+}
+
+
+/*
+ * SKY_TO_DMATRIX  -  expand a symmetric skyline matrix, as stored for
+ * ldl_dcmp_pm_sky(), into a full matrix  B[1..n][1..n]
+ * row and column i of B is row and column p[i] of A,  or i if p is NULL
+ */
+void sky_to_dmatrix ( double *A, int *maxa, int n, int *p, double **B )
+{
+	double	*Aj;
+	int	*ip, i, j, mj;
+
+	ip = ivector(1,n);	/* row of B for each row of A */
+	for (i=1; i<=n; i++)	ip[ (p) ? p[i] : i ] = i;
+
+	for (i=1; i<=n; i++)	for (j=1; j<=n; j++)	B[i][j] = 0.0;
+
+	for (j=1; j<=n; j++) {
+		Aj = A + maxa[j] + j;
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		for (i=mj; i <= j; i++)
+			B[ip[i]][ip[j]] = B[ip[j]][ip[i]] = Aj[-i];
+	}
+
+	free_ivector(ip,1,n);
+	return;
+}
+
+
 /*
  * PSB_UPDATE
  * Update secant stiffness matrix via the Powell-Symmetric-Broyden update eqn.
@@ -675,6 +1188,32 @@ void prodABj ( double **A, double **B, double *u, int n, int j )
 }
 
 
+/*
+ * PRODAX  -  matrix-matrix multiplication  [Y] = [A][X]  for symmetric A,
+ * for the nb vectors in the rows of X[1..n][1..nb], in one pass over the
+ * upper triangle of A, with the terms of each element in the order of
+ * prodABj()
+ */
+void prodAX ( double **A, double **X, double **Y, int n, int nb )
+{
+	double	a, *Ai, *xi, *xj, *yi, *yj;
+	int	i, j, k;
+
+	for (i=1; i<=n; i++)	for (k=1; k<=nb; k++)	Y[i][k] = 0.0;
+
+	for (i=1; i<=n; i++) {
+		Ai = A[i];	xi = X[i];	yi = Y[i];
+		for (j=i; j<=n; j++) {
+			a = Ai[j];	xj = X[j];	yj = Y[j];
+			for (k=1; k<=nb; k++)	yi[k] += a*xj[k];
+			if ( j > i )
+				for (k=1; k<=nb; k++)	yj[k] += a*xi[k];
+		}
+	}
+	return;
+}
+
+
 /* 
  * prodAB - matrix-matrix multiplication      C = A * B			27apr01
  */
@@ -837,6 +1376,55 @@ void xtAx(double **A, double **X, double **C, int N, int J)
 }
 
 
+/*
+ * XTAX_PAIR - the two products  CA = X' A X  for symmetric A  and  CB = X' BX
+ * for the product BX = B X of X with a symmetric B stored apart, as xtAx()
+ * computes each of them, in one pass over the upper triangle of A and over
+ * the rows of X
+ *	CA and CB are J by J      X and BX are N by J     A is N by N
+ */
+void xtAx_pair(
+	double **A, double **X, double **BX, double **CA, double **CB,
+	int N, int J
+){
+	double	**AX, a, *xi, *xk, *axi, *axk, *bxk;
+	int	i, j, k;
+
+	AX = dmatrix(1,N,1,J);
+
+	for (i=1; i<=J; i++)	for (j=1; j<=J; j++)	CA[i][j] = CB[i][j] = 0.0;
+	for (i=1; i<=N; i++)	for (j=1; j<=J; j++)	AX[i][j] = 0.0;
+
+	for (i=1; i<=N; i++) {	/*  use upper triangle of A */
+		xi = X[i];	axi = AX[i];
+		for (k=i; k<=N; k++) {
+			a = A[i][k];	xk = X[k];	axk = AX[k];
+			for (j=1; j<=J; j++)	axi[j] += a * xk[j];
+			if ( k > i )
+				for (j=1; j<=J; j++)	axk[j] += a * xi[j];
+		}
+	}
+
+	for (k=1; k<=N; k++) {
+		xk = X[k];	axk = AX[k];	bxk = BX[k];
+		for (i=1; i<=J; i++)
+			for (j=1; j<=J; j++) {
+				CA[i][j] += xk[i] * axk[j];
+				CB[i][j] += xk[i] * bxk[j];
+			}
+	}
+
+	for (i=1; i<=J; i++)	    /*  make  CA and CB  symmetric */
+		for (j=i; j<=J; j++) {
+			CA[i][j] = CA[j][i] = 0.5 * ( CA[i][j] + CA[j][i] );
+			CB[i][j] = CB[j][i] = 0.5 * ( CB[i][j] + CB[j][i] );
+		}
+
+	free_dmatrix(AX,1,N,1,J);
+	return;
+}
+
+
 /* 
  * xtAy - carry out vector-matrix-vector multiplication for symmetric A  7apr94
  */
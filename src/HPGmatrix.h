@@ -179,7 +179,172 @@ void ldl_mprove_pm (
         int *ok );      /**< 1: >10% reduction in rms_resid; 0: not     */
 
 
-/* 
+/*
+ * LDL_DCMP_PM_SKY  -  Solves the partitioned matrix equations of ldl_dcmp_pm
+ * where the symmetric matrix [A] is stored in skyline (active column) form.
+ * The upper triangle of column j, from the diagonal up to the first
+ * structurally non-zero term, is stored in A[maxa[j]] ... A[maxa[j+1]-1].
+ *	A[i][j] = A[ maxa[j] + j - i ]	for  j-i < maxa[j+1]-maxa[j]
+ * The terms of [A_qq] are replaced by the upper triangle L' of its
+ * L D L' reduction;  [A_qr] and [A_rr] are returned unchanged.
+ *
+ * usage: double *A, *d, *b, *x, *c;
+ *	int   *maxa, n, *q, *r, reduce, solve, pd;
+ *	ldl_dcmp_pm_sky ( A, maxa, n, d, b, x, c, q, r, reduce, solve, &pd );
+ */
+void ldl_dcmp_pm_sky (
+	double *A,	/**< the skyline matrix, and L' of the L D L' decomp.*/
+	int *maxa,	/**< index of each diagonal term of A, [1..n+1]	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	int reduce,	/**< 1: do a forward reduction of A; 0: don't   */
+	int solve,	/**< 1: do a back substitution for {x}; 0: don't */
+	int *pd );	/**< 1: definite matrix and successful L D L' decomp'n*/
+
+
+/*
+ * LDL_REDUCE_PM_SKY
+ * The L D L' reduction of [A_qq] by ldl_dcmp_pm_sky() from column j0 on,
+ * with columns 1 to j0-1 of [A] and {d} already reduced.
+ * Returns 0 if a zero is found on the diagonal of D.
+ */
+int ldl_reduce_pm_sky (
+	double *A,	/**< the skyline matrix, and L' of the L D L' decomp.*/
+	int *maxa,	/**< index of each diagonal term of A, [1..n+1]	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int j0,		/**< first column to be reduced			*/
+	int *pd );	/**< number of negative terms of D		*/
+
+
+/*
+ * LDL_MPROVE_PM_SKY
+ * Improves a solution vector x[1..n] of the partitioned set of linear
+ * equations solved by ldl_dcmp_pm_sky().  The residual is computed with
+ * the un-factored skyline matrix [K]; the correction is solved with its
+ * L D L' decomposition [A], {d}.  Only {x} and {c} are modified.
+ *
+ * usage: double *K, *A, *d, *b, *x, *c, rms_resid;
+ * 	int   *maxa, n, ok, *q, *r;
+ *	ldl_mprove_pm_sky ( K, A, maxa, n, d, b, x, c, q, r, &rms_resid, &ok );
+ */
+void ldl_mprove_pm_sky (
+	double *K,	/**< the skyline matrix, not factored		*/
+	double *A,	/**< L D L' decomposition of K, ldl_dcmp_pm_sky()*/
+	int *maxa,	/**< index of each diagonal term of K and A	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	double *rms_resid, /**< root-mean-square of residual error	*/
+	int *ok );	/**< 1: >10% reduction in rms_resid; 0: not	*/
+
+/*
+ * LDL_SOLVE_PM_SKY_BLOCK
+ * The back substitution of ldl_dcmp_pm_sky() for nb right hand sides at
+ * once, held in the rows of the panels B[1..n][1..nb], X and C, with the
+ * same solutions as ldl_dcmp_pm_sky() for each of them.  X may be B.
+ *
+ * usage: double *A, *d, **B, **X, **C;
+ *	int   *maxa, n, nb, *q, *r;
+ *	ldl_solve_pm_sky_block ( A, maxa, n, d, B, X, C, nb, q, r );
+ */
+void ldl_solve_pm_sky_block (
+	double *A,	/**< L D L' decomposition, from ldl_dcmp_pm_sky() */
+	int *maxa,	/**< index of each diagonal term of A, [1..n+1]	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double **B,	/**< the right hand sides, B[1..n][1..nb]	*/
+	double **X,	/**< parts of the solutions, X[1..n][1..nb]	*/
+	double **C,	/**< parts of the solutions in the rhs		*/
+	int nb,		/**< the number of right hand sides		*/
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r );	/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+
+/*
+ * LDL_MPROVE_PM_SKY_BLOCK
+ * One refinement of the solutions k of ldl_solve_pm_sky_block() with
+ * ok[k] = 1, as ldl_mprove_pm_sky() does for one solution;  ok[k] is set
+ * to 0 for each solution that did not improve.
+ * Returns the number of solutions improved.
+ *
+ * usage: double *K, *A, *d, **B, **X, **C, *rms_resid;
+ * 	int   *maxa, n, nb, *ok, *q, *r, more;
+ *	more = ldl_mprove_pm_sky_block ( K, A, maxa, n, d, B, X, C, nb, q, r,
+ *						rms_resid, ok );
+ */
+int ldl_mprove_pm_sky_block (
+	double *K,	/**< the skyline matrix, not factored		*/
+	double *A,	/**< L D L' decomposition of K, ldl_dcmp_pm_sky()*/
+	int *maxa,	/**< index of each diagonal term of K and A	*/
+	int n,		/**< the dimension of the matrix		*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double **B,	/**< the right hand sides, B[1..n][1..nb]	*/
+	double **X,	/**< parts of the solutions, X[1..n][1..nb]	*/
+	double **C,	/**< parts of the solutions in the rhs		*/
+	int nb,		/**< the number of right hand sides		*/
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	double *rms_resid, /**< root-mean-square of each residual error	*/
+	int *ok );	/**< 1: >10% reduction in rms_resid[k]; 0: not	*/
+
+/*
+ * LDL_DCMP_SKY_F
+ * single-precision L D L' decomposition of a symmetric positive-definite
+ * matrix [A] stored in skyline form, as in ldl_dcmp_pm_sky(), in place.  
+ * *pd is the number of negative terms of D, or -(n+1) if one is zero.
+ *
+ * usage: float *A, *d;  int *maxa, n, pd;
+ *	ldl_dcmp_sky_f ( A, maxa, n, d, &pd );
+ */
+void ldl_dcmp_sky_f (
+	float *A,	/**< the skyline matrix, and L' of the L D L' decomp.*/
+	int *maxa,	/**< index of each diagonal term of A, [1..n+1]	*/
+	int n,		/**< the dimension of the matrix		*/
+	float *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	int *pd );	/**< number of negative terms of D		*/
+
+/*
+ * LDL_SOLVE_SKY_F
+ * solve [A]{x} = {b} in place, {x} = {b} on input, with the single-precision
+ * L D L' decomposition from ldl_dcmp_sky_f();  {x} is in double precision.
+ */
+void ldl_solve_sky_f (
+	float *A,	/**< L D L' decomposition, from ldl_dcmp_sky_f() */
+	int *maxa,	/**< index of each diagonal term of A, [1..n+1]	*/
+	int n,		/**< the dimension of the matrix		*/
+	float *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *x );	/**< the right hand side, and the solution	*/
+
+/*
+ * PRODAX_SKY  -  matrix-vector multiplication  {y} = [A]{x}
+ * for a symmetric matrix [A] stored in skyline form
+ */
+void prodAx_sky ( double *A, int *maxa, int n, double *x, double *y );
+
+/*
+ * PRODAX_SKY  -  matrix-matrix multiplication  [Y] = [A][X]  for the nb 
+ * vectors in the rows of X[1..n][1..nb], with [A] in skyline form
+ */
+void prodAX_sky ( double *A, int *maxa, int n, double **X, double **Y, int nb );
+
+/*
+ * SKY_TO_DMATRIX  -  expand a symmetric skyline matrix into a full matrix
+ * row and column i of B is row and column p[i] of A,  or i if p is NULL
+ */
+void sky_to_dmatrix ( double *A, int *maxa, int n, int *p, double **B );
+
+
+/*
  * PSB_UPDATE
  * Update secant stiffness matrix via the Powell-Symmetric-Broyden update eqn.
  *
@@ -213,6 +378,12 @@ void pseudo_inv(
  */
 void prodABj ( double **A, double **B, double *u, int n, int j );
 
+/*
+ * PRODAX  -  matrix-matrix multiplication  [Y] = [A][X]  for symmetric A,
+ * for the nb vectors in the rows of X[1..n][1..nb], as prodABj() for each
+ */
+void prodAX ( double **A, double **X, double **Y, int n, int nb );
+
 /* 
  * prodAB - matrix-matrix multiplication      C = A * B                 27apr01
  */
@@ -240,6 +411,14 @@ void xtinvAy(
  */
 void xtAx(double **A, double **X, double **C, int N, int J);
 
+/*
+ * xtAx_pair - CA = X' A X  for symmetric A  and  CB = X' BX  for a given
+ *	BX = B X,  as xtAx() for each, in one pass over A and X
+ */
+void xtAx_pair(
+	double **A, double **X, double **BX, double **CA, double **CB,
+	int N, int J );
+
 /* 
  * xAy1 - carry out vector-matrix-vector multiplication for symmetric A  7apr94
  */
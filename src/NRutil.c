@@ -1065,3 +1065,43 @@ void save_ut_dmatrix ( char filename[], double **A, int n, const char *mode )
 	fclose ( fp_m);
 	return;
 }
+
+
+/*
+ * SAVE_UT_SKY  -
+ * save a symetric matrix of dimension [1..n][1..n] to the named file 
+ * the upper-triangular part is stored in skyline form,
+ * A[i][j] = A[maxa[j]+j-i] for j-i < maxa[j+1]-maxa[j]
+ * row and column i of the file is row and column p[i] of A, or i if p is NULL
+ */
+void save_ut_sky ( char filename[], double *A, int *maxa, int n, int *p, const char *mode )
+{
+	FILE    *fp_m;
+	int     i,j,k, ii,jj;
+	double	Aij;
+	time_t	now;
+
+	if ((fp_m = fopen (filename, mode)) == NULL) {
+		printf (" error: cannot open file: %s \n", filename );
+		exit(1016);
+	}
+        (void) time(&now);
+	fprintf(fp_m,"%% filename: %s - %s\n", filename, ctime(&now));
+	fprintf(fp_m,"%% type: matrix \n");
+	fprintf(fp_m,"%% rows: %d\n", n );
+	fprintf(fp_m,"%% columns: %d\n", n );
+	for (i=1; i <= n; i++) {
+	  for (j=1; j <= n; j++) {
+		ii = (p) ? p[i] : i;
+		jj = (p) ? p[j] : j;
+		if ( ii > jj ) { k = ii; ii = jj; jj = k; }
+		Aij = 0.0;
+		if ( jj-ii < maxa[jj+1]-maxa[jj] )	Aij = A[maxa[jj]+jj-ii];
+		if (fabs(Aij) > 1.e-99) fprintf(fp_m,"%21.12e", Aij );
+		else		        fprintf(fp_m,"    0                ");
+	  }
+	  fprintf(fp_m,"\n");
+	}
+	fclose ( fp_m);
+	return;
+}
@@ -105,6 +105,7 @@ void save_dmatrix ( char filename[], double **A, int ml, int mh, int nl, int nh,
 
 void save_ut_matrix ( char filename[], float **A, int n, const char *mode );
 void save_ut_dmatrix ( char filename[], double **A, int n, const char *mode );
+void save_ut_sky ( char filename[], double *A, int *maxa, int n, int *p, const char *mode );
 
 
 
@@ -124,41 +124,74 @@ void coord_trans(
 }
 
 
+/* -------------------------------------------------------------------------
+ELEMENT_GEOMETRY - evaluate the coordinate transformation coefficients and
+the shear deformation coefficients of every frame element once, so that the
+trigonometric functions and square roots of coord_trans are not re-evaluated
+for every assembly, iteration, load case, and output file.  
+------------------------------------------------------------------------- */
+void element_geometry(
+		int nE, vec3 *xyz, double *L, double *Le,
+		int *N1, int *N2,
+		float *Asy, float *Asz, float *Iy, float *Iz,
+		float *E, float *G, float *p, int shear, elem_geom *eg
+){
+	elem_geom *g;
+	int	m;
+
+	for (m=1; m <= nE; m++) {
+		g = &eg[m];
+		coord_trans ( xyz, L[m], N1[m], N2[m],
+			&g->t1, &g->t2, &g->t3, &g->t4, &g->t5, &g->t6,
+			&g->t7, &g->t8, &g->t9, p[m] );
+		if ( shear ) {
+			g->Ksy = 12.*E[m]*Iz[m] / (G[m]*Asy[m]*Le[m]*Le[m]);
+			g->Ksz = 12.*E[m]*Iy[m] / (G[m]*Asz[m]*Le[m]*Le[m]);
+		} else	g->Ksy = g->Ksz = 0.0;
+	}
+}
+
+
+/* -------------------------------------------------------------------------
+GET_COORD_TRANS - the coordinate transformation coefficients of one frame
+element, from element_geometry
+------------------------------------------------------------------------- */
+void get_coord_trans(
+		elem_geom *g,
+		double *t1, double *t2, double *t3, double *t4, double *t5,
+		double *t6, double *t7, double *t8, double *t9
+){
+	*t1 = g->t1;	*t2 = g->t2;	*t3 = g->t3;
+	*t4 = g->t4;	*t5 = g->t5;	*t6 = g->t6;
+	*t7 = g->t7;	*t8 = g->t8;	*t9 = g->t9;
+}
+
+
 /* ------------------------------------------------------------------------------
  * ATMA  -  perform the coordinate transformation from local to global     6jan96
  *	  include effects of a finite node radii, r1 and r2.	    9dec04
+ *	  The 12-by-12 transformation is block-diagonal, with four copies of the
+ *	  3-by-3 direction cosine matrix [t], so each 3-by-3 block [m_IJ] of [m]
+ *	  is transformed in place to [t]'[m_IJ][t].
  *	  ------------------------------------------------------------------------------*/
 void atma(
 	double t1, double t2, double t3,
 	double t4, double t5, double t6,
 	double t7, double t8, double t9,
-	double **m, float r1, float r2
+	double **m
 ){
-	double  **a, **ma, **dmatrix();
-	int     i,j,k;
-
-	a  = dmatrix(1,12,1,12);
-	ma = dmatrix(1,12,1,12);
-
-	for (i=1; i<=12; i++)
-	    for (j=i; j<=12; j++) 
-		ma[j][i] = ma[i][j] = a[j][i] = a[i][j] = 0.0;
-
-	for (i=0; i<=3; i++) {
-		a[3*i+1][3*i+1] = t1;
-		a[3*i+1][3*i+2] = t2;
-		a[3*i+1][3*i+3] = t3;
-		a[3*i+2][3*i+1] = t4;
-		a[3*i+2][3*i+2] = t5;
-		a[3*i+2][3*i+3] = t6;
-		a[3*i+3][3*i+1] = t7;
-		a[3*i+3][3*i+2] = t8;
-		a[3*i+3][3*i+3] = t9;
-	}
+	double	t[3][3],	/* direction cosines			*/
+		mt[3][3];	/* [m_IJ][t]				*/
+	int	I, J, i, j;
 
+	t[0][0] = t1;	t[0][1] = t2;	t[0][2] = t3;
+	t[1][0] = t4;	t[1][1] = t5;	t[1][2] = t6;
+	t[2][0] = t7;	t[2][1] = t8;	t[2][2] = t9;
 
 /*  effect of finite node radius on coordinate transformation  ... */
-/*  this needs work ... */
+/*  this needs work ... the node radii r1 and r2 are not passed in;  */
+/*  with these terms [a] is no longer block-diagonal, and the offsets
+    would be applied to the 3-by-3 blocks of [m] below   */
 /*
  	a[5][1] =  r1*t7; 
   	a[5][2] =  r1*t8; 
@@ -175,28 +208,63 @@ void atma(
   	a[12][9] =  r2*t6; 
 */
 
+	for (I=0; I < 12; I += 3) {
+	    for (J=0; J < 12; J += 3) {
+		for (i=0; i < 3; i++)		/*  MT = M T     */
+		    for (j=0; j < 3; j++)
+			mt[i][j] = m[I+i+1][J+1]*t[0][j] +
+				   m[I+i+1][J+2]*t[1][j] +
+				   m[I+i+1][J+3]*t[2][j];
+		for (i=0; i < 3; i++)		/*  T'MT = T' MT */
+		    for (j=0; j < 3; j++)
+			m[I+i+1][J+j+1] = t[0][i]*mt[0][j] +
+					  t[1][i]*mt[1][j] +
+					  t[2][i]*mt[2][j];
+	    }
+	}
+
 #ifdef MATRIX_DEBUG
-	save_dmatrix( "aa", a, 1,12, 1,12, 0, "w");	 /*  save cord xfmtn */
+	save_dmatrix( "atma", m, 1,12, 1,12, 0, "w");	       /*  debug atma */
 #endif
+}
 
-	for (j=1; j <= 12; j++)			 /*  MT = M T     */
-	    for (i=1; i <= 12; i++)
-		for (k=1; k <= 12; k++)    ma[i][j] += m[i][k] * a[k][j];
 
-#ifdef MATRIX_DEBUG
-	save_dmatrix( "ma", ma, 1,12, 1,12, 0, "w");	/*  partial transformation */
-#endif
+/* ------------------------------------------------------------------------------
+ * ROTATE_TO_GLOBAL  -  add the end forces {q} of a frame element in local 
+ *	  coordinates, transformed to global coordinates, to {f}.
+ *	  {f} += [T]'{q}, for 12-vectors {q} and {f}, indexed 1 to 12. 
+ *	  ------------------------------------------------------------------------------*/
+void rotate_to_global(
+	double t1, double t2, double t3,
+	double t4, double t5, double t6,
+	double t7, double t8, double t9,
+	double *q, double *f
+){
+	int	i;
 
-	for (i=1; i<=12; i++)   for (j=i; j<=12; j++)   m[j][i] = m[i][j] = 0.0;
+	for (i=1; i <= 12; i += 3) {
+		f[i]   += q[i]*t1 + q[i+1]*t4 + q[i+2]*t7;
+		f[i+1] += q[i]*t2 + q[i+1]*t5 + q[i+2]*t8;
+		f[i+2] += q[i]*t3 + q[i+1]*t6 + q[i+2]*t9;
+	}
+}
 
-	for (j=1; j <= 12; j++)			 /*  T'MT = T' MT */
-	    for (i=1; i <= 12; i++)
-		for (k=1; k <= 12; k++)    m[i][j] += a[k][i] * ma[k][j];
 
-#ifdef MATRIX_DEBUG
-	save_dmatrix( "atma", m, 1,12, 1,12, 0, "w");	       /*  debug atma */
-#endif
+/* ------------------------------------------------------------------------------
+ * ROTATE_TO_LOCAL  -  transform the 12 end forces or displacements {f} of a 
+ *	  frame element from global to local coordinates, {q} = [T]{f}. 
+ *	  ------------------------------------------------------------------------------*/
+void rotate_to_local(
+	double t1, double t2, double t3,
+	double t4, double t5, double t6,
+	double t7, double t8, double t9,
+	double *f, double *q
+){
+	int	i;
 
-	free_dmatrix(a, 1,12,1,12);
-	free_dmatrix(ma,1,12,1,12);
+	for (i=1; i <= 12; i += 3) {
+		q[i]   = f[i]*t1 + f[i+1]*t2 + f[i+2]*t3;
+		q[i+1] = f[i]*t4 + f[i+1]*t5 + f[i+2]*t6;
+		q[i+2] = f[i]*t7 + f[i+1]*t8 + f[i+2]*t9;
+	}
 }
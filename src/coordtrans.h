@@ -32,6 +32,19 @@
 #include "HPGutil.h" 
 
 
+/**
+	geometry of a frame element that does not change during the analysis,
+	evaluated once for each element by element_geometry()
+*/
+typedef struct {
+	double	t1, t2, t3,	/**< coordinate transformation coefficients */
+		t4, t5, t6,	/**< from coord_trans()			*/
+		t7, t8, t9;
+	double	Ksy, Ksz;	/**< shear deformation coefficients, 0 if
+				     shear deformation is neglected	*/
+} elem_geom;
+
+
 /**
 	COORD_TRANS -  evaluate the 3D coordinate transformation coefficients 1dec04
 	Default order of coordinate rotations...  typical for Y as the vertical axis
@@ -56,14 +69,64 @@ void coord_trans (
 	float p				// the roll angle (radians) 
 );
 
+/**
+	ELEMENT_GEOMETRY - evaluate the coordinate transformation and shear
+	deformation coefficients of every frame element, eg[1..nE]
+*/
+void element_geometry (
+	int nE,				// number of frame elements
+	vec3 *xyz,			// XYZ coordinate of all nodes
+	double *L, double *Le,		// length of each element, effective
+	int *N1, int *N2,		// node connectivity
+	float *Asy, float *Asz,		// shear areas
+	float *Iy, float *Iz,		// bending moments of inertia
+	float *E, float *G,		// elastic and shear moduli
+	float *p,			// the roll angle (radians)
+	int shear,			// 1: include shear deformation
+	elem_geom *eg			// the element geometry, [1..nE]
+);
+
+/**
+	GET_COORD_TRANS - the coordinate transformation coefficients of
+	one frame element, as from coord_trans(), from its element_geometry()
+*/
+void get_coord_trans (
+	elem_geom *g,
+	double *t1, double *t2, double *t3, double *t4, double *t5, 
+	double *t6, double *t7, double *t8, double *t9
+);
+
 /**  
-  ATMA - carry out the coordinate transformation
+  ATMA - carry out the coordinate transformation, [m] = [T]'[m][T],
+  one 3-by-3 block at a time
 */
 void atma (
         double t1, double t2, double t3,
         double t4, double t5, double t6,
         double t7, double t8, double t9,
-        double **m, float r1, float r2
+        double **m
+);
+
+/**  
+  ROTATE_TO_GLOBAL - add element end forces in local coordinates, {q},
+  to end forces in global coordinates, {f} += [T]'{q}
+*/
+void rotate_to_global (
+        double t1, double t2, double t3,
+        double t4, double t5, double t6,
+        double t7, double t8, double t9,
+        double *q, double *f	// 12-vectors, indexed 1 to 12
+);
+
+/**  
+  ROTATE_TO_LOCAL - element end forces or displacements in global 
+  coordinates, {f}, to local coordinates, {q} = [T]{f}
+*/
+void rotate_to_local (
+        double t1, double t2, double t3,
+        double t4, double t5, double t6,
+        double t7, double t8, double t9,
+        double *f, double *q	// 12-vectors, indexed 1 to 12
 );
 
 #endif /* FRAME_COORDTRANS_H */
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 
 #include "eig.h"
+#include "frame3dd.h"
 #include "common.h" 
 #include "HPGmatrix.h"
 #include "HPGutil.h"
@@ -49,7 +50,29 @@ static void rotate ( double **A, int n,double alpha, double beta, int i,int j);
 
 void eigsort ( double *e, double **v, int n, int m);
 
-int sturm ( double **K, double **M, int n, int m, double shift, double ws, int verbose );
+int sturm ( stiffness_matrix *K, mass_matrix *M, int n, int m, double shift, double *w, double ws, int nthreads, int verbose );
+
+static int stiffness_loc ( stiffness_matrix *K, int i, int j );
+
+static void stiffness_add_mass ( stiffness_matrix *K, double *A, mass_matrix *M, double a );
+
+static void stiffness_prodAx ( stiffness_matrix *K, double *x, double *y, int n );
+
+static double stiffness_xtAx ( stiffness_matrix *K, double *x, int n );
+
+static void stiffness_factor ( stiffness_matrix *K, double *A, int n, double *d, int *pd );
+
+static void stiffness_solve ( stiffness_matrix *K, double *A, double *d, int n, double *b, double *x );
+
+static void random_vector ( double *x, int n, unsigned long *seed );
+
+static void m_orthogonalize ( double *x, double **Q, double **MQ, int k, int n, double *c );
+
+static int m_orthonormalize ( mass_matrix *M, double **Q, double **MQ, int d, int k, int n, double *c2, double **R, unsigned long *seed );
+
+static void tred2 ( double **A, int n, double *d, double *e );
+
+static void tqli ( double *d, double *e, int n, double **Z );
 
 /*-----------------------------------------------------------------------------
 SUBSPACE - Find the lowest m eigen-values, w, and eigen-vectors, V, of the 
@@ -59,26 +82,36 @@ where
   M is an n by n  symmetric positive definate real (mass) matrix
   w is a diagonal matrix of eigen-values
   V is a  rectangular matrix of eigen-vectors
+K is in skyline form, or in the columns of the sparse L D L' decomposition
+K->S.  K + shift M is decomposed by factor_system() and the m iterates are 
+solved together by solve_factored_block(), so no full matrix is formed.
 
  H.P. Gavin, Civil Engineering, Duke University, hpgavin@duke.edu  1 March 2007
  Bathe, Finite Element Procecures in Engineering Analysis, Prentice Hall, 1982
 -----------------------------------------------------------------------------*/
 void subspace(
-	double **K, double **M,
+	stiffness_matrix *K, mass_matrix *M,
 	int n, int m,	/**< DoF and number of required modes	*/
 	double *w, double **V,
 	double tol, double shift,
 	int *iter,	/**< sub-space iterations		*/
 	int *ok,	/**< Sturm check result			*/
+	int nthreads,	/**< threads of the Sturm check		*/
 	int verbose
 ){
-	double	**Kb, **Mb, **Xb, **Qb, *d, *u, *v, km, km_old,
+	ldl_factor *KF;		/* L D L' decomposition of K + shift M	*/
+	double	**Kb, **Mb, **Qb, *d, *rms, km, km_old,
+		**X,		/* the iterates, X[k][1..n]		*/
+		**MX,		/* M X[k], the right hand sides		*/
+		**KX,		/* (K + shift M) X[k], or the reactions	*/
+		**R, *c2,	/* for the M-orthonormal basis of X	*/
 		error=1.0, w_old = 0.0;
+	unsigned long seed = 1;
 
 	int	i=0, j=0, k=0,
 		modes,
 		disp = 0,	/* display convergence info.	*/
-		*idx;
+		*idx, *q, okb;
 	char	errMsg[MAXL];
 	
 	if ( m > n ) {
@@ -88,13 +121,17 @@ void subspace(
 	}
 
 	d  = dvector(1,n);
-	u  = dvector(1,n);
-	v  = dvector(1,n);
 	Kb = dmatrix(1,m,1,m);
 	Mb = dmatrix(1,m,1,m);
-	Xb = dmatrix(1,n,1,m);
 	Qb = dmatrix(1,m,1,m);
+	X  = dmatrix(1,m,1,n);
+	MX = dmatrix(1,m,1,n);
+	KX = dmatrix(1,m,1,n);
+	R  = dmatrix(1,m,1,m);
+	c2 = dvector(1,m);
+	rms = dvector(1,m);
 	idx = ivector(1,m);
+	q   = ivector(1,n);
 
 	for (i=1; i<=m; i++) {
 	 idx[i] = 0;
@@ -102,25 +139,27 @@ void subspace(
 	  Kb[i][j]=Kb[j][i] = Mb[i][j]=Mb[j][i] = Qb[i][j]=Qb[j][i] = 0.0;
 	}
 
-	for (i=1; i<=n; i++) for (j=1; j<=m; j++) Xb[i][j] = V[i][j] = 0.0;
+	for (i=1; i<=n; i++) for (j=1; j<=m; j++) V[i][j] = 0.0;
 
 	modes = (int) ( (double)(0.5*m) > (double)(m-8.0) ? (int)(m/2.0) : m-8 );
 
 					/* shift eigen-values by this much */
-	for (i=1;i<=n;i++) for (j=i;j<=n;j++) K[i][j] += shift*M[i][j];
-
-
-	ldl_dcmp ( K, n, u, v, v, 1, 0, ok );	/* use L D L' decomp  */
+	stiffness_add_mass ( K, K->K, M, shift );
 
 	for (i=1; i<=n; i++) {
-		if ( M[i][i] <= 0.0 )  {
-		 sprintf(errMsg," subspace: M[%d][%d] = %e \n", i,i, M[i][i] );
+		if ( M->val[M->dg[i]] <= 0.0 )  {
+		 sprintf(errMsg," subspace: M[%d][%d] = %e \n", i,i, M->val[M->dg[i]] );
 		 errorMsg(errMsg);
 		 exit(32);
 		}
-		d[i] = K[i][i] / M[i][i];
+		d[i] = K->K[stiffness_loc(K,i,i)] / M->val[M->dg[i]];
+		q[i] = !K->r[i];
 	}
 
+					/* use L D L' decomp  */
+	KF = factor_system ( K->K, K->maxa, K->dof, K->S, NULL, n, q, K->r, ok );
+	KF->indefinite = 1;
+
 	km_old = 0.0;
 	for (k=1; k<=m; k++) {
 	    km = d[1];
@@ -164,28 +203,45 @@ void subspace(
 	*iter = 0;
 	do { 					/* Begin sub-space iterations */
 
-		for (k=1; k<=m; k++) {		/* K Xb = M V	(12.10) */
-			prodABj ( M, V, v, n, k );
-			ldl_dcmp ( K, n, u, v, d, 0, 1, ok ); /* LDL bk-sub */
-
-                                        /* improve the solution iteratively */
-			if (disp) fprintf(stdout,"  RMS matrix error:");
-			error = *ok = 1;
-			do {
-				ldl_mprove ( K, n, u, v, d, &error, ok );
-				if (disp) fprintf(stdout,"%9.2e", error );
-			} while ( *ok );
-			if (disp) fprintf(stdout,"\n");
-
-			for (i=1; i<=n; i++)	Xb[i][k] = d[i];
+				/* K X = M V (12.10), all m at once, refined */
+		for (k=1; k<=m; k++) {
+			for (i=1; i<=n; i++)	KX[k][i] = V[i][k];
+			mass_prodAx ( M, KX[k], MX[k] );
+			for (i=1; i<=n; i++)	/* the reaction coordinates */
+				X[k][i] = K->r[i] ? MX[k][i] /
+					K->K[stiffness_loc(K,i,i)] : 0.0;
+		}
+		solve_factored_block ( KF, K->K, X, MX, KX, m, NULL,
+						q, K->r, &okb, rms );
+		if (disp) fprintf(stdout,"  RMS matrix error: %9.2e\n", rms[1]);
+
+		/* M-orthonormalize X, whose vectors all lean toward the
+		 * lowest modes, so that Mb is not singular to round-off   */
+		for (k=1; k<=m; k++)	c2[k] = 0.0;
+		m_orthonormalize ( M, X, MX, 0, m, n, c2, R, &seed );
+
+				/* Kb = X K X' (12.11), Mb = X M X' (12.12) */
+		for (k=1; k<=m; k++)
+			stiffness_prodAx ( K, X[k], KX[k], n );
+		for (i=1; i<=m; i++) {
+			for (j=i; j<=m; j++) {
+				Kb[i][j] = Mb[i][j] = 0.0;
+				for (k=1; k<=n; k++) {
+					Kb[i][j] += X[i][k] * KX[j][k];
+					Mb[i][j] += X[i][k] * MX[j][k];
+				}
+				Kb[j][i] = Kb[i][j];
+				Mb[j][i] = Mb[i][j];
+			}
 		}
-
-		xtAx ( K, Xb, Kb, n,m );	/* Kb = Xb' K Xb (12.11) */
-		xtAx ( M, Xb, Mb, n,m );	/* Mb = Xb' M Xb (12.12) */
 
 		jacobi ( Kb, Mb, w, Qb, m );		/* (12.13) */
 
-		prodAB ( Xb, Qb, V, n,m,m );		/* V = Xb Qb (12.14) */
+		for (i=1; i<=n; i++)			/* V = X' Qb (12.14) */
+			for (j=1; j<=m; j++) {
+				V[i][j] = 0.0;
+				for (k=1; k<=m; k++)	V[i][j] += X[k][i] * Qb[k][j];
+			}
 
 		eigsort ( w, V, n, m );
 
@@ -222,14 +278,23 @@ void subspace(
 				k, idx[k], sqrt(w[k])/(2.0*PI) );
 	}
 
-	*ok = sturm ( K, M, n, m, shift, w[modes]+tol, verbose ); 
+	free_factor ( KF );
+	*ok = sturm ( K, M, n, m, shift, w, w[modes]+tol, nthreads, verbose ); 
 
-	for (i=1;i<=n;i++) for (j=i;j<=n;j++) K[i][j] -= shift*M[i][j];
+	stiffness_add_mass ( K, K->K, M, -shift );
 
+	free_dvector(d,1,n);
 	free_dmatrix(Kb,1,m,1,m);
 	free_dmatrix(Mb,1,m,1,m);
-	free_dmatrix(Xb,1,n,1,m);
 	free_dmatrix(Qb,1,m,1,m);
+	free_dmatrix(X,1,m,1,n);
+	free_dmatrix(MX,1,m,1,n);
+	free_dmatrix(KX,1,m,1,n);
+	free_dmatrix(R,1,m,1,m);
+	free_dvector(c2,1,m);
+	free_dvector(rms,1,m);
+	free_ivector(idx,1,m);
+	free_ivector(q,1,n);
 
 	return;
 }
@@ -357,125 +422,112 @@ void rotate ( double **A, int n, double alpha, double beta, int i, int j )
 STODOLA  -  calculate the lowest m eigen-values and eigen-vectors of the
 generalized eigen-problem, K v = w M v, using a matrix iteration approach
 with shifting. 								15oct98
+The dynamics matrix D = K^(-1) M is applied to each trial vector as it is
+needed, by a product with M and a solution with the L D L' decomposition
+of K, and the modes already found are purged from each iterate by 
+Gram-Schmidt orthogonalization.  K is in skyline form, or in the columns
+of the sparse L D L' decomposition K->S, and only K + shift M is
+decomposed, in a skyline copy or in K->S, so no full matrix is formed.
+K + shift M is left in K.
 
  H.P. Gavin, Civil Engineering, Duke University, hpgavin@duke.edu  12 Jul 2001
 ------------------------------------------------------------------------------*/
 void stodola (
-	double **K, double **M, /* stiffness and mass matrices */
+	stiffness_matrix *K, mass_matrix *M, /* stiffness and mass matrices */
 	int n, int m, /* DoF and number of required modes	*/
 	double *w, double **V, double tol, double shift, int *iter, int *ok, 
-	int verbose
+	int nthreads, int verbose
 ){
-	double	**D,		/* the dynamics matrix, D = K^(-1) M	*/
-		d_min = 0.0,	/* minimum value of D[i][i]		*/
-		d_max = 0.0,	/* maximum value of D[i][i]		*/
-		d_old = 0.0,	/* previous extreme value of D[i][i]	*/
-		*d,		/* columns of the D, M, and V matrices	*/
+	double	*Dii,		/* M[i][i]/K[i][i], estimates of D[i][i] */
+		*Kf,		/* L D L' decomposition of the skyline K */
+		*dk,		/* diagonal of the L D L' decomposition	*/
+		*d,		/* columns of the M and V matrices	*/
+		*Mu,		/* M u, the right hand side for D u	*/
 		*u, *v,		/* trial eigen-vector vectors		*/
 		*c,		/* coefficients for lower mode purge	*/
 		vMv,		/* factor for mass normalization	*/
-		RQ, RQold=0.0,	/* Raliegh quotient			*/
-		error = 1.0;
+		RQ, RQold=0.0;	/* Raliegh quotient			*/
 
-	int	i_ex = 9999, /* location of minimum value of D[i][i]	*/
+	int	i_ex = 1,	/* location of maximum value of Dii[i]	*/
+		*used,		/* 1: DoF already used for a trial vector */
 		modes,		/* number of desired modes		*/
-		disp = 0,	/* 1: display convergence error; 0: dont*/
 		i,j,k;
 
 	char	errMsg[MAXL];
 
-	D  = dmatrix(1,n,1,n);
+	Dii = dvector(1,n);
+	dk = dvector(1,n);
 	d  = dvector(1,n);
+	Mu = dvector(1,n);
 	u  = dvector(1,n);
 	v  = dvector(1,n);
 	c  = dvector(1,m);
+	used = ivector(1,n);
 
 	modes = (int) ( (double)(0.5*m) > (double)(m-8) ? (int)(m/2.0) : m-8 );
 
 					/* shift eigen-values by this much */
-	for (i=1;i<=n;i++) for (j=i;j<=n;j++) K[i][j] += shift*M[i][j];
+	stiffness_add_mass ( K, K->K, M, shift );
 
-	ldl_dcmp ( K, n, u, v, v, 1, 0, ok );	/* use L D L' decomp	*/
+	Kf = K->S ? NULL : dvector(1,K->nK);	/* use L D L' decomp	*/
+	if ( Kf )	for (i=1; i<=K->nK; i++)	Kf[i] = K->K[i];
+	stiffness_factor ( K, Kf ? Kf : K->K, n, dk, ok );
 	if (*ok<0) {
 		sprintf(errMsg," Make sure that all six rigid body translation are restrained.\n");
 		errorMsg(errMsg);
 		exit(32); 
 	}
-						/* calculate  D = K^(-1) M */
-	for (j=1; j<=n; j++) {
-		for (i=1; i<=n; i++)	v[i] = M[i][j];
-
-		ldl_dcmp ( K, n, u, v, d, 0, 1, ok );	/* L D L' bk-sub */
-
-					/* improve the solution iteratively */
-		if (disp) fprintf(stdout,"  RMS matrix error:");
-		error = *ok = 1;
-		do {
-			ldl_mprove ( K, n, u, v, d, &error, ok );
-			if (disp) fprintf(stdout,"%9.2e", error );
-		} while ( *ok );
-		if (disp) fprintf(stdout,"\n");
-
-		for (i=1; i<=n; i++)	D[i][j] = d[i];
-	}
-
-#ifdef EIG_DEBUG
-	save_dmatrix ( "D", D, 1,n, 1,n, 0, "w" ); /* save dynamics matrix */
-#endif
+			/* estimate the diagonal of D = K^(-1) M, for trial vectors */
+	for (i=1; i<=n; i++)
+		Dii[i] = M->val[M->dg[i]] / K->K[stiffness_loc(K,i,i)];
 
 	*iter = 0;
-	for (i=1; i<=n; i++) if ( D[i][i] > d_max )	d_max = D[i][i];
-	d_old = d_min = d_max;
-	for (i=1; i<=n; i++) if ( D[i][i] < d_min )	d_min = D[i][i];
+	for (i=1; i<=n; i++)	used[i] = 0;
 
 	for (k=1; k<=m; k++) {			/* loop over lowest m modes */
 
-	    d_max = d_min;
-	    for (i=1; i<=n; i++) {			/* initial guess */
+	    i_ex = 0;			/* initial guess at the largest unused */
+	    for (i=1; i<=n; i++) {		/* estimate of D[i][i]  */
 		u[i] = 0.0;
-		if ( D[i][i] < d_old && D[i][i] > d_max ) {
-			d_max = D[i][i];
+		if ( !used[i] && ( i_ex == 0 || Dii[i] > Dii[i_ex] ) )
 			i_ex = i;
-		}
 	    }
-	    u[i_ex] = 1.0;  u[i_ex+1] = 1.e-4; 
-	    d_old = d_max;
+	    used[i_ex] = 1;
+	    u[i_ex] = 1.0;  u[ i_ex < n ? i_ex+1 : i_ex-1 ] = 1.e-4; 
 
-	    vMv = xtAy ( u, M, u, n, d );		/* mass-normalize */
+	    vMv = mass_xtAy ( u, M, u, d );		/* mass-normalize */
 	    for (i=1; i<=n; i++)	u[i] /= sqrt ( vMv ); 
 
 	    for (j=1; j<k; j++) {			/* purge lower modes */
 		for (i=1; i<=n; i++)	v[i] = V[i][j];
-		c[j] = xtAy ( v, M, u, n, d );
+		c[j] = mass_xtAy ( v, M, u, d );
 	    }
 	    for (j=1; j<k; j++)
 		for (i=1; i<=n; i++)	u[i] -= c[j] * V[i][j];
 			
-	    vMv = xtAy ( u, M, u, n, d );		/* mass-normalize */
+	    vMv = mass_xtAy ( u, M, u, d );		/* mass-normalize */
 	    for (i=1; i<=n; i++)	u[i] /= sqrt ( vMv ); 
-	    RQ  = xtAy ( u, K, u, n, d );		/* Raleigh quotient */
+	    RQ  = stiffness_xtAx ( K, u, n );		/* Raleigh quotient */
 
 	    do {					/* iterate	*/
-		for (i=1; i<=n; i++) {			/* v = D u	*/
-			v[i] = 0.0;
-			for (j=1; j<=n; j++)	v[i] += D[i][j] * u[j];
-		}
+		mass_prodAx ( M, u, Mu );		/* v = D u	*/
+		stiffness_solve ( K, Kf ? Kf : K->K, dk, n, Mu, v );
 
-		vMv = xtAy ( v, M, v, n, d );		/* mass-normalize */
+		vMv = mass_xtAy ( v, M, v, d );		/* mass-normalize */
 		for (i=1; i<=n; i++)	v[i] /= sqrt ( vMv ); 
 
 		for (j=1; j<k; j++) {			/* purge lower modes */
 			for (i=1; i<=n; i++)	u[i] = V[i][j];
-			c[j] = xtAy ( u, M, v, n, d );
+			c[j] = mass_xtAy ( u, M, v, d );
 		}
 		for (j=1; j<k; j++)
 			for (i=1; i<=n; i++)	v[i] -= c[j] * V[i][j];
 
-		vMv = xtAy ( v, M, v,  n, d );		/* mass-normalize */
+		vMv = mass_xtAy ( v, M, v, d );		/* mass-normalize */
 		for (i=1; i<=n; i++)	u[i] = v[i] / sqrt ( vMv ); 
 
 		RQold = RQ;
-		RQ = xtAy ( u, K, u, n, d );		/* Raleigh quotient */
+		RQ = stiffness_xtAx ( K, u, n );	/* Raleigh quotient */
 		(*iter)++;
 
 		if ( *iter > 1000 ) {
@@ -488,7 +540,7 @@ void stodola (
 
 	    for (i=1; i<=n; i++)	V[i][k] = v[i];
 
-	    w[k] = xtAy ( u, K, u, n, d );
+	    w[k] = stiffness_xtAx ( K, u, n );
 	    if ( w[k] > shift )	w[k] = w[k] - shift;
 	    else		w[k] = shift - w[k];
 
@@ -499,22 +551,592 @@ void stodola (
 
 	eigsort ( w, V, n, m );
 
-	*ok = sturm ( K, M, n, m, shift, w[modes]+tol, verbose );
+	if ( Kf )	free_dvector(Kf,1,K->nK);
+	*ok = sturm ( K, M, n, m, shift, w, w[modes]+tol, nthreads, verbose );
 
 #ifdef EIG_DEBUG
 	save_dmatrix ( "V", V, 1,n, 1,m, 0, "w" ); /* save mode shape matrix */
 #endif
 
-	free_dmatrix(D,1,n,1,n);
+	free_dvector(Dii,1,n);
+	free_dvector(dk,1,n);
 	free_dvector(d,1,n);
+	free_dvector(Mu,1,n);
 	free_dvector(u,1,n);
 	free_dvector(v,1,n);
 	free_dvector(c,1,m);
+	free_ivector(used,1,n);
+
+	return;
+}
+
+
+/*-----------------------------------------------------------------------------
+LANCZOS - Find the lowest m eigen-values, w, and eigen-vectors, V, of the 
+general eigen-problem  K V = w M V  by shift-invert block Lanczos iteration.
+The Lanczos vectors are M-orthonormal blocks of the Krylov subspace of
+(K + shift M)^-1 M, from the L D L' decomposition of K + shift M, each
+re-orthogonalized against all of the earlier ones.  The eigen-values of
+(K + shift M)^-1 M are approximated by those of the block tridiagonal 
+projection  T = Q' M (K + shift M)^-1 M Q,  and the iterations stop when 
+the residual of each of the lowest modes is within tol of its eigen-value.
+The mode shapes are mass-normalized, as those of subspace(), and the number
+of eigen-values below the highest is checked with sturm().  K is in skyline
+form, or in the columns of the sparse L D L' decomposition K->S, and only 
+K + shift M is decomposed, in a skyline copy or in K->S, as in stodola().
+  K is an n by n  symmetric real (stiffness) matrix
+  M is an n by n  symmetric positive definate real (mass) matrix
+  w is a diagonal matrix of eigen-values
+  V is a  rectangular matrix of eigen-vectors
+
+ Grimes, Lewis and Simon, A shifted block Lanczos algorithm for solving
+ sparse symmetric generalized eigenproblems, SIAM J. Matrix Anal. Appl.
+ 15(1):228-272, 1994
+-----------------------------------------------------------------------------*/
+void lanczos(
+	stiffness_matrix *K, mass_matrix *M,
+	int n, int m,	/**< DoF and number of required modes	*/
+	double *w, double **V,
+	double tol, double shift,
+	int *iter,	/**< block Lanczos steps		*/
+	int *ok,	/**< Sturm check result			*/
+	int nthreads,	/**< threads of the Sturm check		*/
+	int verbose
+){
+	double	**Q,		/* the Lanczos vectors, Q[k][1..n]	*/
+		**MQ,		/* the products M Q[k]			*/
+		**T,		/* the projection Q' M (K+shift M)^-1 M Q */
+		**Z,		/* the eigen-vectors of T		*/
+		**R,		/* coupling of the next block to the last */
+		*theta,		/* the eigen-values of T		*/
+		*Kf,		/* L D L' decomposition of the skyline K */
+		*dk,		/* diagonal of the L D L' decomposition	*/
+		*e, *c,
+		*c2,		/* squared M-norms of the removed components */
+		s, beta, error = 1.0;
+	int	p,		/* the number of vectors in a block	*/
+		nb,		/* the number of vectors in the next block */
+		dmax,		/* the largest number of Lanczos vectors */
+		d = 0,		/* the number of Lanczos vectors	*/
+		k0,		/* the Lanczos vectors before the last block */
+		d_check,	/* the number of vectors at the next check */
+		converged = 0, modes, i, a, b, k;
+	unsigned long seed = 1;
+	char	errMsg[MAXL];
+
+	if ( m > n ) {
+		sprintf(errMsg,"lanczos: Number of eigen-values must be less than the problem dimension.\n Desired number of eigen-values=%d \n Dimension of the problem= %d \n", m, n);
+		errorMsg(errMsg);
+		exit(32);
+	}
+
+	p    = ( m < LANCZOS_BLOCK ) ? m : LANCZOS_BLOCK;
+	dmax = lanczos_dim ( n, m );
+
+	Q  = dmatrix(1,dmax+p,1,n);
+	MQ = dmatrix(1,dmax+p,1,n);
+	T  = dmatrix(1,dmax+p,1,dmax+p);
+	Z  = dmatrix(1,dmax,1,dmax);
+	R  = dmatrix(1,p,1,p);
+	theta = dvector(1,dmax);
+	e  = dvector(1,dmax);
+	dk = dvector(1,n);
+	c  = dvector(1,dmax+p);
+	c2 = dvector(1,p);
+
+	for (a=1; a<=dmax+p; a++) for (b=1; b<=dmax+p; b++) T[a][b] = 0.0;
+
+	modes = (int) ( (double)(0.5*m) > (double)(m-8.0) ? (int)(m/2.0) : m-8 );
+
+					/* shift eigen-values by this much */
+	stiffness_add_mass ( K, K->K, M, shift );
+
+	Kf = K->S ? NULL : dvector(1,K->nK);	/* use L D L' decomp	*/
+	if ( Kf )	for (i=1; i<=K->nK; i++)	Kf[i] = K->K[i];
+	stiffness_factor ( K, Kf ? Kf : K->K, n, dk, ok );
+	if (*ok<0) {
+		sprintf(errMsg," Make sure that all six rigid body translation are restrained.\n");
+		errorMsg(errMsg);
+		exit(32); 
+	}
+
+	/* the first block, (K + shift M)^-1 M of p pseudo-random vectors */
+	for (a=1; a<=p; a++) {
+		random_vector ( Q[a], n, &seed );
+		mass_prodAx ( M, Q[a], MQ[a] );
+		stiffness_solve ( K, Kf ? Kf : K->K, dk, n, MQ[a], Q[a] );
+		c2[a] = 0.0;
+	}
+	nb = m_orthonormalize ( M, Q, MQ, 0, p, n, c2, R, &seed );
+
+	*iter = 0;
+	d_check = m;
+	do {					/* Begin block Lanczos steps */
+
+		k0 = d;			/* the last block is Q[k0+1 .. d] */
+		d += nb;
+
+		/* the next block, (K + shift M)^-1 M Q[k0+a] */
+		for (a=1; a<=nb; a++)
+			stiffness_solve ( K, Kf ? Kf : K->K, dk, n,
+							MQ[k0+a], Q[d+a] );
+
+		/* orthogonalize it against all of the Lanczos vectors ... */
+		for (a=1; a<=nb; a++) {
+			m_orthogonalize ( Q[d+a], Q, MQ, d, n, c );
+			for (b=1; b<=nb; b++)	T[k0+b][k0+a] = c[k0+b];
+			for (c2[a]=0.0, i=1; i<=d; i++)	c2[a] += c[i]*c[i];
+		}
+		for (a=1; a<=nb; a++)		/* the symmetric block of T */
+			for (b=a+1; b<=nb; b++)
+				T[k0+a][k0+b] = T[k0+b][k0+a] = 
+				    0.5 * ( T[k0+a][k0+b] + T[k0+b][k0+a] );
+
+		/* ... and within itself, for the coupling R of the blocks */
+		k  = nb;
+		nb = m_orthonormalize ( M, Q, MQ, d, k, n, c2, R, &seed );
+		for (a=1; a<=k; a++)
+			for (b=1; b<=nb; b++)
+				T[d+b][k0+a] = T[k0+a][d+b] = R[b][a];
+
+		(*iter)++;
+
+		if ( d < d_check && nb > 0 && d+nb <= dmax )	continue;
+
+		/* eigen-values and eigen-vectors of T, in descending order */
+		for (a=1; a<=d; a++) for (b=1; b<=d; b++) Z[a][b] = T[a][b];
+		tred2 ( Z, d, theta, e );
+		tqli ( theta, e, d, Z );
+		for (a=1; a<=d; a++)	theta[a] = -theta[a];
+		eigsort ( theta, Z, d, d );
+		for (a=1; a<=d; a++)	theta[a] = -theta[a];
+
+		/* the residual of each of the lowest modes */
+		error = 0.0;
+		for (i=1; i<=modes && i<=d; i++) {
+			beta = 0.0;
+			for (b=1; b<=nb; b++) {
+				s = 0.0;
+				for (a=1; a<=k; a++)	s += R[b][a] * Z[k0+a][i];
+				beta += s*s;
+			}
+			beta = sqrt(beta) / fabs(theta[i]);
+			if ( beta > error )	error = beta;
+		}
+		converged = ( d >= m && ( error <= tol || nb == 0 ) );
+
+		if ( !converged && d+nb > dmax ) {
+		    sprintf(errMsg,"  lanczos: Lanczos vector limit %d exceeded\n rel. error = %e > %e\n", dmax, error, tol );
+		    errorMsg(errMsg);
+		    exit(32);
+		}
+		d_check = d + ( d/8 > p ? d/8 : p );
+
+	} while ( !converged );			/* End   block Lanczos steps */
+
+	for (k=1; k<=m; k++) {		/* Ritz vectors, V = Q' Z */
+		for (i=1; i<=n; i++)	V[i][k] = 0.0;
+		for (a=1; a<=d; a++) {
+			s = Z[a][k];
+			for (i=1; i<=n; i++)	V[i][k] += Q[a][i] * s;
+		}
+		w[k] = 1.0 / theta[k];
+	}
+
+	for (k=1; k<=m; k++) {			/* shift eigen-values */
+	    if ( w[k] > shift )	w[k] = w[k] - shift;
+	    else		w[k] = shift - w[k];
+	}
+
+	eigsort ( w, V, n, m );
+
+	if ( verbose ) {
+		fprintf(stdout," %4d block Lanczos steps, %d vectors,   error: %.4e \n", *iter, d, error );
+		for ( k=1; k<=m; k++ ) 
+			fprintf(stdout,"  mode: %2d\t %9.4lf Hz\n",
+				k, sqrt(w[k])/(2.0*PI) );
+	}
+
+	if ( Kf )	free_dvector(Kf,1,K->nK);
+	*ok = sturm ( K, M, n, m, shift, w, w[modes]+tol, nthreads, verbose ); 
+
+	stiffness_add_mass ( K, K->K, M, -shift );
+
+	free_dmatrix(Q,1,dmax+p,1,n);
+	free_dmatrix(MQ,1,dmax+p,1,n);
+	free_dmatrix(T,1,dmax+p,1,dmax+p);
+	free_dmatrix(Z,1,dmax,1,dmax);
+	free_dmatrix(R,1,p,1,p);
+	free_dvector(theta,1,dmax);
+	free_dvector(e,1,dmax);
+	free_dvector(dk,1,n);
+	free_dvector(c,1,dmax+p);
+	free_dvector(c2,1,p);
 
 	return;
 }
 
 
+/*-----------------------------------------------------------------------------
+LANCZOS_DIM - the largest number of Lanczos vectors of lanczos() for the
+lowest m modes of an eigen-problem of dimension n
+-----------------------------------------------------------------------------*/
+int lanczos_dim ( int n, int m )
+{
+	int	d = ( 6*m > m + 12*LANCZOS_BLOCK ) ? 6*m : m + 12*LANCZOS_BLOCK;
+
+	return ( d < n ) ? d : n;
+}
+
+
+/*-----------------------------------------------------------------------------
+STIFFNESS_LOC - the location in K->K of the term i,j of the stiffness matrix,
+for the coordinates i and j, or 0 if it is not held
+-----------------------------------------------------------------------------*/
+static int stiffness_loc ( stiffness_matrix *K, int i, int j )
+{
+	int	ii = K->dof[i], jj = K->dof[j], t;
+
+	if ( ii > jj )	{ t = ii;  ii = jj;  jj = t; }
+	if ( K->S )	return sparse_K_loc ( K->S, ii, jj );
+	if ( jj-ii < K->maxa[jj+1]-K->maxa[jj] )	return K->maxa[jj] + jj - ii;
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------------
+STIFFNESS_ADD_MASS - add a M to A, which is held as K->K is;  the terms of M
+outside the skyline or sparse columns of K are not added
+-----------------------------------------------------------------------------*/
+static void stiffness_add_mass ( stiffness_matrix *K, double *A, mass_matrix *M, double a )
+{
+	int	i, k, l;
+
+	for (i=1; i<=M->n; i++)
+		for (k=M->dg[i]; k<M->rptr[i+1]; k++)
+			if ( (l = stiffness_loc ( K, i, M->col[k] )) )
+				A[l] += a*M->val[k];
+}
+
+
+/*-----------------------------------------------------------------------------
+STIFFNESS_PRODAX - the product {y} = K {x}, as prodAx() for a full matrix
+-----------------------------------------------------------------------------*/
+static void stiffness_prodAx ( stiffness_matrix *K, double *x, double *y, int n )
+{
+	double	*xk, *yk;
+	int	i;
+
+	xk = dvector(1,n);
+	yk = dvector(1,n);
+	for (i=1; i<=n; i++)	xk[K->dof[i]] = x[i];
+	if ( K->S )	sparse_prodAx ( K->S, K->K, xk, yk );
+	else		prodAx_sky ( K->K, K->maxa, n, xk, yk );
+	for (i=1; i<=n; i++)	y[i] = yk[K->dof[i]];
+	free_dvector(xk,1,n);
+	free_dvector(yk,1,n);
+}
+
+
+/*-----------------------------------------------------------------------------
+STIFFNESS_XTAX - the quadratic form {x}' K {x}, as xtAy() for a full matrix
+-----------------------------------------------------------------------------*/
+static double stiffness_xtAx ( stiffness_matrix *K, double *x, int n )
+{
+	double	*y, xtAx = 0.0;
+	int	i;
+
+	y = dvector(1,n);
+	stiffness_prodAx ( K, x, y, n );
+	for (i=1; i<=n; i++)	xtAx += x[i] * y[i];
+	free_dvector(y,1,n);
+	return xtAx;
+}
+
+
+/*-----------------------------------------------------------------------------
+STIFFNESS_FACTOR - L D L' decomposition of the free-coordinate partition of
+A, which is held as K->K is, in place in skyline form, or in the panels of
+K->S.  The reaction coordinates are not reduced.  *pd is minus the number of
+negative terms of D.
+-----------------------------------------------------------------------------*/
+static void stiffness_factor ( stiffness_matrix *K, double *A, int n, double *d, int *pd )
+{
+	int	*qk, i;
+
+	if ( K->S ) {
+		sparse_ldl_pm ( K->S, A, K->dof, NULL, NULL, NULL, K->r,
+								1, 0, pd );
+		return;
+	}
+	qk = ivector(1,n);
+	for (i=1; i<=n; i++)	qk[K->dof[i]] = !K->r[i];
+	ldl_reduce_pm_sky ( A, K->maxa, n, d, qk, 1, pd );
+	free_ivector(qk,1,n);
+}
+
+
+/*-----------------------------------------------------------------------------
+STIFFNESS_SOLVE - solve A {x} = {b} with the decomposition of A from
+stiffness_factor().  The reaction coordinates are solved with the diagonal
+of K->K, as the rest of their rows and columns are zero.
+-----------------------------------------------------------------------------*/
+static void stiffness_solve ( stiffness_matrix *K, double *A, double *d, int n, double *b, double *x )
+{
+	double	*bk, *xk, *ck;
+	int	*qk, *rk, *dof = K->dof, i, pd;
+
+	for (i=1; i<=n; i++)
+		x[i] = K->r[i] ? b[i] / K->K[stiffness_loc(K,i,i)] : 0.0;
+	ck = dvector(1,n);
+	if ( K->S ) {
+		sparse_ldl_pm ( K->S, A, dof, b, x, ck, K->r, 0, 1, &pd );
+		free_dvector(ck,1,n);
+		return;
+	}
+	bk = dvector(1,n);
+	xk = dvector(1,n);
+	qk = ivector(1,n);
+	rk = ivector(1,n);
+	for (i=1; i<=n; i++) {
+		bk[dof[i]] = b[i];	xk[dof[i]] = x[i];
+		qk[dof[i]] = !K->r[i];	rk[dof[i]] = K->r[i];
+	}
+	ldl_dcmp_pm_sky ( A, K->maxa, n, d, bk, xk, ck, qk, rk, 0, 1, &pd );
+	for (i=1; i<=n; i++)	if ( !K->r[i] )	x[i] = xk[dof[i]];
+	free_dvector(bk,1,n);
+	free_dvector(xk,1,n);
+	free_dvector(ck,1,n);
+	free_ivector(qk,1,n);
+	free_ivector(rk,1,n);
+}
+
+
+/*-----------------------------------------------------------------------------
+RANDOM_VECTOR - a vector of pseudo-random terms between -1/2 and 1/2,
+the same for the same seed
+-----------------------------------------------------------------------------*/
+static void random_vector ( double *x, int n, unsigned long *seed )
+{
+	int	i;
+
+	for (i=1; i<=n; i++) {
+		*seed = ( *seed * 1103515245UL + 12345UL ) & 0x7fffffffUL;
+		x[i] = (double)( *seed >> 16 ) / 32768.0 - 0.5;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------
+M_ORTHOGONALIZE - remove the components of {x} along the M-orthonormal 
+vectors Q[1..k] by modified Gram-Schmidt, twice, with MQ[j] = M Q[j];
+c[1..k] are the M-inner products removed
+-----------------------------------------------------------------------------*/
+static void m_orthogonalize (
+	double *x, double **Q, double **MQ, int k, int n, double *c
+){
+	double	s, *Qj, *MQj;
+	int	i, j, pass;
+
+	for (j=1; j<=k; j++)	c[j] = 0.0;
+	for (pass=1; pass<=2; pass++) {
+		for (j=1; j<=k; j++) {
+			Qj = Q[j];	MQj = MQ[j];
+			for (s=0.0, i=1; i<=n; i++)	s += MQj[i]*x[i];
+			for (i=1; i<=n; i++)		x[i] -= s*Qj[i];
+			c[j] += s;
+		}
+	}
+}
+
+
+/*-----------------------------------------------------------------------------
+M_ORTHONORMALIZE - M-orthonormalize the k vectors Q[d+1 .. d+k], which are
+M-orthogonal to Q[1..d], so that the input vectors are  Q[d+1 .. d+nq] R,
+with MQ[j] = M Q[j] for the new vectors.  c2[a] is the squared M-norm 
+of the components of vector a already removed.  A vector that is within
+round-off of the ones before it is replaced by a pseudo-random vector 
+M-orthogonal to all of them, with a zero in R.  
+Returns nq, less than k only if the vectors span the n dimensions.
+-----------------------------------------------------------------------------*/
+static int m_orthonormalize (
+	mass_matrix *M, double **Q, double **MQ, int d, int k, int n,
+	double *c2, double **R, unsigned long *seed
+){
+	double	*x, *c, ref, nrm;
+	int	a, b, i, nq = 0;
+
+	c = dvector(1,d+k);
+
+	for (a=1; a<=k; a++) for (b=1; b<=k; b++)	R[b][a] = 0.0;
+
+	for (a=1; a<=k; a++) {
+		x = Q[d+a];		/* within the new vectors, so far */
+		m_orthogonalize ( x, Q+d, MQ+d, nq, n, c );
+		ref = c2[a];
+		for (b=1; b<=nq; b++) {
+			R[b][a] = c[b];
+			ref += c[b]*c[b];
+		}
+		if ( d+nq == n )	continue;	/* the space is spanned */
+
+		mass_prodAx ( M, x, MQ[d+nq+1] );
+		for (nrm=0.0, i=1; i<=n; i++)	nrm += x[i]*MQ[d+nq+1][i];
+		nrm = sqrt ( nrm > 0.0 ? nrm : 0.0 );
+		ref = sqrt ( ref + nrm*nrm );
+
+		if ( nrm <= 1e-8 * ref ) {	/* a pseudo-random vector */
+			random_vector ( x, n, seed );
+			m_orthogonalize ( x, Q, MQ, d+nq, n, c );
+			mass_prodAx ( M, x, MQ[d+nq+1] );
+			for (nrm=0.0, i=1; i<=n; i++)	nrm += x[i]*MQ[d+nq+1][i];
+			nrm = sqrt ( nrm > 0.0 ? nrm : 0.0 );
+			R[nq+1][a] = 0.0;
+		} else	R[nq+1][a] = nrm;
+
+		++nq;
+		for (i=1; i<=n; i++) {
+			Q[d+nq][i]  = x[i] / nrm;
+			MQ[d+nq][i] /= nrm;
+		}
+	}
+
+	free_dvector(c,1,d+k);
+
+	return nq;
+}
+
+
+/*-----------------------------------------------------------------------------
+TRED2 - Householder reduction of a real symmetric matrix A[1..n][1..n] to
+tridiagonal form;  on output A is replaced by the orthogonal matrix of the
+transformation, d[1..n] holds the diagonal and e[2..n] the sub-diagonal of
+the tridiagonal matrix.
+Adapted from Numerical Recipes in C, Ch 11
+-----------------------------------------------------------------------------*/
+static void tred2 ( double **A, int n, double *d, double *e )
+{
+	double	scale, hh, h, g, f;
+	int	l, k, j, i;
+
+	for (i=n; i>=2; i--) {
+		l = i-1;
+		h = scale = 0.0;
+		if (l > 1) {
+			for (k=1; k<=l; k++)	scale += fabs(A[i][k]);
+			if (scale == 0.0)
+				e[i] = A[i][l];
+			else {
+				for (k=1; k<=l; k++) {
+					A[i][k] /= scale;
+					h += A[i][k]*A[i][k];
+				}
+				f = A[i][l];
+				g = ( f >= 0.0 ? -sqrt(h) : sqrt(h) );
+				e[i] = scale*g;
+				h -= f*g;
+				A[i][l] = f-g;
+				f = 0.0;
+				for (j=1; j<=l; j++) {
+					A[j][i] = A[i][j]/h;
+					g = 0.0;
+					for (k=1; k<=j; k++)	g += A[j][k]*A[i][k];
+					for (k=j+1; k<=l; k++)	g += A[k][j]*A[i][k];
+					e[j] = g/h;
+					f += e[j]*A[i][j];
+				}
+				hh = f/(h+h);
+				for (j=1; j<=l; j++) {
+					f = A[i][j];
+					e[j] = g = e[j] - hh*f;
+					for (k=1; k<=j; k++)
+						A[j][k] -= ( f*e[k] + g*A[i][k] );
+				}
+			}
+		} else
+			e[i] = A[i][l];
+		d[i] = h;
+	}
+	d[1] = 0.0;
+	e[1] = 0.0;
+	for (i=1; i<=n; i++) {
+		l = i-1;
+		if (d[i]) {
+			for (j=1; j<=l; j++) {
+				g = 0.0;
+				for (k=1; k<=l; k++)	g += A[i][k]*A[k][j];
+				for (k=1; k<=l; k++)	A[k][j] -= g*A[k][i];
+			}
+		}
+		d[i] = A[i][i];
+		A[i][i] = 1.0;
+		for (j=1; j<=l; j++)	A[j][i] = A[i][j] = 0.0;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------
+TQLI - eigen-values d[1..n] and eigen-vectors of a real symmetric tridiagonal
+matrix with diagonal d[1..n] and sub-diagonal e[2..n], by the QL algorithm
+with implicit shifts.  On input Z[1..n][1..n] is the matrix of tred2(), 
+and on output column k of Z is the eigen-vector of d[k].
+Adapted from Numerical Recipes in C, Ch 11
+-----------------------------------------------------------------------------*/
+static void tqli ( double *d, double *e, int n, double **Z )
+{
+	double	s, r, p, g, f, dd, c, b;
+	int	m, l, iter, i, k;
+
+	for (i=2; i<=n; i++)	e[i-1] = e[i];
+	e[n] = 0.0;
+	for (l=1; l<=n; l++) {
+		iter = 0;
+		do {
+			for (m=l; m<=n-1; m++) {
+				dd = fabs(d[m]) + fabs(d[m+1]);
+				if ( fabs(e[m]) + dd == dd )	break;
+			}
+			if (m != l) {
+				if ( iter++ == 60 ) {
+					errorMsg("  tqli: too many iterations\n");
+					exit(32);
+				}
+				g = (d[l+1]-d[l]) / (2.0*e[l]);
+				r = hypot(g,1.0);
+				g = d[m] - d[l] + e[l] / ( g + ( g >= 0.0 ? fabs(r) : -fabs(r) ) );
+				s = c = 1.0;
+				p = 0.0;
+				for (i=m-1; i>=l; i--) {
+					f = s*e[i];
+					b = c*e[i];
+					e[i+1] = ( r = hypot(f,g) );
+					if (r == 0.0) {
+						d[i+1] -= p;
+						e[m] = 0.0;
+						break;
+					}
+					s = f/r;
+					c = g/r;
+					g = d[i+1] - p;
+					r = (d[i]-g)*s + 2.0*c*b;
+					d[i+1] = g + ( p = s*r );
+					g = c*r - b;
+					for (k=1; k<=n; k++) {
+						f = Z[k][i+1];
+						Z[k][i+1] = s*Z[k][i] + c*f;
+						Z[k][i]   = c*Z[k][i] - s*f;
+					}
+				}
+				if (r == 0.0 && i >= l)	continue;
+				d[l] -= p;
+				e[l] = g;
+				e[m] = 0.0;
+			}
+		} while (m != l);
+	}
+}
+
+
 /*------------------------------------------------------------------------------
 EIGSORT  -  Given the eigenvallues e[1..m] and eigenvectors v[1..n][1..m],
 this routine sorts the eigenvalues into ascending order, and rearranges
@@ -555,43 +1177,99 @@ STURM  -  Determine the number of eigenvalues, w, of the general eigen-problem
   ws is the limit 
   n is the number of DoF 
   m is the number of required modes
+ K is in skyline or sparse form, and holds K + shift M.  The count is made
+ by sturm_count(), so K is not changed.  If modes are missing, the interval
+ between the modes found that holds the lowest missing one is located by
+ counting at the mid-point between each pair, with nthreads threads.
  
 
  H.P. Gavin, Civil Engineering, Duke University, hpgavin@duke.edu  30 Aug 2001
  Bathe, Finite Element Procecures in Engineering Analysis, Prentice Hall, 1982
 -----------------------------------------------------------------------------*/
 int sturm(
-	double **K, double **M, int n, int m,
-	double shift, double ws, int verbose
+	stiffness_matrix *K, mass_matrix *M, int n, int m,
+	double shift, double *w, double ws, int nthreads, int verbose
 ){
-	double	ws_shift, *d;
-	int	ok=0, i,j, modes;
+	double	ws1[2],		/* the limit, ws1[1] = ws		*/
+		*wm;		/* mid-points between the modes found	*/
+	int	count[2],	/* number of modes below ws		*/
+		*below,		/* number of modes below each mid-point	*/
+		modes, k;
 	
-	d  = dvector(1,n);
-
 	modes = (int) ( (float)(0.5*m) > (float)(m-8.0) ? (int)(m/2.0) : m-8 );
 
-	ws_shift = ws + shift;			/* shift [K]	*/
-	for (i=1; i<=n; i++) for (j=i; j<=n; j++) K[i][j] -= ws_shift*M[i][j];
-
-	ldl_dcmp ( K, n, d, d, d, 1, 0, &ok );
+	ws1[1] = ws;
+	sturm_count ( K, M, n, shift, ws1, 1, count, 1 );
 
 	if ( verbose )
-	 fprintf(stdout,"  There are %d modes below %f Hz.", -ok, sqrt(ws)/(2.0*PI) );
+	 fprintf(stdout,"  There are %d modes below %f Hz.", count[1], sqrt(ws)/(2.0*PI) );
+
+	if ( count[1] > modes ) {
+		fprintf(stderr," ... %d modes were not found.\n", count[1]-modes );
+
+		wm = dvector(1,modes);
+		below = ivector(1,modes);
+		for (k=1; k < modes; k++)	wm[k] = 0.5*(w[k]+w[k+1]);
+		sturm_count ( K, M, n, shift, wm, modes-1, below, nthreads );
+		for (k=1; k < modes && below[k] <= k; k++) ;
+		fprintf(stderr," The lowest one is between %f and %f Hz.\n",
+				k > 1 ? sqrt(wm[k-1])/(2.0*PI) : 0.0,
+				sqrt( k < modes ? wm[k] : ws )/(2.0*PI) );
+		free_dvector(wm,1,modes);
+		free_ivector(below,1,modes);
 
-	if ( -ok > modes ) {
-		fprintf(stderr," ... %d modes were not found.\n", -ok-modes );
 		fprintf(stderr," Try increasing the number of modes in \n");
 		fprintf(stderr," order to get the missing modes below %f Hz.\n",
 							sqrt(ws)/(2.0*PI) );
 	} else if ( verbose ) 
 		fprintf(stdout,"  All %d modes were found.\n",modes);
 
-	for (i=1; i<=n; i++) for (j=i; j<=n; j++) K[i][j] += ws_shift*M[i][j];
+	return -count[1];
+}
+
 
-	free_dvector(d,1,n);
+/*-----------------------------------------------------------------------------
+STURM_COUNT  -  the number of eigen-values of K V = w M V below each of the
+ns limits ws[1..ns], from the number of negative terms of D in the L D L' 
+decomposition of K - ws M.  K holds K + shift M, as in sturm().  K - ws M 
+is copied from K, in its own skyline or sparse form, and only that copy is
+reduced, by stiffness_factor(), so K is not changed.  With the skyline K 
+and nthreads > 1 the limits are counted in parallel, each thread with a 
+copy of its own;  the sparse decomposition is held in K->S, so with the 
+sparse K the limits are counted one at a time.
+-----------------------------------------------------------------------------*/
+void sturm_count(
+	stiffness_matrix *K, mass_matrix *M, int n, double shift,
+	double *ws, int ns, int *count, int nthreads
+){
+	double	*A,		/* K - ws M, reduced			*/
+		*d;		/* diagonal of D			*/
+	int	i, k, s, pd;
 
-	return ok;
+	if ( K->S )	nthreads = 1;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(ns > 1) private(A,d,i,k,s,pd)
+#endif
+	{
+	A = dvector(1,K->nK);
+	d = dvector(1,n);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	for (s=1; s <= ns; s++) {
+		for (k=1; k <= K->nK; k++)	A[k] = K->K[k];
+		stiffness_add_mass ( K, A, M, -(ws[s]+shift) );
+		stiffness_factor ( K, A, n, d, &pd );
+		count[s] = -pd;
+		for (i=1; i<=n; i++)	/* the reaction coordinates */
+			if ( K->r[i] && A[stiffness_loc(K,i,i)] < 0.0 )
+				count[s]++;
+	}
+
+	free_dvector(A,1,K->nK);
+	free_dvector(d,1,n);
+	}
 }
 
 
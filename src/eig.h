@@ -28,23 +28,45 @@
 #ifndef FRAME_EIG_H
 #define FRAME_EIG_H
 
+#include "mass.h"
+#include "sparse.h"
+
+/**
+	a stiffness matrix in skyline form, or in the columns of a sparse
+	L D L' decomposition, in the numbering of dof, for subspace(),
+	stodola() and lanczos().  The rows and columns of the reaction
+	coordinates are zero but for their diagonal terms.
+*/
+typedef struct {
+	double	*K;		/**< skyline or sparse stiffness matrix	*/
+	int	*maxa;		/**< location of diagonal terms in K	*/
+	sparse_ldl *S;		/**< columns of a sparse K, or NULL	*/
+	int	*dof;		/**< location of each coordinate in K	*/
+	int	*r;		/**< 1: a reaction coordinate		*/
+	int	nK;		/**< number of terms of K		*/
+} stiffness_matrix;
+
 /**
 	Find the lowest m eigenvalues, w, and eigenvectors, V, of the 
-	general eigenproblem, K V = w M V, using sub-space / Jacobi iteration.
+	general eigenproblem, K V = w M V, using sub-space / Jacobi iteration,
+	with the L D L' decomposition of K + shift M from factor_system().
 
-	@param K is an n by n  symmetric real (stiffness) matrix
-	@param M is an n by n  symmetric positive definate real (mass) matrix
+	@param K is an n by n  symmetric real (stiffness) matrix, in skyline
+		form or in the columns of a sparse L D L' decomposition
+	@param M is an n by n  symmetric positive definate real (mass) matrix,
+		in compact storage
 	@param w is a diagonal matrix of eigen-values
 	@param V is a  rectangular matrix of eigen-vectors
 */
 void subspace(
-	double **K, double **M,	/**< stiffness and mass matrices	*/
+	stiffness_matrix *K, mass_matrix *M, /**< stiffness and mass	*/
 	int n, int m,		/**< DoF and number of required modes	*/
 	double *w, double **V,	/**< modal frequencies and mode shapes	*/
 	double tol,		/**< covergence tolerence		*/
 	double shift,		/**< frequency shift for unrestrained frames */
 	int *iter,		/**< number of sub-space iterations	*/
 	int *ok,		/**< Sturm check result			*/
+	int nthreads,		/**< number of threads for the Sturm check */
 	int verbose		/**< 1: copious screen output, 0: none	*/
 );
 
@@ -58,21 +80,73 @@ void xtAx( double **A, double **X, double **C, int N, int J );
 /**
 	calculate the lowest m eigen-values and eigen-vectors of the
 	generalized eigen-problem, K v = w M v, using a matrix
-	iteration approach with shifting.
+	iteration approach with shifting, with the L D L' decomposition
+	of K in skyline form or of its sparse columns.  K + shift M is
+	left in K.
 
 	@param n number of degrees of freedom
 	@param m number of required modes
 */
 void stodola(
-	double **K, double **M,	/**< stiffness and mass matrices	*/
+	stiffness_matrix *K, mass_matrix *M, /**< stiffness and mass	*/
 	int n, int m,		/**< DoF and number of required modes	*/
 	double *w, double **V,	/**< modal frequencies and mode shapes	*/
 	double tol,		/**< covergence tolerence		*/
 	double shift,		/**< frequency shift for unrestrained frames */
 	int *iter,		/**< number of sub-space iterations	*/
 	int *ok,		/**< Sturm check result			*/
+	int nthreads,		/**< number of threads for the Sturm check */
 	int verbose		/**< 1: copious screen output, 0: none	*/
 );
 
+#define LANCZOS_BLOCK	6	/* vectors in a block of lanczos()	*/
+
+/**
+	Find the lowest m eigenvalues, w, and eigenvectors, V, of the
+	general eigenproblem, K V = w M V, by shift-invert block Lanczos 
+	iteration with full re-orthogonalization, with the L D L'
+	decomposition of K + shift M in skyline or sparse form.
+
+	@param K is an n by n  symmetric real (stiffness) matrix, in skyline
+		form or in the columns of a sparse L D L' decomposition
+	@param M is an n by n  symmetric positive definate real (mass) matrix,
+		in compact storage
+	@param w is a diagonal matrix of eigen-values
+	@param V is a  rectangular matrix of mass-normalized eigen-vectors
+*/
+void lanczos(
+	stiffness_matrix *K, mass_matrix *M, /**< stiffness and mass	*/
+	int n, int m,		/**< DoF and number of required modes	*/
+	double *w, double **V,	/**< modal frequencies and mode shapes	*/
+	double tol,		/**< covergence tolerence		*/
+	double shift,		/**< frequency shift for unrestrained frames */
+	int *iter,		/**< number of block Lanczos steps	*/
+	int *ok,		/**< Sturm check result			*/
+	int nthreads,		/**< number of threads for the Sturm check */
+	int verbose		/**< 1: copious screen output, 0: none	*/
+);
+
+/**
+	the number of eigen-values of K V = w M V below each of the limits
+	ws[1..ns], with K + shift M in K.  K is not changed;  K - ws M is
+	reduced in a skyline copy, one for each thread, or in a copy of the
+	sparse K, one limit at a time.
+*/
+void sturm_count(
+	stiffness_matrix *K, mass_matrix *M, /**< stiffness and mass	*/
+	int n,			/**< DoF				*/
+	double shift,		/**< shift of K, as in subspace()	*/
+	double *ws,		/**< the limits, ws[1..ns]		*/
+	int ns,			/**< the number of limits		*/
+	int *count,		/**< eigen-values below each limit	*/
+	int nthreads		/**< number of threads for the limits	*/
+);
+
+/** the largest number of Lanczos vectors of lanczos() */
+int lanczos_dim(
+	int n,			/**< dimension of the eigen-problem	*/
+	int m			/**< number of required modes		*/
+);
+
 #endif /* FRAME_EIG_H */
 
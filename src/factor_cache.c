@@ -0,0 +1,413 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//**
+	@file
+	Factor cache file: the stiffness matrix of a linear analysis and its
+	skyline or sparse L D L' decomposition.
+
+	The file is a header followed by arrays, each starting on an 8-byte
+	boundary:  dof, q, r, maxa, K, and then  Kf, diag  (skyline) or
+	kptr, krow, kmap, perm, first, sup, rptr, rows, lptr, L, d  (sparse),
+	with K held in the skyline or in the columns kptr, krow.  Coordinate
+	vectors are in the numbering of the input data, as in the program.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32) && !defined(DJGPP)
+#include <sys/mman.h>
+#endif
+
+#include "factor_cache.h"
+#include "common.h"
+#include "NRutil.h"
+
+#define FC_MAGIC	"F3DDLDL2"	/* identifies a factor cache file */
+#define FC_ALIGN(n)	( ( (n) + 7 ) & ~((size_t) 7) )
+
+/* header of a factor cache file */
+typedef struct {
+	char	magic[8];
+	uint64_t key;
+	int	layout;		/* sizes of int, long and double	*/
+	int	solver;		/* 1: skyline, 2: sparse L D L'		*/
+	int	DoF, nK;	/* number of coordinates, terms of K	*/
+	int	nq, ns;		/* rows of L and supernodes, sparse	*/
+	int	ok;		/* status of the L D L' decomposition	*/
+	int	pad;
+	unsigned long nrows, nL; /* row indices and terms of L, sparse	*/
+} fc_header;
+
+#define FC_LAYOUT (int) ( 100*sizeof(int) + 10*sizeof(long) + sizeof(double) )
+
+
+/* forward declarations */
+
+static void hash_bytes( uint64_t *h, const void *v, size_t n );
+static int  same_ints( int *a, int *b, int n );
+static void write_block( FILE *fp, const void *v, size_t n, int *ok );
+
+
+/*
+ * STIFFNESS_HASH - a 64-bit FNV-1a hash of the data that determine the
+ * stiffness matrix and its decomposition.  The arrays are indexed from 1.
+ */
+uint64_t stiffness_hash(
+	int nN, int nE, vec3 *xyz, float *rj, int *N1, int *N2,
+	float *Ax, float *Asy, float *Asz,
+	float *Jx, float *Iy, float *Iz,
+	float *E, float *G, float *p, int *r,
+	int shear, int geom, int solver
+){
+	uint64_t h = 14695981039346656037ULL;	/* FNV offset basis */
+	int	flags[5];
+
+	flags[0] = nN;	flags[1] = nE;
+	flags[2] = shear; flags[3] = geom; flags[4] = solver;
+	hash_bytes ( &h, flags, sizeof(flags) );
+
+	hash_bytes ( &h, xyz+1, nN*sizeof(vec3) );
+	hash_bytes ( &h, rj+1,  nN*sizeof(float) );
+	hash_bytes ( &h, r+1, 6*nN*sizeof(int) );
+	hash_bytes ( &h, N1+1,  nE*sizeof(int) );
+	hash_bytes ( &h, N2+1,  nE*sizeof(int) );
+	hash_bytes ( &h, Ax+1,  nE*sizeof(float) );
+	hash_bytes ( &h, Asy+1, nE*sizeof(float) );
+	hash_bytes ( &h, Asz+1, nE*sizeof(float) );
+	hash_bytes ( &h, Jx+1,  nE*sizeof(float) );
+	hash_bytes ( &h, Iy+1,  nE*sizeof(float) );
+	hash_bytes ( &h, Iz+1,  nE*sizeof(float) );
+	hash_bytes ( &h, E+1,   nE*sizeof(float) );
+	hash_bytes ( &h, G+1,   nE*sizeof(float) );
+	hash_bytes ( &h, p+1,   nE*sizeof(float) );
+
+	return h;
+}
+
+
+/*
+ * OPEN_FACTOR_CACHE - map the factor cache file into memory.  If the file
+ * was written for the same solver, and the same ordering of the
+ * coordinates, skyline and reactions, and for the sparse solver the same
+ * columns of [K] as in S, FC->K, FC->KF and FC->S (sparse)
+ * point into the mapped file.  If the key is also the same FC->hit is 1,
+ * and the stiffness matrix is neither assembled nor factored.  If only
+ * the key differs FC->base is 1, and the decomposition in the file is
+ * updated by update_factor() for the changed elements.  Otherwise both
+ * are 0 and the file is written by save_factor_cache() once [K] has been
+ * factored.
+ */
+factor_cache *open_factor_cache(
+	char *path, uint64_t key, int solver,
+	int DoF, int *maxa, int *dof, sparse_ldl *Sk, int *q, int *r
+){
+	factor_cache *FC;
+	fc_header *hd;
+	ldl_factor *KF;
+	sparse_ldl *S;
+	FILE	*fp;
+	char	*b;
+	size_t	off;
+	long	size;
+	int	*kptr = NULL, *krow = NULL,
+		i, nK = ( solver == 2 ) ? Sk->nK : maxa[DoF+1]-1;
+
+	FC = (factor_cache *) malloc ( sizeof(factor_cache) );
+	FC->path = (char *) malloc ( strlen(path)+1 );
+	strcpy ( FC->path, path );
+	FC->key  = key;
+	FC->hit  = 0;
+	FC->base = 0;
+	FC->map  = NULL;
+	FC->size = 0;
+	FC->K    = NULL;
+	FC->KF   = NULL;
+	FC->S    = NULL;
+
+	if ( (fp = fopen ( path, "rb" )) == NULL )	return FC;
+	fseek ( fp, 0L, SEEK_END );
+	size = ftell ( fp );
+	if ( size < (long) sizeof(fc_header) ) { fclose(fp); return FC; }
+	FC->size = (size_t) size;
+
+#if !defined(WIN32) && !defined(DJGPP)
+	FC->map = mmap ( NULL, FC->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+							fileno(fp), 0 );
+	if ( FC->map == MAP_FAILED )	FC->map = NULL;
+#else
+	FC->map = malloc ( FC->size );
+	rewind ( fp );
+	if ( FC->map && fread ( FC->map, 1, FC->size, fp ) != FC->size ) {
+		free ( FC->map );
+		FC->map = NULL;
+	}
+#endif
+	fclose ( fp );
+	if ( !FC->map )	return FC;
+
+	b  = (char *) FC->map;
+	hd = (fc_header *) b;
+	if ( memcmp ( hd->magic, FC_MAGIC, 8 ) != 0 ||
+	     hd->layout != FC_LAYOUT || hd->solver != solver ||
+	     hd->DoF != DoF || hd->nK != nK || hd->ok < 0 )
+		return FC;
+
+	off = FC_ALIGN ( sizeof(fc_header) );
+	off += 3*FC_ALIGN ( DoF*sizeof(int) ) + FC_ALIGN ( (DoF+1)*sizeof(int) )
+	     + FC_ALIGN ( nK*sizeof(double) );
+	if ( solver == 1 )
+		off += FC_ALIGN ( nK*sizeof(double) )
+		     + FC_ALIGN ( DoF*sizeof(double) );
+	else
+		off += FC_ALIGN ( (DoF+1)*sizeof(int) )
+		     + FC_ALIGN ( nK*sizeof(int) )
+		     + FC_ALIGN ( nK*sizeof(unsigned long) )
+		     + 2*FC_ALIGN ( hd->nq*sizeof(int) )
+		     + 2*FC_ALIGN ( (hd->ns+1)*sizeof(int) )
+		     + FC_ALIGN ( hd->nrows*sizeof(int) )
+		     + FC_ALIGN ( (hd->ns+1)*sizeof(unsigned long) )
+		     + FC_ALIGN ( hd->nL*sizeof(double) )
+		     + FC_ALIGN ( hd->nq*sizeof(double) );
+	if ( off != FC->size )	return FC;	/* a truncated file */
+
+	/* the ordering and the reactions must be those of this analysis */
+	off = FC_ALIGN ( sizeof(fc_header) );
+	if ( !same_ints ( (int *)(b+off), dof+1, DoF ) )	return FC;
+	off += FC_ALIGN ( DoF*sizeof(int) );
+	if ( !same_ints ( (int *)(b+off), q+1, DoF ) )		return FC;
+	off += FC_ALIGN ( DoF*sizeof(int) );
+	if ( !same_ints ( (int *)(b+off), r+1, DoF ) )		return FC;
+	off += FC_ALIGN ( DoF*sizeof(int) );
+	if ( !same_ints ( (int *)(b+off), maxa+1, DoF+1 ) )	return FC;
+	off += FC_ALIGN ( (DoF+1)*sizeof(int) );
+
+	/* arrays in the map, indexed from 1 as by NRutil */
+	FC->K = (double *)(b+off) - 1;
+	off += FC_ALIGN ( nK*sizeof(double) );
+
+	if ( solver == 2 ) {	/* the columns of [K] must be those of Sk */
+		kptr = (int *)(b+off) - 1;
+		off += FC_ALIGN ( (DoF+1)*sizeof(int) );
+		krow = (int *)(b+off) - 1;
+		off += FC_ALIGN ( nK*sizeof(int) );
+		if ( !same_ints ( kptr+1, Sk->kptr+1, DoF+1 ) ||
+		     !same_ints ( krow+1, Sk->krow+1, nK ) ) {
+			FC->K = NULL;
+			return FC;
+		}
+	}
+
+	KF = (ldl_factor *) malloc(sizeof(ldl_factor));
+	KF->DoF  = DoF;
+	KF->nK   = nK;
+	KF->maxa = maxa;
+	KF->dof  = dof;
+	KF->S    = NULL;
+	KF->P    = NULL;
+	KF->Kf   = KF->diag = NULL;
+	KF->Kfs  = KF->diags = NULL;
+	KF->qk   = KF->rk   = NULL;
+	KF->Fk   = dvector ( 1, DoF );
+	KF->Dk   = dvector ( 1, DoF );
+	KF->Rk   = dvector ( 1, DoF );
+	KF->ok   = hd->ok;
+	KF->indefinite = 0;
+	KF->mapped = 1;
+	KF->nw   = -1;
+
+	if ( solver == 1 ) {
+		KF->Kf   = (double *)(b+off) - 1;
+		off += FC_ALIGN ( nK*sizeof(double) );
+		KF->diag = (double *)(b+off) - 1;
+		KF->qk   = ivector ( 1, DoF );
+		KF->rk   = ivector ( 1, DoF );
+		for (i=1; i<=DoF; i++) {
+			KF->qk[dof[i]] = q[i];	KF->rk[dof[i]] = r[i];
+		}
+	} else {
+		S = (sparse_ldl *) malloc ( sizeof(sparse_ldl) );
+		S->n  = DoF;
+		S->nq = hd->nq;
+		S->ns = hd->ns;
+		S->nK = nK;
+		S->kptr  = kptr;
+		S->krow  = krow;
+		S->kmap  = (unsigned long *)(b+off) - 1;
+		off += FC_ALIGN ( nK*sizeof(unsigned long) );
+		S->perm  = (int *)(b+off) - 1;
+		off += FC_ALIGN ( S->nq*sizeof(int) );
+		S->first = (int *)(b+off) - 1;
+		off += FC_ALIGN ( (S->ns+1)*sizeof(int) );
+		S->sup   = (int *)(b+off) - 1;
+		off += FC_ALIGN ( S->nq*sizeof(int) );
+		S->rptr  = (int *)(b+off) - 1;
+		off += FC_ALIGN ( (S->ns+1)*sizeof(int) );
+		S->rows  = (int *)(b+off) - 1;
+		off += FC_ALIGN ( hd->nrows*sizeof(int) );
+		S->lptr  = (unsigned long *)(b+off) - 1;
+		off += FC_ALIGN ( (S->ns+1)*sizeof(unsigned long) );
+		S->L     = (double *)(b+off) - 1;
+		off += FC_ALIGN ( hd->nL*sizeof(double) );
+		S->d     = (double *)(b+off) - 1;
+		KF->S = FC->S = S;
+	}
+
+	FC->KF   = KF;
+	FC->hit  = ( hd->key == key );
+	FC->base = !FC->hit;
+	return FC;
+}
+
+
+/*
+ * SAVE_FACTOR_CACHE - write [K] and its double-precision L D L'
+ * decomposition to the factor cache file, through a temporary file
+ * that is renamed, so that an analysis reading the file never sees
+ * a partial file.  A decomposition of a matrix that is not pos-def, or
+ * a Woodbury update of the decomposition in the file, is not saved.
+ * A file that can not be written gives a warning only.
+ */
+void save_factor_cache(
+	factor_cache *FC, ldl_factor *KF, double *K, int *q, int *r
+){
+	fc_header hd;
+	sparse_ldl *S = KF->S;
+	FILE	*fp;
+	char	*tmp;
+	int	DoF = KF->DoF, nK = KF->nK, ok = 1;
+
+	if ( FC->hit || KF->ok < 0 || KF->nw >= 0 || ( !KF->Kf && !S ) )
+		return;
+
+	memset ( &hd, 0, sizeof(hd) );
+	memcpy ( hd.magic, FC_MAGIC, 8 );
+	hd.key    = FC->key;
+	hd.layout = FC_LAYOUT;
+	hd.solver = S ? 2 : 1;
+	hd.DoF    = DoF;
+	hd.nK     = nK;
+	hd.ok     = KF->ok;
+	if ( S ) {
+		hd.nq = S->nq;
+		hd.ns = S->ns;
+		hd.nrows = S->rptr[S->ns+1]-1;
+		hd.nL    = S->lptr[S->ns+1]-1;
+	}
+
+	tmp = (char *) malloc ( strlen(FC->path)+5 );
+	sprintf ( tmp, "%s.tmp", FC->path );
+	if ( (fp = fopen ( tmp, "wb" )) == NULL ) {
+		fprintf(stderr," Unable to write factor cache file '%s'\n", tmp);
+		free ( tmp );
+		return;
+	}
+
+	write_block ( fp, &hd, sizeof(hd), &ok );
+	write_block ( fp, KF->dof+1, DoF*sizeof(int), &ok );
+	write_block ( fp, q+1, DoF*sizeof(int), &ok );
+	write_block ( fp, r+1, DoF*sizeof(int), &ok );
+	write_block ( fp, KF->maxa+1, (DoF+1)*sizeof(int), &ok );
+	write_block ( fp, K+1, nK*sizeof(double), &ok );
+	if ( !S ) {
+		write_block ( fp, KF->Kf+1, nK*sizeof(double), &ok );
+		write_block ( fp, KF->diag+1, DoF*sizeof(double), &ok );
+	} else {
+		write_block ( fp, S->kptr+1,  (DoF+1)*sizeof(int), &ok );
+		write_block ( fp, S->krow+1,  nK*sizeof(int), &ok );
+		write_block ( fp, S->kmap+1,  nK*sizeof(unsigned long), &ok );
+		write_block ( fp, S->perm+1,  S->nq*sizeof(int), &ok );
+		write_block ( fp, S->first+1, (S->ns+1)*sizeof(int), &ok );
+		write_block ( fp, S->sup+1,   S->nq*sizeof(int), &ok );
+		write_block ( fp, S->rptr+1,  (S->ns+1)*sizeof(int), &ok );
+		write_block ( fp, S->rows+1,  hd.nrows*sizeof(int), &ok );
+		write_block ( fp, S->lptr+1,  (S->ns+1)*sizeof(unsigned long),&ok);
+		write_block ( fp, S->L+1,     hd.nL*sizeof(double), &ok );
+		write_block ( fp, S->d+1,     S->nq*sizeof(double), &ok );
+	}
+
+	if ( fclose ( fp ) != 0 || !ok || rename ( tmp, FC->path ) != 0 ) {
+		fprintf(stderr," Unable to write factor cache file '%s'\n",
+								FC->path );
+		remove ( tmp );
+	}
+	free ( tmp );
+}
+
+
+/*
+ * CLOSE_FACTOR_CACHE - release the mapped factor cache file and FC->KF,
+ * unless the analysis has taken FC->KF and set it to NULL.
+ */
+void close_factor_cache( factor_cache *FC )
+{
+	if ( !FC )	return;
+	if ( FC->KF )	free_factor ( FC->KF );
+	if ( FC->S )	free ( FC->S );
+	if ( FC->map ) {
+#if !defined(WIN32) && !defined(DJGPP)
+		munmap ( FC->map, FC->size );
+#else
+		free ( FC->map );
+#endif
+	}
+	free ( FC->path );
+	free ( FC );
+}
+
+
+/*
+ * HASH_BYTES - continue the FNV-1a hash h with n bytes at v
+ */
+static void hash_bytes( uint64_t *h, const void *v, size_t n )
+{
+	const unsigned char *c = (const unsigned char *) v;
+	size_t	i;
+
+	for (i=0; i < n; i++) {
+		*h ^= c[i];
+		*h *= 1099511628211ULL;		/* FNV prime */
+	}
+}
+
+
+/*
+ * SAME_INTS - 1 if the n integers at a and b are the same
+ */
+static int same_ints( int *a, int *b, int n )
+{
+	return ( memcmp ( a, b, n*sizeof(int) ) == 0 );
+}
+
+
+/*
+ * WRITE_BLOCK - write n bytes at v, padded to a multiple of 8 bytes
+ */
+static void write_block( FILE *fp, const void *v, size_t n, int *ok )
+{
+	static const char zero[8] = { 0,0,0,0,0,0,0,0 };
+
+	if ( n > 0 && fwrite ( v, 1, n, fp ) != n )	*ok = 0;
+	if ( FC_ALIGN(n) > n &&
+	     fwrite ( zero, 1, FC_ALIGN(n)-n, fp ) != FC_ALIGN(n)-n )  *ok = 0;
+}
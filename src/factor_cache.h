@@ -0,0 +1,117 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//** @file
+	A file holding the stiffness matrix of a linear analysis and its
+	L D L' decomposition, for later analyses of the same frame with
+	other loads.
+
+	The file is identified by a hash of the data that determine the
+	stiffness matrix: node locations, element connectivity, sections,
+	materials, reactions, and the shear, geometric stiffness and solver
+	options.  The arrays are stored as they are held in memory, so the
+	file is mapped into memory rather than read.
+*/
+#ifndef FRAME_FACTOR_CACHE_H
+#define FRAME_FACTOR_CACHE_H
+
+#include <stdint.h>
+
+#include "microstran/vec3.h"
+#include "frame3dd.h"
+#include "sparse.h"
+
+
+/**
+	a factor cache file, from open_factor_cache()
+*/
+typedef struct {
+	char	*path;		/**< name of the file			*/
+	uint64_t key;		/**< hash of the stiffness data		*/
+	int	hit;		/**< 1: the file holds [K] of this frame */
+	int	base;		/**< 1: the file holds [K] of this frame 
+					with other element properties	*/
+	void	*map;		/**< the file, mapped into memory	*/
+	size_t	size;		/**< length of the file			*/
+	double	*K;		/**< stiffness matrix, in the map	*/
+	ldl_factor *KF;		/**< L D L' decomposition, in the map	*/
+	sparse_ldl *S;		/**< sparse L D L' decomposition, in the map */
+} factor_cache;
+
+
+/**
+	STIFFNESS_HASH - a 64-bit hash of the data of the stiffness matrix
+*/
+uint64_t stiffness_hash(
+	int nN,		/**< number of nodes				*/
+	int nE,		/**< number of frame elements			*/
+	vec3 *xyz,	/**< XYZ locations of every node		*/
+	float *rj,	/**< rigid radius of every node			*/
+	int *N1, int *N2, /**< node connectivity			*/
+	float *Ax, float *Asy, float *Asz,	/**< section areas	*/
+	float *Jx, float *Iy, float *Iz,	/**< section inertias	*/
+	float *E, float *G,	/**< elastic and shear moduli		*/
+	float *p,	/**< roll angle of each frame element		*/
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int shear,	/**< 1: include shear deformation, 0: don't	*/
+	int geom,	/**< 1: include geometric stiffness, 0: don't	*/
+	int solver	/**< 1: skyline L D L', 2: sparse L D L'	*/
+);
+
+
+/**
+	OPEN_FACTOR_CACHE - map the file holding [K] and its decomposition
+	into memory if its ordering, skyline, sparse columns and reactions
+	match those given
+*/
+factor_cache *open_factor_cache(
+	char *path,	/**< name of the file				*/
+	uint64_t key,	/**< hash of the stiffness data			*/
+	int solver,	/**< 1: skyline L D L', 2: sparse L D L'	*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	sparse_ldl *Sk,	/**< columns of a sparse K, with solver 2	*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r		/**< 0: not a reaction; 1: a reaction coordinate */
+);
+
+
+/**
+	SAVE_FACTOR_CACHE - write [K] and its decomposition to the file
+*/
+void save_factor_cache(
+	factor_cache *FC, /**< the file, from open_factor_cache()	*/
+	ldl_factor *KF,	/**< L D L' decomposition, from factor_system() */
+	double *K,	/**< skyline or sparse stiffness matrix		*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r		/**< 0: not a reaction; 1: a reaction coordinate */
+);
+
+
+/**
+	CLOSE_FACTOR_CACHE - release the mapped file; FC->K, FC->KF and
+	FC->S, and decompositions updated from FC->KF, are not to be used
+	afterwards
+*/
+void close_factor_cache( factor_cache *FC );
+
+#endif /* FRAME_FACTOR_CACHE_H */
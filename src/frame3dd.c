@@ -25,6 +25,7 @@
 
 #include <math.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "frame3dd.h"
 #include "common.h"
@@ -38,382 +39,2175 @@
 
 /* forward declarations */
 
-static void elastic_K(
-	double **k, vec3 *xyz, float *r,
-	double L, double Le,
-	int n1, int n2,
-	float Ax, float Asy, float Asz,
-	float Jx, float Iy, float Iz, float E, float G, float p,
-	int shear
-);
-
-static void geometric_K(
-	double **k, vec3 *xyz, float *r,
-	double L, double Le, 
-	int n1, int n2, float
-	Ax, float Asy, float Asz, float Jx, float Iy, float Iz,
-	float E, float G, float p, double T, 
-	int shear
-);
-
 static void frame_element_force(
-	double *s, vec3 *xyz, double L, double Le,
+	double *s, double L, double Le,
 	int n1, int n2,
-	float Ax, float Asy, float Asz, float Jx, float Iy, float Iz,
-	float E, float G, float p,
+	float Ax, float Jx, float Iy, float Iz,
+	float E, float G, elem_geom *g,
 	double *f_t, double *f_m,
 	double *D,
-	int shear, int geom, double *axial_strain
+	int geom, double *axial_strain
 );
 
 static void lumped_M(
-	double **m, vec3 *xyz,
-	double L, int n1, int n2,
-	float Ax, float Jx, float Iy, float Iz, float p, 
+	double **m, double L,
+	float Ax, float Jx, float Iy, float Iz, elem_geom *g, 
 	float d, float EMs
 );
 
 static void consistent_M(
-	double **m, vec3 *xyz, float *r, double L,
-	int n1, int n2,
-	float Ax, float Jx, float Iy, float Iz, float p, 
+	double **m, double L,
+	float Ax, float Jx, float Iy, float Iz, elem_geom *g, 
 	float d, float EMs
 );
 
+static void order_colors( int nE, int nc, int *color, int *elist, int *cptr );
+
+static void factor_skyline( ldl_factor *KF, double *K, int *ok );
+
+static int K_loc( int *maxa, sparse_ldl *S, int i, int j );
+
+static void prod_K( double *K, int *maxa, sparse_ldl *S, int DoF,
+			double *x, double *y );
+
+static void unpack_K( K_cache *KC, int i, double T, double k[12][12] );
+
+static int solve_single(
+	ldl_factor *KF, double *K, double *Fk, double *Dk, double *Rk,
+	double *rms_resid
+);
+
+static void base_solve(
+	ldl_factor *KB, double *K0, double *b, double *x, int *q, int *r
+);
+
+static void solve_updated(
+	ldl_factor *KF, double *K, double *Fk, double *Dk, double *Rk,
+	int *q, int *r, double *rms_resid
+);
+
+static int incomplete_cholesky( pcg_solver *PC, int nE, int *N1, int *N2 );
+
+static void precondition( pcg_solver *PC, double *res, double *z );
+
+#ifdef _OPENMP
+static void color_elements( int nN, int nE, int *N1, int *N2,
+				int *nc, int **color );
+#endif
+
+#define NB 4	/* number of elements in a batch of element_K_batch()	*/
+
+static void element_K_batch(
+	int nb, int *elem, double *L, double *Le,
+	float *Ax, float *Jx, float *Iy, float *Iz,
+	float *E, float *G, elem_geom *eg,
+	int elastic, double *T, double kb[12][12][NB]
+);
+
+static double step_residual(
+	double lambda, double **Q, int nE, double *L, double *Le,
+	int *N1, int *N2, float *Ax,
+	float *Jx, float *Iy, float *Iz, float *E, float *G, elem_geom *eg,
+	double **eqF_temp, double **eqF_mech, double **eqFt, double **eqFm,
+	int *axial_strain_warning, K_cache *KC, double *K,
+	int *maxa, sparse_ldl *S, int *dof, double *F, double *Fl,
+	double *D, double *dF, int DoF, int *q
+);
+
+static void tangent_product(
+	K_cache *KC, double *K, int *maxa, sparse_ldl *S, int *dof,
+	int DoF, int nE, float *Ax, float *E, double *Le,
+	elem_geom *eg, double *dN0, double *D, double *v, double mu,
+	double *y, double *Dk, double *vk, double *yk
+);
+
+static void newton_krylov(
+	NR_solver *NR, K_cache *KC, double *K, int *maxa, sparse_ldl *S,
+	int *dof, int DoF, int nE, float *Ax, float *E, double *Le,
+	elem_geom *eg, double *dN0, double *F, float *Dp, double *D,
+	double *dF, double *dDF, double *DD, double cc, int arc,
+	int *q, int *r, double *x, double *rms_resid
+);
+
+
+/*
+ * RENUMBER_NODES - reduce the profile of the stiffness matrix by numbering
+ * the nodes internally in reverse Cuthill-McKee order.  Each connected part
+ * of the frame is numbered by a breadth-first search from a pseudo-peripheral
+ * node (Gibbs, Poole and Stockmeyer, 1976), visiting neighbors in order of
+ * increasing degree.  The numbering of the input file is kept if it gives
+ * the smaller profile.  
+ * Input and output data keep the node numbering of the input file; 
+ * dof[i] is the location of structural coordinate i in [K].
+ */
+void renumber_nodes( int nN, int nE, int *N1, int *N2, int *dof )
+{
+	int	*xadj, *adj,	/* node adjacency lists			*/
+		*deg,		/* number of elements framing into a node */
+		*order,		/* nodes in Cuthill-McKee order		*/
+		*new,		/* internal number of each node		*/
+		*mask,		/* 1: node has been numbered		*/
+		*level,		/* breadth-first level of each node	*/
+		root, head, tail, nlvl, width, n1,n2, i,j,k,l, t, next=0;
+	double	profile_in, profile_rcm;
+
+	xadj  = ivector(1,nN+1);
+	adj   = ivector(1,2*nE+1);
+	deg   = ivector(1,nN);
+	order = ivector(1,nN);
+	new   = ivector(1,nN);
+	mask  = ivector(1,nN);
+	level = ivector(1,nN);
+
+	for (j=1; j<=nN; j++)	deg[j] = mask[j] = 0;
+	for (i=1; i<=nE; i++) 	{ ++deg[N1[i]];  ++deg[N2[i]]; }
+	xadj[1] = 1;
+	for (j=1; j<=nN; j++)	xadj[j+1] = xadj[j] + deg[j];
+	for (j=1; j<=nN; j++)	level[j] = xadj[j];
+	for (i=1; i<=nE; i++) {
+		adj[level[N1[i]]++] = N2[i];
+		adj[level[N2[i]]++] = N1[i];
+	}
+
+	while ( next < nN ) {	/* number each connected part of the frame */
+
+		root = 0;	/* un-numbered node of minimum degree */
+		for (j=1; j<=nN; j++)
+			if ( !mask[j] && ( root == 0 || deg[j] < deg[root] ) )
+				root = j;
+
+		width = 0;	/* find a pseudo-peripheral root node */
+		do {
+			for (j=1; j<=nN; j++)	level[j] = 0;
+			head = tail = next + 1;
+			order[tail++] = root;	level[root] = 1;
+			while ( head < tail ) {
+				n1 = order[head++];
+				for (k=xadj[n1]; k<xadj[n1+1]; k++) {
+					n2 = adj[k];
+					if ( !mask[n2] && level[n2] == 0 ) {
+						level[n2] = level[n1] + 1;
+						order[tail++] = n2;
+					}
+				}
+			}
+			nlvl = level[order[tail-1]];
+			if ( nlvl <= width )	break;
+			width = nlvl;
+			for (k=tail-1; k>next && level[order[k]] == nlvl; k--)
+				if ( deg[order[k]] < deg[root] || k == tail-1 )
+					root = order[k];
+		} while ( nlvl > 1 );
+
+		/* Cuthill-McKee: visit neighbors in order of increasing degree */
+		head = tail = next + 1;
+		order[tail++] = root;	mask[root] = 1;
+		while ( head < tail ) {
+			n1 = order[head++];
+			l = tail;
+			for (k=xadj[n1]; k<xadj[n1+1]; k++) {
+				n2 = adj[k];
+				if ( !mask[n2] ) {
+					mask[n2] = 1;
+					for (t=tail++; t>l && deg[order[t-1]] > deg[n2]; t--)
+						order[t] = order[t-1];
+					order[t] = n2;
+				}
+			}
+		}
+		next = tail - 1;
+	}
+
+	for (k=1; k<=nN; k++)	new[order[k]] = nN - k + 1;	/* reverse */
+
+	/* compare the profile of the reversed order with that of the input */
+	for (j=1; j<=nN; j++)	deg[j] = j;
+	for (j=1; j<=nN; j++)	level[j] = j;
+	for (i=1; i<=nE; i++) {
+		n1 = ( N1[i] < N2[i] ) ? N1[i] : N2[i];
+		n2 = ( N1[i] < N2[i] ) ? N2[i] : N1[i];
+		if ( n1 < deg[n2] )	deg[n2] = n1;
+		n1 = ( new[N1[i]] < new[N2[i]] ) ? new[N1[i]] : new[N2[i]];
+		n2 = ( new[N1[i]] < new[N2[i]] ) ? new[N2[i]] : new[N1[i]];
+		if ( n1 < level[n2] )	level[n2] = n1;
+	}
+	profile_in = profile_rcm = 0.0;
+	for (j=1; j<=nN; j++) {
+		profile_in  += 36.0*(j - deg[j]) + 21.0;
+		profile_rcm += 36.0*(j - level[j]) + 21.0;
+	}
+	if ( profile_rcm >= profile_in )  for (j=1; j<=nN; j++)	new[j] = j;
+
+	for (j=1; j<=nN; j++)
+		for (l=1; l<=6; l++)	dof[6*j-6+l] = 6*new[j]-6+l;
+
+	free_ivector(xadj,1,nN+1);
+	free_ivector(adj,1,2*nE+1);
+	free_ivector(deg,1,nN);
+	free_ivector(order,1,nN);
+	free_ivector(new,1,nN);
+	free_ivector(mask,1,nN);
+	free_ivector(level,1,nN);
+}
+
+
+/*
+ * SKYLINE_PROFILE - locate the diagonal terms of the skyline storage of the
+ * global stiffness matrix from the frame element connectivity.   
+ * The height of column j is the distance from coordinate j up to the
+ * lowest-numbered coordinate connected to it through a frame element.
+ * dof[i] is the location of structural coordinate i in [K].
+ * Returns the number of terms within the profile.
+ */
+int skyline_profile( int DoF, int nE, int *N1, int *N2, int *dof, int *maxa )
+{
+	int	*top,		/* top row of the skyline in each column */
+		c[13], cmin, i, j, l;
+	double	nK = 0.0;	/* number of terms within the profile	*/
+
+	top = ivector(1,DoF);
+
+	for (j=1; j<=DoF; j++)	top[j] = j;
+
+	for (i=1; i<=nE; i++) {
+		for (l=1; l<=6; l++) {
+			c[l]   = dof[6*N1[i]-6+l];
+			c[l+6] = dof[6*N2[i]-6+l];
+		}
+		cmin = c[1];
+		for (l=2; l<=12; l++)	if ( c[l] < cmin )	cmin = c[l];
+		for (l=1; l<=12; l++)	if ( cmin < top[c[l]] )	top[c[l]] = cmin;
+	}
+
+	for (j=1; j<=DoF; j++)	nK += j - top[j] + 1;
+
+	if ( nK > (double) INT_MAX - 1 ) {
+		fprintf(stderr," skyline_profile: %.0f terms in the stiffness matrix profile\n", nK);
+		fprintf(stderr," exceed the capacity of the skyline index.\n");
+		exit(33);
+	}
+
+	maxa[1] = 1;
+	for (j=1; j<=DoF; j++)	maxa[j+1] = maxa[j] + j - top[j] + 1;
+
+	free_ivector(top,1,DoF);
+
+	return maxa[DoF+1] - 1;
+}
+
+
+/*
+ * K_LOC - the location of the term i,j of [K], i <= j, in the skyline of
+ * maxa, or in the columns of S if S is not NULL
+ */
+static int K_loc( int *maxa, sparse_ldl *S, int i, int j )
+{
+	if ( S )	return sparse_K_loc ( S, i, j );
+	return maxa[j] + j - i;
+}
+
+
+/*
+ * PROD_K - {y} = [K]{x} in the numbering of [K], for [K] in the skyline of
+ * maxa, or in the columns of S if S is not NULL
+ */
+static void prod_K( double *K, int *maxa, sparse_ldl *S, int DoF,
+			double *x, double *y )
+{
+	if ( S )	sparse_prodAx ( S, K, x, y );
+	else		prodAx_sky ( K, maxa, DoF, x, y );
+}
+
 
 /*
  * ASSEMBLE_K  -  assemble global stiffness matrix from individual elements 23feb94
+ * [K] is stored in skyline form, with diagonal terms located by maxa[],
+ * or, if S is not NULL, in the columns of the sparse solver, S
+ * structural coordinate i is located in row and column dof[i] of [K]
+ * The element stiffness matrices are computed in batches of NB elements
+ * by element_K_batch(), or one at a time if they are to be written to files.
+ * With more than one thread the elements are colored so that no two
+ * elements of a color share a node, and the elements of each color are
+ * assembled concurrently.  The colors are assembled in order, so [K] does
+ * not depend on the number of threads.
  */
 void assemble_K(
-	double **K,
+	double *K, int *maxa, sparse_ldl *S, int *dof,
 	int DoF, int nE,
-	vec3 *xyz, float *r, double *L, double *Le,
+	double *L, double *Le,
 	int *N1, int *N2,
-	float *Ax, float *Asy, float *Asz,
+	float *Ax,
 	float *Jx, float *Iy, float *Iz,
-	float *E, float *G, float *p,
-	int shear, int geom, double **Q, int debug
+	float *E, float *G, elem_geom *eg,
+	int geom, double **Q, int debug, int nthreads
 ){
-	double	**k;		/* element stiffness matrix in global coord */
+	double	**k,		/* element stiffness matrix in global coord */
+		kb[12][12][NB],	/* stiffness matrices of a batch of elements */
+		T[NB];		/* axial forces of a batch of elements	*/
 	int	**ind,		/* member-structure DoF index table	*/
+		*color=NULL,	/* color of each element		*/
+		*elist=NULL,	/* elements in order of color		*/
+		*cptr=NULL,	/* first element of each color in elist	*/
+		batch[NB],	/* the elements in a batch		*/
+		nc=1,		/* number of colors			*/
+		nb,		/* number of elements in a batch	*/
 		res=0,
-		i, j, ii, jj, l, ll;
+		i, j, b, ii, jj, l, ll, c;
 	char	stiffness_fn[FILENMAX];
 
-	for (i=1; i<=DoF; i++)	for (j=1; j<=DoF; j++)	K[i][j] = 0.0;
+	for (i=1; i <= (S ? S->nK : maxa[DoF+1]-1); i++)	K[i] = 0.0;
 
-	k   =  dmatrix(1,12,1,12);
 	ind = imatrix(1,12,1,nE);
 
+	for ( i=1; i<= nE; i++ ) {	/* locations in the renumbered [K] */
+		for ( l=1; l <= 6; l++ ) {
+			ind[l][i]   = dof[6*N1[i]-6+l];
+			ind[l+6][i] = dof[6*N2[i]-6+l];
+		}
+	}
 
-	for ( i=1; i<= nE; i++ ) {
-		ind[1][i] = 6*N1[i] - 5;	ind[7][i]  = 6*N2[i] - 5;
-		ind[2][i] = ind[1][i] + 1;	ind[8][i]  = ind[7][i] + 1;
-		ind[3][i] = ind[1][i] + 2;	ind[9][i]  = ind[7][i] + 2;
-		ind[4][i] = ind[1][i] + 3;	ind[10][i] = ind[7][i] + 3;
-		ind[5][i] = ind[1][i] + 4;	ind[11][i] = ind[7][i] + 4;
-		ind[6][i] = ind[1][i] + 5;	ind[12][i] = ind[7][i] + 5;
+	if ( debug ) {	/* one element at a time, saving each matrix	*/
+
+	  k   =  dmatrix(1,12,1,12);
+
+	  for ( i = 1; i <= nE; i++ ) {
+
+		T[0] = geom ? -Q[i][1] : 0.0;
+		element_K_batch ( 1, &i, L, Le, Ax, Jx,Iy,Iz, E,G, eg,
+						1, geom ? T : NULL, kb );
+		for ( l=1; l <= 12; l++ )
+			for ( ll=1; ll <= 12; ll++ )	k[l][ll] = kb[l-1][ll-1][0];
+
+		res = sprintf(stiffness_fn,"k_%03d",i);
+		save_dmatrix(stiffness_fn,k,1,12,1,12,0, "w");
+
+		for ( l=1; l <= 12; l++ ) {	/* upper triangle only */
+			ii = ind[l][i];
+			for ( ll=1; ll <= 12; ll++ ) {
+				jj = ind[ll][i];
+				if ( ii <= jj )	K[K_loc(maxa,S,ii,jj)] += k[l][ll];
+			}
+		}
+	  }
+	  free_dmatrix ( k,1,12,1,12);
+	  free_imatrix(ind,1,12,1,nE);
+	  return;
 	}
 
-	for ( i = 1; i <= nE; i++ ) {
+#ifdef _OPENMP
+	if ( nthreads > 1 )
+		color_elements ( DoF/6, nE, N1, N2, &nc, &color );
+#endif
+	elist = ivector(1,nE);
+	cptr  = ivector(1,nc+1);
+	order_colors ( nE, nc, color, elist, cptr );
 
-		elastic_K ( k, xyz, r, L[i], Le[i], N1[i], N2[i],
-		Ax[i],Asy[i],Asz[i], Jx[i],Iy[i],Iz[i], E[i],G[i], p[i], shear);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(nc > 1) private(kb,T,batch,nb,i,j,b,c,l,ll,ii,jj)
+#endif
+	for (c=1; c <= nc; c++) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+	    for ( j = cptr[c]; j < cptr[c+1]; j += NB ) {
 
-		if (geom)
-		 geometric_K( k, xyz, r, L[i], Le[i], N1[i], N2[i],
-		           Ax[i], Asy[i],Asz[i], 
-                           Jx[i], Iy[i], Iz[i], 
-                           E[i],G[i], p[i], -Q[i][1], shear);
+		nb = ( cptr[c+1]-j < NB ) ? cptr[c+1]-j : NB;
+		for (b=0; b < nb; b++) {
+			batch[b] = elist[j+b];
+			T[b] = geom ? -Q[batch[b]][1] : 0.0;
+		}
 
-		if (debug) {
-			res = sprintf(stiffness_fn,"k_%03d",i);
-			save_dmatrix(stiffness_fn,k,1,12,1,12,0, "w");
+		element_K_batch ( nb, batch, L, Le, Ax, Jx,Iy,Iz, E,G, eg,
+						1, geom ? T : NULL, kb );
+
+		for (b=0; b < nb; b++) {
+			i = batch[b];
+			for ( l=0; l < 12; l++ ) {	/* upper triangle only */
+				ii = ind[l+1][i];
+				for ( ll=0; ll < 12; ll++ ) {
+					jj = ind[ll+1][i];
+					if ( ii <= jj )
+					 K[K_loc(maxa,S,ii,jj)] += kb[l][ll][b];
+				}
+			}
+		}
+	    }
+	}
+
+	if ( color )	free_ivector(color,1,nE);
+	free_ivector(elist,1,nE);
+	free_ivector(cptr,1,nc+1);
+	free_imatrix(ind,1,12,1,nE);
+	return;
+}
+
+
+/*
+ * CACHE_ELEMENTS - the upper triangle of the elastic stiffness matrix of
+ * each element, [Ke_i], in global coordinates, and the location of each 
+ * of its coordinates in [K], for the element-by-element products of 
+ * element_product_K() without an assembled [K].  
+ * With nthreads > 1 the elements are colored as in assemble_K(), 
+ * so that the products of the elements of each color are concurrent.
+ */
+K_cache *cache_elements(
+	int *dof, int DoF, int nE,
+	double *L, double *Le,
+	int *N1, int *N2,
+	float *Ax,
+	float *Jx, float *Iy, float *Iz,
+	float *E, float *G, elem_geom *eg,
+	int nthreads
+){
+	K_cache *KC;
+	double	kb[12][12][NB];	/* elastic stiffness of a batch of elements */
+	int	*ind,		/* member-structure DoF index table	*/
+		*color=NULL,	/* color of each element		*/
+		batch[NB],	/* the elements in a batch		*/
+		nb, i, j, b, l, ll, t;
+
+	KC = (K_cache *) malloc ( sizeof(K_cache) );
+	KC->DoF = DoF;
+	KC->nE  = nE;
+	KC->nK  = 0;
+	KC->Ke  = NULL;
+	KC->kg  = NULL;
+	KC->loc = NULL;
+	KC->ke  = dmatrix(1,nE,1,78);
+	KC->ind = imatrix(1,nE,1,12);
+	KC->nc  = 1;
+	KC->nthreads = nthreads;
+
+#ifdef _OPENMP
+	if ( nthreads > 1 )
+		color_elements ( DoF/6, nE, N1, N2, &KC->nc, &color );
+#endif
+	KC->elist = ivector(1,nE);
+	KC->cptr  = ivector(1,KC->nc+1);
+	order_colors ( nE, KC->nc, color, KC->elist, KC->cptr );
+	if ( color )	free_ivector(color,1,nE);
+
+	for (i=1; i <= nE; i++) {
+		ind = KC->ind[i];
+		for ( l=1; l <= 6; l++ ) {
+			ind[l]   = dof[6*N1[i]-6+l];
+			ind[l+6] = dof[6*N2[i]-6+l];
+		}
+	}
+
+	for (j=1; j <= nE; j += NB) {
+		nb = ( nE+1-j < NB ) ? nE+1-j : NB;
+		for (b=0; b < nb; b++)	batch[b] = j+b;
+
+		element_K_batch ( nb, batch, L, Le, Ax, Jx,Iy,Iz, E,G, eg,
+							1, NULL, kb );
+
+		for (b=0; b < nb; b++) {
+			t = 0;
+			for (l=0; l < 12; l++)	/* upper triangle of ke	*/
+			    for (ll=l; ll < 12; ll++)
+				KC->ke[j+b][++t] = kb[l][ll][b];
+		}
+	}
+
+	return KC;
+}
+
+
+/*
+ * CACHE_K - assemble the elastic stiffness matrix [Ke] once, and compute the
+ * geometric stiffness matrix of each element for a unit axial force, [Kg_i].
+ * The geometric stiffness is proportional to the axial force, so within
+ * the iterations of a geometrically nonlinear analysis update_K() forms
+ * [K] = [Ke] + sum_i N_i [Kg_i] without re-computing the element matrices.
+ * The 78 terms of the upper triangle of [Kg_i] are kept as they are, with
+ * their locations in [K] in KC->loc[i][]; update_K() adds them to [K].
+ * The element matrices of cache_elements() are kept too, for the products
+ * of element_product_K().
+ */
+K_cache *cache_K(
+	int *maxa, sparse_ldl *S, int *dof,
+	int DoF, int nE,
+	double *L, double *Le,
+	int *N1, int *N2,
+	float *Ax,
+	float *Jx, float *Iy, float *Iz,
+	float *E, float *G, elem_geom *eg,
+	double **Q, int debug, int nthreads
+){
+	K_cache *KC;
+	double	kb[12][12][NB],	/* unit geometric stiffness of a batch	*/
+		T[NB];		/* unit axial forces			*/
+	int	*ind,		/* member-structure DoF index table	*/
+		batch[NB],	/* the elements in a batch		*/
+		nb, i, j, b, l, ll, ii, jj, t;
+
+	KC = cache_elements ( dof, DoF, nE, L, Le, N1, N2,
+			Ax,Jx,Iy,Iz, E,G, eg, nthreads );
+	KC->nK  = S ? S->nK : maxa[DoF+1] - 1;
+	KC->Ke  = dvector(1,KC->nK);
+	KC->kg  = dmatrix(1,nE,1,78);
+	KC->loc = imatrix(1,nE,1,78);
+
+	assemble_K ( KC->Ke, maxa, S, dof, DoF, nE, L, Le, N1, N2,
+			Ax,Jx,Iy,Iz, E,G, eg, 0, Q,
+			debug, nthreads );
+
+	for (b=0; b < NB; b++)	T[b] = 1.0;
+
+	for (j=1; j <= nE; j += NB) {
+		nb = ( nE+1-j < NB ) ? nE+1-j : NB;
+		for (b=0; b < nb; b++)	batch[b] = j+b;
+
+		element_K_batch ( nb, batch, L, Le, Ax, Jx,Iy,Iz, E,G, eg,
+							0, T, kb );
+
+		for (b=0; b < nb; b++) {
+			i = j+b;
+			ind = KC->ind[i];
+			t = 0;
+			for (l=0; l < 12; l++) {	/* upper triangle of k */
+				for (ll=l; ll < 12; ll++) {
+					ii = ind[l+1];	jj = ind[ll+1];
+					if ( ii > jj ) { ii = ind[ll+1]; jj = ind[l+1]; }
+					++t;
+					KC->loc[i][t] = K_loc ( maxa, S, ii, jj );
+					KC->kg[i][t]  = kb[l][ll][b];
+				}
+			}
+		}
+	}
+
+	return KC;
+}
+
+
+/*
+ * UPDATE_K - [K] = [Ke] + sum_i N_i [Kg_i], with the element axial forces 
+ * N_i = -Q[i][1] and the matrices from cache_K().  An off-diagonal term of
+ * [Kg_i] at a diagonal location of [K] is added from both triangles.
+ */
+void update_K( K_cache *KC, double *K, double **Q )
+{
+	double	T,		/* axial force of an element		*/
+		*kg;
+	int	*loc, i, t, l, ll, td;
+
+	for (i=1; i <= KC->nK; i++)	K[i] = KC->Ke[i];
+
+	for (i=1; i <= KC->nE; i++) {
+		T   = -Q[i][1];
+		kg  = KC->kg[i];
+		loc = KC->loc[i];
+		for (l=0, t=1; l < 12; l++) {
+			td = t;		/* the diagonal term of row l	*/
+			for (ll=l; ll < 12; ll++, t++)
+				K[loc[t]] += ( ll > l && loc[t] == loc[td] ) ?
+						2.0 * T * kg[t] : T * kg[t];
+		}
+	}
+}
+
+
+/*
+ * DYNAMIC_K - the stiffness matrix of a modal analysis by stodola(), in
+ * place of [K] in skyline form or in the columns of S:  the rows and
+ * columns of the reaction coordinates are zero but for the diagonal term,
+ * 1e4 times the trace of [K_qq], so the reactions are uncoupled from the
+ * free coordinates.  Returns the trace of [K_qq].
+ */
+double dynamic_K(
+	double *K, int *maxa, sparse_ldl *S, int *dof, int DoF, int *r
+){
+	double	traceK = 0.0;
+	int	*rk, i, j, t, t0, t1;
+
+	for (j=1; j<=DoF; j++)
+		if ( !r[j] )	traceK += K[K_loc(maxa,S,dof[j],dof[j])];
+
+	rk = ivector(1,DoF);	/* the reactions in the numbering of K	*/
+	for (j=1; j<=DoF; j++)	rk[dof[j]] = r[j];
+	for (j=1; j<=DoF; j++) {
+		t0 = S ? S->kptr[j] : maxa[j];
+		t1 = S ? S->kptr[j+1] : maxa[j+1];
+		for (t=t0; t<t1; t++) {
+			i = S ? S->krow[t] : maxa[j]+j-t;
+			if ( rk[i] || rk[j] )
+				K[t] = ( i == j ) ? traceK * 1e4 : 0.0;
+		}
+	}
+	free_ivector(rk,1,DoF);
+
+	return traceK;
+}
+
+/*
+ * UNPACK_K - the stiffness matrix of element i, [Ke_i] + T [Kg_i], from the
+ * upper triangles held by cache_elements() and cache_K(), as a full matrix
+ */
+static void unpack_K( K_cache *KC, int i, double T, double k[12][12] )
+{
+	double	*ke = KC->ke[i], *kg = ( T != 0.0 ) ? KC->kg[i] : NULL;
+	int	l, ll, t;
+
+	for (l=0, t=1; l < 12; l++)
+		for (ll=l; ll < 12; ll++, t++)
+			k[l][ll] = k[ll][l] = kg ? ke[t] + T*kg[t] : ke[t];
+}
+
+
+/*
+ * ELEMENT_PRODUCT_K - {y} = [K]{x}, element by element, for
+ * [K] = [Ke] + sum_i N_i [Kg_i] with the axial forces N_i = -Q[i][1], 
+ * or [K] = [Ke] if Q is NULL.  {x} and {y} are in the numbering of [K].
+ * The work is proportional to the number of elements rather than to the
+ * profile of [K].  The elements of each color, which share no nodes, 
+ * are multiplied concurrently.
+ */
+void element_product_K( K_cache *KC, double **Q, double *x, double *y )
+{
+	double	k[12][12],	/* element stiffness matrix		*/
+		xe[12], ye,	/* element displacements and forces	*/
+		T;		/* element axial force			*/
+	int	*ind, i, j, c, l, ll;
+
+	for (i=1; i <= KC->DoF; i++)	y[i] = 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(KC->nthreads) if(KC->nc > 1) private(k,xe,ye,T,ind,i,j,c,l,ll)
+#endif
+	for (c=1; c <= KC->nc; c++) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+	    for (j = KC->cptr[c]; j < KC->cptr[c+1]; j++) {
+		i = KC->elist[j];
+		T = Q ? -Q[i][1] : 0.0;
+		ind = KC->ind[i];
+
+		unpack_K ( KC, i, T, k );
+		for (l=0; l < 12; l++)	xe[l] = x[ind[l+1]];
+		for (l=0; l < 12; l++) {
+			ye = 0.0;
+			for (ll=0; ll < 12; ll++)	ye += k[l][ll]*xe[ll];
+			y[ind[l+1]] += ye;
+		}
+	    }
+	}
+}
+
+
+/*
+ * FREE_K_CACHE - release the memory of the stiffness matrices from cache_K()
+ */
+void free_K_cache( K_cache *KC )
+{
+	if ( !KC )	return;
+	if ( KC->Ke ) {
+		free_dvector(KC->Ke,1,KC->nK);
+		free_dmatrix(KC->kg,1,KC->nE,1,78);
+		free_imatrix(KC->loc,1,KC->nE,1,78);
+	}
+	free_dmatrix(KC->ke,1,KC->nE,1,78);
+	free_imatrix(KC->ind,1,KC->nE,1,12);
+	free_ivector(KC->elist,1,KC->nE);
+	free_ivector(KC->cptr,1,KC->nc+1);
+	free(KC);
+}
+
+
+/*
+ * ELEMENT_K_BATCH - elastic and geometric stiffness matrices, in global
+ * coordinates, of a batch of up to NB frame elements, elem[0..nb-1].
+ * The element properties are gathered into arrays indexed by the element
+ * in the batch, and every operation is carried out for all elements of the
+ * batch in an innermost loop, which the compiler vectorizes.
+ * The local stiffness matrix is made of 3-by-3 blocks, 
+ *	[ A  C -A  C  ]
+ *	[ C' B -C' E  ]
+ *	[-A -C  A -C  ]
+ *	[ C' E -C' B  ]
+ * where A, B and E are diagonal and C has two terms, so each global block
+ * T'AT, T'BT, T'CT and T'ET is a sum of two or three outer products
+ * of the rows of the 3-by-3 coordinate transformation T.  
+ * kb[i][j][b] is the i,j term of the stiffness matrix of element elem[b], 
+ * with i and j from 0 to 11.  The elastic stiffness is included if elastic
+ * is 1, and the geometric stiffness for the axial force T[b] if T is not 
+ * NULL.  This is the only evaluation of the element stiffness matrices.
+ */
+static void element_K_batch(
+	int nb, int *elem, double *L, double *Le,
+	float *Ax, float *Jx, float *Iy, float *Iz,
+	float *E, float *G, elem_geom *eg,
+	int elastic, double *T, double kb[12][12][NB]
+){
+	double	t[9][NB],		/* coordinate transformation	*/
+		a[3][NB], bb[3][NB], e[3][NB], c2[NB], c3[NB], /* blocks */
+		GA[3][3][NB], GB[3][3][NB], GE[3][3][NB], GC[3][3][NB],
+		EE[NB], GG[NB], AA[NB], JJ[NB], YY[NB], ZZ[NB], /* props */
+		KY[NB], KZ[NB], LL[NB], LE[NB], TT[NB],
+		Ksy, Ksz, Dsy, Dsz;	/* shear deformation coefficients */
+	elem_geom *g;
+	int	b, i, j, n;
+
+	for (b=0; b < NB; b++) {	/* gather, repeating the last element */
+		n = elem[ b < nb ? b : nb-1 ];
+		g = &eg[n];
+		t[0][b] = g->t1;  t[1][b] = g->t2;  t[2][b] = g->t3;
+		t[3][b] = g->t4;  t[4][b] = g->t5;  t[5][b] = g->t6;
+		t[6][b] = g->t7;  t[7][b] = g->t8;  t[8][b] = g->t9;
+		EE[b] = E[n];	GG[b] = G[n];	AA[b] = Ax[n];	JJ[b] = Jx[n];
+		YY[b] = Iy[n];	ZZ[b] = Iz[n];	KY[b] = g->Ksy;	KZ[b] = g->Ksz;
+		LL[b] = L[n];	LE[b] = Le[n];
+		TT[b] = T ? T[ b < nb ? b : nb-1 ] : 0.0;	/* axial force */
+	}
+
+#ifdef _OPENMP
+#pragma omp simd private(Ksy,Ksz,Dsy,Dsz)
+#endif
+	for (b=0; b < NB; b++) {	/* terms of the local blocks */
+		Ksy = KY[b];
+		Ksz = KZ[b];
+		Dsy = (1+Ksy)*(1+Ksy);
+		Dsz = (1+Ksz)*(1+Ksz);
+
+		if ( elastic ) {	/* the elastic stiffness	*/
+			a[0][b]  = EE[b]*AA[b] / LE[b];
+			a[1][b]  = 12.*EE[b]*ZZ[b] / ( LE[b]*LE[b]*LE[b]*(1.+Ksy) );
+			a[2][b]  = 12.*EE[b]*YY[b] / ( LE[b]*LE[b]*LE[b]*(1.+Ksz) );
+			bb[0][b] = GG[b]*JJ[b] / LE[b];
+			bb[1][b] = (4.+Ksz)*EE[b]*YY[b] / ( LE[b]*(1.+Ksz) );
+			bb[2][b] = (4.+Ksy)*EE[b]*ZZ[b] / ( LE[b]*(1.+Ksy) );
+			e[0][b]  = -bb[0][b];
+			e[1][b]  = (2.-Ksz)*EE[b]*YY[b] / ( LE[b]*(1.+Ksz) );
+			e[2][b]  = (2.-Ksy)*EE[b]*ZZ[b] / ( LE[b]*(1.+Ksy) );
+			c2[b]    =  6.*EE[b]*ZZ[b] / ( LE[b]*LE[b]*(1.+Ksy) );
+			c3[b]    = -6.*EE[b]*YY[b] / ( LE[b]*LE[b]*(1.+Ksz) );
+		} else {
+			a[0][b] = a[1][b] = a[2][b] = 0.0;
+			bb[0][b] = bb[1][b] = bb[2][b] = 0.0;
+			e[0][b] = e[1][b] = e[2][b] = 0.0;
+			c2[b] = c3[b] = 0.0;
+		}
+
+		if ( T ) {		/* add the geometric stiffness	*/
+			a[1][b]  += TT[b]/LL[b]*(1.2+2.0*Ksy+Ksy*Ksy)/Dsy;
+			a[2][b]  += TT[b]/LL[b]*(1.2+2.0*Ksz+Ksz*Ksz)/Dsz;
+			bb[0][b] += TT[b]/LL[b]*JJ[b]/AA[b];
+			bb[1][b] += TT[b]*LL[b]*(2.0/15.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz;
+			bb[2][b] += TT[b]*LL[b]*(2.0/15.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy;
+			e[0][b]  -= TT[b]/LL[b]*JJ[b]/AA[b];
+			e[1][b]  -= TT[b]*LL[b]*(1.0/30.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz;
+			e[2][b]  -= TT[b]*LL[b]*(1.0/30.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy;
+			c2[b]    += TT[b]/10.0/Dsy;
+			c3[b]    -= TT[b]/10.0/Dsz;
 		}
+	}
+
+	for (i=0; i < 3; i++) {		/* global 3-by-3 blocks, T'XT	*/
+	    for (j=0; j < 3; j++) {
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+		for (b=0; b < NB; b++) {
+			GA[i][j][b] = a[0][b]*t[i][b]*t[j][b] +
+			   a[1][b]*t[3+i][b]*t[3+j][b] + a[2][b]*t[6+i][b]*t[6+j][b];
+			GB[i][j][b] = bb[0][b]*t[i][b]*t[j][b] +
+			   bb[1][b]*t[3+i][b]*t[3+j][b] + bb[2][b]*t[6+i][b]*t[6+j][b];
+			GE[i][j][b] = e[0][b]*t[i][b]*t[j][b] +
+			   e[1][b]*t[3+i][b]*t[3+j][b] + e[2][b]*t[6+i][b]*t[6+j][b];
+			GC[i][j][b] = c2[b]*t[3+i][b]*t[6+j][b] +
+					c3[b]*t[6+i][b]*t[3+j][b];
+		}
+	    }
+	}
+
+	for (i=0; i < 3; i++) {		/* place the blocks		*/
+	    for (j=0; j < 3; j++) {
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+		for (b=0; b < NB; b++) {
+			kb[i  ][j  ][b] = kb[i+6][j+6][b] =  GA[i][j][b];
+			kb[i  ][j+6][b] = kb[i+6][j  ][b] = -GA[i][j][b];
+			kb[i+3][j+3][b] = kb[i+9][j+9][b] =  GB[i][j][b];
+			kb[i+3][j+9][b] = kb[i+9][j+3][b] =  GE[i][j][b];
+			kb[i  ][j+3][b] = kb[i  ][j+9][b] =  GC[i][j][b];
+			kb[j+3][i  ][b] = kb[j+9][i  ][b] =  GC[i][j][b];
+			kb[i+6][j+3][b] = kb[i+6][j+9][b] = -GC[i][j][b];
+			kb[j+3][i+6][b] = kb[j+9][i+6][b] = -GC[i][j][b];
+		}
+	    }
+	}
+}
+
+
+#ifdef _OPENMP
+/*
+ * COLOR_ELEMENTS - color the frame elements so that no two elements of the
+ * same color share a node.  Each element, in turn, takes the lowest color
+ * not yet taken at either of its nodes.  color[1..nE] is allocated here.
+ */
+static void color_elements( int nN, int nE, int *N1, int *N2, int *nc, int **color )
+{
+	int	*nptr,		/* first element at each node in nlist	*/
+		*nlist,		/* elements at each node		*/
+		*used,		/* element that last took each color	*/
+		i, j, m, n, c;
+
+	nptr  = ivector(1,nN+1);
+	nlist = ivector(1,2*nE);
+	used  = ivector(1,2*nE+1);
+	*color = ivector(1,nE);
+
+	for (n=1; n <= nN+1; n++)	nptr[n] = 0;
+	for (i=1; i <= nE; i++) {
+		++nptr[N1[i]];
+		if ( N2[i] != N1[i] )	++nptr[N2[i]];
+	}
+	for (n=2; n <= nN+1; n++)	nptr[n] += nptr[n-1];
+	for (i=nE; i >= 1; i--) {	/* elements at each node, in order */
+		nlist[nptr[N1[i]]--] = i;
+		if ( N2[i] != N1[i] )	nlist[nptr[N2[i]]--] = i;
+	}
+	for (n=1; n <= nN+1; n++)	++nptr[n];
+	for (c=1; c <= 2*nE+1; c++)	used[c] = 0;
+
+	*nc = 0;
+	for (i=1; i <= nE; i++) {
+		for (m=0; m < 2; m++) {	/* colors taken at N1 and N2	*/
+			n = m ? N2[i] : N1[i];
+			for (j=nptr[n]; j < nptr[n+1] && nlist[j] < i; j++)
+				used[(*color)[nlist[j]]] = i;
+		}
+		for (c=1; used[c] == i; c++) ;
+		(*color)[i] = c;
+		if ( c > *nc )	*nc = c;
+	}
+
+	free_ivector(nptr,1,nN+1);
+	free_ivector(nlist,1,2*nE);
+	free_ivector(used,1,2*nE+1);
+}
+#endif /* _OPENMP */
+
+
+/*
+ * ORDER_COLORS - list the frame elements in order of color;  the elements
+ * of color c are elist[cptr[c]] to elist[cptr[c+1]-1].  
+ * With no colors (color == NULL) all elements are of color 1.
+ */
+static void order_colors( int nE, int nc, int *color, int *elist, int *cptr )
+{
+	int	i, c;
+
+	for (c=1; c <= nc+1; c++)	cptr[c] = 0;
+	for (i=1; i <= nE; i++)	++cptr[ (color ? color[i] : 1) + 1 ];
+	cptr[1] = 1;
+	for (c=2; c <= nc+1; c++)	cptr[c] += cptr[c-1];
+	for (i=1; i <= nE; i++)	elist[cptr[ color ? color[i] : 1 ]++] = i;
+	for (c=nc; c >= 1; c--)	cptr[c+1] = cptr[c];
+	cptr[1] = 1;
+}
+
+
+#if 0 /* DISUSED CODE */
+/*
+ * END_RELEASE - apply matrix condensation for one member end force release 20nov04
+ */
+void end_release ( X, r )
+double	**X;
+int	r;
+{
+	int	i,j;
+
+	for (i=1; i<=12; i++)  if ( i != r) 
+		for (j=1; j<=12; j++) if ( j != r) 
+			X[i][j]  =  X[i][j]  -  X[i][r] * X[r][j] / X[r][r];
+	
+	for (i=1; i<=12; i++) 
+		X[r][i] = X[i][r] = 0.0;
+
+	return;
+}
+#endif
+
+
+/*
+ * FACTOR_SYSTEM  -  L D L' decomposition of [K_qq], held for later solutions
+ * with solve_factored().  [K] is not changed; the skyline decomposition is
+ * held in a separate array.  If S is not NULL the sparse supernodal L D L'
+ * decomposition is used, and its numerical values are held in S itself.
+ * If P is not NULL the skyline decomposition is held out of core, in the
+ * scratch file of P.
+ * *ok < 0 if [K_qq] is not positive definite.
+ */
+ldl_factor *factor_system(
+	double *K, int *maxa, int *dof, sparse_ldl *S, ooc_profile *P,
+	int DoF, int *q, int *r, int *ok
+){
+	ldl_factor *KF;
+	int	i;
+
+	KF = (ldl_factor *) malloc(sizeof(ldl_factor));
+	KF->DoF  = DoF;
+	KF->nK   = S ? S->nK : maxa[DoF+1]-1;
+	KF->maxa = maxa;
+	KF->dof  = dof;
+	KF->S    = S;
+	KF->P    = S ? NULL : P;
+	KF->Kf   = KF->diag = NULL;
+	KF->Kfs  = KF->diags = NULL;
+	KF->qk   = KF->rk   = NULL;
+	KF->mapped = 0;
+	KF->nw   = -1;
+	KF->Fk   = dvector ( 1, DoF );
+	KF->Dk   = dvector ( 1, DoF );
+	KF->Rk   = dvector ( 1, DoF );
+
+	if ( S ) {	/* sparse L D L' decomposition of K[q,q] */
+		sparse_ldl_pm ( S, K, dof, KF->Fk,KF->Dk,KF->Rk, r,
+								1, 0, ok );
+	} else {	/* skyline L D L' decomposition of K[q,q] */
+		KF->qk   = ivector ( 1, DoF );
+		KF->rk   = ivector ( 1, DoF );
+		for (i=1; i<=DoF; i++) {
+			KF->qk[dof[i]] = q[i];	KF->rk[dof[i]] = r[i];
+		}
+		factor_skyline ( KF, K, ok );
+	}
+
+	if ( *ok < 0 ) {
+	 	fprintf(stderr," Make sure that all six");
+		fprintf(stderr," rigid body translations are restrained!\n");
+		/* exit(31); */
+	}
+	KF->ok = *ok;
+	KF->indefinite = 0;
+
+	return KF;
+}
+
+
+/*
+ * FACTOR_SKYLINE - double-precision skyline L D L' decomposition of [K_qq]
+ * into KF->Kf and KF->diag, or into the scratch file of KF->P, with 
+ * KF->qk and KF->rk already set
+ */
+static void factor_skyline( ldl_factor *KF, double *K, int *ok )
+{
+	int	i;
+
+	KF->diag = dvector ( 1, KF->DoF );
+	if ( KF->P ) {		/* out of core, K is KF->P->K */
+		ooc_ldl_dcmp_pm_sky ( KF->P, KF->diag, KF->Fk,KF->Dk,KF->Rk,
+					KF->qk,KF->rk, 1, 0, ok );
+		return;
+	}
+	KF->Kf   = dvector ( 1, KF->nK );
+	for (i=1; i<=KF->nK; i++)	KF->Kf[i] = K[i];
+	ldl_dcmp_pm_sky ( KF->Kf, KF->maxa, KF->DoF, KF->diag,
+		KF->Fk,KF->Dk,KF->Rk, KF->qk,KF->rk, 1, 0, ok );
+}
+
+
+#define MIXED_ITER	30	/* refinements with a single-precision factor */
+#define MIXED_TOL	1e-9	/* relative correction of a converged solution
+				   with a single-precision factor	*/
+
+/*
+ * FACTOR_SINGLE  -  single-precision L D L' decomposition of [K_qq], held in
+ * KF->Kfs for solutions with solve_factored(), which refines the solutions
+ * in double precision with [K].  The decomposition takes half the memory
+ * of the one from factor_system(), and its inner products are in single
+ * precision.  The rows and columns of the reaction coordinates are replaced
+ * by those of the identity matrix, so the reduction has no branches.  
+ * If [K_qq] does not have a positive definite single-precision 
+ * decomposition, the double-precision decomposition is used instead.
+ * *ok < 0 if [K_qq] is not positive definite.
+ */
+ldl_factor *factor_single(
+	double *K, int *maxa, int *dof,
+	int DoF, int *q, int *r, int *ok
+){
+	ldl_factor *KF;
+	int	i, j, mj, pd;
+
+	KF = (ldl_factor *) malloc(sizeof(ldl_factor));
+	KF->DoF  = DoF;
+	KF->nK   = maxa[DoF+1]-1;
+	KF->maxa = maxa;
+	KF->dof  = dof;
+	KF->S    = NULL;
+	KF->P    = NULL;
+	KF->Kf   = KF->diag = NULL;
+	KF->mapped = 0;
+	KF->nw   = -1;
+	KF->Fk   = dvector ( 1, DoF );
+	KF->Dk   = dvector ( 1, DoF );
+	KF->Rk   = dvector ( 1, DoF );
+	KF->qk   = ivector ( 1, DoF );
+	KF->rk   = ivector ( 1, DoF );
+	for (i=1; i<=DoF; i++) {
+		KF->qk[dof[i]] = q[i];	KF->rk[dof[i]] = r[i];
+	}
+
+	KF->Kfs   = vector ( 1, KF->nK );
+	KF->diags = vector ( 1, DoF );
+	for (j=1; j<=DoF; j++) {	/* [K_qq] and the identity	*/
+		mj = j - (maxa[j+1] - maxa[j]) + 1;
+		for (i=mj; i<=j; i++) {
+			if ( KF->qk[i] && KF->qk[j] )
+				KF->Kfs[maxa[j]+j-i] = (float) K[maxa[j]+j-i];
+			else	KF->Kfs[maxa[j]+j-i] = ( i == j ) ? 1.0f : 0.0f;
+		}
+	}
+	ldl_dcmp_sky_f ( KF->Kfs, maxa, DoF, KF->diags, &pd );
+
+	*ok = 1;
+	if ( pd < 0 ) {		/* try the double-precision decomposition */
+		free_vector( KF->Kfs, 1, KF->nK );
+		free_vector( KF->diags, 1, DoF );
+		KF->Kfs = KF->diags = NULL;
+		factor_skyline ( KF, K, ok );
+	}
+
+	if ( *ok < 0 ) {
+	 	fprintf(stderr," Make sure that all six");
+		fprintf(stderr," rigid body translations are restrained!\n");
+	}
+	KF->ok = *ok;
+	KF->indefinite = 0;
+
+	return KF;
+}
+
+
+/*
+ * SOLVE_SINGLE - solve {F} = [K]{D} for {D_q} and {R_r}, in the numbering
+ * of [K], with the single-precision decomposition from factor_single(), 
+ * refining {D_q} with the equilibrium error computed with [K] in double
+ * precision until a refinement reduces its correction by less than 10%.
+ * Returns 1 if the correction is within MIXED_TOL of the solution.
+ */
+static int solve_single(
+	ldl_factor *KF, double *K, double *Fk, double *Dk, double *Rk,
+	double *rms_resid
+){
+	double	*dx, rms = 0.0, rms0 = 0.0, Dn = 0.0;
+	int	*qk = KF->qk, *rk = KF->rk, i, it, DoF = KF->DoF;
+
+	dx = dvector(1,DoF);
+
+	for (i=1; i<=DoF; i++)	if ( qk[i] ) Dk[i] = 0.0;
+
+	for (it=0; it < MIXED_ITER; it++) {
+		prodAx_sky ( K, KF->maxa, DoF, Dk, dx );
+		for (i=1; i<=DoF; i++)	dx[i] = qk[i] ? Fk[i] - dx[i] : 0.0;
+		ldl_solve_sky_f ( KF->Kfs, KF->maxa, DoF, KF->diags, dx );
+
+		rms = 0.0;
+		for (i=1; i<=DoF; i++)	if ( qk[i] ) rms += dx[i]*dx[i];
+		rms = sqrt ( rms / (double) DoF );
+
+		if ( it > 0 && !( rms < 0.90 * rms0 ) )	break;
+		for (i=1; i<=DoF; i++)	if ( qk[i] ) Dk[i] += dx[i];
+		rms0 = rms;
+	}
+
+	prodAx_sky ( K, KF->maxa, DoF, Dk, Rk );   /* reactions, {R_r} */
+	for (i=1; i<=DoF; i++)	Rk[i] = rk[i] ? Rk[i] - Fk[i] : 0.0;
+
+	for (i=1; i<=DoF; i++)	if ( qk[i] ) Dn += Dk[i]*Dk[i];
+	Dn = sqrt ( Dn / (double) DoF );
+	*rms_resid = rms0;
+
+	free_dvector(dx,1,DoF);
+
+	return ( rms0 <= MIXED_TOL * Dn );
+}
+
+
+/*
+ * UPDATE_FACTOR - the L D L' decomposition of [K_qq] from the decomposition
+ * KB of an earlier stiffness matrix [K0] with the same skyline, or the same
+ * sparse columns, and the same reactions, as after a change of the sections
+ * or materials of a few elements.  [K] - [K0] couples only the nw free
+ * coordinates of the changed elements.  Either 
+ *   the columns of the skyline decomposition from the first changed column
+ *   on are reduced again, with the columns before it copied from KB, or 
+ *   the decomposition KB is kept, and solve_factored() applies the 
+ *   Sherman-Morrison-Woodbury formula for the change of [K_qq] 
+ *   with nw solutions by KB, 
+ * whichever takes fewer operations.  The decomposition KB is not changed,
+ * and must be kept as long as the one returned.
+ * Returns NULL if a new sparse decomposition takes fewer operations.
+ */
+ldl_factor *update_factor(
+	ldl_factor *KB, double *K0, double *K, int *q, int *r, int *ok
+){
+	ldl_factor *KF;
+	sparse_ldl *S = KB->S;
+	double	cost_w, cost_p = 0.0, h, dK, **Zs;
+	int	*maxa = KB->maxa, *dof = KB->dof, *mark, DoF = KB->DoF,
+		nK = KB->nK, i, j, k, l, t, t0, t1, j0 = DoF+1, nw = 0;
+
+	KF = (ldl_factor *) malloc(sizeof(ldl_factor));
+	KF->DoF  = DoF;
+	KF->nK   = nK;
+	KF->maxa = maxa;
+	KF->dof  = dof;
+	KF->S    = S;
+	KF->P    = NULL;
+	KF->Kf   = KF->diag = NULL;
+	KF->Kfs  = KF->diags = NULL;
+	KF->qk   = ivector ( 1, DoF );
+	KF->rk   = ivector ( 1, DoF );
+	for (i=1; i<=DoF; i++) { KF->qk[dof[i]] = q[i];	KF->rk[dof[i]] = r[i]; }
+	KF->ok   = *ok = KB->ok;
+	KF->indefinite = 0;
+	KF->mapped = 1;
+	KF->nw   = 0;
+	KF->wk   = NULL;
+
+	/* the free coordinates coupled by [K_qq] - [K0_qq] */
+	mark = ivector(1,DoF);
+	for (j=1; j<=DoF; j++)	mark[j] = 0;
+	for (j=1; j<=DoF; j++) {
+		if ( !KF->qk[j] )	continue;
+		t0 = S ? S->kptr[j] : maxa[j];
+		t1 = S ? S->kptr[j+1] : maxa[j+1];
+		for (t=t0; t<t1; t++) {
+			i = S ? S->krow[t] : maxa[j]+j-t;
+			if ( KF->qk[i] && K[t] != K0[t] ) {
+				mark[i] = mark[j] = 1;
+				if ( j < j0 )	j0 = j;
+			}
+		}
+	}
+	for (j=1; j<=DoF; j++)	nw += mark[j];
+
+	/* operations of the Woodbury formula, and of a new decomposition */
+	h = S ? (double) S->lptr[S->ns+1] : (double) nK;
+	cost_w = 4.0*nw*h + (double) nw*nw*DoF;
+	if ( S ) {
+		for (k=1; k <= S->ns; k++) {
+			h = S->rptr[k+1] - S->rptr[k];
+			cost_p += (S->first[k+1] - S->first[k]) * h*h;
+		}
+		if ( cost_w > 0.5*cost_p ) {	/* decompose [K_qq] again */
+			free_ivector(mark,1,DoF);
+			free_ivector(KF->qk,1,DoF);
+			free_ivector(KF->rk,1,DoF);
+			free(KF);
+			return NULL;
+		}
+	} else {
+		for (j=j0; j<=DoF; j++) {
+			h = maxa[j+1] - maxa[j];
+			cost_p += 0.5*h*h;
+		}
+	}
+
+	KF->Fk   = dvector ( 1, DoF );
+	KF->Dk   = dvector ( 1, DoF );
+	KF->Rk   = dvector ( 1, DoF );
+
+	if ( !S && cost_p <= cost_w ) {	/* reduce columns j0 ... DoF again */
+		KF->mapped = 0;
+		KF->nw   = -1;
+		KF->Kf   = dvector ( 1, nK );
+		KF->diag = dvector ( 1, DoF );
+		for (i=1; i < maxa[j0]; i++)	KF->Kf[i] = KB->Kf[i];
+		for (i=maxa[j0]; i <= nK; i++)	KF->Kf[i] = K[i];
+		for (j=1; j < j0; j++)		KF->diag[j] = KB->diag[j];
+		ldl_reduce_pm_sky ( KF->Kf, maxa, DoF, KF->diag, KF->qk, j0, ok);
+		KF->ok = *ok;
+		free_ivector(mark,1,DoF);
+		return KF;
+	}
+
+	/* the Woodbury formula with the decomposition KB of [K0_qq] */
+	KF->Kf   = KB->Kf;
+	KF->diag = KB->diag;
+	KF->nw   = nw;
+	if ( nw == 0 ) {
+		free_ivector(mark,1,DoF);
+		return KF;
+	}
+	KF->wk = ivector(1,nw);
+	for (j=1, k=0; j<=DoF; j++)	if ( mark[j] )	KF->wk[++k] = j;
+	free_ivector(mark,1,DoF);
+
+	KF->Zw = dmatrix(1,nw,1,DoF);	/* [Z] = [K0_qq]^-1 [U] */
+	KF->Cw = dmatrix(1,nw,1,nw);	/* [C] = [U]'([K_qq]-[K0_qq])[U] */
+	KF->Mw = dmatrix(1,nw,1,nw);	/* [M] = [U]'[Z] ( [I] + [C][U]'[Z] ) */
+	KF->dw = dvector(1,nw);
+	Zs     = dmatrix(1,nw,1,nw);
+	for (k=1; k<=nw; k++) {
+		for (i=1; i<=DoF; i++)	KF->Fk[i] = 0.0;
+		KF->Fk[KF->wk[k]] = 1.0;
+		base_solve ( KB, K0, KF->Fk, KF->Zw[k], q, r );
+	}
+	for (k=1; k<=nw; k++) {
+		for (l=1; l<=nw; l++) {
+			Zs[k][l] = KF->Zw[l][KF->wk[k]];
+			i = KF->wk[k];	j = KF->wk[l];
+			if ( i > j )	{ i = KF->wk[l];  j = KF->wk[k]; }
+			dK = 0.0;
+			if ( S )		t = sparse_K_loc ( S, i, j );
+			else if ( j-i < maxa[j+1]-maxa[j] )
+						t = maxa[j]+j-i;
+			else			t = 0;
+			if ( t )	dK = K[t] - K0[t];
+			KF->Cw[k][l] = dK;
+		}
+	}
+	for (k=1; k<=nw; k++) {
+		for (l=1; l<=nw; l++) {
+			KF->Mw[k][l] = Zs[k][l];
+			for (i=1; i<=nw; i++)
+				for (j=1; j<=nw; j++)
+					KF->Mw[k][l] += Zs[k][i]*KF->Cw[i][j]*Zs[j][l];
+		}
+	}
+	free_dmatrix(Zs,1,nw,1,nw);
+
+	ldl_dcmp ( KF->Mw, nw, KF->dw, KF->Fk, KF->Fk, 1, 0, &i );
+	if ( i < 0 ) {	/* [K_qq] is not positive definite */
+	 	fprintf(stderr," Make sure that all six");
+		fprintf(stderr," rigid body translations are restrained!\n");
+		KF->ok = *ok = i;
+	}
+
+	return KF;
+}
+
+
+/*
+ * BASE_SOLVE - {x_q} = [K0_qq]^-1 {b_q} and {x_r} = {0} with the 
+ * decomposition KB of an earlier [K0], in the numbering of K
+ */
+static void base_solve(
+	ldl_factor *KB, double *K0, double *b, double *x, int *q, int *r
+){
+	double	*bs, *xs, *c;
+	int	*dof = KB->dof, DoF = KB->DoF, i, pd;
+
+	c = dvector(1,DoF);
+	if ( KB->S ) {
+		bs = dvector(1,DoF);
+		xs = dvector(1,DoF);
+		for (i=1; i<=DoF; i++) { bs[i] = b[dof[i]];  xs[i] = 0.0; }
+		sparse_ldl_pm ( KB->S, K0, dof, bs, xs, c, r, 0,1,&pd );
+		for (i=1; i<=DoF; i++)	x[dof[i]] = q[i] ? xs[i] : 0.0;
+		free_dvector(bs,1,DoF);
+		free_dvector(xs,1,DoF);
+	} else {
+		for (i=1; i<=DoF; i++)	x[i] = 0.0;
+		ldl_dcmp_pm_sky ( KB->Kf, KB->maxa, DoF, KB->diag, b, x, c,
+						KB->qk, KB->rk, 0, 1, &pd );
+	}
+	free_dvector(c,1,DoF);
+}
+
+
+/*
+ * SOLVE_UPDATED - {D_q} and {R_r} with a decomposition from update_factor(),
+ * by iterative refinement of the equilibrium error of [K].  Each correction
+ * {y} = [K0_qq]^-1 {res_q} is updated by the Woodbury formula,
+ *   {y} <- {y} - [Z] [M]^-1 [U]'[Z] [C] [U]'{y}
+ * {Fk}, {Dk}, {Rk} are in the numbering of K, with the prescribed {Dk_r}.
+ */
+static void solve_updated(
+	ldl_factor *KF, double *K, double *Fk, double *Dk, double *Rk,
+	int *q, int *r, double *rms_resid
+){
+	double	*dx, *y, *t, *u, rms = 0.0, rms0 = 0.0, s;
+	int	*qk = KF->qk, *rk = KF->rk, *wk = KF->wk, nw = KF->nw,
+		i, k, l, it, pd, DoF = KF->DoF;
+
+	dx = dvector(1,DoF);
+	y  = dvector(1,DoF);
+	if ( nw > 0 ) {
+		t = dvector(1,nw);
+		u = dvector(1,nw);
+	}
+
+	for (i=1; i<=DoF; i++)	if ( qk[i] ) Dk[i] = 0.0;
+
+	for (it=0; it < MIXED_ITER; it++) {
+		prod_K ( K, KF->maxa, KF->S, DoF, Dk, dx );
+		for (i=1; i<=DoF; i++)	dx[i] = qk[i] ? Fk[i] - dx[i] : 0.0;
+		base_solve ( KF, K, dx, y, q, r );
+
+		if ( nw > 0 ) {		/* the Woodbury formula */
+			for (k=1; k<=nw; k++) {
+				s = 0.0;
+				for (l=1; l<=nw; l++)	s += KF->Cw[k][l]*y[wk[l]];
+				u[k] = s;
+			}
+			for (k=1; k<=nw; k++) {
+				s = 0.0;
+				for (l=1; l<=nw; l++)	s += KF->Zw[l][wk[k]]*u[l];
+				t[k] = s;
+			}
+			ldl_dcmp ( KF->Mw, nw, KF->dw, t, u, 0, 1, &pd );
+			for (k=1; k<=nw; k++)
+				for (i=1; i<=DoF; i++)	y[i] -= KF->Zw[k][i]*u[k];
+		}
+
+		rms = 0.0;
+		for (i=1; i<=DoF; i++)	if ( qk[i] ) rms += y[i]*y[i];
+		rms = sqrt ( rms / (double) DoF );
+
+		if ( it > 0 && !( rms < 0.90 * rms0 ) )	break;
+		for (i=1; i<=DoF; i++)	if ( qk[i] ) Dk[i] += y[i];
+		rms0 = rms;
+	}
+
+	prod_K ( K, KF->maxa, KF->S, DoF, Dk, Rk );   /* reactions, {R_r} */
+	for (i=1; i<=DoF; i++)	Rk[i] = rk[i] ? Rk[i] - Fk[i] : 0.0;
+	*rms_resid = rms0;
+
+	free_dvector(dx,1,DoF);
+	free_dvector(y,1,DoF);
+	if ( nw > 0 ) {
+		free_dvector(t,1,nw);
+		free_dvector(u,1,nw);
+	}
+}
+
+
+/*
+ * SOLVE_FACTORED  -  solve {F} = [K]{D} for {D_q} and {R_r} with the 
+ * L D L' decomposition from factor_system(), followed by iterative refinement
+ * Prescribed displacements are "mechanical loads" not "temperature loads"  
+ * {F}, {D}, {R}, q and r are in the node numbering of the input data, and
+ * q and r must be those given to factor_system()
+ */
+void solve_factored(
+	ldl_factor *KF, double *K,
+	double *D, double *F, double *R,
+	int *q, int *r, int *ok, int verbose, double *rms_resid
+){
+	double	*Fk = KF->Fk, *Dk = KF->Dk, *Rk = KF->Rk;
+	int	*dof = KF->dof, i, DoF = KF->DoF;
+
+	verbose = 0;		/* suppress verbose output		*/
+
+	*ok = KF->ok;
+	if ( *ok < 0 && !KF->indefinite )  return; /* K is not pos-def	*/
+
+	if ( KF->nw >= 0 ) {	/* update of an earlier decomposition */
+		for (i=1; i<=DoF; i++) {
+			Fk[dof[i]] = F[i];  Dk[dof[i]] = D[i];  Rk[dof[i]] = R[i];
+		}
+		solve_updated ( KF, K, Fk, Dk, Rk, q, r, rms_resid );
+		for (i=1; i<=DoF; i++) { D[i] = Dk[dof[i]];  R[i] = Rk[dof[i]]; }
+		return;
+	}
+
+	if ( KF->S ) {
+		sparse_ldl_pm ( KF->S, K, dof, F,D,R, r, 0,1, ok );
+		*rms_resid = *ok = 1;
+		do {	/* improve solution for D[q] and R[r] */
+			sparse_mprove_pm ( KF->S, K, dof, F,D,R, q,r,
+							rms_resid, ok );
+		} while ( *ok );
+		return;
+	}
+
+	for (i=1; i<=DoF; i++) {
+		Fk[dof[i]] = F[i];	Dk[dof[i]] = D[i];	Rk[dof[i]] = R[i];
+	}
+
+	if ( KF->Kfs ) {	/* single-precision decomposition */
+		if ( solve_single ( KF, K, Fk, Dk, Rk, rms_resid ) ) {
+			for (i=1; i<=DoF; i++) {
+				D[i] = Dk[dof[i]];  R[i] = Rk[dof[i]];
+			}
+			return;
+		}
+		/* the refinements stalled: a double-precision decomposition */
+		free_vector( KF->Kfs, 1, KF->nK );
+		free_vector( KF->diags, 1, DoF );
+		KF->Kfs = KF->diags = NULL;
+		factor_skyline ( KF, K, ok );
+		KF->ok = *ok;
+		if ( *ok < 0 && !KF->indefinite )  return;
+		for (i=1; i<=DoF; i++) {
+			Fk[dof[i]] = F[i];  Dk[dof[i]] = D[i];  Rk[dof[i]] = R[i];
+		}
+	}
+
+	/*  LDL'  back-substitution for D[q] and R[r] */
+	if ( KF->P )
+		ooc_ldl_dcmp_pm_sky ( KF->P, KF->diag, Fk,Dk,Rk,
+						KF->qk,KF->rk, 0,1, ok );
+	else	ldl_dcmp_pm_sky ( KF->Kf, KF->maxa, DoF, KF->diag, Fk,Dk,Rk,
+						KF->qk,KF->rk, 0,1, ok );
+	if ( verbose ) fprintf(stdout,"    LDL' RMS residual:");
+	*rms_resid = *ok = 1;
+	do {	/* improve solution for D[q] and R[r] */
+		if ( KF->P )
+		 ooc_ldl_mprove_pm_sky ( K, KF->P, KF->diag,
+				Fk,Dk,Rk, KF->qk,KF->rk, rms_resid, ok );
+		else
+		 ldl_mprove_pm_sky ( K, KF->Kf, KF->maxa, DoF, KF->diag,
+				Fk,Dk,Rk, KF->qk,KF->rk, rms_resid, ok );
+		if ( verbose ) fprintf(stdout,"%9.2e", *rms_resid );
+	} while ( *ok );
+        if ( verbose ) fprintf(stdout,"\n");
+
+	for (i=1; i<=DoF; i++) { D[i] = Dk[dof[i]];  R[i] = Rk[dof[i]]; }
+}
+
+
+/*
+ * SOLVE_FACTORED_BLOCK  -  solve {F} = [K]{D} for {D_q} and {R_r} for each
+ * of the load vectors F[k], k = 1 ... nb, with sel[k] > 0, or for all of 
+ * them if sel is NULL, with the L D L' decomposition from factor_system().
+ * With the skyline decomposition in memory, up to RHS_BLOCK load vectors
+ * are gathered into panels with a row for each coordinate of K, solved
+ * and refined together by ldl_solve_pm_sky_block() and 
+ * ldl_mprove_pm_sky_block(), and scattered back;  otherwise each is solved
+ * by solve_factored().  The solutions are those of solve_factored().
+ * D[k] holds the prescribed displacements {D_r} of load vector k on input,
+ * and rms_resid[k] is the RMS residual of its solution.
+ */
+void solve_factored_block(
+	ldl_factor *KF, double *K,
+	double **D, double **F, double **R, int nb, int *sel,
+	int *q, int *r, int *ok, double *rms_resid
+){
+	double	**Fb, **Db, **Rb,	/* panels of the load vectors	*/
+		*rms;			/* the RMS residual of each	*/
+	int	*dof = KF->dof, *okb, *kb, i, k, k0, m, n, np, DoF = KF->DoF;
+
+	*ok = KF->ok;
+	if ( *ok < 0 && !KF->indefinite )  return; /* K is not pos-def	*/
+
+	if ( !KF->Kf || KF->nw >= 0 ) {	/* sparse, single, out of core	*/
+		for (k=1; k <= nb; k++)	if ( !sel || sel[k] > 0 )
+			solve_factored ( KF, K, D[k], F[k], R[k], q, r, ok, 0,
+							&rms_resid[k] );
+		return;
+	}
+
+	kb = ivector ( 1, nb );		/* the load vectors to be solved */
+	for (n=0, k=1; k <= nb; k++)	if ( !sel || sel[k] > 0 )  kb[++n] = k;
+
+	np  = ( n < RHS_BLOCK ) ? n : RHS_BLOCK;
+	if ( np > 0 ) {
+		Fb  = dmatrix ( 1, DoF, 1, np );
+		Db  = dmatrix ( 1, DoF, 1, np );
+		Rb  = dmatrix ( 1, DoF, 1, np );
+		rms = dvector ( 1, np );
+		okb = ivector ( 1, np );
+	}
+
+	for (k0=0; k0 < n; k0 += np) {
+		m = ( n-k0 < np ) ? n-k0 : np;
+		for (k=1; k <= m; k++)
+			for (i=1; i<=DoF; i++) {
+				Fb[dof[i]][k] = F[kb[k0+k]][i];
+				Db[dof[i]][k] = D[kb[k0+k]][i];
+				Rb[dof[i]][k] = R[kb[k0+k]][i];
+			}
 
-		for ( l=1; l <= 12; l++ ) {
-			ii = ind[l][i];
-			for ( ll=1; ll <= 12; ll++ ) {
-				jj = ind[ll][i];
-				K[ii][jj] += k[l][ll];
+		/*  LDL'  back-substitution for D[q] and R[r] */
+		ldl_solve_pm_sky_block ( KF->Kf, KF->maxa, DoF, KF->diag,
+					Fb, Db, Rb, m, KF->qk, KF->rk );
+		for (k=1; k <= m; k++) {
+			rms[k] = 1.0;
+			okb[k] = 1;
+		}
+		/* improve the solutions for D[q] and R[r] */
+		while ( ldl_mprove_pm_sky_block ( K, KF->Kf, KF->maxa, DoF,
+				KF->diag, Fb, Db, Rb, m, KF->qk, KF->rk,
+				rms, okb ) > 0 )	;
+
+		for (k=1; k <= m; k++) {
+			for (i=1; i<=DoF; i++) {
+				D[kb[k0+k]][i] = Db[dof[i]][k];
+				R[kb[k0+k]][i] = Rb[dof[i]][k];
 			}
+			rms_resid[kb[k0+k]] = rms[k];
 		}
 	}
-	free_dmatrix ( k,1,12,1,12);
-	free_imatrix(ind,1,12,1,nE);
-	return;
+	*ok = 0;		/* as from the last refinement		*/
+
+	if ( np > 0 ) {
+		free_dmatrix ( Fb, 1, DoF, 1, np );
+		free_dmatrix ( Db, 1, DoF, 1, np );
+		free_dmatrix ( Rb, 1, DoF, 1, np );
+		free_dvector ( rms, 1, np );
+		free_ivector ( okb, 1, np );
+	}
+	free_ivector ( kb, 1, nb );
 }
 
 
 /*
- * ELASTIC_K - space frame elastic stiffness matrix in global coordnates	22oct02
+ * FREE_FACTOR  -  release the memory of an L D L' decomposition 
+ * from factor_system()
  */
-void elastic_K(
-	double **k, vec3 *xyz, float *r,
-	double L, double Le,
-	int n1, int n2,
-	float Ax, float Asy, float Asz,
-	float J, float Iy, float Iz, float E, float G, float p,
-	int shear
+void free_factor( ldl_factor *KF )
+{
+	int	DoF = KF->DoF;
+
+	if ( KF->Kfs ) {
+		free_vector( KF->Kfs, 1, KF->nK );
+		free_vector( KF->diags, 1, DoF );
+	}
+	if ( KF->Kf && !KF->mapped ) {
+		free_dvector( KF->diag, 1, DoF );
+		free_dvector( KF->Kf, 1, KF->nK );
+	}
+	if ( KF->P && KF->diag )	free_dvector( KF->diag, 1, DoF );
+	if ( KF->qk ) {
+		free_ivector( KF->qk, 1, DoF );
+		free_ivector( KF->rk, 1, DoF );
+	}
+	if ( KF->nw > 0 ) {
+		free_ivector( KF->wk, 1, KF->nw );
+		free_dmatrix( KF->Zw, 1, KF->nw, 1, DoF );
+		free_dmatrix( KF->Cw, 1, KF->nw, 1, KF->nw );
+		free_dmatrix( KF->Mw, 1, KF->nw, 1, KF->nw );
+		free_dvector( KF->dw, 1, KF->nw );
+	}
+	free_dvector( KF->Fk, 1, DoF );
+	free_dvector( KF->Dk, 1, DoF );
+	free_dvector( KF->Rk, 1, DoF );
+	free( KF );
+}
+
+
+/*
+ * SOLVE_SYSTEM  -  solve {F} =   [K]{D} via L D L' decomposition        27dec01
+ * Prescribed displacements are "mechanical loads" not "temperature loads"  
+ * [K] is stored in skyline form and is not changed; 
+ * {F}, {D}, {R}, q and r are in the node numbering of the input data,
+ * structural coordinate i is located in row and column dof[i] of [K]
+ * If S is not NULL the sparse supernodal L D L' decomposition is used,
+ * and if P is not NULL the out-of-core skyline decomposition.
+ * To solve for several load vectors with the same [K], use 
+ * factor_system() once and solve_factored() for each load vector.
+ */
+void solve_system(
+	double *K, int *maxa, int *dof, sparse_ldl *S, ooc_profile *P,
+	double *D, double *F, double *R,
+	int DoF, int *q, int *r, int *ok, int verbose, double *rms_resid
 ){
-	double   t1, t2, t3, t4, t5, t6, t7, t8, t9,     /* coord Xformn */
-		Ksy, Ksz;		/* shear deformatn coefficients	*/
-	int     i, j;
+	ldl_factor *KF;
 
-	coord_trans ( xyz, L, n1, n2,
-				&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p );
+	KF = factor_system ( K, maxa, dof, S, P, DoF, q, r, ok );
+	solve_factored ( KF, K, D, F, R, q, r, ok, verbose, rms_resid );
+	free_factor ( KF );
+}
 
-	for (i=1;i<=12;i++)	for (j=1;j<=12;j++)	k[i][j] = 0.0;
 
-	if ( shear ) {
-		Ksy = 12.*E*Iz / (G*Asy*Le*Le);
-		Ksz = 12.*E*Iy / (G*Asz*Le*Le);
-	} else	Ksy = Ksz = 0.0;
+#define PCG_TOL		1e-12	/* relative residual of a converged solution */
+#define IC_SHIFT	1e-3	/* first diagonal shift of a failed 
+				   incomplete Cholesky decomposition	*/
 
-	k[1][1]  = k[7][7]   = E*Ax / Le;
-	k[2][2]  = k[8][8]   = 12.*E*Iz / ( Le*Le*Le*(1.+Ksy) );
-	k[3][3]  = k[9][9]   = 12.*E*Iy / ( Le*Le*Le*(1.+Ksz) );
-	k[4][4]  = k[10][10] = G*J / Le;
-	k[5][5]  = k[11][11] = (4.+Ksz)*E*Iy / ( Le*(1.+Ksz) );
-	k[6][6]  = k[12][12] = (4.+Ksy)*E*Iz / ( Le*(1.+Ksy) );
+/*
+ * NEW_PCG_SOLVER - the preconditioner for the conjugate gradient solutions
+ * of pcg_solve(), in which [K] is applied element by element with the
+ * matrices from cache_elements(), so that [K] is never assembled.
+ *   PCG_JACOBI: the diagonal of [K_qq]
+ *   PCG_BLOCK:  the Cholesky factor of the 6-by-6 block of [K_qq] at each
+ *               node; the diagonal of a block that is not pos-def
+ *   PCG_IC:     the incomplete Cholesky factor of [K_qq] with the pattern
+ *               of the nodes joined by frame elements, IC(0)
+ * Rows and columns of reaction coordinates are those of the identity.
+ */
+pcg_solver *new_pcg_solver(
+	K_cache *KC, int *dof, int nN, int nE, int *N1, int *N2,
+	int DoF, int *q, int *r, int precond
+){
+	pcg_solver *PC;
+	double	k[12][12], *b, s, d[6];
+	int	i, j, l, ll, n, ok;
+
+	PC = (pcg_solver *) malloc ( sizeof(pcg_solver) );
+	PC->DoF = DoF;
+	PC->nN  = nN;
+	PC->precond = precond;
+	PC->KC  = KC;
+	PC->dof = dof;
+	PC->dinv = PC->blk = PC->a = NULL;
+	PC->ia = PC->ja = NULL;
+	PC->iter = 0;
+	PC->qk  = ivector(1,DoF);
+	PC->rk  = ivector(1,DoF);
+	PC->x   = dvector(1,DoF);
+	PC->res = dvector(1,DoF);
+	PC->z   = dvector(1,DoF);
+	PC->p   = dvector(1,DoF);
+	PC->Ap  = dvector(1,DoF);
+	PC->Fk  = dvector(1,DoF);
+	for (i=1; i<=DoF; i++) { PC->qk[dof[i]] = q[i];  PC->rk[dof[i]] = r[i]; }
+
+	if ( precond == PCG_IC ) {
+		if ( incomplete_cholesky ( PC, nE, N1, N2 ) )	return PC;
+		fprintf(stderr," Incomplete Cholesky decomposition failed;");
+		fprintf(stderr," block Jacobi preconditioner used.\n");
+		PC->precond = PCG_BLOCK;
+	}
 
-	k[5][3]  = k[3][5]   = -6.*E*Iy / ( Le*Le*(1.+Ksz) );
-	k[6][2]  = k[2][6]   =  6.*E*Iz / ( Le*Le*(1.+Ksy) );
-	k[7][1]  = k[1][7]   = -k[1][1];
+	/* the 6-by-6 block of [K] at each node, blk[36*(n-1)+6*l+ll+1] */
+	PC->blk = dvector(1,36*nN);
+	for (i=1; i <= 36*nN; i++)	PC->blk[i] = 0.0;
+	for (i=1; i <= nE; i++) {
+		unpack_K ( KC, i, 0.0, k );
+		for (l=0; l < 6; l++) {
+			for (ll=0; ll < 6; ll++) {
+				PC->blk[36*(N1[i]-1)+6*l+ll+1] += k[l][ll];
+				PC->blk[36*(N2[i]-1)+6*l+ll+1] += k[l+6][ll+6];
+			}
+		}
+	}
+	for (n=1; n <= nN; n++) {	/* reactions: rows of the identity */
+		b = PC->blk + 36*(n-1);
+		for (l=0; l < 6; l++) {
+			if ( !r[6*n-5+l] )	continue;
+			for (ll=0; ll < 6; ll++)  b[6*l+ll+1] = b[6*ll+l+1] = 0.0;
+			b[7*l+1] = 1.0;
+		}
+	}
 
-	k[12][8] = k[8][12]  =  k[8][6] = k[6][8] = -k[6][2];
-	k[11][9] = k[9][11]  =  k[9][5] = k[5][9] = -k[5][3];
-	k[10][4] = k[4][10]  = -k[4][4];
-	k[11][3] = k[3][11]  =  k[5][3];
-	k[12][2] = k[2][12]  =  k[6][2];
+	if ( PC->precond == PCG_JACOBI ) {
+		PC->dinv = dvector(1,DoF);
+		for (n=1; n <= nN; n++) {
+			for (l=0; l < 6; l++) {
+				s = PC->blk[36*(n-1)+7*l+1];
+				PC->dinv[dof[6*n-5+l]] = ( s > 0.0 ) ? 1.0/s : 1.0;
+			}
+		}
+		free_dvector(PC->blk,1,36*nN);
+		PC->blk = NULL;
+		return PC;
+	}
 
-	k[8][2]  = k[2][8]   = -k[2][2];
-	k[9][3]  = k[3][9]   = -k[3][3];
-	k[11][5] = k[5][11]  = (2.-Ksz)*E*Iy / ( Le*(1.+Ksz) );
-	k[12][6] = k[6][12]  = (2.-Ksy)*E*Iz / ( Le*(1.+Ksy) );
+	for (n=1; n <= nN; n++) {	/* Cholesky factor L of each block */
+		b = PC->blk + 36*(n-1);
+		for (l=0; l < 6; l++)	d[l] = b[7*l+1];
+		ok = 1;
+		for (j=0; j < 6 && ok; j++) {
+			for (i=j; i < 6; i++) {
+				s = b[6*i+j+1];
+				for (l=0; l < j; l++)	s -= b[6*i+l+1]*b[6*j+l+1];
+				if ( i == j ) {
+					if ( s <= 0.0 ) { ok = 0; break; }
+					b[7*j+1] = sqrt(s);
+				} else	b[6*i+j+1] = s / b[7*j+1];
+			}
+		}
+		if ( !ok ) {	/* the square root of the diagonal */
+			for (l=0; l < 36; l++)	b[l+1] = 0.0;
+			for (l=0; l < 6; l++)
+				b[7*l+1] = ( d[l] > 0.0 ) ? sqrt(d[l]) : 1.0;
+		}
+	}
 
-#ifdef MATRIX_DEBUG
-	save_dmatrix ( "ke", k, 1,12, 1,12, 0, "w" ); /* element elastic stiffness matrix */
-#endif
+	return PC;
+}
 
-	atma(t1,t2,t3,t4,t5,t6,t7,t8,t9, k, r[n1],r[n2]);	/* globalize */
 
-	/* check and enforce symmetry of elastic element stiffness matrix */
+/*
+ * INCOMPLETE_CHOLESKY - the incomplete Cholesky decomposition of [K_qq],
+ * [L][L]', in which L has the terms of the lower triangle of [K] coupling
+ * the coordinates of nodes joined by a frame element, IC(0).
+ * Row i of L is ja[ia[i] .. ia[i+1]-1] in the numbering of K, in ascending
+ * order, ending with the diagonal.  If a pivot is not positive the 
+ * decomposition is repeated with the diagonal of [K] scaled by 1+IC_SHIFT,
+ * and so on with shifts ten times as large.  Returns 0 if that fails.
+ */
+static int incomplete_cholesky( pcg_solver *PC, int nE, int *N1, int *N2 )
+{
+	double	k[12][12], *a0, *a, s, shift;
+	int	*dof = PC->dof, *rk = PC->rk, *ia, *ja, *node, *nptr, *nadj, 
+		*pos, *ind, DoF = PC->DoF, nN = PC->nN, nnz,
+		i, j, l, ll, m, n, t, ii, jj, lo, hi, mid, a1, a2, ok=0;
+
+	/* the nodes joined to each node, nadj[nptr[n] .. nptr[n+1]-1]	*/
+	nptr = ivector(1,nN+1);
+	pos  = ivector(1,nN);
+	nadj = ivector(1,2*nE+nN);
+	for (n=1; n <= nN; n++)	pos[n] = 1;
+	for (i=1; i <= nE; i++) { ++pos[N1[i]]; ++pos[N2[i]]; }
+	nptr[1] = 1;
+	for (n=1; n <= nN; n++)	nptr[n+1] = nptr[n] + pos[n];
+	for (n=1; n <= nN; n++) { pos[n] = nptr[n];  nadj[pos[n]++] = n; }
+	for (i=1; i <= nE; i++) {
+		nadj[pos[N1[i]]++] = N2[i];
+		nadj[pos[N2[i]]++] = N1[i];
+	}
 
-	for(i=1; i<=12; i++){
-	    for (j=i+1; j<=12; j++){
-			if( k[i][j] != k[j][i] ) {
-				if(fabs(k[i][j]/k[j][i]-1.0) > 1.0e-6 
-					&&(fabs(k[i][j]/k[i][i]) > 1e-6 
-						|| fabs(k[j][i]/k[i][i]) > 1e-6
-					)
-				){
-					fprintf(stderr,"elastic_K: element stiffness matrix not symetric ...\n" ); 
-					fprintf(stderr," ... k[%d][%d] = %15.6e \n",i,j,k[i][j] ); 
-					fprintf(stderr," ... k[%d][%d] = %15.6e   ",j,i,k[j][i] ); 
-					fprintf(stderr," ... relative error = %e \n",  fabs(k[i][j]/k[j][i]-1.0) ); 
-					fprintf(stderr," ... element matrix saved in file 'kt'\n");
-					save_dmatrix ( "kt", k, 1,12, 1,12, 0, "w" ); 
+	node = ivector(1,DoF);	/* the node at each row of K */
+	for (n=1; n <= nN; n++)	for (l=0; l < 6; l++)  node[dof[6*n-5+l]] = n;
+
+	/* the pattern of L, row by row, in ascending order */
+	nnz = 0;
+	for (i=1; i <= DoF; i++)
+		for (t=nptr[node[i]]; t < nptr[node[i]+1]; t++)
+			for (l=0; l < 6; l++)
+				if ( dof[6*nadj[t]-5+l] <= i )	++nnz;
+	ia = ivector(1,DoF+1);
+	ja = ivector(1,nnz);
+	ia[1] = m = 1;
+	for (i=1; i <= DoF; i++) {
+		for (t=nptr[node[i]]; t < nptr[node[i]+1]; t++) {
+			for (l=0; l < 6; l++) {
+				j = dof[6*nadj[t]-5+l];
+				if ( j > i )	continue;
+				for (ll=m-1; ll >= ia[i] && ja[ll] > j; ll--) ;
+				if ( ll >= ia[i] && ja[ll] == j )  continue;
+				for (n=m; n > ll+1; n--)  ja[n] = ja[n-1];
+				ja[ll+1] = j;	/* nodes joined by two elements */
+				++m;		/* appear once			*/
+			}
+		}
+		ia[i+1] = m;
+	}
+	free_ivector(nadj,1,2*nE+nN);
+	free_ivector(pos,1,nN);
+	free_ivector(nptr,1,nN+1);
+	free_ivector(node,1,DoF);
+
+	/* the lower triangle of [K_qq], and the identity for [K_rr]	*/
+	a0 = dvector(1,ia[DoF+1]);
+	for (t=1; t < ia[DoF+1]; t++)	a0[t] = 0.0;
+	for (i=1; i <= DoF; i++)	if ( rk[i] )  a0[ia[i+1]-1] = 1.0;
+	for (m=1; m <= nE; m++) {
+		unpack_K ( PC->KC, m, 0.0, k );
+		ind = PC->KC->ind[m];
+		for (l=0; l < 12; l++) {
+			ii = ind[l+1];
+			if ( rk[ii] )	continue;
+			for (ll=0; ll < 12; ll++) {
+				jj = ind[ll+1];
+				if ( jj > ii || rk[jj] )	continue;
+				lo = ia[ii];	hi = ia[ii+1]-1;
+				while ( lo < hi ) {
+					mid = (lo+hi)/2;
+					if ( ja[mid] < jj )	lo = mid+1;
+					else			hi = mid;
 				}
+				a0[lo] += k[l][ll];
+			}
+		}
+	}
 
-				k[i][j] = k[j][i] = 0.5 * ( k[i][j] + k[j][i] );
+	a = dvector(1,ia[DoF+1]);
+	for (shift = 0.0; shift < 1.0 && !ok; 
+				shift = ( shift == 0.0 ) ? IC_SHIFT : 10.0*shift ) {
+		for (t=1; t < ia[DoF+1]; t++)	a[t] = a0[t];
+		ok = 1;
+		for (i=1; i <= DoF && ok; i++) {
+			for (t=ia[i]; t < ia[i+1]; t++) {
+				j = ja[t];
+				s = a[t];
+				a1 = ia[i];	a2 = ia[j];  /* rows i and j of L */
+				while ( a1 < t && a2 < ia[j+1]-1 ) {
+					if      ( ja[a1] < ja[a2] )	a1++;
+					else if ( ja[a1] > ja[a2] )	a2++;
+					else	s -= a[a1++]*a[a2++];
+				}
+				if ( j < i )	a[t] = s / a[ia[j+1]-1];
+				else {
+					s += shift * a0[t];
+					if ( s <= 0.0 )	{ ok = 0; break; }
+					a[t] = sqrt(s);
+				}
 			}
 		}
 	}
-#ifdef MATRIX_DEBUG
-	save_dmatrix ( "ket", k, 1,12, 1,12, 0, "w" ); /* transformed element matx */
-#endif
+	free_dvector(a0,1,ia[DoF+1]);
+
+	if ( !ok ) {
+		free_dvector(a,1,ia[DoF+1]);
+		free_ivector(ja,1,nnz);
+		free_ivector(ia,1,DoF+1);
+		return 0;
+	}
+	PC->ia = ia;
+	PC->ja = ja;
+	PC->a  = a;
+	return 1;
 }
 
 
 /*
- * GEOMETRIC_K - space frame geometric stiffness matrix, global coordnates 20dec07
+ * PRECONDITION - {z} = [M]^-1 {res} for the preconditioner of 
+ * new_pcg_solver(), in the numbering of K
  */
-void geometric_K(
-	double **k, vec3 *xyz, float *r,
-	double L, double Le,
-	int n1, int n2, float Ax, float Asy, float Asz, float J,
-	float Iy, float Iz, float E, float G, float p, double T,
-	int shear
-){
-	double t1, t2, t3, t4, t5, t6, t7, t8, t9; /* coord Xformn */
-	double **kg;
-	double Ksy,Ksz,Dsy,Dsz; /* shear deformation coefficients	*/
-	int i, j;
+static void precondition( pcg_solver *PC, double *res, double *z )
+{
+	double	*b, y[6], s;
+	int	*dof = PC->dof, *ia = PC->ia, *ja = PC->ja,
+		DoF = PC->DoF, i, l, ll, n, t;
+
+	switch ( PC->precond ) {
+	 case PCG_JACOBI:
+		for (i=1; i <= DoF; i++)	z[i] = PC->dinv[i] * res[i];
+		break;
+	 case PCG_BLOCK:
+		for (n=1; n <= PC->nN; n++) {
+			b = PC->blk + 36*(n-1);
+			for (l=0; l < 6; l++) {		/* [L]{y} = {res} */
+				s = res[dof[6*n-5+l]];
+				for (ll=0; ll < l; ll++)  s -= b[6*l+ll+1]*y[ll];
+				y[l] = s / b[7*l+1];
+			}
+			for (l=5; l >= 0; l--) {	/* [L]'{z} = {y} */
+				s = y[l];
+				for (ll=l+1; ll < 6; ll++) s -= b[6*ll+l+1]*y[ll];
+				y[l] = s / b[7*l+1];
+			}
+			for (l=0; l < 6; l++)	z[dof[6*n-5+l]] = y[l];
+		}
+		break;
+	 case PCG_IC:
+		for (i=1; i <= DoF; i++) {		/* [L]{z} = {res} */
+			s = res[i];
+			for (t=ia[i]; t < ia[i+1]-1; t++)  s -= PC->a[t]*z[ja[t]];
+			z[i] = s / PC->a[ia[i+1]-1];
+		}
+		for (i=DoF; i >= 1; i--) {		/* [L]'{z} = {z} */
+			z[i] /= PC->a[ia[i+1]-1];
+			for (t=ia[i]; t < ia[i+1]-1; t++)  z[ja[t]] -= PC->a[t]*z[i];
+		}
+		break;
+	}
+}
 
-	coord_trans(
-		xyz, L, n1, n2, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p 
-	);
 
-	kg = dmatrix(1,12,1,12);
-	for (i=1;i<=12;i++)	for (j=1;j<=12;j++)	kg[i][j] = 0.0;
+/*
+ * PCG_SOLVE - solve {F} = [K]{D} for {D_q} and {R_r} by preconditioned 
+ * conjugate gradient iterations on [K_qq]{D_q} = {F_q} - [K_qr]{D_r}, 
+ * with [K] applied element by element by element_product_K().
+ * {D_r} holds the prescribed displacements.  The iterations start 
+ * from {D_q} = {D0_q}, which is then set to the solution, so that D0 
+ * carries the solution of one load case to the next.  
+ * {F}, {D}, {R}, {D0} are in the node numbering of the input data.
+ * Returns 1 if [K_qq]{D_q} is within PCG_TOL of {F_q} - [K_qr]{D_r}.
+ */
+int pcg_solve(
+	pcg_solver *PC, double *D, double *F, double *R, double *D0,
+	double *rms_resid
+){
+	double	*x = PC->x, *res = PC->res, *z = PC->z, *p = PC->p, 
+		*Ap = PC->Ap, *Fk = PC->Fk,
+		bn = 0.0, rn, rz, rz0, pAp, alpha;
+	int	*dof = PC->dof, *qk = PC->qk, *rk = PC->rk, 
+		DoF = PC->DoF, i, it, maxit = 2*DoF;
 
-	if ( shear ) {
-		Ksy = 12.*E*Iz / (G*Asy*Le*Le);
-		Ksz = 12.*E*Iy / (G*Asz*Le*Le);
-		Dsy = (1+Ksy)*(1+Ksy);
-		Dsz = (1+Ksz)*(1+Ksz);
-	} else{
-		Ksy = Ksz = 0.0;
-		Dsy = Dsz = 1.0;
+	for (i=1; i<=DoF; i++) {
+		Fk[dof[i]] = F[i];
+		x[dof[i]]  = rk[dof[i]] ? D[i] : D0[i];
+		p[dof[i]]  = rk[dof[i]] ? D[i] : 0.0;
 	}
 
+	/* the norm of {b_q} = {F_q} - [K_qr]{D_r} */
+	element_product_K ( PC->KC, NULL, p, Ap );
+	for (i=1; i<=DoF; i++)	if ( qk[i] )	bn += (Fk[i]-Ap[i])*(Fk[i]-Ap[i]);
+	bn = sqrt(bn);
 
-        kg[1][1]  = kg[7][7]   = 0.0; // T/L;
-
-	kg[2][2]  = kg[8][8]   = T/L*(1.2+2.0*Ksy+Ksy*Ksy)/Dsy;
-	kg[3][3]  = kg[9][9]   = T/L*(1.2+2.0*Ksz+Ksz*Ksz)/Dsz;
-	kg[4][4]  = kg[10][10] = T/L*J/Ax;
-	kg[5][5]  = kg[11][11] = T*L*(2.0/15.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz;
-	kg[6][6]  = kg[12][12] = T*L*(2.0/15.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy;
-
-        kg[1][7]  = kg[7][1]   = 0.0; // -T/L;
- 
-	kg[5][3]  = kg[3][5]   =  kg[11][3] = kg[3][11] = -T/10.0/Dsz;
-	kg[9][5]  = kg[5][9]   =  kg[11][9] = kg[9][11] =  T/10.0/Dsz;
-	kg[6][2]  = kg[2][6]   =  kg[12][2] = kg[2][12] =  T/10.0/Dsy;
-	kg[8][6]  = kg[6][8]   =  kg[12][8] = kg[8][12] = -T/10.0/Dsy;
+	/* the residual {res_q} = {F_q} - [K_q]{x} */
+	element_product_K ( PC->KC, NULL, x, Ap );
+	rn = 0.0;
+	for (i=1; i<=DoF; i++) {
+		res[i] = qk[i] ? Fk[i] - Ap[i] : 0.0;
+		rn += res[i]*res[i];
+	}
+	rn = sqrt(rn);
 
-        kg[4][10] = kg[10][4]  = -kg[4][4];
+	precondition ( PC, res, z );
+	rz = 0.0;
+	for (i=1; i<=DoF; i++) { p[i] = z[i];  rz += res[i]*z[i]; }
 
-	kg[8][2]  = kg[2][8]   = -T/L*(1.2+2.0*Ksy+Ksy*Ksy)/Dsy;
-	kg[9][3]  = kg[3][9]   = -T/L*(1.2+2.0*Ksz+Ksz*Ksz)/Dsz;
+	for (it=0; it < maxit && rn > PCG_TOL * bn; it++) {
 
-	kg[11][5] = kg[5][11]  = -T*L*(1.0/30.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz;
-	kg[12][6] = kg[6][12]  = -T*L*(1.0/30.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy;
+		element_product_K ( PC->KC, NULL, p, Ap );
+		pAp = 0.0;
+		for (i=1; i<=DoF; i++) {
+			if ( rk[i] )	Ap[i] = 0.0;
+			pAp += p[i]*Ap[i];
+		}
+		if ( pAp <= 0.0 )	break;	/* [K_qq] is not pos-def */
+		alpha = rz / pAp;
+
+		rn = 0.0;
+		for (i=1; i<=DoF; i++) {
+			x[i]   += alpha * p[i];
+			res[i] -= alpha * Ap[i];
+			rn += res[i]*res[i];
+		}
+		rn = sqrt(rn);
 
-#ifdef MATRIX_DEBUG
-	save_dmatrix ( "kg", kg, 1,12, 1,12, 0, "w" ); /* element geom. stiffness matrix */
-#endif
+		precondition ( PC, res, z );
+		rz0 = rz;
+		rz = 0.0;
+		for (i=1; i<=DoF; i++)	rz += res[i]*z[i];
+		for (i=1; i<=DoF; i++)	p[i] = z[i] + (rz/rz0) * p[i];
+	}
+	PC->iter = it;
+	*rms_resid = ( bn > 0.0 ) ? rn / bn : rn;	/* relative residual */
 
-	atma(t1,t2,t3,t4,t5,t6,t7,t8,t9, kg, r[n1],r[n2]);	/* globalize */
+	/* reactions {R_r} = [K_r]{D} - {F_r} */
+	element_product_K ( PC->KC, NULL, x, Ap );
+	for (i=1; i<=DoF; i++) {
+		D[i] = x[dof[i]];
+		R[i] = rk[dof[i]] ? Ap[dof[i]] - F[i] : 0.0;
+		if ( qk[dof[i]] )	D0[i] = D[i];
+	}
 
-	/* check and enforce symmetry of geometric element stiffness matrix */ 
+	return ( rn <= PCG_TOL * bn );
+}
 
-	for(i=1; i<=12; i++){
-	    for (j=i+1; j<=12; j++){
-			if( kg[i][j] != kg[j][i] ) {
-				if(fabs(kg[i][j]/kg[j][i]-1.0) > 1.0e-6 
-					&&(fabs(kg[i][j]/kg[i][i]) > 1e-6 
-						|| fabs(kg[j][i]/kg[i][i]) > 1e-6
-					)
-				){
-					fprintf(stderr,"geometric_K element stiffness matrix not symetric ...\n" ); 
-					fprintf(stderr," ... kg[%d][%d] = %15.6e \n",i,j,kg[i][j] ); 
-					fprintf(stderr," ... kg[%d][%d] = %15.6e   ",j,i,kg[j][i] ); 
-					fprintf(stderr," ... relative error = %e \n",  fabs(kg[i][j]/kg[j][i]-1.0) ); 
-					fprintf(stderr," ... element matrix saved in file 'kg'\n");
-					save_dmatrix ( "kg", kg, 1,12, 1,12, 0, "w" ); 
-				}
 
-				kg[i][j] = kg[j][i] = 0.5 * ( kg[i][j] + kg[j][i] );
-			}
-	    }
+/*
+ * FREE_PCG_SOLVER - release the memory of new_pcg_solver()
+ */
+void free_pcg_solver( pcg_solver *PC )
+{
+	int	DoF = PC->DoF;
+
+	if ( PC->dinv )	free_dvector(PC->dinv,1,DoF);
+	if ( PC->blk )	free_dvector(PC->blk,1,36*PC->nN);
+	if ( PC->a ) {
+		free_dvector(PC->a,1,PC->ia[DoF+1]);
+		free_ivector(PC->ja,1,PC->ia[DoF+1]);
+		free_ivector(PC->ia,1,DoF+1);
 	}
+	free_ivector(PC->qk,1,DoF);
+	free_ivector(PC->rk,1,DoF);
+	free_dvector(PC->x,1,DoF);
+	free_dvector(PC->res,1,DoF);
+	free_dvector(PC->z,1,DoF);
+	free_dvector(PC->p,1,DoF);
+	free_dvector(PC->Ap,1,DoF);
+	free_dvector(PC->Fk,1,DoF);
+	free(PC);
+}
 
-#ifdef MATRIX_DEBUG
-	save_dmatrix ( "kgt", kg, 1,12, 1,12, 0, "w" );   /* transformed element matx */
-#endif
 
-	/* add geometric stiffness matrix to elastic stiffness matrix ... */
+#define NR_STALL	0.5	/* re-factor [K] if the error falls less	*/
 
-	for (i=1; i<=12; i++)   for (j=1; j<=12; j++)	k[i][j] += kg[i][j];
 
-	free_dmatrix(kg,1,12,1,12);
+/*
+ * NEW_NR_SOLVER - allocate the state of the quasi Newton-Raphson iterations
+ * for geometric nonlinearity.  
+ *   NR_NEWTON:   [K] is factored at every iteration
+ *   NR_MODIFIED: [K] is factored every "interval" iterations, 
+ *                or when the equilibrium error falls by less than NR_STALL
+ *   NR_LBFGS:    up to "interval" limited-memory BFGS updates are applied
+ *                to the last factored [K], which is re-factored only when
+ *                the equilibrium error falls by less than NR_STALL
+ */
+NR_solver *new_NR_solver( int method, int interval, int DoF, ooc_profile *P )
+{
+	NR_solver *NR;
+
+	NR = (NR_solver *) malloc(sizeof(NR_solver));
+	NR->method   = method;
+	NR->interval = ( interval > 0 ) ? interval : 1;
+	NR->DoF      = DoF;
+	NR->P        = P;
+	NR->KF       = NULL;
+	NR->s = NR->y = NULL;
+	NR->rho = NR->alpha = NULL;
+	NR->dD0 = NR->dF0 = NULL;
+	NR->indefinite = 0;
+	if ( method == NR_LBFGS ) {
+		NR->s     = dmatrix(1,NR->interval,1,DoF);
+		NR->y     = dmatrix(1,NR->interval,1,DoF);
+		NR->rho   = dvector(1,NR->interval);
+		NR->alpha = dvector(1,NR->interval);
+		NR->dD0   = dvector(1,DoF);
+		NR->dF0   = dvector(1,DoF);
+	}
+	reset_NR_solver ( NR );
+
+	return NR;
 }
 
 
-#if 0 /* DISUSED CODE */
 /*
- * END_RELEASE - apply matrix condensation for one member end force release 20nov04
+ * RESET_NR_SOLVER - forget the factored [K] and the L-BFGS update pairs,
+ * and reset the count of factorizations, at the start of a load case
  */
-void end_release ( X, r )
-double	**X;
-int	r;
+void reset_NR_solver( NR_solver *NR )
 {
-	int	i,j;
+	if ( NR->KF )	free_factor ( NR->KF );
+	NR->KF       = NULL;
+	NR->age      = 0;
+	NR->error    = 0.0;
+	NR->np       = 0;
+	NR->head     = 0;
+	NR->n_factor = 0;
+}
 
-	for (i=1; i<=12; i++)  if ( i != r) 
-		for (j=1; j<=12; j++) if ( j != r) 
-			X[i][j]  =  X[i][j]  -  X[i][r] * X[r][j] / X[r][r];
-	
-	for (i=1; i<=12; i++) 
-		X[r][i] = X[i][r] = 0.0;
 
-	return;
+/*
+ * NR_FACTOR - factor [K] for an iteration with equilibrium error, error, 
+ * if the method of the iterations calls for it, and count the iteration.
+ * [K] is factored in every Newton iteration, every NR->interval iterations
+ * of the modified Newton method, and whenever the error of the iterations
+ * falls by less than the factor NR_STALL.  
+ * Returns 1 if [K] was factored.
+ */
+int NR_factor(
+	NR_solver *NR, double *K, int *maxa, int *dof, sparse_ldl *S,
+	double error, int *q, int *r, int *ok
+){
+	int	refactor;
+
+	refactor = ( NR->KF == NULL || NR->method == NR_NEWTON ||
+		( NR->method == NR_MODIFIED && NR->age >= NR->interval ) ||
+		( NR->error > 0.0 && error > NR_STALL * NR->error ) );
+
+	if ( refactor ) {
+		if ( NR->KF )	free_factor ( NR->KF );
+		NR->KF = factor_system ( K, maxa, dof, S, NR->P, NR->DoF,
+								q, r, ok );
+		NR->KF->indefinite = NR->indefinite;
+		++NR->n_factor;
+		NR->age = 0;
+		NR->np  = 0;
+	}
+	++NR->age;
+	NR->error = error;
+
+	return refactor;
 }
-#endif
 
 
 /*
- * SOLVE_SYSTEM  -  solve {F} =   [K]{D} via L D L' decomposition        27dec01
- * Prescribed displacements are "mechanical loads" not "temperature loads"  
+ * NR_SOLVE - solve {dF} = [K]{dD} for the displacement increment of an
+ * iteration for geometric nonlinearity, re-using the L D L' decomposition 
+ * of an earlier [K] as allowed by the method of the iterations.
+ * The solution is refined against the current [K] by solve_factored().
+ * With NR_LBFGS the L D L' solution is the initial inverse of the
+ * two-loop recursion over the pairs of increments {s} = {dD} and 
+ * {y} = change in {-dF} of the previous iterations.  
+ * {dD}, {dF}, and {dR} are in the node numbering of the input data.
  */
-void solve_system(
-	double **K, double *D, double *F, double *R, int DoF, int *q, int *r,
-	int *ok, int verbose, double *rms_resid
+void NR_solve(
+	NR_solver *NR, double *K, int *maxa, int *dof, sparse_ldl *S,
+	double *dD, double *dF, double *dR, double error,
+	int *q, int *r, int *ok, int verbose, double *rms_resid
 ){
-	double	*diag;		/* diagonal vector of the L D L' decomp. */
+	double	**s = NR->s, **y = NR->y, sy, ss, yy, beta;
+	int	i, j, k, DoF = NR->DoF, m = NR->interval;
+
+	if ( !NR_factor ( NR, K, maxa, dof, S, error, q, r, ok ) &&
+					NR->method == NR_LBFGS ) {
+		j = NR->head % m + 1;		/* store the newest pair */
+		sy = ss = yy = 0.0;
+		for (i=1; i<=DoF; i++) {
+			s[j][i] = q[i] ? NR->dD0[i] : 0.0;
+			y[j][i] = q[i] ? NR->dF0[i] - dF[i] : 0.0;
+			sy += s[j][i]*y[j][i];
+			ss += s[j][i]*s[j][i];
+			yy += y[j][i]*y[j][i];
+		}
+		if ( sy > 1e-12 * sqrt(ss*yy) ) {	/* curvature condition */
+			NR->rho[j] = 1.0 / sy;
+			NR->head = j;
+			if ( NR->np < m )	++NR->np;
+		} else if ( NR->np == m )	--NR->np; /* oldest overwritten */
+	}
 
-	verbose = 0;		/* suppress verbose output		*/
+	for (i=1; i<=DoF; i++)	dD[i] = 0.0;
+
+	if ( NR->method != NR_LBFGS || NR->np == 0 ) {
+		solve_factored ( NR->KF, K, dD, dF, dR, q, r, ok,
+							verbose, rms_resid );
+	} else {	/* L-BFGS two-loop recursion, newest pair first	*/
+		for (i=1; i<=DoF; i++)	NR->dF0[i] = dF[i];
+		for (k=0, j=NR->head; k < NR->np; k++, j = (j+m-2) % m + 1) {
+			NR->alpha[j] = 0.0;
+			for (i=1; i<=DoF; i++)	NR->alpha[j] += s[j][i]*NR->dF0[i];
+			NR->alpha[j] *= NR->rho[j];
+			for (i=1; i<=DoF; i++)	NR->dF0[i] -= NR->alpha[j]*y[j][i];
+		}
+		solve_factored ( NR->KF, K, dD, NR->dF0, dR, q, r, ok,
+							verbose, rms_resid );
+		for (k=0, j=(NR->head+m-NR->np) % m + 1; k < NR->np; 
+							k++, j = j % m + 1) {
+			beta = 0.0;
+			for (i=1; i<=DoF; i++)	beta += y[j][i]*dD[i];
+			beta *= NR->rho[j];
+			for (i=1; i<=DoF; i++)
+				if (q[i]) dD[i] += s[j][i]*(NR->alpha[j]-beta);
+		}
+	}
+
+	if ( NR->method == NR_LBFGS ) {	/* for the next pair */
+		for (i=1; i<=DoF; i++) { NR->dD0[i] = dD[i]; NR->dF0[i] = dF[i]; }
+	}
+}
 
-	diag = dvector ( 1, DoF );
 
-	/*  L D L' decomposition of K[q,q] into lower triangle of K[q,q] and diag[q] */
-	/*  vectors F and D are unchanged */
-	ldl_dcmp_pm ( K, DoF, diag, F, D, R, q,r, 1, 0, ok );
-	if ( *ok < 0 ) {
-	 	fprintf(stderr," Make sure that all six");
-		fprintf(stderr," rigid body translations are restrained!\n");
-		/* exit(31); */
-	} else {	/* LDL'  back-substitution for D[q] and R[r] */
-		ldl_dcmp_pm ( K, DoF, diag, F,D,R, q,r, 0, 1, ok );
-		if ( verbose ) fprintf(stdout,"    LDL' RMS residual:");
-		*rms_resid = *ok = 1;
-		do {	/* improve solution for D[q] and R[r] */
-			ldl_mprove_pm ( K, DoF, diag, F,D,R, q,r, rms_resid,ok);
-			if ( verbose ) fprintf(stdout,"%9.2e", *rms_resid );
-		} while ( *ok );
-	        if ( verbose ) fprintf(stdout,"\n");
+/*
+ * FREE_NR_SOLVER - release the memory of the iterations from new_NR_solver()
+ */
+void free_NR_solver( NR_solver *NR )
+{
+	if ( !NR )	return;
+	if ( NR->KF )	free_factor ( NR->KF );
+	if ( NR->method == NR_LBFGS ) {
+		free_dmatrix(NR->s,1,NR->interval,1,NR->DoF);
+		free_dmatrix(NR->y,1,NR->interval,1,NR->DoF);
+		free_dvector(NR->rho,1,NR->interval);
+		free_dvector(NR->alpha,1,NR->interval);
+		free_dvector(NR->dD0,1,NR->DoF);
+		free_dvector(NR->dF0,1,NR->DoF);
 	}
-	
-	free_dvector( diag, 1, DoF );
+	free(NR);
 }
 
 
 /*
  * EQUILIBRIUM_ERROR -  compute {dF_q} =   {F_q} - [K_qq]{D_q} - [K_qr]{D_r} 
- * use only the upper-triangle of [K_qq]
+ * [K] is stored in skyline form, or in the columns of S,
+ * coordinate i is row dof[i] of [K]
+ * With the element matrices of cache_K(), KC, [K]{D} is computed element 
+ * by element, for [K] = [Ke] + sum_i N_i [Kg_i] with N_i = -Q[i][1].
  * return ||dF||/||F||
  * 2014-05-16
  */
-double equilibrium_error( double *dF, double *F, double **K, double *D, int DoF, int *q, int *r )
-{
+double equilibrium_error(
+	double *dF, double *F, double *K, int *maxa, sparse_ldl *S, int *dof,
+	double *D, int DoF, int *q, K_cache *KC, double **Q
+){
 	double	ss_dF = 0.0,	//  sum of squares of dF
 		ss_F  = 0.0,	//  sum of squares of F	
-		errF  = 0.0;
-	int	i,j;
+		*Dk, *KD;	//  {D} and [K]{D} in the numbering of K
+	int	i;
+
+	Dk = dvector(1,DoF);
+	KD = dvector(1,DoF);
 
 	// compute equilibrium error at free coord's (q)
+	for (i=1; i<=DoF; i++)	Dk[dof[i]] = D[i];
+	if ( KC )	element_product_K ( KC, Q, Dk, KD );
+	else		prod_K ( K, maxa, S, DoF, Dk, KD );
 	for (i=1; i<=DoF; i++) {
-		errF = 0.0;
-		if (q[i]) {
-			errF = F[i];
-			for (j=1; j<=DoF; j++) {
-				if ( q[j] ) {	// K_qq in upper triangle only
-					if ( i <= j )   errF -= K[i][j] * D[j];
-					else            errF -= K[j][i] * D[j];
-				}
-			}
-			for (j=1; j<=DoF; j++) 
-				if ( r[j] )	errF -= K[i][j] * D[j];
-		}
-		dF[i] = errF;
+		if (q[i])	dF[i] = F[i] - KD[dof[i]];
+		else		dF[i] = 0.0;
 	}
 
 	for (i=1; i<=DoF; i++) if (q[i]) ss_dF += ( dF[i] * dF[i] );
 	for (i=1; i<=DoF; i++) if (q[i]) ss_F  += (  F[i] *  F[i] );
 
+	free_dvector(Dk,1,DoF);
+	free_dvector(KD,1,DoF);
+
 	return ( sqrt(ss_dF) / sqrt(ss_F) );	// convergence criterion
 }
 
@@ -423,14 +2217,14 @@ double equilibrium_error( double *dF, double *F, double **K, double *D, int DoF,
  * 23feb94
  */
 void element_end_forces(
-	double **Q, int nE, vec3 *xyz,
+	double **Q, int nE,
 	double *L, double *Le,
 	int *N1, int *N2,
-	float *Ax, float *Asy, float *Asz,
-	float *Jx, float *Iy, float *Iz, float *E, float *G, float *p,
+	float *Ax,
+	float *Jx, float *Iy, float *Iz, float *E, float *G, elem_geom *eg,
 	double **eqF_temp, // equivalent element end forces from temp loads
 	double **eqF_mech, // equivalent element end forces from mech loads
-	double *D, int shear, int geom, int *axial_strain_warning
+	double *D, int geom, int *axial_strain_warning
 ){
 	double	*s, axial_strain = 0;
 	int	m,j;
@@ -440,9 +2234,9 @@ void element_end_forces(
 	*axial_strain_warning = 0;
 	for(m=1; m <= nE; m++) {
 
-     	    frame_element_force ( s, xyz, L[m], Le[m], N1[m], N2[m],
-		Ax[m], Asy[m], Asz[m], Jx[m], Iy[m], Iz[m], E[m], G[m], p[m],
-		eqF_temp[m], eqF_mech[m], D, shear, geom, &axial_strain );
+     	    frame_element_force ( s, L[m], Le[m], N1[m], N2[m],
+		Ax[m], Jx[m], Iy[m], Iz[m], E[m], G[m], eg+m,
+		eqF_temp[m], eqF_mech[m], D, geom, &axial_strain );
 
 		for(j=1; j<=12; j++)	Q[m][j] = s[j];
 
@@ -457,47 +2251,512 @@ void element_end_forces(
 }
 
 
+#define STEP_ITER	25	/* iterations allowed in each increment	*/
+#define STEP_FAST	4	/* an increment converging in fewer iterations
+				   is followed by a larger increment	*/
+#define STEP_CUTS	12	/* successive halvings of failed increments */
+#define STEP_MIN	1e-4	/* smallest increment of the load factor */
+#define STEP_MAX	200	/* number of increments allowed		*/
+#define STEP_TOL	1e-6	/* convergence tolerance of the increments 
+				   before the last one			*/
+#define LINE_SEARCH	4	/* number of halvings of a line search step */
+#define KRYLOV		20	/* Krylov vectors of a Newton correction */
+#define KRYLOV_TOL	1e-6	/* relative residual of a Newton correction */
+
+/*
+ * LOAD_INCREMENTS - geometrically nonlinear analysis by increments of the
+ * load factor, lambda, from 0 to 1, starting from {D} = {0}.  
+ * The equilibrium error of an iterate is {dF} = lambda{F} - [K({D})]{D},
+ * and the element loads and prescribed displacements are scaled by lambda.
+ * Each iteration solves for the Newton correction with the tangent of 
+ * {dF}, which includes the change of the axial forces in [K({D})], 
+ * by GMRES preconditioned with the [K] factored by NR_factor(), 
+ * see newton_krylov().  
+ * Under load control (arc = 0) a line search halves the correction up to 
+ * LINE_SEARCH times until the equilibrium error is reduced. 
+ * Under arc-length control (arc = 1) the first increment is under load
+ * control, and its displacement increment sets the arc length, dl. 
+ * The following increments satisfy ||{D}-{D_c}|| = dl (Crisfield's 
+ * cylindrical arc-length method), so that the load factor may decrease
+ * past a limit point, where [K] is not positive definite.  
+ * An increment that would pass lambda = 1 is replaced by a load-controlled
+ * increment to lambda = 1.  
+ * The increments before the last one converge to STEP_TOL, the last one
+ * converges to tol on the equilibrium error of the full load, with one
+ * more correction after the error is below tol.  An increment that fails to converge is halved and 
+ * tried again; one that converges in fewer than STEP_FAST iterations, 
+ * and did not follow a failure, is followed by one twice as large.  
+ * Returns the load factor reached, with {D} and {Q} at that load factor.
+ */
+double load_increments(
+	double **Q, int nE,
+	double *L, double *Le,
+	int *N1, int *N2,
+	float *Ax,
+	float *Jx, float *Iy, float *Iz, float *E, float *G, elem_geom *eg,
+	double **eqF_temp, double **eqF_mech,
+	int *axial_strain_warning,
+	K_cache *KC, double *K, int *maxa, int *dof, sparse_ldl *S,
+	NR_solver *NR, double *F, float *Dp, double *D, double *dF,
+	int DoF, int *q, int *r, double tol, double step, int arc,
+	int verbose, double *error, double *rms_resid, int *iter, int *ok
+){
+	double	lambda = 0.0,	/* load factor of the last increment	*/
+		lam,		/* load factor of the current iterate	*/
+		dlam = step,	/* increment of the load factor		*/
+		dl = 0.0,	/* arc length of an increment		*/
+		*Dc,		/* displacements of the last increment	*/
+		*DD,		/* displacement increment, last increment */
+		*Dl,		/* displacements at the start of a line search,
+				   or displacement increment of an iterate */
+		*dD,		/* Newton correction of {D} and lambda	*/
+		*dDF,		/* solution for the reference load	*/
+		*dR, *Fl,	/* reaction increment, lambda {F}	*/
+		*dN0,		/* element axial forces from the element
+				   loads, per unit load factor		*/
+		**eqFt, **eqFm,	/* element loads scaled by lambda	*/
+		tl,		/* convergence tolerance of an increment */
+		err0, eta, a, b, cc;
+	int	i, it, ls, nf, cuts = 0, n_incr = 0, controlled, finish = 0;
+
+	Dc   = dvector(1,DoF);
+	DD   = dvector(1,DoF);
+	Dl   = dvector(1,DoF);
+	dD   = dvector(1,DoF+1);
+	dDF  = dvector(1,DoF);
+	dR   = dvector(1,DoF);
+	Fl   = dvector(1,DoF);
+	dN0  = dvector(1,nE);
+	eqFt = dmatrix(1,nE,1,12);
+	eqFm = dmatrix(1,nE,1,12);
+
+	NR->indefinite = arc;
+	*iter = 0;
+	*error = 1.0;
+	for (i=1; i<=DoF; i++)	D[i] = DD[i] = dR[i] = 0.0;
+
+	element_end_forces ( Q, nE, L, Le, N1,N2, Ax,Jx,Iy,Iz,
+		E,G, eg, eqF_temp, eqF_mech, D, 1, axial_strain_warning );
+	for (i=1; i<=nE; i++)	dN0[i] = -Q[i][1];
+
+	while ( lambda < 1.0 && n_incr++ < STEP_MAX ) {
+
+		for (i=1; i<=DoF; i++)	Dc[i] = D[i];
+		nf = NR->n_factor;	/* a new [K] for each increment */
+		reset_NR_solver ( NR );
+		NR->n_factor = nf;
+		it = 0;
+		*ok = 0;
+
+		controlled = 1;
+		if ( arc && dl > 0.0 && !finish ) {	/* arc-length predictor */
+			*error = step_residual ( lambda, Q, nE, L, Le, N1,N2,
+				Ax,Jx,Iy,Iz, E,G, eg, eqF_temp, eqF_mech,
+				eqFt, eqFm, axial_strain_warning, KC, K,
+				maxa, S, dof, F, Fl, D, dF, DoF, q );
+			NR_factor ( NR, K, maxa, dof, S, *error, q, r, ok );
+			for (i=1; i<=DoF; i++)	dDF[i] = r[i] ? Dp[i] : 0.0;
+			solve_factored ( NR->KF, K, dDF, F, dR, q, r, ok, 0,
+								rms_resid );
+			a = b = 0.0;
+			for (i=1; i<=DoF; i++) if (q[i]) {
+				a += dDF[i]*dDF[i];
+				b += dDF[i]*DD[i];
+			}
+			dlam = ( b < 0.0 ? -dl : dl ) / sqrt(a);
+			controlled = ( lambda + dlam >= 1.0 );
+		}
+
+		if ( controlled ) {
+			lam = ( lambda + dlam < 1.0 ) ? lambda + dlam : 1.0;
+			tl  = ( lam < 1.0 && tol < STEP_TOL ) ? STEP_TOL : tol;
+			for (i=1; i<=DoF; i++)	if (r[i]) D[i] = lam*Dp[i];
+		} else {
+			lam = lambda + dlam;
+			tl  = ( tol < STEP_TOL ) ? STEP_TOL : tol;
+			for (i=1; i<=DoF; i++) {
+				if (q[i])	D[i] = Dc[i] + dlam*dDF[i];
+				else		D[i] = lam*Dp[i];
+			}
+		}
+		*error = step_residual ( lam, Q, nE, L, Le, N1,N2,
+				Ax,Jx,Iy,Iz, E,G, eg, eqF_temp, eqF_mech,
+				eqFt, eqFm, axial_strain_warning, KC, K,
+				maxa, S, dof, F, Fl, D, dF, DoF, q );
+		err0 = *error;
+
+		/* the last increment, like the Newton-Raphson iterations,
+		   ends with a correction from an error below tol	*/
+		while ( ( *error > tl || ( controlled && lam == 1.0 && err0 > tl ) )
+							&& it < STEP_ITER ) {
+			++it;
+			NR_factor ( NR, K, maxa, dof, S, *error, q, r, ok );
+			if ( *ok < 0 && !NR->indefinite )	break;
+
+			if ( controlled ) {	/* load control, line search */
+				newton_krylov ( NR, KC, K, maxa, S, dof, DoF, nE,
+					Ax, E, Le, eg, dN0, F, Dp, D,
+					dF, NULL, NULL, 0.0, 0, q, r, dD,
+					rms_resid );
+				err0 = *error;
+				for (i=1; i<=DoF; i++)	Dl[i] = D[i];
+				for (ls=0, eta=1.0; ; ls++, eta *= 0.5) {
+					for (i=1; i<=DoF; i++)
+						if (q[i]) D[i] = Dl[i] + eta*dD[i];
+					*error = step_residual ( lam, Q, nE,
+						L, Le, N1,N2, Ax,Jx,Iy,Iz,
+						E,G, eg, eqF_temp, eqF_mech, eqFt, eqFm,
+						axial_strain_warning, KC, K,
+						maxa, S, dof, F, Fl, D, dF, DoF, q );
+					if ( *error < err0 || ls == LINE_SEARCH ) break;
+				}
+				if ( !(*error < err0) )	break;	/* no progress */
+			} else {		/* arc-length corrector */
+				for (i=1; i<=DoF; i++)	dDF[i] = r[i] ? Dp[i] : 0.0;
+				solve_factored ( NR->KF, K, dDF, F, dR, q, r, ok,
+							0, rms_resid );
+				cc = dl*dl;
+				for (i=1; i<=DoF; i++) {
+					Dl[i] = q[i] ? D[i] - Dc[i] : 0.0;
+					cc -= Dl[i]*Dl[i];
+				}
+				newton_krylov ( NR, KC, K, maxa, S, dof, DoF, nE,
+					Ax, E, Le, eg, dN0, F, Dp, D,
+					dF, dDF, Dl, cc, 1, q, r, dD,
+					rms_resid );
+				lam += dD[DoF+1];
+				for (i=1; i<=DoF; i++) {
+					if (q[i])  D[i] += dD[i];
+					else	   D[i]  = lam*Dp[i];
+				}
+				*error = step_residual ( lam, Q, nE, L, Le,
+					N1,N2, Ax,Jx,Iy,Iz, E,G, eg,
+					eqF_temp, eqF_mech, eqFt, eqFm,
+					axial_strain_warning, KC, K, maxa, S,
+					dof, F, Fl, D, dF, DoF, q );
+				if ( !(*error < 1e3) )	break;	/* diverged */
+			}
+		}
+		*iter += it;
+		if ( !controlled )	dlam = lam - lambda;
+
+		if ( *error <= tl && *ok >= 0 && lam > 1.0 ) {
+			for (i=1; i<=DoF; i++)	D[i] = Dc[i];
+			dlam = 1.0 - lambda;	/* passed lambda = 1 */
+			finish = 1;
+		} else if ( *error <= tl && *ok >= 0 ) { /* converged */
+			for (i=1; i<=DoF; i++)	DD[i] = D[i] - Dc[i];
+			if ( arc && dl == 0.0 ) {	/* the arc length */
+				for (i=1; i<=DoF; i++) if (q[i]) dl += DD[i]*DD[i];
+				dl = sqrt(dl);
+			}
+			if ( verbose ) {
+			 fprintf(stdout,"   load factor %7.4f ---", lam );
+			 fprintf(stdout," %2d iterations, error = %8.2e \n",
+								it, *error );
+			}
+			lambda = lam;
+			if ( it < STEP_FAST && cuts == 0 ) { dlam *= 2.0; dl *= 2.0; }
+			cuts = 0;
+		} else {			/* halve the increment	*/
+			for (i=1; i<=DoF; i++)	D[i] = Dc[i];
+			dlam *= 0.5;
+			dl   *= 0.5;
+			*error = 1.0;
+			if ( ++cuts > STEP_CUTS || ( !arc && dlam < STEP_MIN ) )
+				break;
+		}
+	}
+
+	if ( lambda < 1.0 ) {	/* {Q} and [K] at the load factor reached */
+		*error = step_residual ( lambda, Q, nE, L, Le, N1,N2,
+				Ax,Jx,Iy,Iz, E,G, eg, eqF_temp, eqF_mech,
+				eqFt, eqFm, axial_strain_warning, KC, K,
+				maxa, S, dof, F, Fl, D, dF, DoF, q );
+		if ( lambda <= 0.0 )	*error = 1.0;
+	}
+	NR->indefinite = 0;
+
+	free_dvector(Dc,1,DoF);
+	free_dvector(DD,1,DoF);
+	free_dvector(Dl,1,DoF);
+	free_dvector(dD,1,DoF+1);
+	free_dvector(dDF,1,DoF);
+	free_dvector(dR,1,DoF);
+	free_dvector(Fl,1,DoF);
+	free_dvector(dN0,1,nE);
+	free_dmatrix(eqFt,1,nE,1,12);
+	free_dmatrix(eqFm,1,nE,1,12);
+
+	return lambda;
+}
+
+
+/*
+ * STEP_RESIDUAL - element end forces {Q}, stiffness matrix [K], and 
+ * equilibrium error {dF} = lambda{F} - [K]{D} at the load factor lambda,
+ * returning ||dF|| / ||lambda F||
+ */
+static double step_residual(
+	double lambda, double **Q, int nE, double *L, double *Le,
+	int *N1, int *N2, float *Ax,
+	float *Jx, float *Iy, float *Iz, float *E, float *G, elem_geom *eg,
+	double **eqF_temp, double **eqF_mech, double **eqFt, double **eqFm,
+	int *axial_strain_warning, K_cache *KC, double *K,
+	int *maxa, sparse_ldl *S, int *dof, double *F, double *Fl,
+	double *D, double *dF, int DoF, int *q
+){
+	int	i, j;
+
+	for (i=1; i<=nE; i++) {
+		for (j=1; j<=12; j++) {
+			eqFt[i][j] = lambda * eqF_temp[i][j];
+			eqFm[i][j] = lambda * eqF_mech[i][j];
+		}
+	}
+	element_end_forces ( Q, nE, L, Le, N1,N2, Ax,Jx,Iy,Iz,
+			E,G, eg, eqFt, eqFm, D, 1, axial_strain_warning );
+	update_K ( KC, K, Q );
+	for (i=1; i<=DoF; i++)	Fl[i] = lambda * F[i];
+
+	return equilibrium_error ( dF, Fl, K, maxa, S, dof, D, DoF, q, KC, Q );
+}
+
+
+/*
+ * TANGENT_PRODUCT - {y} = [K]{v} + sum_i dN_i [Kg_i]{D}, the product of the
+ * tangent of the internal forces [K({D})]{D} with {v}, where 
+ * dN_i = (EA/Le)_i (t . ({v}_2 - {v}_1))_i + mu dN0_i is the change of the 
+ * axial force of element i, and mu is a change of the load factor.  
+ * {D}, {v}, and {y} are in the numbering of the coordinates, 
+ * Dk, vk, and yk are work vectors in the numbering of [K].
+ */
+static void tangent_product(
+	K_cache *KC, double *K, int *maxa, sparse_ldl *S, int *dof,
+	int DoF, int nE, float *Ax, float *E, double *Le,
+	elem_geom *eg, double *dN0, double *D, double *v, double mu,
+	double *y, double *Dk, double *vk, double *yk
+){
+	double	dN, *kg;
+	int	*ind, i, l, ll, ii, jj, t;
+
+	for (i=1; i<=DoF; i++) { Dk[dof[i]] = D[i];  vk[dof[i]] = v[i]; }
+	prod_K ( K, maxa, S, DoF, vk, yk );
+
+	for (i=1; i <= nE; i++) {
+		ind = KC->ind[i];
+		dN = Ax[i]*E[i]/Le[i] * ( 
+			eg[i].t1 * ( vk[ind[7]] - vk[ind[1]] ) +
+			eg[i].t2 * ( vk[ind[8]] - vk[ind[2]] ) +
+			eg[i].t3 * ( vk[ind[9]] - vk[ind[3]] ) ) + mu*dN0[i];
+		if ( dN == 0.0 )	continue;
+
+		kg = KC->kg[i];
+		t = 0;
+		for (l=1; l <= 12; l++) {	/* upper triangle of [Kg_i] */
+			for (ll=l; ll <= 12; ll++) {
+				ii = ind[l];	jj = ind[ll];
+				++t;
+				yk[ii] += dN * kg[t] * Dk[jj];
+				if ( ll > l )	yk[jj] += dN * kg[t] * Dk[ii];
+			}
+		}
+	}
+
+	for (i=1; i<=DoF; i++)	y[i] = yk[dof[i]];
+}
+
+
+/*
+ * NEWTON_KRYLOV - the Newton correction {x} = ({dD}, d lambda) of the 
+ * equilibrium error {dF} of an iterate {D} by GMRES (Saad and Schultz, 1986)
+ * with up to KRYLOV vectors, stopping at a relative residual of KRYLOV_TOL.
+ * The tangent of the equilibrium error is applied by tangent_product(), 
+ * so the correction accounts for the change of the axial forces in 
+ * [K({D})] that a solution with [K] alone neglects.  
+ * The preconditioner solves with the last factored [K], NR->KF. 
+ * Under arc-length control (arc = 1) the equations are bordered by the 
+ * linearized arc-length constraint 2 {DD}'{dD} = cc, where {DD} is the
+ * displacement increment of the iterate, and the load factor changes by
+ * x[DoF+1];  {dDF} is the solution of [K] for the reference load.  
+ * rms_resid is the residual of the last solution with the factored [K].
+ */
+static void newton_krylov(
+	NR_solver *NR, K_cache *KC, double *K, int *maxa, sparse_ldl *S,
+	int *dof, int DoF, int nE, float *Ax, float *E, double *Le,
+	elem_geom *eg, double *dN0, double *F, float *Dp, double *D,
+	double *dF, double *dDF, double *DD, double cc, int arc,
+	int *q, int *r, double *x, double *rms_resid
+){
+	double	**V, **Z, **H,	/* Krylov basis, preconditioned basis,
+				   Hessenberg matrix			*/
+		*g, *cs, *sn, *y, *w, *u, *rhs, *dR, *Dk, *vk, *yk,
+		beta, a, b, h;
+	int	n = DoF+1, i, j, k, m = 0, ok;
+
+	V   = dmatrix(1,KRYLOV+1,1,n);
+	Z   = dmatrix(1,KRYLOV,1,n);
+	H   = dmatrix(1,KRYLOV+1,1,KRYLOV);
+	g   = dvector(1,KRYLOV+1);
+	cs  = dvector(1,KRYLOV);
+	sn  = dvector(1,KRYLOV);
+	y   = dvector(1,KRYLOV);
+	w   = dvector(1,n);
+	u   = dvector(1,DoF);
+	rhs = dvector(1,DoF);
+	dR  = dvector(1,DoF);
+	Dk  = dvector(1,DoF);
+	vk  = dvector(1,DoF);
+	yk  = dvector(1,DoF);
+
+	for (i=1; i<=n; i++)	x[i] = 0.0;
+
+	beta = 0.0;
+	for (i=1; i<=DoF; i++) {
+		V[1][i] = q[i] ? dF[i] : 0.0;
+		beta += V[1][i]*V[1][i];
+	}
+	V[1][n] = arc ? cc : 0.0;
+	beta = sqrt ( beta + V[1][n]*V[1][n] );
+	if ( beta == 0.0 )	goto done;
+	for (i=1; i<=n; i++)	V[1][i] /= beta;
+	g[1] = beta;
+
+	for (j=1; j <= KRYLOV; j++) {
+
+		/* {z_j} = [M]^-1 {v_j}, with the factored [K]	*/
+		for (i=1; i<=DoF; i++) {
+			rhs[i] = q[i] ? V[j][i] : 0.0;
+			Z[j][i] = 0.0;
+		}
+		solve_factored ( NR->KF, K, Z[j], rhs, dR, q, r, &ok, 0,
+								rms_resid );
+		Z[j][n] = 0.0;
+		if ( arc ) {	/* with the arc-length constraint	*/
+			a = b = 0.0;
+			for (i=1; i<=DoF; i++) if (q[i]) {
+				a += DD[i]*Z[j][i];
+				b += DD[i]*dDF[i];
+			}
+			Z[j][n] = ( b != 0.0 ) ? ( V[j][n] - 2.0*a ) / (2.0*b) : 0.0;
+			for (i=1; i<=DoF; i++)
+				if (q[i])	Z[j][i] += Z[j][n]*dDF[i];
+		}
+
+		/* {w} = [A]{z_j}, with the tangent of the equilibrium error */
+		for (i=1; i<=DoF; i++) {
+			if (q[i])	u[i] = Z[j][i];
+			else		u[i] = ( arc && r[i] ) ? Z[j][n]*Dp[i] : 0.0;
+		}
+		tangent_product ( KC, K, maxa, S, dof, DoF, nE, Ax, E, Le,
+			eg, dN0, D, u, arc ? Z[j][n] : 0.0, w, Dk, vk, yk );
+		w[n] = 0.0;
+		for (i=1; i<=DoF; i++) {
+			if (q[i]) {
+				w[i] -= Z[j][n]*F[i];
+				if ( arc )	w[n] += 2.0*DD[i]*Z[j][i];
+			} else	w[i] = 0.0;
+		}
+
+		/* modified Gram-Schmidt orthogonalization	*/
+		for (k=1; k <= j; k++) {
+			H[k][j] = 0.0;
+			for (i=1; i<=n; i++)	H[k][j] += w[i]*V[k][i];
+			for (i=1; i<=n; i++)	w[i] -= H[k][j]*V[k][i];
+		}
+		h = 0.0;
+		for (i=1; i<=n; i++)	h += w[i]*w[i];
+		H[j+1][j] = h = sqrt(h);
+		if ( h > 0.0 )	for (i=1; i<=n; i++)	V[j+1][i] = w[i] / h;
+
+		/* Givens rotations reduce [H] to upper triangular form	*/
+		for (k=1; k < j; k++) {
+			a = H[k][j];
+			H[k][j]   =  cs[k]*a + sn[k]*H[k+1][j];
+			H[k+1][j] = -sn[k]*a + cs[k]*H[k+1][j];
+		}
+		a = sqrt ( H[j][j]*H[j][j] + h*h );
+		if ( a == 0.0 )	break;
+		cs[j] = H[j][j] / a;
+		sn[j] = h / a;
+		H[j][j] = a;
+		g[j+1] = -sn[j]*g[j];
+		g[j]   =  cs[j]*g[j];
+		m = j;
+
+		if ( fabs(g[j+1]) <= KRYLOV_TOL * beta || h == 0.0 )	break;
+	}
+
+	for (k=m; k >= 1; k--) {	/* back substitution for {y} */
+		y[k] = g[k];
+		for (j=k+1; j <= m; j++)	y[k] -= H[k][j]*y[j];
+		y[k] /= H[k][k];
+	}
+	for (k=1; k <= m; k++)
+		for (i=1; i<=n; i++)	x[i] += y[k]*Z[k][i];
+
+done:
+	free_dmatrix(V,1,KRYLOV+1,1,n);
+	free_dmatrix(Z,1,KRYLOV,1,n);
+	free_dmatrix(H,1,KRYLOV+1,1,KRYLOV);
+	free_dvector(g,1,KRYLOV+1);
+	free_dvector(cs,1,KRYLOV);
+	free_dvector(sn,1,KRYLOV);
+	free_dvector(y,1,KRYLOV);
+	free_dvector(w,1,n);
+	free_dvector(u,1,DoF);
+	free_dvector(rhs,1,DoF);
+	free_dvector(dR,1,DoF);
+	free_dvector(Dk,1,DoF);
+	free_dvector(vk,1,DoF);
+	free_dvector(yk,1,DoF);
+}
+
+
 /*
  * FRAME_ELEMENT_FORCE  -  evaluate the end forces in local coord's
+ * The end displacements are transformed to local coordinates one 3-by-3
+ * block at a time, and each stiffness coefficient is evaluated once.
  * 12nov02
  */
 void frame_element_force(
-	double *s, vec3 *xyz, double L, double Le,
-	int n1, int n2, float Ax, float Asy, float Asz, float J,
-	float Iy, float Iz, float E, float G, float p,
+	double *s, double L, double Le,
+	int n1, int n2, float Ax, float J,
+	float Iy, float Iz, float E, float G, elem_geom *g,
 	double *f_t, double *f_m,
-	double *D, int shear, int geom, double *axial_strain
+	double *D, int geom, double *axial_strain
 ){
 	double	t1, t2, t3, t4, t5, t6, t7, t8, t9, /* coord Xformn	*/
-		d1, d2, d3, d4, d5, d6, d7, d8, d9, d10, d11, d12,
+		d[13],		/* end displ. differences and rotations	*/
+		u[13],		/* ... in local coordinates		*/
+		f[13],		/* fixed end forces, global coordinates	*/
+		fl[13],		/* fixed end forces, local coordinates	*/
 		// x1, y1, z1, x2, y2, z2,	/* node coordinates	*/
 		//  Ls,			/* stretched length of element */
 		delta=0.0,		/* stretch in the frame element */
 		Ksy, Ksz, Dsy, Dsz,	/* shear deformation coeff's	*/
+		ky, kz,		/* transverse stiffness coefficients	*/
+		cy, cz,		/* transverse-rotation coupling		*/
+		ay, az, by, bz,	/* rotational stiffness coefficients	*/
 		T = 0.0;		/* axial force for geometric stiffness */
+	int	i;
 
-	double	f1=0, f2=0, f3=0, f4=0,  f5=0,  f6=0, 
-		f7=0, f8=0, f9=0, f10=0, f11=0, f12=0;
-
-	coord_trans ( xyz, L, n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p );
+	get_coord_trans ( g, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 	n1 = 6*(n1-1);	n2 = 6*(n2-1);
 
-	d1  = D[n1+1];	d2  = D[n1+2];	d3  = D[n1+3];
-	d4  = D[n1+4];	d5  = D[n1+5];	d6  = D[n1+6];
-	d7  = D[n2+1];	d8  = D[n2+2];	d9  = D[n2+3];
-	d10 = D[n2+4];	d11 = D[n2+5];	d12 = D[n2+6];
-
-	if ( shear ) {
-		Ksy = 12.*E*Iz / (G*Asy*Le*Le);
-		Ksz = 12.*E*Iy / (G*Asz*Le*Le);
-		Dsy = (1+Ksy)*(1+Ksy);
-		Dsz = (1+Ksz)*(1+Ksz);
-	} else {
-		Ksy = Ksz = 0.0;
-		Dsy = Dsz = 1.0;
+	/* translation of end 2 relative to end 1, and end rotations	*/
+	for (i=1; i<=3; i++) {
+		d[i]   = D[n2+i] - D[n1+i];
+		d[i+3] = D[n1+i+3];
+		d[i+6] = 0.0;
+		d[i+9] = D[n2+i+3];
 	}
+	rotate_to_local ( t1,t2,t3,t4,t5,t6,t7,t8,t9, d, u );
+
+	Ksy = g->Ksy;	Ksz = g->Ksz;
+	Dsy = (1+Ksy)*(1+Ksy);
+	Dsz = (1+Ksz)*(1+Ksz);
 
 
 	/* finite strain ... (not consistent with 2nd order formulation) */
@@ -520,91 +2779,47 @@ void frame_element_force(
  */
 
 	/* axial element displacement ... */
-	delta = (d7-d1)*t1 + (d8-d2)*t2 + (d9-d3)*t3; 
+	delta = u[1];
 	*axial_strain = delta / Le;	// log(Ls/Le);
 
-	s[1]  =  -(Ax*E/Le)*( (d7-d1)*t1 + (d8-d2)*t2 + (d9-d3)*t3 );
+	s[1]  =  -(Ax*E/Le)*u[1];
 
 	if ( geom )	T = -s[1];
 
-	s[2]  = -( 12.*E*Iz/(Le*Le*Le*(1.+Ksy)) + 
-		   T/L*(1.2+2.0*Ksy+Ksy*Ksy)/Dsy ) *
-				( (d7-d1)*t4 + (d8-d2)*t5 + (d9-d3)*t6 )
-		+ (6.*E*Iz/(Le*Le*(1.+Ksy)) + T/10.0/Dsy) *
-				( (d4+d10)*t7 + (d5+d11)*t8 + (d6+d12)*t9 );
-	s[3]  = -(12.*E*Iy/(Le*Le*Le*(1.+Ksz)) + 
-		  T/L*(1.2+2.0*Ksz+Ksz*Ksz)/Dsz ) * 
-				( (d7-d1)*t7  + (d8-d2)*t8  + (d9-d3)*t9 )
-		- ( 6.*E*Iy/(Le*Le*(1.+Ksz)) + T/10.0/Dsz ) *
-				( (d4+d10)*t4 + (d5+d11)*t5 + (d6+d12)*t6 );
-	s[4]  =   -(G*J/Le) * ( (d10-d4)*t1 + (d11-d5)*t2 + (d12-d6)*t3 );
-	s[5]  =   (6.*E*Iy/(Le*Le*(1.+Ksz)) + T/10.0/Dsz ) * 
-				( (d7-d1)*t7 + (d8-d2)*t8 + (d9-d3)*t9 )
-		+ ( (4.+Ksz)*E*Iy/(Le*(1.+Ksz)) + 
-		    T*L*(2.0/15.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz ) *
-				(d4 *t4 + d5 *t5 + d6 *t6)
-		+ ((2.-Ksz)*E*Iy/(Le*(1.+Ksz)) -  
-		    T*L*(1.0/30.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz ) *
-				(d10*t4 + d11*t5 + d12*t6);
-	s[6]  =  -( 6.*E*Iz/(Le*Le*(1.+Ksy)) + T/10.0/Dsy ) *
-				( (d7-d1)*t4 + (d8-d2)*t5 + (d9-d3)*t6 )
-		+ ((4.+Ksy)*E*Iz/(Le*(1.+Ksy)) + 
-		    T*L*(2.0/15.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy ) *
-				( d4 *t7 + d5 *t8 + d6 *t9 )
-		+ ((2.-Ksy)*E*Iz/(Le*(1.+Ksy)) - 
-		    T*L*(1.0/30.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy ) * 
-				( d10*t7 + d11*t8 + d12*t9 );
+	ky = 12.*E*Iz/(Le*Le*Le*(1.+Ksy)) + T/L*(1.2+2.0*Ksy+Ksy*Ksy)/Dsy;
+	kz = 12.*E*Iy/(Le*Le*Le*(1.+Ksz)) + T/L*(1.2+2.0*Ksz+Ksz*Ksz)/Dsz;
+	cy = 6.*E*Iz/(Le*Le*(1.+Ksy)) + T/10.0/Dsy;
+	cz = 6.*E*Iy/(Le*Le*(1.+Ksz)) + T/10.0/Dsz;
+	ay = (4.+Ksy)*E*Iz/(Le*(1.+Ksy)) + T*L*(2.0/15.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy;
+	az = (4.+Ksz)*E*Iy/(Le*(1.+Ksz)) + T*L*(2.0/15.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz;
+	by = (2.-Ksy)*E*Iz/(Le*(1.+Ksy)) - T*L*(1.0/30.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy;
+	bz = (2.-Ksz)*E*Iy/(Le*(1.+Ksz)) - T*L*(1.0/30.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz;
+
+	s[2]  = -ky*u[2] + cy*( u[6] + u[12] );
+	s[3]  = -kz*u[3] - cz*( u[5] + u[11] );
+	s[4]  = -(G*J/Le) * ( u[10] - u[4] );
+	s[5]  =  cz*u[3] + az*u[5]  + bz*u[11];
+	s[6]  = -cy*u[2] + ay*u[6]  + by*u[12];
 	s[7]  = -s[1];
 	s[8]  = -s[2]; 
 	s[9]  = -s[3]; 
 	s[10] = -s[4]; 
-
-	s[11] =   ( 6.*E*Iy/(Le*Le*(1.+Ksz)) + T/10.0/Dsz ) * 
-				( (d7-d1)*t7 + (d8-d2)*t8 + (d9-d3)*t9 )
-		+ ((4.+Ksz)*E*Iy/(Le*(1.+Ksz)) + 
-		    T*L*(2.0/15.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz ) * 
-				( d10*t4 + d11*t5 + d12*t6 )
-		+ ((2.-Ksz)*E*Iy/(Le*(1.+Ksz)) - 
-		    T*L*(1.0/30.0+Ksz/6.0+Ksz*Ksz/12.0)/Dsz ) *
-				( d4 *t4 + d5 *t5 + d6 *t6 );
-	s[12] =  -(6.*E*Iz/(Le*Le*(1.+Ksy)) + T/10.0/Dsy ) *
-				( (d7-d1)*t4 + (d8-d2)*t5 + (d9-d3)*t6 )
-		+ ((4.+Ksy)*E*Iz/(Le*(1.+Ksy)) + 
-		    T*L*(2.0/15.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy ) * 
-				( d10*t7 + d11*t8 + d12*t9 )
-		+ ((2.-Ksy)*E*Iz/(Le*(1.+Ksy)) - 
-		    T*L*(1.0/30.0+Ksy/6.0+Ksy*Ksy/12.0)/Dsy ) * 
-				( d4 *t7 + d5 *t8 + d6 *t9 );
+	s[11] =  cz*u[3] + az*u[11] + bz*u[5];
+	s[12] = -cy*u[2] + ay*u[12] + by*u[6];
 
 	// add fixed end forces to internal element forces
 	// 18oct2012, 14may1204, 15may2014
 
-	// add temperature fixed-end-forces to variables f1-f12
-	// add mechanical load fixed-end-forces to variables f1-f12
-	// f1 ...  f12 are in the global element coordinate system
-	f1  = f_t[1] +f_m[1];   f2  = f_t[2] +f_m[2];   f3  = f_t[3]+f_m[3];
-	f4  = f_t[4] +f_m[4];   f5  = f_t[5] +f_m[5];   f6  = f_t[6]+f_m[6];
-	f7  = f_t[7] +f_m[7];   f8  = f_t[8] +f_m[8];   f9  = f_t[9]+f_m[9];
-	f10 = f_t[10]+f_m[10];  f11 = f_t[11]+f_m[11];  f12 = f_t[12]+f_m[12];
+	// add temperature fixed-end-forces to f
+	// add mechanical load fixed-end-forces to f
+	// f is in the global element coordinate system
+	for (i=1; i<=12; i++)	f[i] = f_t[i] + f_m[i];
 
-	// transform f1 ... f12 to local element coordinate system and
+	// transform f to local element coordinate system and
 	// add local fixed end forces (-equivalent loads) to internal loads 
 	// {Q} = [T]{f}
-
-	s[1]  -= ( f1 *t1 + f2 *t2 + f3 *t3 );    
-	s[2]  -= ( f1 *t4 + f2 *t5 + f3 *t6 );
-	s[3]  -= ( f1 *t7 + f2 *t8 + f3 *t9 );
-	s[4]  -= ( f4 *t1 + f5 *t2 + f6 *t3 );
-	s[5]  -= ( f4 *t4 + f5 *t5 + f6 *t6 );
-	s[6]  -= ( f4 *t7 + f5 *t8 + f6 *t9 );
-
-	s[7]  -= ( f7 *t1 + f8 *t2 + f9 *t3 );
-	s[8]  -= ( f7 *t4 + f8 *t5 + f9 *t6 );
-	s[9]  -= ( f7 *t7 + f8 *t8 + f9 *t9 );
-	s[10] -= ( f10*t1 + f11*t2 + f12*t3 );
-	s[11] -= ( f10*t4 + f11*t5 + f12*t6 );
-	s[12] -= ( f10*t7 + f11*t8 + f12*t9 );
-
+	rotate_to_local ( t1,t2,t3,t4,t5,t6,t7,t8,t9, f, fl );
+	for (i=1; i<=12; i++)	s[i] -= fl[i];
 }
 
 
@@ -653,37 +2868,48 @@ int nE, int DoF,
  * COMPUTE_REACTION_FORCES : R(r) = [K(r,q)]*{D(q)} + [K(r,r)]*{D(r)} - F(r)
  * reaction forces satisfy equilibrium in the solved system
  * only really needed for geometric-nonlinear problems
+ * [K] is stored in skyline form, or in the columns of S,
+ * coordinate i is row dof[i] of [K]
  * 2012-10-12  , 2014-05-16
  */
 void compute_reaction_forces(
-	 double *R, double *F, double **K, double *D, int DoF, int *r
+	double *R, double *F, double *K, int *maxa, sparse_ldl *S, int *dof,
+	double *D, int DoF, int *r
 ){
-	int	i,j;
+	double	*Dk, *KD;	// {D} and [K]{D} in the numbering of K
+	int	i;
+
+	Dk = dvector(1,DoF);
+	KD = dvector(1,DoF);
 
+	// reactions are relaxed through system deformations
+	for (i=1; i<=DoF; i++)	Dk[dof[i]] = D[i];
+	prod_K ( K, maxa, S, DoF, Dk, KD );
 	for (i=1; i<=DoF; i++) {
-		R[i] = 0;
-		if (r[i]) {		// coordinate "i" is a reaction coord.
-			R[i] = -F[i];	// negative of equiv loads at coord i
-			// reactions are relaxed through system deformations
-			for (j=1; j<=DoF; j++)  R[i] += K[i][j]*D[j];
-		}
+		if (r[i])	R[i] = KD[dof[i]] - F[i];
+		else		R[i] = 0;
 	}
+
+	free_dvector(Dk,1,DoF);
+	free_dvector(KD,1,DoF);
 }
 
 
 /*
  * ASSEMBLE_M  -  assemble global mass matrix from element mass & inertia  24nov98
+ * into the terms of M from mass_analyze()
  */
 void assemble_M(
-	double **M, int DoF, int nN, int nE,
-	vec3 *xyz, float *r, double *L,
+	mass_matrix *M, int DoF, int nN, int nE,
+	double *L,
 	int *N1, int *N2,
-	float *Ax, float *Jx, float *Iy, float *Iz, float *p,
+	float *Ax, float *Jx, float *Iy, float *Iz, elem_geom *eg,
 	float *d, float *EMs,
 	float *NMs, float *NMx, float *NMy, float *NMz,
 	int lump, int debug
 ){
 	double  **m,	    /* element mass matrix in global coord */
+		*Mij,	    /* a term of the mass matrix		*/
 		**dmatrix();
 	int     **ind,	  /* member-structure DoF index table     */
 		**imatrix(),
@@ -691,7 +2917,7 @@ void assemble_M(
 		i, j, ii, jj, l, ll;
 	char	mass_fn[FILENMAX];
 
-	for (i=1; i<=DoF; i++)  for (j=1; j<=DoF; j++)  M[i][j] = 0.0;
+	for (i=M->rptr[1]; i<M->rptr[DoF+1]; i++)	M->val[i] = 0.0;
 
 	m      = dmatrix(1,12,1,12);
 	ind    = imatrix(1,12,1,nE);
@@ -708,10 +2934,10 @@ void assemble_M(
 
 	for ( i = 1; i <= nE; i++ ) {
 
-		if ( lump )	lumped_M ( m, xyz, L[i], N1[i], N2[i],
-				Ax[i], Jx[i], Iy[i], Iz[i], p[i], d[i], EMs[i]);
-		else		consistent_M ( m, xyz,r,L[i], N1[i], N2[i],
-				Ax[i], Jx[i], Iy[i], Iz[i], p[i], d[i], EMs[i]);
+		if ( lump )	lumped_M ( m, L[i],
+				Ax[i], Jx[i], Iy[i], Iz[i], eg+i, d[i], EMs[i]);
+		else		consistent_M ( m, L[i],
+				Ax[i], Jx[i], Iy[i], Iz[i], eg+i, d[i], EMs[i]);
 
 		if (debug) {
 			res = sprintf(mass_fn,"m_%03d",i);
@@ -722,25 +2948,26 @@ void assemble_M(
 			ii = ind[l][i];
 			for ( ll=1; ll <= 12; ll++ ) {
 				jj = ind[ll][i];
-				M[ii][jj] += m[l][ll];
+				if ( (Mij = mass_term ( M, ii, jj )) )
+					*Mij += m[l][ll];
 			}
 		}
 	}
 
 	for ( j = 1; j <= nN; j++ ) {		// add extra node mass
 		i = 6*(j-1);
-		M[i+1][i+1] += NMs[j];
-		M[i+2][i+2] += NMs[j];
-		M[i+3][i+3] += NMs[j];
-		M[i+4][i+4] += NMx[j];
-		M[i+5][i+5] += NMy[j];
-		M[i+6][i+6] += NMz[j];
+		M->val[M->dg[i+1]] += NMs[j];
+		M->val[M->dg[i+2]] += NMs[j];
+		M->val[M->dg[i+3]] += NMs[j];
+		M->val[M->dg[i+4]] += NMx[j];
+		M->val[M->dg[i+5]] += NMy[j];
+		M->val[M->dg[i+6]] += NMz[j];
 	}
 
 	for (i=1; i<= DoF; i++) {
-		if ( M[i][i] <= 0.0 ) {
+		if ( M->val[M->dg[i]] <= 0.0 ) {
 			fprintf(stderr,"  error: Non pos-def mass matrix\n");
-			fprintf(stderr,"  M[%d][%d] = %lf\n", i,i, M[i][i] );
+			fprintf(stderr,"  M[%d][%d] = %lf\n", i,i, M->val[M->dg[i]] );
 		}
 	}
 	free_dmatrix ( m, 1,12,1,12);
@@ -752,16 +2979,15 @@ void assemble_M(
  * LUMPED_M  -  space frame element lumped mass matrix in global coordnates 7apr94
  */
 static void lumped_M(
-	double **m, vec3 *xyz, double L,
-	int n1, int n2, float Ax, float J, float Iy, float Iz, float p,
+	double **m, double L,
+	float Ax, float J, float Iy, float Iz, elem_geom *g,
 	float d, float EMs
 ){
 	double   t1, t2, t3, t4, t5, t6, t7, t8, t9,     /* coord Xformn */
 		t, ry,rz, po;	/* translational, rotational & polar inertia */
 	int     i, j;
 
-	coord_trans ( xyz, L, n1, n2,
-				&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p );
+	get_coord_trans ( g, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 			/* rotatory inertia of extra mass is neglected */
 
@@ -789,16 +3015,15 @@ static void lumped_M(
  *		 does not include shear deformations
  */
 void consistent_M(
-	double **m, vec3 *xyz, float *r, double L,
-	int n1, int n2, float Ax, float J, float Iy, float Iz, float p, 
+	double **m, double L,
+	float Ax, float J, float Iy, float Iz, elem_geom *g, 
 	float d, float EMs
 ){
 	double	t1, t2, t3, t4, t5, t6, t7, t8, t9,     /* coord Xformn */
 		t, ry, rz, po;	/* translational, rotational & polar inertia */
 	int     i, j;
 
-	coord_trans ( xyz, L, n1, n2,
-				&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p );
+	get_coord_trans ( g, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 	t  =  d*Ax*L;	
 	ry =  d*Iy;
@@ -841,7 +3066,7 @@ void consistent_M(
 	save_dmatrix ( "mo", m, 1,12, 1,12, 0, "w" ); /* element mass matrix */
 #endif
 
-	atma(t1,t2,t3,t4,t5,t6,t7,t8,t9, m, r[n1],r[n2]);	/* globalize */
+	atma(t1,t2,t3,t4,t5,t6,t7,t8,t9, m);	/* globalize */
 
 
 	/* check and enforce symmetry of consistent element mass matrix */ 
@@ -932,17 +3157,28 @@ void static_condensation(
 }
 
 
+/*
+ * M_TERM  -  term i,j of the mass matrix, zero if it is not stored
+ */
+static double M_term ( mass_matrix *M, int i, int j )
+{
+	double	*Mij = mass_term ( M, i, j );
+
+	return Mij ? *Mij : 0.0;
+}
+
+
 /*
  * PAZ_CONDENSATION -   Paz condensation of mass and stiffness matrices 6jun07
  *          Paz M. Dynamic condensation. AIAA J 1984;22(5):724-727.
  */
 void paz_condensation(
-	double **M, double **K, int N,
+	mass_matrix *M, double **K, int N,
 	int *c, int n,
 	double **Mc, double **Kc, double w2, 
 	int verbose
 ){
-	double	**Drr, **Drc, **invDrrDrc, **T;
+	double	**Drr, **Drc, **invDrrDrc, **T, **MT;
 	int	i,j,k, ri,rj,cj, ok, 
 		*r;
 	
@@ -974,8 +3210,8 @@ void paz_condensation(
 			ri = r[i];
 			rj = r[j];
 			if ( ri <= rj )	
-				Drr[j][i] = Drr[i][j] = K[ri][rj]-w2*M[ri][rj];
-			else	Drr[j][i] = Drr[i][j] = K[rj][ri]-w2*M[rj][ri];
+				Drr[j][i] = Drr[i][j] = K[ri][rj]-w2*M_term(M,ri,rj);
+			else	Drr[j][i] = Drr[i][j] = K[rj][ri]-w2*M_term(M,rj,ri);
 		}
 	}
 
@@ -983,8 +3219,8 @@ void paz_condensation(
 		for (j=1; j<=n; j++) {	/* use only upper triangle of K,M */
 			ri = r[i];
 			cj = c[j];
-			if ( ri < cj )	Drc[i][j] = K[ri][cj] - w2*M[ri][cj];
-			else		Drc[i][j] = K[cj][ri] - w2*M[cj][ri];
+			if ( ri < cj )	Drc[i][j] = K[ri][cj] - w2*M_term(M,ri,cj);
+			else		Drc[i][j] = K[cj][ri] - w2*M_term(M,cj,ri);
 		}
 	}
 
@@ -998,9 +3234,12 @@ void paz_condensation(
 	for (i=1; i<=N-n; i++) 
 		for (j=1; j<=n; j++)	T[r[i]][j] = -invDrrDrc[i][j];
 
-	xtAx ( K, T, Kc, N, n );		/* Kc = T' * K * T	*/
+	MT  = dmatrix(1,N,1,n);
+	mass_prodAX ( M, T, MT, n );		/* M * T		*/
+
+	xtAx_pair ( K, T, MT, Kc, Mc, N, n );	/* Kc = T'*K*T, Mc = T'*M*T */
 
-	xtAx ( M, T, Mc, N, n );		/* Mc = T' * M * T	*/
+	free_dmatrix ( MT, 1,N,1,n );
 
 	free_ivector ( r,   1, N-n );
 	free_dmatrix ( Drr, 1,N-n,1,N-n );
@@ -1017,7 +3256,7 @@ void paz_condensation(
  * WARNING: Kc and Mc may be ill-conditioned, and xyzsibly non-positive def.
  */
 void modal_condensation(
-	double **M, double **K, int N, int *R, int *p, int n,
+	mass_matrix *M, int N, int *R, int *p, int n,
 	double **Mc, double **Kc, double **V, double *f, int *m,
 	int verbose
 ){
@@ -1035,7 +3274,7 @@ void modal_condensation(
 
 	pseudo_inv ( P, invP, n, n, 1e-9, verbose );
 
-	for (i=1; i<=N; i++) if ( !R[i] ) traceM += M[i][i];
+	for (i=1; i<=N; i++) if ( !R[i] ) traceM += M->val[M->dg[i]];
 
 	for (i=1; i<=n; i++) { 		/* compute inv(P)' * I * inv(P)	*/
 	    for (j=1; j<=n; j++) {
@@ -1074,8 +3313,7 @@ void modal_condensation(
  * DEALLOCATE  -  release allocated memory					9sep08
  */
 void deallocate( 
-	int nN, int nE, int nL, int *nF, int *nU, int *nW, int *nP, int *nT,
-	int DoF, int nM,
+	int nN, int nE, int nL, int DoF, int nM,
 	vec3 *xyz, float *rj, double *L, double *Le,
 	int *N1, int *N2, int *q, int *r,
 	float *Ax, float *Asy, float *Asz, float *J, float *Iy, float *Iz,
@@ -1084,11 +3322,11 @@ void deallocate(
 	float **Dp,
 	double **F_mech, double **F_temp, 
 	double ***eqF_mech, double ***eqF_temp, double *F, double *dF,
-	double **K, double **Q,
+	double *K, int *maxa, int *dof, double **Q,
 	double *D, double *dD,
 	double *R, double *dR,
 	float *d, float *EMs, float *NMs, float *NMx, float *NMy, float *NMz,
-	double **M, double *f, double **V,
+	mass_matrix *M, double *f, double **V,
 	int *c, int *m, 
 	double **pkNx, double **pkVy, double **pkVz, double **pkTx, double **pkMy, double **pkMz, 
 	double **pkDx, double **pkDy, double **pkDz, double **pkRx, double **pkSy, double **pkSz 
@@ -1139,7 +3377,9 @@ void deallocate(
 	free_dvector(dF,1,DoF);
 
 // printf("..H.. K & Q\n"); /* debug */
-	free_dmatrix(K,1,DoF,1,DoF);
+	if ( K )	free_dvector(K,1,maxa[DoF+1]-1);
+	free_ivector(maxa,1,DoF+1);
+	free_ivector(dof,1,DoF);
 	free_dmatrix(Q,1,nE,1,12);
 
 // printf("..I.. D  dD R dR \n"); /* debug */
@@ -1176,7 +3416,7 @@ void deallocate(
 
 // printf("..L.. M f V\n"); /* debug */
 	if ( nM > 0 ) {
-		free_dmatrix(M,1,DoF,1,DoF);
+		free_mass_matrix ( M );
 		free_dvector(f,1,nM);
 		free_dmatrix(V,1,DoF,1,DoF);
 	}
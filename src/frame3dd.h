@@ -30,37 +30,413 @@
 /* for Micro-Stran compatability, structure for cartesian vectors */
 #include "microstran/vec3.h"
 
+/* sparse supernodal L D L' decomposition of the stiffness matrix */
+#include "sparse.h"
+
+/* out-of-core skyline L D L' decomposition of the stiffness matrix */
+#include "outcore.h"
+
+/* compact storage of the mass matrix */
+#include "mass.h"
+
+/* element coordinate transformations, elem_geom */
+#include "coordtrans.h"
+
 /* maximum number of load cases */
 #define _NL_ 32
 
 
+/** renumber the nodes internally to reduce the profile of [K] */
+void renumber_nodes(
+	int nN,			/**< number of nodes			*/
+	int nE,			/**< number of frame elements		*/
+	int *N1, int *N2,	/**< node connectivity			*/
+	int *dof		/**< location of each coordinate in [K]	*/
+);
+
+
+/** locate the diagonal terms of the skyline stiffness matrix */
+int skyline_profile(
+	int DoF,		/**< number of degrees of freedom	*/
+	int nE,			/**< number of frame elements		*/
+	int *N1, int *N2,	/**< node connectivity			*/
+	int *dof,		/**< location of each coordinate in [K]	*/
+	int *maxa		/**< location of diagonal terms, 1..DoF+1 */
+);
+
+
 /** form the global stiffness matrix */
 void assemble_K(
-	double **K,		/**< stiffness matrix			*/
+	double *K,		/**< skyline or sparse stiffness matrix	*/
+	int *maxa,		/**< location of diagonal terms in K	*/
+	sparse_ldl *S,		/**< columns of a sparse K, or NULL	*/
+	int *dof,		/**< location of each coordinate in K	*/
 	int DoF,		/**< number of degrees of freedom	*/
 	int nE,			/**< number of frame elements		*/
-	vec3 *xyz,		/**< XYZ locations of every node	*/
-	float *r,		/**< rigid radius of every node	*/
 	double *L, double *Le,	/**< length of each frame element, effective */
 	int *N1, int *N2,	/**< node connectivity			*/
-	float *Ax, float *Asy, float *Asz,	/**< section areas	*/
+	float *Ax,	/**< cross section area of each element	*/
 	float *Jx, float *Iy, float *Iz,	/**< section inertias	*/
 	float *E, float *G,	/**< elastic and shear moduli		*/
-	float *p,		/**< roll angle, radians		*/
-	int shear,		/**< 1: include shear deformation, 0: don't */
+	elem_geom *eg,		/**< element coordinate transformations	*/
 	int geom,		/**< 1: include goemetric stiffness, 0: don't */
 	double **Q,		/**< frame element end forces		*/
-	int debug		/**< 1: write element stiffness matrices*/
+	int debug,		/**< 1: write element stiffness matrices*/
+	int nthreads		/**< number of threads for the assembly	*/
+);
+
+
+/**
+	elastic stiffness matrix of the frame and geometric stiffness matrices
+	of its elements for a unit axial force, from cache_K(), so that 
+	update_K() forms [K] = [Ke] + sum of N_i [Kg_i] for element forces N_i
+*/
+typedef struct {
+	int	DoF;		/**< number of degrees of freedom	*/
+	int	nE;		/**< number of frame elements		*/
+	int	nK;		/**< number of terms in the skyline of K,
+					or in the columns of a sparse K	*/
+	double	*Ke;		/**< skyline or sparse elastic stiffness */
+	double	**ke;		/**< upper triangle of each [Ke_i]	*/
+	double	**kg;		/**< upper triangle of each unit [Kg_i]	*/
+	int	**loc;		/**< location in K of each term of kg	*/
+	int	**ind;		/**< location in K of each element coord */
+	int	nc;		/**< number of element colors		*/
+	int	*elist;		/**< elements in order of color		*/
+	int	*cptr;		/**< first element of each color in elist */
+	int	nthreads;	/**< number of threads for the products	*/
+} K_cache;
+
+
+/** 
+	assemble the elastic stiffness matrix and compute the unit geometric
+	stiffness matrix of each element, for update_K()
+*/
+K_cache *cache_K(
+	int *maxa,		/**< location of diagonal terms in K	*/
+	sparse_ldl *S,		/**< columns of a sparse K, or NULL	*/
+	int *dof,		/**< location of each coordinate in K	*/
+	int DoF,		/**< number of degrees of freedom	*/
+	int nE,			/**< number of frame elements		*/
+	double *L, double *Le,	/**< length of each frame element, effective */
+	int *N1, int *N2,	/**< node connectivity			*/
+	float *Ax,	/**< cross section area of each element	*/
+	float *Jx, float *Iy, float *Iz,	/**< section inertias	*/
+	float *E, float *G,	/**< elastic and shear moduli		*/
+	elem_geom *eg,		/**< element coordinate transformations	*/
+	double **Q,		/**< frame element end forces		*/
+	int debug,		/**< 1: write element stiffness matrices*/
+	int nthreads		/**< number of threads for the assembly	*/
+);
+
+
+/** 
+	the elastic stiffness matrix of each element and its location in [K],
+	for element_product_K() without an assembled [K]
+*/
+K_cache *cache_elements(
+	int *dof,		/**< location of each coordinate in K	*/
+	int DoF,		/**< number of degrees of freedom	*/
+	int nE,			/**< number of frame elements		*/
+	double *L, double *Le,	/**< length of each frame element, effective */
+	int *N1, int *N2,	/**< node connectivity			*/
+	float *Ax,	/**< cross section area of each element	*/
+	float *Jx, float *Iy, float *Iz,	/**< section inertias	*/
+	float *E, float *G,	/**< elastic and shear moduli		*/
+	elem_geom *eg,		/**< element coordinate transformations	*/
+	int nthreads		/**< number of threads for the products	*/
 );
 
 
+/** [K] = [Ke] + sum of [Kg_i] scaled by the axial force of each element */
+void update_K(
+	K_cache *KC,	/**< stiffness matrices from cache_K()		*/
+	double *K,	/**< skyline stiffness matrix			*/
+	double **Q	/**< frame element end forces			*/
+);
+
+
+
+/**
+	the stiffness matrix of a modal analysis by stodola(), in place of
+	[K], with the reactions applied;  returns the trace of [K_qq]
+*/
+double dynamic_K(
+	double *K,	/**< skyline or sparse stiffness matrix		*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	sparse_ldl *S,	/**< columns of a sparse K, or NULL		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *r		/**< 0: not a reaction; 1: a reaction coordinate */
+);
+
+/** {y} = [K]{x} element by element, with [K] as formed by update_K() */
+void element_product_K(
+	K_cache *KC,	/**< stiffness matrices from cache_K()		*/
+	double **Q,	/**< frame element end forces, or NULL for [Ke]	*/
+	double *x,	/**< vector in the numbering of K		*/
+	double *y	/**< product [K]{x} in the numbering of K	*/
+);
+
+
+/** release the memory of the stiffness matrices from cache_K() */
+void free_K_cache( K_cache *KC );
+
+
+/**
+	L D L' decomposition of the free-coordinate partition of [K],
+	from factor_system(), for any number of solutions with solve_factored()
+*/
+typedef struct {
+	int	DoF;		/**< number of degrees of freedom	*/
+	int	nK;		/**< number of terms in the skyline of K,
+					or in the columns of S		*/
+	int	*maxa;		/**< location of diagonal terms in K	*/
+	int	*dof;		/**< location of each coordinate in K	*/
+	sparse_ldl *S;		/**< sparse L D L' of K, or NULL for skyline */
+	ooc_profile *P;		/**< out-of-core skyline L D L' of K, or NULL */
+	double	*Kf;		/**< skyline L D L' decomposition of K	*/
+	double	*diag;		/**< diagonal of D of the skyline L D L' */
+	float	*Kfs;		/**< single-precision skyline L D L' of K */
+	float	*diags;		/**< diagonal of D of the single L D L'	*/
+	int	*qk, *rk;	/**< q and r in the numbering of K	*/
+	double	*Fk, *Dk, *Rk;	/**< work vectors in the numbering of K	*/
+	int	ok;		/**< status of the L D L' decomposition	*/
+	int	indefinite;	/**< 1: solve even if K is not pos-def	*/
+	int	mapped;		/**< 1: Kf and diag are not held by this */
+	int	nw;		/**< rank of the Woodbury update of an earlier 
+					decomposition, or -1		*/
+	int	*wk;		/**< coordinates of the update, in K	*/
+	double	**Zw;		/**< [K0_qq]^-1 at each coordinate wk	*/
+	double	**Cw;		/**< change of [K_qq] at the coordinates wk */
+	double	**Mw;		/**< L D L' of [Z]'(I+[C][Z]) at coord's wk */
+	double	*dw;		/**< diagonal of D of Mw		*/
+} ldl_factor;
+
+
+/** 
+	L D L' decomposition of [K_qq] for solutions with solve_factored().
+	With the sparse solver the numerical factor is held in S, and
+	out of core in the scratch file of P, so only one decomposition
+	may use S or P at a time.
+*/
+ldl_factor *factor_system(
+	double *K,	/**< skyline stiffness matrix, or the columns of S */
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	sparse_ldl *S,	/**< sparse L D L' of K, or NULL for skyline	*/
+	ooc_profile *P,	/**< scratch file holding K, P->K, or NULL	*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok		/**< indicates positive definite stiffness matrix */
+);
+
+
+/** 
+	single-precision skyline L D L' decomposition of [K_qq] for solutions 
+	with solve_factored(), refined in double precision
+*/
+ldl_factor *factor_single(
+	double *K,	/**< skyline stiffness matrix, restrained frame	*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok		/**< indicates positive definite stiffness matrix */
+);
+
+
+/**
+	L D L' decomposition of [K_qq] from that of an earlier [K0_qq] with 
+	the same skyline, changed in the terms of a few elements
+*/
+ldl_factor *update_factor(
+	ldl_factor *KB,	/**< L D L' decomposition of K0, kept	*/
+	double *K0,	/**< earlier skyline stiffness matrix		*/
+	double *K,	/**< skyline stiffness matrix, restrained frame	*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok		/**< indicates positive definite stiffness matrix */
+);
+
+
+/** solve {F} = [K]{D} with the L D L' decomposition from factor_system() */
+void solve_factored(
+	ldl_factor *KF,	/**< L D L' decomposition of K, from factor_system */
+	double *K,	/**< skyline stiffness matrix, restrained frame	*/
+	double *D,	/**< displacement vector to be solved		*/
+	double *F,	/**< external load vector			*/
+	double *R,	/**< reaction vector				*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok,	/**< indicates positive definite stiffness matrix */
+	int verbose,	/**< 1: copious screen output; 0: none		*/
+	double *rms_resid /**< the RMS error of the solution residual */
+);
+
+
+#define RHS_BLOCK	16	/* load vectors solved together		*/
+
+/** 
+	solve {F} = [K]{D} for nb load vectors with the L D L' decomposition
+	from factor_system(), RHS_BLOCK at a time
+*/
+void solve_factored_block(
+	ldl_factor *KF,	/**< L D L' decomposition of K, from factor_system */
+	double *K,	/**< skyline stiffness matrix, restrained frame	*/
+	double **D,	/**< displacement vectors to be solved, D[1..nb] */
+	double **F,	/**< external load vectors, F[1..nb]		*/
+	double **R,	/**< reaction vectors, R[1..nb]			*/
+	int nb,		/**< number of load vectors			*/
+	int *sel,	/**< sel[k] > 0: solve load vector k, NULL: all	*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok,	/**< indicates positive definite stiffness matrix */
+	double *rms_resid /**< the RMS error of each solution residual	*/
+);
+
+
+/** release the memory of an L D L' decomposition from factor_system() */
+void free_factor( ldl_factor *KF );
+
+
 /** solve {F} =   [K]{D} via L D L' decomposition */
 void solve_system(
-	double **K,	/**< stiffness matrix for the restrained frame	*/
+	double *K,	/**< skyline stiffness matrix, restrained frame	*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	sparse_ldl *S,	/**< sparse L D L' of K, or NULL for skyline	*/
+	ooc_profile *P,	/**< scratch file holding K, P->K, or NULL	*/
+	double *D,	/**< displacement vector to be solved		*/
+	double *F,	/**< external load vector			*/
+	double *R,	/**< reaction vector				*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok,	/**< indicates positive definite stiffness matrix */
+	int verbose,	/**< 1: copious screen output; 0: none		*/
+	double *rms_resid /**< the RMS error of the solution residual */
+);
+
+
+#define PCG_JACOBI	1	/* diagonal preconditioner		*/
+#define PCG_BLOCK	2	/* 6-by-6 nodal block preconditioner	*/
+#define PCG_IC		3	/* incomplete Cholesky preconditioner	*/
+
+/**
+	preconditioned conjugate gradient solutions of [K]{D} = {F} 
+	with element-by-element products, from new_pcg_solver()
+*/
+typedef struct {
+	int	DoF;		/**< number of degrees of freedom	*/
+	int	nN;		/**< number of nodes			*/
+	int	precond;	/**< PCG_JACOBI, PCG_BLOCK, or PCG_IC	*/
+	K_cache	*KC;		/**< element matrices from cache_elements() */
+	int	*dof;		/**< location of each coordinate in K	*/
+	int	*qk, *rk;	/**< q and r in the numbering of K	*/
+	double	*dinv;		/**< inverse of the diagonal of K	*/
+	double	*blk;		/**< Cholesky factor of each nodal block */
+	int	*ia, *ja;	/**< rows and columns of the IC factor	*/
+	double	*a;		/**< incomplete Cholesky factor of K	*/
+	double	*x, *res, *z, *p, *Ap, *Fk; /**< work vectors		*/
+	int	iter;		/**< iterations of the last solution	*/
+} pcg_solver;
+
+
+/** the preconditioner of pcg_solve() */
+pcg_solver *new_pcg_solver(
+	K_cache *KC,	/**< element matrices from cache_elements()	*/
+	int *dof,	/**< location of each coordinate in K		*/
+	int nN,		/**< number of nodes				*/
+	int nE,		/**< number of frame elements			*/
+	int *N1, int *N2, /**< node connectivity			*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int precond	/**< PCG_JACOBI, PCG_BLOCK, or PCG_IC		*/
+);
+
+
+/** solve {F} = [K]{D} by preconditioned conjugate gradient iterations */
+int pcg_solve(
+	pcg_solver *PC,	/**< preconditioner from new_pcg_solver()	*/
 	double *D,	/**< displacement vector to be solved		*/
 	double *F,	/**< external load vector			*/
 	double *R,	/**< reaction vector				*/
+	double *D0,	/**< initial {D_q}, returned as the solution	*/
+	double *rms_resid /**< the relative residual of the solution	*/
+);
+
+
+/** release the memory of new_pcg_solver() */
+void free_pcg_solver( pcg_solver *PC );
+
+
+#define NR_NEWTON	0	/* factor [K] at every iteration	*/
+#define NR_MODIFIED	1	/* factor [K] every few iterations	*/
+#define NR_LBFGS	2	/* L-BFGS updates to the last factored [K] */
+
+/**
+	state of the iterations for geometric nonlinearity, from new_NR_solver()
+*/
+typedef struct {
+	int	method;		/**< NR_NEWTON, NR_MODIFIED, or NR_LBFGS */
+	int	interval;	/**< iterations between factorizations, or
+					number of L-BFGS update pairs	*/
+	int	DoF;		/**< number of degrees of freedom	*/
+	ooc_profile *P;		/**< scratch file holding [K], or NULL	*/
+	ldl_factor *KF;		/**< L D L' decomposition of the last [K] factored */
+	int	age;		/**< iterations since the last factorization */
+	double	error;		/**< equilibrium error of the last iteration */
+	int	np, head;	/**< number of update pairs, and the newest */
+	double	**s, **y;	/**< L-BFGS increments of {D} and of {dF} */
+	double	*rho, *alpha;	/**< 1/(y's) and the two-loop coefficients */
+	double	*dD0, *dF0;	/**< step and residual of the last iteration */
+	int	n_factor;	/**< number of factorizations of [K]	*/
+	int	indefinite;	/**< 1: solve even if [K] is not pos-def */
+} NR_solver;
+
+
+/** allocate the state of the iterations for geometric nonlinearity */
+NR_solver *new_NR_solver(
+	int method,	/**< NR_NEWTON, NR_MODIFIED, or NR_LBFGS	*/
+	int interval,	/**< iterations between factorizations, or pairs */
 	int DoF,	/**< number of degrees of freedom		*/
+	ooc_profile *P	/**< scratch file holding [K], or NULL		*/
+);
+
+
+/** forget the factored [K] and the update pairs, e.g., for a new load case */
+void reset_NR_solver( NR_solver *NR );
+
+
+/** factor [K] if the iterations call for it; returns 1 if [K] was factored */
+int NR_factor(
+	NR_solver *NR,	/**< state of the iterations, from new_NR_solver() */
+	double *K,	/**< skyline stiffness matrix at this iteration	*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	sparse_ldl *S,	/**< sparse L D L' of K, or NULL for skyline	*/
+	double error,	/**< relative equilibrium error of this iteration */
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	int *ok		/**< indicates positive definite stiffness matrix */
+);
+
+
+/** solve {dF} = [K]{dD} for an iteration for geometric nonlinearity */
+void NR_solve(
+	NR_solver *NR,	/**< state of the iterations, from new_NR_solver() */
+	double *K,	/**< skyline stiffness matrix at this iteration	*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	sparse_ldl *S,	/**< sparse L D L' of K, or NULL for skyline	*/
+	double *dD,	/**< displacement increment to be solved	*/
+	double *dF,	/**< equilibrium error of this iteration	*/
+	double *dR,	/**< reaction increment				*/
+	double error,	/**< relative equilibrium error of this iteration */
 	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
 	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
 	int *ok,	/**< indicates positive definite stiffness matrix */
@@ -69,6 +445,10 @@ void solve_system(
 );
 
 
+/** release the memory of the iterations from new_NR_solver() */
+void free_NR_solver( NR_solver *NR );
+
+
 /*
  * COMPUTE_REACTION_FORCES : R(r) = [K(r,q)]*{D(q)} + [K(r,r)]*{D(r)} - F(r)
  * reaction forces satisfy equilibrium in the solved system
@@ -77,7 +457,10 @@ void solve_system(
 void compute_reaction_forces(
 	double *R, 	/**< computed reaction forces			*/
 	double *F,	/**< vector of equivalent external loads	*/
-	double **K,	/**< stiffness matrix for the solved system	*/
+	double *K,	/**< skyline or sparse stiffness matrix, solved system */
+	int *maxa,	/**< location of diagonal terms in K		*/
+	sparse_ldl *S,	/**< columns of a sparse K, or NULL		*/
+	int *dof,	/**< location of each coordinate in K		*/
 	double *D,	/**< displacement vector for the solved system	*/
 	int DoF,	/**< number of structural coordinates		*/
 	int *r		/**< 0: not a reaction; 1: a reaction coordinate */
@@ -105,16 +488,22 @@ void add_feF(
 /*
  * EQUILBRIUM_ERROR - compute {dF} = {F} - [K_qq]{D_q} - [K_qr]{D_r}
  * and return ||dF|| / ||F||
- * use only the upper trianlge of [K_qq]
+ * [K] is stored in skyline form or in the columns of S, or is applied
+ * element by element with the matrices from cache_K() and the axial forces
+ * in Q
  */
 double equilibrium_error(
 	double *dF,	/**< equilibrium error  {dF} = {F} - [K]{D}	*/
 	double *F,	/**< load vector                                */
-	double **K,	/**< stiffness matrix for the restrained frame  */
+	double *K,	/**< skyline or sparse stiffness matrix		*/
+	int *maxa,	/**< location of diagonal terms in K            */
+	sparse_ldl *S,	/**< columns of a sparse K, or NULL		*/
+	int *dof,	/**< location of each coordinate in K           */
 	double *D,	/**< displacement vector to be solved           */
 	int DoF,	/**< number of degrees of freedom               */
 	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
-	int *r		/**< 0: not a reaction; 1: a reaction coordinate */
+	K_cache *KC,	/**< element matrices from cache_K(), or NULL	*/
+	double **Q	/**< frame element end forces, with KC		*/
 );
 
 
@@ -122,35 +511,72 @@ double equilibrium_error(
 void element_end_forces(
 	double **Q,	/**< frame element end forces			*/
 	int nE,		/**< number of frame elements			*/
-	vec3 *xyz,	/** XYZ locations of each node			*/
 	double *L, double *Le,	/**< length of each frame element, effective */
 	int *N1, int *N2,	/**< node connectivity			*/
-	float *Ax, float *Asy, float *Asz,	/**< section areas	*/
+	float *Ax,	/**< cross section area of each element	*/
 	float *Jx, float *Iy, float *Iz,	/**< section area inertias */
 	float *E, float *G,	/**< elastic and shear moduli		*/
-	float *p,		/**< roll angle, radians		*/
+	elem_geom *eg,		/**< element coordinate transformations	*/
 	double **eqF_temp, /**< equivalent temp loads on elements, global */
 	double **eqF_mech, /**< equivalent mech loads on elements, global */
 	double *D,	/**< displacement vector			*/
-	int shear,	/**< 1: include shear deformation, 0: don't	*/
 	int geom,	/**< 1: include goemetric stiffness, 0: don't	*/
 	int *axial_strain_warning /** < 0: strains < 0.001         */ 
 );
 
 
+/** 
+	geometrically nonlinear analysis by increments of the load factor
+	from 0 to 1, under load control or arc-length control, 
+	returning the load factor reached
+*/
+double load_increments(
+	double **Q,	/**< frame element end forces			*/
+	int nE,		/**< number of frame elements			*/
+	double *L, double *Le,	/**< length of each frame element, effective */
+	int *N1, int *N2,	/**< node connectivity			*/
+	float *Ax,	/**< cross section area of each element	*/
+	float *Jx, float *Iy, float *Iz,	/**< section area inertias */
+	float *E, float *G,	/**< elastic and shear moduli		*/
+	elem_geom *eg,		/**< element coordinate transformations	*/
+	double **eqF_temp, /**< equivalent temp loads on elements, global */
+	double **eqF_mech, /**< equivalent mech loads on elements, global */
+	int *axial_strain_warning, /**< 0: strains < 0.001		*/
+	K_cache *KC,	/**< stiffness matrices from cache_K()		*/
+	double *K,	/**< skyline stiffness matrix			*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	sparse_ldl *S,	/**< sparse L D L' of K, or NULL for skyline	*/
+	NR_solver *NR,	/**< state of the iterations, from new_NR_solver() */
+	double *F,	/**< external load vector, full load		*/
+	float *Dp,	/**< prescribed displacements, full load	*/
+	double *D,	/**< displacement vector at the load factor reached */
+	double *dF,	/**< equilibrium error at the load factor reached */
+	int DoF,	/**< number of degrees of freedom		*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	int *r,		/**< 0: not a reaction; 1: a reaction coordinate */
+	double tol,	/**< convergence tolerance of each increment	*/
+	double step,	/**< first increment of the load factor		*/
+	int arc,	/**< 1: arc-length control, 0: load control	*/
+	int verbose,	/**< 1: copious screen output; 0: none		*/
+	double *error,	/**< relative equilibrium error at the end	*/
+	double *rms_resid, /**< RMS residual of the last L D L' solution */
+	int *iter,	/**< total number of iterations			*/
+	int *ok		/**< indicates positive definite stiffness matrix */
+);
+
+
 
 /** assemble global mass matrix from element mass & inertia */
 void assemble_M(
-	double **M,	/**< mass matrix				*/
+	mass_matrix *M,	/**< mass matrix, from mass_analyze()		*/
 	int DoF,	/**< number of degrees of freedom		*/
 	int nN, int nE,	/**< number of nodes, number of frame elements	*/
-	vec3 *xyz,	/** XYZ locations of each node			*/
-	float *r,	/**< rigid radius of every node		*/
 	double *L,	/**< length of each frame element, effective	*/
 	int *N1, int *N2, /**< node connectivity			*/
 	float *Ax,	/**< node connectivity				*/
 	float *Jx, float *Iy, float *Iz,	/**< section area inertias*/
-	float *p,	/**< roll angle, radians			*/
+	elem_geom *eg,	/**< element coordinate transformations		*/
 	float *d,	/**< frame element density			*/
 	float *EMs,	/**< extra frame element mass			*/
 	float *NMs,	/**< node mass					*/
@@ -177,7 +603,7 @@ void static_condensation(
         Paz M. Dynamic condensation. AIAA J 1984;22(5):724-727.
 */
 void paz_condensation(
-	double **M, double **K,	/**< mass and stiffness matrices	*/
+	mass_matrix *M, double **K, /**< mass and stiffness matrices	*/
 	int N,			/**< dimension of the matrices, DoF	*/
 	int *q,			/**< list of degrees of freedom to retain */
 	int n,			/**< dimension of the condensed matrices */
@@ -194,7 +620,7 @@ void paz_condensation(
 	@NOTE Kc and Mc may be ill-conditioned, and xyzsibly non-positive def.
 */
 void modal_condensation(
-	double **M, double **K,	/**< mass and stiffness matrices	*/
+	mass_matrix *M,	/**< mass matrix				*/
 	int N,			/**< dimension of the matrices, DoF	*/
 	int *R,		/**< R[i]=1: DoF i is fixed, R[i]=0: DoF i is free */
 	int *p,		/**< list of primary degrees of freedom		*/
@@ -210,8 +636,7 @@ void modal_condensation(
 	release allocated memory
 */
 void deallocate( 
-	int nN, int nE, int nL, int *nF, int *nU, int *nW, int *nP, int *nT, int DoF,
-	int modes,
+	int nN, int nE, int nL, int DoF, int modes,
 	vec3 *xyz, float *rj, double *L, double *Le,
 	int *N1, int *N2, int *q, int *r,
 	float *Ax, float *Asy, float *Asz,
@@ -222,12 +647,12 @@ void deallocate(
 	float **Dp,
 	double **F_mech, double **F_temp,
 	double ***eqF_mech, double ***eqF_temp, double *F, double *dF, 
-	double **K, double **Q,
+	double *K, int *maxa, int *dof, double **Q,
 	double *D, double *dD,
 	double *R, double *dR,
 	float *d, float *EMs,
 	float *NMs, float *NMx, float *NMy, float *NMz,
-	double **M, double *f, double **V, 
+	mass_matrix *M, double *f, double **V, 
 	int *c, int *m, 
 	double **pkNx, double **pkVy, double **pkVz, double **pkTx, double **pkMy, double **pkMz,
 	double **pkDx, double **pkDy, double **pkDz, double **pkRx, double **pkSy, double **pkSz
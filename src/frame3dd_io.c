@@ -34,6 +34,7 @@
 
 #include "common.h"
 #include "frame3dd_io.h"
+#include "frame3dd.h"
 #include "coordtrans.h"
 #include "HPGmatrix.h"
 #include "HPGutil.h"
@@ -43,6 +44,10 @@
 
 /* forward decls */
 
+static int skip_values ( FILE *fp, long n );
+static int find_root ( int *root, int n );
+static void write_node_list ( FILE *fp, int *list, int n );
+
 static void getline_no_comment(
 	FILE *fp,    /**< pointer to the file from which to read */
 	char *s,     /**< pointer to the string to which to write */
@@ -71,6 +76,15 @@ void parse_options (
 	int *write_matrix,
 	int *axial_sign,
 	int *condense_flag,
+	int *solver_flag,
+	int *pcg_precond,
+	char cache_file[],
+	int *threads,
+	int *NR_method,
+	int *NR_interval,
+	double *load_step,
+	int *arc_length,
+	double *mem_limit,
 	int *verbose,
 	int *debug
 ){
@@ -79,6 +93,12 @@ void parse_options (
 	char	errMsg[MAXL];
 	int	sfrv=0;		/* *scanf return value	*/
 
+	/* long forms of options */
+	static struct option long_options[] = {
+		{ "mem-limit", required_argument, NULL, 'y' },
+		{ NULL, 0, NULL, 0 }
+	};
+
 	/* default values */
 
 	*shear_flag = *geom_flag  = *anlyz_flag = *lump_flag = *modal_flag = -1;
@@ -86,12 +106,21 @@ void parse_options (
 	*D3_flag = 0;
 	*pan_flag = -1.0;
 	*condense_flag = -1;
+	*solver_flag = -1;
+	*pcg_precond = PCG_BLOCK;
+	*threads = 1;
+	*NR_method = NR_NEWTON;
+	*NR_interval = 5;
+	*load_step = 0.0;
+	*arc_length = 0;
+	*mem_limit = 0.0;
 	*write_matrix = 0;
 	*axial_sign = 1;
 	*debug = 0; *verbose = 1;
 
 	strcpy(  IN_file , "\0" );
 	strcpy( OUT_file , "\0" );
+	strcpy( cache_file , "\0" );
 
 	/* set up file names for the the input data and the output data */
 
@@ -117,9 +146,11 @@ void parse_options (
 	 }
 	}
 
-	// remaining unused flags ... b j k n u y 
+	// remaining unused flags ... none
 
-	while ((option=getopt(argc,argv, "i:o:acdhqvwxzs:e:f:g:l:m:p:r:t:")) != -1){
+	while ((option=getopt_long(argc,argv,
+		"i:o:acdhqvwxzb:s:e:f:g:j:k:l:m:n:p:r:t:u:y:", long_options,
+								NULL)) != -1){
 		switch ( option ) {
 			case 'i':		/* input data file name */
 				strcpy(IN_file,optarg);
@@ -192,11 +223,75 @@ void parse_options (
 					*modal_flag = 1;
 				else if (strcmp(optarg,"S")==0)
 					*modal_flag = 2;
+				else if (strcmp(optarg,"L")==0)
+					*modal_flag = 3;
 				else {
-				 errorMsg("\n frame3dd command-line error: argument to -m option should be either J or S\n");
+				 errorMsg("\n frame3dd command-line error: argument to -m option should be J, S or L\n");
 				 exit(6);
 				}
 				break;
+			case 'k':		/* stiffness matrix solver */
+				if (strcmp(optarg,"P")==0)
+					*solver_flag = 1;
+				else if (strcmp(optarg,"S")==0)
+					*solver_flag = 2;
+				else if (strcmp(optarg,"F")==0)
+					*solver_flag = 3;
+				else if (optarg[0]=='C') {
+					*solver_flag = 4;
+					if (optarg[1]=='J')
+						*pcg_precond = PCG_JACOBI;
+					else if (optarg[1]=='I')
+						*pcg_precond = PCG_IC;
+					else if (optarg[1]=='B' || !optarg[1])
+						*pcg_precond = PCG_BLOCK;
+					else	*solver_flag = -2;
+				} else	*solver_flag = -2;
+				if (*solver_flag == -2 || strlen(optarg) > 2) {
+				 errorMsg("\n frame3dd command-line error: argument to -k option should be P, S, F, C, CJ, CB, or CI\n");
+				 exit(34);
+				}
+				break;
+			case 'b':		/* factor cache file */
+				strcpy(cache_file,optarg);
+				break;
+			case 'j':		/* number of threads */
+				*threads = atoi(optarg);
+				if (*threads < 1) {
+				 errorMsg("\n frame3dd command-line error: argument to -j option should be a positive integer.\n");
+				 exit(35);
+				}
+				break;
+			case 'n':		/* nonlinear iteration method */
+				if (optarg[0]=='N')
+					*NR_method = NR_NEWTON;
+				else if (optarg[0]=='M')
+					*NR_method = NR_MODIFIED;
+				else if (optarg[0]=='B')
+					*NR_method = NR_LBFGS;
+				else	*NR_method = -1;
+				if (optarg[0] && optarg[1])
+					*NR_interval = atoi(optarg+1);
+				if (*NR_method < 0 || *NR_interval < 1) {
+				 errorMsg("\n frame3dd command-line error: argument to -n option should be N, M, or B, optionally followed by a positive integer\n");
+				 exit(36);
+				}
+				break;
+			case 'u':		/* load increments	*/
+				*arc_length = ( optarg[0]=='A' );
+				*load_step = atof(optarg + *arc_length);
+				if (*load_step <= 0.0 || *load_step > 1.0) {
+				 errorMsg("\n frame3dd command-line error: argument to -u option should be a load increment between 0 and 1, optionally preceded by A\n");
+				 exit(37);
+				}
+				break;
+			case 'y':		/* memory limit, MB	*/
+				*mem_limit = atof(optarg);
+				if (*mem_limit <= 0.0) {
+				 errorMsg("\n frame3dd command-line error: argument to -y (--mem-limit) option should be a positive number of megabytes.\n");
+				 exit(38);
+				}
+				break;
 			case 't':		/* modal analysis tolerence */
 				*tol_flag = atof(optarg);
 				if (*tol_flag == 0.0) {
@@ -287,8 +382,23 @@ void display_help()
  fprintf(stderr,"  -z            force X-Y-Z plotting\n");
  fprintf(stderr,"  -l  On|Off    On: lumped mass matrix or Off: consistent mass matrix\n");
  fprintf(stderr,"  -f <value>    modal frequency shift for unrestrained structures\n");
- fprintf(stderr,"  -m   J|S      modal analysis method: J=Jacobi-Subspace or S=Stodola\n");
+ fprintf(stderr,"  -m   J|S|L    modal analysis method: J=Jacobi-Subspace, S=Stodola,\n");
+ fprintf(stderr,"                or L=shift-invert block Lanczos\n");
  fprintf(stderr,"  -t <value>    convergence tolerance for modal analysis\n");
+ fprintf(stderr,"  -k P|S|F|C[J|B|I] stiffness solver: P=Profile (skyline), S=Sparse L D L',\n");
+ fprintf(stderr,"                F=single-precision (Float) profile with refinement,\n");
+ fprintf(stderr,"                C=Conjugate gradient, element by element, with Jacobi,\n");
+ fprintf(stderr,"                Block (nodal, default), or Incomplete Cholesky precond.\n");
+ fprintf(stderr,"  -b <file>     keep the factored stiffness matrix of a linear analysis in\n");
+ fprintf(stderr,"                a file, for later analyses of the same frame\n");
+ fprintf(stderr,"  -j <value>    number of threads for stiffness matrix assembly and for\n");
+ fprintf(stderr,"                the Sturm check of a modal analysis\n");
+ fprintf(stderr,"  -n  N|M|B[k]  nonlinear iterations: N=Newton, M=modified Newton, B=L-BFGS\n");
+ fprintf(stderr,"  -u [A]<value> first load increment for nonlinear analysis, A: arc-length\n");
+ fprintf(stderr,"  -y <value>    memory limit in MB, also --mem-limit; the analysis is planned\n");
+ fprintf(stderr,"                to fit, out of core if need be, or is not started\n");
+ fprintf(stderr,"                (a matrix condensation holds the full stiffness matrix\n");
+ fprintf(stderr,"                in memory)\n");
  fprintf(stderr,"  -p <value>    pan rate for mode shape animation\n");
  fprintf(stderr,"  -r <value>    matrix condensation method: 0, 1, 2, or 3 \n");
  fprintf(stderr," -------------------------------------------------------------------------\n");
@@ -844,15 +954,12 @@ void read_reaction_data (
 void read_and_assemble_loads (
 		FILE *fp,
 		int nN, int nE, int nL, int DoF,
-		vec3 *xyz,
 		double *L, double *Le,
 		int *J1, int *J2,
-		float *Ax, float *Asy, float *Asz,
-		float *Iy, float *Iz, float *E, float *G,
-		float *p,
+		float *Ax, float *Iy, float *Iz, float *E,
+		elem_geom *eg,
 		float *d, float *gX, float *gY, float *gZ, 
 		int *r,
-		int shear,
 		int *nF, int *nU, int *nW, int *nP, int *nT, int *nD,
 		double **Q,
 		double **F_temp, double **F_mech, double *Fo, 
@@ -868,7 +975,8 @@ void read_and_assemble_loads (
 
 	/* equivalent element end forces from distributed and thermal loads */
 	double	Nx1, Vy1, Vz1, Mx1=0.0, My1=0.0, Mz1=0.0,
-		Nx2, Vy2, Vz2, Mx2=0.0, My2=0.0, Mz2=0.0;
+		Nx2, Vy2, Vz2, Mx2=0.0, My2=0.0, Mz2=0.0,
+		Qe[13];			/* end forces in local coordinates */
 	double	Ksy, Ksz, 		/* shear deformatn coefficients	*/
 		a, b,			/* point load locations */
 		t1, t2, t3, t4, t5, t6, t7, t8, t9;	/* 3D coord Xfrm coeffs */
@@ -910,8 +1018,7 @@ void read_and_assemble_loads (
 
 		n1 = J1[n];	n2 = J2[n];
 
-		coord_trans ( xyz, L[n], n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[n] );
+		get_coord_trans ( eg+n, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		eqF_mech[lc][n][1]  = d[n]*Ax[n]*L[n]*gX[lc] / 2.0;
 		eqF_mech[lc][n][2]  = d[n]*Ax[n]*L[n]*gY[lc] / 2.0;
@@ -1016,8 +1123,7 @@ void read_and_assemble_loads (
 
 		n1 = J1[n];	n2 = J2[n];
 
-		coord_trans ( xyz, L[n], n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[n] );
+		get_coord_trans ( eg+n, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		/* debugging ... check coordinate transform coefficients
 		printf("t1=%5.2f t2=%5.2f t3=%5.2f \n", t1, t2, t3 );
@@ -1026,19 +1132,11 @@ void read_and_assemble_loads (
 		*/
 
 		/* {F} = [T]'{Q} */
-		eqF_mech[lc][n][1]  += ( Nx1*t1 + Vy1*t4 + Vz1*t7 );
-		eqF_mech[lc][n][2]  += ( Nx1*t2 + Vy1*t5 + Vz1*t8 );
-		eqF_mech[lc][n][3]  += ( Nx1*t3 + Vy1*t6 + Vz1*t9 );
-		eqF_mech[lc][n][4]  += ( Mx1*t1 + My1*t4 + Mz1*t7 );
-		eqF_mech[lc][n][5]  += ( Mx1*t2 + My1*t5 + Mz1*t8 );
-		eqF_mech[lc][n][6]  += ( Mx1*t3 + My1*t6 + Mz1*t9 );
-
-		eqF_mech[lc][n][7]  += ( Nx2*t1 + Vy2*t4 + Vz2*t7 );
-		eqF_mech[lc][n][8]  += ( Nx2*t2 + Vy2*t5 + Vz2*t8 );
-		eqF_mech[lc][n][9]  += ( Nx2*t3 + Vy2*t6 + Vz2*t9 );
-		eqF_mech[lc][n][10] += ( Mx2*t1 + My2*t4 + Mz2*t7 );
-		eqF_mech[lc][n][11] += ( Mx2*t2 + My2*t5 + Mz2*t8 );
-		eqF_mech[lc][n][12] += ( Mx2*t3 + My2*t6 + Mz2*t9 );
+		Qe[1]  = Nx1;	Qe[2]  = Vy1;	Qe[3]  = Vz1;
+		Qe[4]  = Mx1;	Qe[5]  = My1;	Qe[6]  = Mz1;
+		Qe[7]  = Nx2;	Qe[8]  = Vy2;	Qe[9]  = Vz2;
+		Qe[10] = Mx2;	Qe[11] = My2;	Qe[12] = Mz2;
+		rotate_to_global ( t1,t2,t3,t4,t5,t6,t7,t8,t9, Qe, eqF_mech[lc][n] );
 
 		/* debugging ... check eqF values
 		printf("n=%d ", n);
@@ -1141,10 +1239,7 @@ void read_and_assemble_loads (
 		  exit(144);
 		}
 
-		if ( shear ) {
-			Ksy = (12.0*E[n]*Iz[n]) / (G[n]*Asy[n]*Le[n]*Le[n]);
-			Ksz = (12.0*E[n]*Iy[n]) / (G[n]*Asz[n]*Le[n]*Le[n]);
-		} else	Ksy = Ksz = 0.0;
+		Ksy = eg[n].Ksy;	Ksz = eg[n].Ksz;
 
 		/* x-axis trapezoidal loads (along the frame element length) */
 		x1 =  W[lc][i][2]; x2 =  W[lc][i][3];
@@ -1214,8 +1309,7 @@ void read_and_assemble_loads (
 
 		n1 = J1[n];	n2 = J2[n];
 
-		coord_trans ( xyz, Ln, n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[n] );
+		get_coord_trans ( eg+n, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		/* debugging ... check coordinate transformation coefficients
 		printf("t1=%5.2f t2=%5.2f t3=%5.2f \n", t1, t2, t3 );
@@ -1224,19 +1318,11 @@ void read_and_assemble_loads (
 		*/
 
 		/* {F} = [T]'{Q} */
-		eqF_mech[lc][n][1]  += ( Nx1*t1 + Vy1*t4 + Vz1*t7 );
-		eqF_mech[lc][n][2]  += ( Nx1*t2 + Vy1*t5 + Vz1*t8 );
-		eqF_mech[lc][n][3]  += ( Nx1*t3 + Vy1*t6 + Vz1*t9 );
-		eqF_mech[lc][n][4]  += ( Mx1*t1 + My1*t4 + Mz1*t7 );
-		eqF_mech[lc][n][5]  += ( Mx1*t2 + My1*t5 + Mz1*t8 );
-		eqF_mech[lc][n][6]  += ( Mx1*t3 + My1*t6 + Mz1*t9 );
-
-		eqF_mech[lc][n][7]  += ( Nx2*t1 + Vy2*t4 + Vz2*t7 );
-		eqF_mech[lc][n][8]  += ( Nx2*t2 + Vy2*t5 + Vz2*t8 );
-		eqF_mech[lc][n][9]  += ( Nx2*t3 + Vy2*t6 + Vz2*t9 );
-		eqF_mech[lc][n][10] += ( Mx2*t1 + My2*t4 + Mz2*t7 );
-		eqF_mech[lc][n][11] += ( Mx2*t2 + My2*t5 + Mz2*t8 );
-		eqF_mech[lc][n][12] += ( Mx2*t3 + My2*t6 + Mz2*t9 );
+		Qe[1]  = Nx1;	Qe[2]  = Vy1;	Qe[3]  = Vz1;
+		Qe[4]  = Mx1;	Qe[5]  = My1;	Qe[6]  = Mz1;
+		Qe[7]  = Nx2;	Qe[8]  = Vy2;	Qe[9]  = Vz2;
+		Qe[10] = Mx2;	Qe[11] = My2;	Qe[12] = Mz2;
+		rotate_to_global ( t1,t2,t3,t4,t5,t6,t7,t8,t9, Qe, eqF_mech[lc][n] );
 
 		/* debugging ... check eqF data
 		for (l=1;l<=13;l++) printf(" %9.2e ", W[lc][i][l] );
@@ -1287,10 +1373,7 @@ void read_and_assemble_loads (
 		    exit(152);
 		}
 
-		if ( shear ) {
-			Ksy = (12.0*E[n]*Iz[n]) / (G[n]*Asy[n]*Le[n]*Le[n]);
-			Ksz = (12.0*E[n]*Iy[n]) / (G[n]*Asz[n]*Le[n]*Le[n]);
-		} else	Ksy = Ksz = 0.0;
+		Ksy = eg[n].Ksy;	Ksz = eg[n].Ksz;
 
 		Ln = L[n];
 
@@ -1321,23 +1404,14 @@ void read_and_assemble_loads (
 
 		n1 = J1[n];	n2 = J2[n];
 
-		coord_trans ( xyz, Ln, n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[n] );
+		get_coord_trans ( eg+n, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		/* {F} = [T]'{Q} */
-		eqF_mech[lc][n][1]  += ( Nx1*t1 + Vy1*t4 + Vz1*t7 );
-		eqF_mech[lc][n][2]  += ( Nx1*t2 + Vy1*t5 + Vz1*t8 );
-		eqF_mech[lc][n][3]  += ( Nx1*t3 + Vy1*t6 + Vz1*t9 );
-		eqF_mech[lc][n][4]  += ( Mx1*t1 + My1*t4 + Mz1*t7 );
-		eqF_mech[lc][n][5]  += ( Mx1*t2 + My1*t5 + Mz1*t8 );
-		eqF_mech[lc][n][6]  += ( Mx1*t3 + My1*t6 + Mz1*t9 );
-
-		eqF_mech[lc][n][7]  += ( Nx2*t1 + Vy2*t4 + Vz2*t7 );
-		eqF_mech[lc][n][8]  += ( Nx2*t2 + Vy2*t5 + Vz2*t8 );
-		eqF_mech[lc][n][9]  += ( Nx2*t3 + Vy2*t6 + Vz2*t9 );
-		eqF_mech[lc][n][10] += ( Mx2*t1 + My2*t4 + Mz2*t7 );
-		eqF_mech[lc][n][11] += ( Mx2*t2 + My2*t5 + Mz2*t8 );
-		eqF_mech[lc][n][12] += ( Mx2*t3 + My2*t6 + Mz2*t9 );
+		Qe[1]  = Nx1;	Qe[2]  = Vy1;	Qe[3]  = Vz1;
+		Qe[4]  = Mx1;	Qe[5]  = My1;	Qe[6]  = Mz1;
+		Qe[7]  = Nx2;	Qe[8]  = Vy2;	Qe[9]  = Vz2;
+		Qe[10] = Mx2;	Qe[11] = My2;	Qe[12] = Mz2;
+		rotate_to_global ( t1,t2,t3,t4,t5,t6,t7,t8,t9, Qe, eqF_mech[lc][n] );
 	  }					/* end element point loads */
 
 	  /* thermal loads ----------------------------------------------- */
@@ -1389,23 +1463,14 @@ void read_and_assemble_loads (
 
 		n1 = J1[n];	n2 = J2[n];
 
-		coord_trans ( xyz, L[n], n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[n] );
+		get_coord_trans ( eg+n, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		/* {F} = [T]'{Q} */
-		eqF_temp[lc][n][1]  += ( Nx1*t1 + Vy1*t4 + Vz1*t7 );
-		eqF_temp[lc][n][2]  += ( Nx1*t2 + Vy1*t5 + Vz1*t8 );
-		eqF_temp[lc][n][3]  += ( Nx1*t3 + Vy1*t6 + Vz1*t9 );
-		eqF_temp[lc][n][4]  += ( Mx1*t1 + My1*t4 + Mz1*t7 );
-		eqF_temp[lc][n][5]  += ( Mx1*t2 + My1*t5 + Mz1*t8 );
-		eqF_temp[lc][n][6]  += ( Mx1*t3 + My1*t6 + Mz1*t9 );
-
-		eqF_temp[lc][n][7]  += ( Nx2*t1 + Vy2*t4 + Vz2*t7 );
-		eqF_temp[lc][n][8]  += ( Nx2*t2 + Vy2*t5 + Vz2*t8 );
-		eqF_temp[lc][n][9]  += ( Nx2*t3 + Vy2*t6 + Vz2*t9 );
-		eqF_temp[lc][n][10] += ( Mx2*t1 + My2*t4 + Mz2*t7 );
-		eqF_temp[lc][n][11] += ( Mx2*t2 + My2*t5 + Mz2*t8 );
-		eqF_temp[lc][n][12] += ( Mx2*t3 + My2*t6 + Mz2*t9 );
+		Qe[1]  = Nx1;	Qe[2]  = Vy1;	Qe[3]  = Vz1;
+		Qe[4]  = Mx1;	Qe[5]  = My1;	Qe[6]  = Mz1;
+		Qe[7]  = Nx2;	Qe[8]  = Vy2;	Qe[9]  = Vz2;
+		Qe[10] = Mx2;	Qe[11] = My2;	Qe[12] = Mz2;
+		rotate_to_global ( t1,t2,t3,t4,t5,t6,t7,t8,t9, Qe, eqF_temp[lc][n] );
 	  }				/* end thermal loads	*/
 
 	  /* debugging ...  check eqF's prior to asembly 
@@ -1457,6 +1522,231 @@ void read_and_assemble_loads (
 }
 
 
+/*
+ * CHECK_SUPPORTS - find the sets of nodes joined by frame elements, by
+ * union-find over N1 and N2, and the rigid-body motions of each set that
+ * its reactions do not restrain, before any matrix is allocated.  A reaction
+ * restrains the combination of the three translations and three rotations
+ * of the set about its centroid that moves its coordinate; the motions of
+ * a set are restrained if these combinations span all six.  The sets are
+ * listed if there is more than one.  Returns the number of sets with
+ * rigid-body motions that are not restrained.
+ */
+int check_supports (
+		int nN, int nE, vec3 *xyz, int *N1, int *N2, int *r
+){
+	static const char *motion[6] = { "translation X", "translation Y",
+		"translation Z", "rotation about X", "rotation about Y",
+		"rotation about Z" };
+	double	G[6][6],	/* sum of a a' over the reactions of a set */
+		a[6],		/* rigid-body motions moving a reaction	*/
+		g[6],		/* the diagonal of G			*/
+		c[3], d[3], len, piv, tol;
+	int	*root, *size, *set, *first, *node, ns=0, nfree, nbad=0,
+		i, j, k, l, m, n, n1, n2;
+
+	root = ivector(1,nN);
+	size = ivector(1,nN);
+	for (n=1; n <= nN; n++) { root[n] = n;  size[n] = 1; }
+	for (m=1; m <= nE; m++) {	/* union by size */
+		n1 = find_root ( root, N1[m] );
+		n2 = find_root ( root, N2[m] );
+		if ( n1 == n2 )	continue;
+		if ( size[n1] < size[n2] ) { n = n1;  n1 = n2;  n2 = n; }
+		root[n2] = n1;
+		size[n1] += size[n2];
+	}
+
+	/* the sets, numbered in the order of their first nodes, and their
+	   nodes in ascending order, node[first[i] .. first[i+1]-1]	*/
+	set   = ivector(1,nN);
+	first = ivector(1,nN+1);
+	node  = ivector(1,nN);
+	for (n=1; n <= nN; n++)	set[n] = 0;
+	for (n=1; n <= nN; n++) {
+		k = find_root ( root, n );
+		if ( set[k] == 0 )	{ set[k] = ++ns;  first[ns] = 0; }
+		++first[set[k]];
+	}
+	for (i=1, m=1; i <= ns; i++) { k = first[i];  first[i] = m;  m += k; }
+	first[ns+1] = m;
+	for (i=1; i <= ns; i++)	size[i] = first[i];
+	for (n=1; n <= nN; n++)	node[size[set[find_root(root,n)]]++] = n;
+
+	if ( ns > 1 ) {
+		fprintf(stderr,"\n  warning: the frame elements join the nodes in %d separate sets\n", ns );
+		for (i=1; i <= ns; i++) {
+			fprintf(stderr,"   set %d, %d nodes: ", i, first[i+1]-first[i] );
+			write_node_list ( stderr, node+first[i]-1, first[i+1]-first[i] );
+		}
+	}
+
+	for (i=1; i <= ns; i++) {	/* the rigid-body motions of each set */
+		c[0] = c[1] = c[2] = len = 0.0;
+		for (m=first[i]; m < first[i+1]; m++) {
+			n = node[m];
+			c[0] += xyz[n].x;  c[1] += xyz[n].y;  c[2] += xyz[n].z;
+		}
+		for (k=0; k < 3; k++)	c[k] /= (first[i+1]-first[i]);
+		for (m=first[i]; m < first[i+1]; m++) {
+			n = node[m];
+			d[0] = fabs(xyz[n].x-c[0]);  if ( d[0] > len ) len = d[0];
+			d[1] = fabs(xyz[n].y-c[1]);  if ( d[1] > len ) len = d[1];
+			d[2] = fabs(xyz[n].z-c[2]);  if ( d[2] > len ) len = d[2];
+		}
+		if ( len == 0.0 )	len = 1.0;
+
+		for (j=0; j < 6; j++)	for (k=0; k < 6; k++)	G[j][k] = 0.0;
+		for (m=first[i]; m < first[i+1]; m++) {
+			n = node[m];
+			d[0] = (xyz[n].x-c[0])/len;	/* scaled to the set */
+			d[1] = (xyz[n].y-c[1])/len;
+			d[2] = (xyz[n].z-c[2])/len;
+			for (l=0; l < 6; l++) {
+				if ( !r[6*n-5+l] )	continue;
+				for (k=0; k < 6; k++)	a[k] = 0.0;
+				a[l] = 1.0;
+				if ( l == 0 ) { a[4] =  d[2];  a[5] = -d[1]; }
+				if ( l == 1 ) { a[3] = -d[2];  a[5] =  d[0]; }
+				if ( l == 2 ) { a[3] =  d[1];  a[4] = -d[0]; }
+				for (j=0; j < 6; j++)
+					for (k=0; k < 6; k++)	G[j][k] += a[j]*a[k];
+			}
+		}
+
+		/* the rank of G, by L D L' decomposition without pivoting;
+		   the row and column of a zero pivot of G, which is positive
+		   semi-definite, are zero				*/
+		tol = 0.0;
+		for (j=0; j < 6; j++)	if ( G[j][j] > tol )	tol = G[j][j];
+		tol *= 1e-10;
+		nfree = 0;
+		for (j=0; j < 6; j++)	g[j] = G[j][j];
+		for (j=0; j < 6; j++) {
+			piv = G[j][j];
+			if ( piv <= tol ) { ++nfree;  continue; }
+			for (k=j+1; k < 6; k++)
+				for (l=k; l < 6; l++)
+					G[k][l] = G[l][k] -= G[k][j]*G[j][l]/piv;
+		}
+
+		if ( nfree > 0 ) {
+			++nbad;
+			fprintf(stderr,"\n  warning: %d of the 6 rigid-body motions of %s are not restrained\n", nfree, ns > 1 ? "a set of nodes" : "the frame" );
+			if ( ns > 1 ) {
+				fprintf(stderr,"   set %d, %d nodes: ", i, first[i+1]-first[i] );
+				write_node_list ( stderr, node+first[i]-1, first[i+1]-first[i] );
+			}
+			for (j=0, k=0; j < 6; j++)
+				if ( g[j] == 0.0 )	/* not restrained at all */
+					fprintf(stderr,"%s%s", k++ ? ", " : "   unrestrained: ", motion[j] );
+			if ( k )	fprintf(stderr,"\n");
+		}
+	}
+
+	free_ivector(root,1,nN);
+	free_ivector(size,1,nN);
+	free_ivector(set,1,nN);
+	free_ivector(first,1,nN+1);
+	free_ivector(node,1,nN);
+
+	return nbad;
+}
+
+
+/*
+ * FIND_ROOT - the root of node n in the union-find forest root[],
+ * halving the path to it
+ */
+static int find_root ( int *root, int n )
+{
+	while ( root[n] != n ) {
+		root[n] = root[root[n]];
+		n = root[n];
+	}
+	return n;
+}
+
+
+/*
+ * WRITE_NODE_LIST - write a list of n node numbers in ascending order,
+ * list[1..n], as ranges, up to twelve of them
+ */
+static void write_node_list ( FILE *fp, int *list, int n )
+{
+	int	i, j, nr = 0;
+
+	for (i=1; i <= n && nr < 12; i = j+1, nr++) {
+		for (j=i; j < n && list[j+1] == list[j]+1; j++) ;
+		if ( j > i )	fprintf(fp,"%s%d-%d", nr ? ", " : "", list[i], list[j]);
+		else		fprintf(fp,"%s%d", nr ? ", " : "", list[i]);
+	}
+	fprintf(fp,"%s\n", i <= n ? ", ..." : "" );
+}
+
+
+/*
+ * SCAN_MASS_COUNTS - read the number of modes, the modal analysis method,
+ * the frequency shift and the number of nodes with condensed coordinates
+ * ahead of the load
+ * data, skipping the values of the load data and of the mass data, and
+ * return to the load data.  The counts are zero if they can not be read;
+ * the data are checked as they are read later.
+ */
+void scan_mass_counts (
+		FILE *fp, int nL,
+		int *nM, int *Mmethod, int modal_flag,
+		double *shift, double shift_flag,
+		int *nC, int condense_flag
+){
+	/* values of each nodal, uniform, trapezoidal, point, thermal load,
+	   and prescribed displacement */
+	static const int nv[6] = { 7, 4, 13, 5, 8, 7 };
+	long	here = ftell(fp);
+	int	lc, t, n, nI=0, nX=0, nA=0, Cmethod=0, ok=1;
+
+	*nM = *nC = 0;
+	*Mmethod = 1;
+	*shift = 0.0;
+
+	for (lc=1; lc <= nL && ok; lc++) {
+		ok = skip_values ( fp, 3 );		/* gX gY gZ	*/
+		for (t=0; t < 6 && ok; t++)
+			ok = fscanf(fp,"%d",&n) == 1 && skip_values(fp,(long)n*nv[t]);
+	}
+	if ( ok && fscanf(fp,"%d",nM) == 1 && *nM > 0 ) {
+		ok = fscanf(fp,"%d",Mmethod) == 1 &&
+		     skip_values ( fp, 2 ) &&		/* lump, tol	*/
+		     fscanf(fp,"%lf",shift) == 1 &&
+		     skip_values ( fp, 1 ) &&		/* exagg_modal	*/
+		     fscanf(fp,"%d",&nI) == 1 && skip_values(fp,5L*nI) &&
+		     fscanf(fp,"%d",&nX) == 1 && skip_values(fp,2L*nX) &&
+		     fscanf(fp,"%d",&nA) == 1 && skip_values(fp,nA+1L);
+	}
+	if ( *nM < 1 )	*nM = 0;
+	if ( ok && fscanf(fp,"%d",&Cmethod) == 1 ) {
+		if ( condense_flag != -1 )	Cmethod = condense_flag;
+		if ( Cmethod > 0 && fscanf(fp,"%d",nC) != 1 )	*nC = 0;
+	}
+	if ( *nC < 0 )	*nC = 0;
+	if ( modal_flag != -1 )	*Mmethod = modal_flag;
+	if ( shift_flag != -1.0 )	*shift = shift_flag;
+
+	fseek ( fp, here, SEEK_SET );
+}
+
+
+/*
+ * SKIP_VALUES - skip n values in the input data file; returns 0 at its end
+ */
+static int skip_values ( FILE *fp, long n )
+{
+	for ( ; n > 0; n-- )
+		if ( fscanf(fp,"%*s") == EOF )	return 0;
+	return 1;
+}
+
+
 /*
  * READ_MASS_DATA  -  read element densities and extra inertial mass data	16aug01 
  */
@@ -1487,6 +1777,10 @@ void read_mass_data (
 
 	*total_mass = *struct_mass = 0.0;
 
+	/* extra inertias are zero unless specified */
+	for (j=1; j <= nN; j++)	NMs[j] = NMx[j] = NMy[j] = NMz[j] = 0.0;
+	for (b=1; b <= nE; b++)	EMs[b] = 0.0;
+
 	sfrv=fscanf ( fp, "%d", nM );
 	if (sfrv != 1) sferr("nM value in mass data");
 
@@ -1509,6 +1803,7 @@ void read_mass_data (
 		dots(stdout,30);	fprintf(stdout," %3d ",*Mmethod);
 		if ( *Mmethod == 1 ) fprintf(stdout," (Subspace-Jacobi)\n");
 		if ( *Mmethod == 2 ) fprintf(stdout," (Stodola)\n");
+		if ( *Mmethod == 3 ) fprintf(stdout," (Lanczos)\n");
 	}
 
 
@@ -2385,10 +2680,9 @@ void write_static_mfile (
 void peak_internal_forces (
 		int lc, 	// load case number
 		int nL, 	// total number of load cases
-		vec3 *xyz, 	// node locations
 		double **Q, int nN, int nE, double *L, int *N1, int *N2, 
 		float *Ax,float *Asy,float *Asz,float *Jx,float *Iy,float *Iz,
-		float *E, float *G, float *p,
+		float *E, float *G, elem_geom *eg,
 		float *d, float gX, float gY, float gZ,
 		int nU, float **U, int nW, float **W, int nP, float **P,
 		double *D, int shear, 
@@ -2452,8 +2746,7 @@ void peak_internal_forces (
 
 	// find interior axial force, shear forces, torsion and bending moments
 
-		coord_trans ( xyz, L[m], n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[m] );
+		get_coord_trans ( eg+m, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		// distributed gravity load in local x, y, z coordinates
 		wxg = d[m]*Ax[m]*(t1*gX + t2*gY + t3*gZ);
@@ -2675,7 +2968,7 @@ void write_internal_forces (
 		vec3 *xyz, 
 		double **Q, int nN, int nE, double *L, int *J1, int *J2, 
 		float *Ax,float *Asy,float *Asz,float *Jx,float *Iy,float *Iz,
-		float *E, float *G, float *p,
+		float *E, float *G, elem_geom *eg,
 		float *d, float gX, float gY, float gZ,
 		int nU, float **U, int nW, float **W, int nP, float **P,
 		double *D, int shear, double error
@@ -2812,8 +3105,7 @@ void write_internal_forces (
 
 	// find interior axial force, shear forces, torsion and bending moments
 
-		coord_trans ( xyz, L[m], n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p[m] );
+		get_coord_trans ( eg+m, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 		// distributed gravity load in local x, y, z coordinates
 		wxg = d[m]*Ax[m]*(t1*gX + t2*gY + t3*gZ);
@@ -3118,7 +3410,7 @@ void write_internal_forces (
 void write_modal_results(
 		FILE *fp,
 		int nN, int nE, int nI, int DoF,
-		double **M, double *f, double **V,
+		mass_matrix *M, double *f, double **V,
 		double total_mass, double struct_mass,
 		int iter, int sumR, int nM,
 		double shift, int lump, double tol, int ok
@@ -3134,9 +3426,11 @@ void write_modal_results(
 
 	for (i=1; i<=DoF; i++) {
 		msX[i] = msY[i] = msZ[i] = 0.0;
-		for (j=1; j<=DoF; j+=6) msX[i] += M[i][j];
-		for (j=2; j<=DoF; j+=6) msY[i] += M[i][j];
-		for (j=3; j<=DoF; j+=6) msZ[i] += M[i][j];
+		for (j=M->rptr[i]; j<M->rptr[i+1]; j++) {
+			if ( M->col[j] % 6 == 1 )	msX[i] += M->val[j];
+			if ( M->col[j] % 6 == 2 )	msY[i] += M->val[j];
+			if ( M->col[j] % 6 == 3 )	msZ[i] += M->val[j];
+		}
 	}
 
 	if ( (DoF - sumR) > nM )	num_modes = nM;
@@ -3153,7 +3447,7 @@ void write_modal_results(
 		k = 6*(j-1);
 		fprintf(fp," %5d", j);
 		for ( i=1; i<=6; i++ )
-			fprintf (fp, " %11.5e", M[k+i][k+i] );
+			fprintf (fp, " %11.5e", M->val[M->dg[k+i]] );
 		fprintf(fp,"\n");
 	}
 	if ( lump )	fprintf(fp,"  Lump masses at nodes.\n");
@@ -3213,7 +3507,7 @@ void static_mesh(
 		char infcpath[], char meshpath[], char plotpath[],
 		char *title, int nN, int nE, int nL, int lc, int DoF,
 		vec3 *xyz, double *L,
-		int *N1, int *N2, float *p, double *D, 
+		int *N1, int *N2, elem_geom *eg, double *D, 
 		double exagg_static, int D3_flag, int anlyz, float dx, float scale
 ){
 	FILE	*fpif=NULL, *fpm=NULL;
@@ -3411,7 +3705,7 @@ void static_mesh(
 		fprintf( fpm, "\n# element %5d \n", m );
 		if ( dx < 0.0 && anlyz ) {
 			cubic_bent_beam ( fpm,
-				N1[m],N2[m], xyz, L[m],p[m], D, exagg_static );
+				N1[m],N2[m], xyz, L[m], eg+m, D, exagg_static );
 		} 
 		if ( dx > 0.0 && anlyz ) {
 			while ( ch != '@' )	ch = getc(fpif);
@@ -3427,7 +3721,7 @@ void static_mesh(
 			*/
 			while ( ch != '~' )	ch = getc(fpif);
 			force_bent_beam ( fpm, fpif, fnif, nx, 
-				N1[m],N2[m], xyz, L[m],p[m], D, exagg_static );
+				N1[m],N2[m], xyz, L[m], eg+m, D, exagg_static );
 		}
 
 	}
@@ -3449,8 +3743,8 @@ void modal_mesh(
 		char plotpath[], char *title,
 		int nN, int nE, int DoF, int nM,
 		vec3 *xyz, double *L,
-		int *J1, int *J2, float *p,
-		double **M, double *f, double **V,
+		int *J1, int *J2, elem_geom *eg,
+		mass_matrix *M, double *f, double **V,
 		double exagg_modal, int D3_flag, int anlyz
 ){
 	FILE	*fpm;
@@ -3472,9 +3766,11 @@ void modal_mesh(
 
 	for (i=1; i<=DoF; i++) {	/* modal participation factors */
 		msX[i] = msY[i] = msZ[i] = 0.0;
-		for (j=1; j<=DoF; j+=6) msX[i] += M[i][j];
-		for (j=2; j<=DoF; j+=6) msY[i] += M[i][j];
-		for (j=3; j<=DoF; j+=6) msZ[i] += M[i][j];
+		for (j=M->rptr[i]; j<M->rptr[i+1]; j++) {
+			if ( M->col[j] % 6 == 1 )	msX[i] += M->val[j];
+			if ( M->col[j] % 6 == 2 )	msY[i] += M->val[j];
+			if ( M->col[j] % 6 == 3 )	msZ[i] += M->val[j];
+		}
 	}
 
 	if (!anlyz) exagg_modal = 0.0;
@@ -3509,7 +3805,7 @@ void modal_mesh(
 
 		for(n=1; n<=nE; n++) {
 			fprintf( fpm, "\n# element %5d \n", n );
-			cubic_bent_beam ( fpm, J1[n], J2[n], xyz, L[n], p[n], v, exagg_modal );
+			cubic_bent_beam ( fpm, J1[n], J2[n], xyz, L[n], eg+n, v, exagg_modal );
 		}
 
 		fclose(fpm);
@@ -3577,7 +3873,7 @@ void animate(
 	char *title,
 	int anim[],
 	int nN, int nE, int DoF, int nM,
-	vec3 *xyz, double *L, float *p,
+	vec3 *xyz, double *L, elem_geom *eg,
 	int *J1, int *J2, double *f, double **V,
 	double exagg_modal, int D3_flag, 
 	float pan,		/* pan rate for animation	     */
@@ -3791,7 +4087,7 @@ void animate(
 
 	    for (n=1; n<=nE; n++) {
 		fprintf( fpm, "\n# element %5d \n", n );
-		cubic_bent_beam ( fpm, J1[n], J2[n], xyz, L[n], p[n], v, ex );
+		cubic_bent_beam ( fpm, J1[n], J2[n], xyz, L[n], eg+n, v, ex );
 	    }
 
 	    fclose(fpm);
@@ -3813,7 +4109,7 @@ void animate(
  */
 void cubic_bent_beam(
 	FILE *fpm, int n1, int n2, vec3 *xyz,
-	double L, float p, double *D, double exagg
+	double L, elem_geom *g, double *D, double exagg
 ){
 	double	t1, t2, t3, t4, t5, t6, t7, t8, t9, 	/* coord xfmn	*/
 		u1, u2, u3, u4, u5, u6, u7, u8, u9, u10, u11, u12,
@@ -3826,8 +4122,7 @@ void cubic_bent_beam(
 	a = dvector(1,4);
 	b = dvector(1,4);
 
-	coord_trans ( xyz, L, n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p );
+	get_coord_trans ( g, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 	i1 = 6*(n1-1);	i2 = 6*(n2-1);
 
@@ -3911,7 +4206,7 @@ void cubic_bent_beam(
  */
 void force_bent_beam(
 	FILE *fpm, FILE *fpif, char fnif[], int nx, int n1, int n2, vec3 *xyz,
-	double L, float p, double *D, double exagg
+	double L, elem_geom *g, double *D, double exagg
 ){
 	double	t1, t2, t3, t4, t5, t6, t7, t8, t9; 	/* coord xfmn	*/
 	double	xi, dX, dY, dZ;
@@ -3924,8 +4219,7 @@ void force_bent_beam(
 	Ly = xyz[n2].y - xyz[n1].y;
 	Lz = xyz[n2].z - xyz[n1].z;
 
-	coord_trans ( xyz, L, n1, n2,
-			&t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, p );
+	get_coord_trans ( g, &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9 );
 
 	x = -1.0;
 	n = 0;
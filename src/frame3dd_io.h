@@ -27,9 +27,12 @@
 #include "common.h"
 #include <time.h>
 #include "microstran/vec3.h"
+#include "coordtrans.h"
+#include "mass.h"
 
 #include <stdio.h>
 #include <unistd.h>	/* getopt for parsing command-line options	*/
+#include <getopt.h>	/* getopt_long for long options			*/
 
 /**
  PARSE_OPTIONS -  parse command line options			     04mar09
@@ -51,6 +54,15 @@ void parse_options (
 	int *write_matrix,
 	int *axial_sign, 
 	int *condense_flag,
+	int *solver_flag, /**< 1: skyline L D L', 2: sparse L D L'	*/
+	int *pcg_precond, /**< preconditioner of the -k C solver	*/
+	char cache_file[], /**< factor cache file, or ""		*/
+	int *threads,	/**< number of threads for stiffness assembly	*/
+	int *NR_method,	/**< iterations for geometric nonlinearity	*/
+	int *NR_interval, /**< iterations between factorizations, or pairs */
+	double *load_step, /**< first load increment, 0: the whole load	*/
+	int *arc_length, /**< 1: arc-length control of load increments	*/
+	double *mem_limit, /**< memory limit in MB, or 0: none		*/
 	int *verbose,
 	int *debug
 );
@@ -173,19 +185,17 @@ void read_and_assemble_loads(
 	int nE,		/**< number of frame elements			*/
 	int nL,		/**< number of load cases			*/
 	int DoF,	/**< number of degrees of freedom		*/
-	vec3 *xyz,	/**< XYZ coordinates of each node		*/
 	double *L, double *Le,	/**< length of each frame element, effective */
 	int *N1, int *N2, 	/**< node connectivity			*/
-	float *Ax, float *Asy, float *Asz,	/**< section areas	*/
+	float *Ax,	/**< cross section area of each element	*/
 	float *Iy, float *Iz,	/**< section inertias			*/
-	float *E, float *G,	/**< elastic moduli and shear moduli	*/
-	float *p,	/**< roll angle of each frame element (radians)	*/
+	float *E,	/**< elastic modulus of each element	*/
+	elem_geom *eg,	/**< coordinate transformation of each element	*/
 	float *d,  /**< mass density of each frame element		*/
 	float *gX, /**< gravitational acceleration in global X each load case */
 	float *gY, /**< gravitational acceleration in global Y each load case */
 	float *gZ, /**< gravitational acceleration in global Z each load case */
 	int *r,		/**< r[i]=1: DoF i is fixed, r[i]=0: DoF i is free */
-	int shear,	/**< 1: include shear deformations, 0: don't	*/
 	int *nF, 		/**< number of concentrated node loads */
 	int *nU, 		/**< number of uniformly distributed loads */
 	int *nW,		/**< number of trapezoidaly distributed loads */
@@ -207,6 +217,39 @@ void read_and_assemble_loads(
 );
 
 
+/**
+	CHECK_SUPPORTS - list the sets of nodes joined by frame elements if
+	there are more than one, and the rigid-body motions of each set that
+	are not restrained; returns the number of such sets
+*/
+int check_supports(
+	int nN,		/**< number of nodes				*/
+	int nE,		/**< number of frame elements			*/
+	vec3 *xyz,	/**< XYZ locations of every node		*/
+	int *N1, int *N2, /**< node connectivity			*/
+	int *r		/**< 0: not a reaction; 1: a reaction coordinate */
+);
+
+
+/**
+	SCAN_MASS_COUNTS - read the number of modes, the modal analysis
+	method, the frequency shift and the number of nodes with condensed
+	coordinates ahead of the load data; the file is returned to the
+	load data
+*/
+void scan_mass_counts(
+	FILE *fp,	/**< input data file pointer, at the load data	*/
+	int nL,		/**< number of load cases			*/
+	int *nM,	/**< number of modes to find			*/
+	int *Mmethod,	/**< modal analysis method			*/
+	int modal_flag,	/**< command-line over-ride			*/
+	double *shift,	/**< frequency shift for unrestrained frames	*/
+	double shift_flag, /**< command-line over-ride			*/
+	int *nC,	/**< number of nodes with condensed DoF's	*/
+	int condense_flag /**< command-line over-ride			*/
+);
+
+
 /**
 	read member densities and extra inertial mass data
 */
@@ -339,10 +382,9 @@ void write_static_mfile(
 void peak_internal_forces (
         int lc,         // load case number
         int nL,         // total number of load cases
-        vec3 *xyz,      // node locations
         double **Q, int nN, int nE, double *L, int *N1, int *N2,
         float *Ax,float *Asy,float *Asz,float *Jx,float *Iy,float *Iz,
-        float *E, float *G, float *p,
+        float *E, float *G, elem_geom *eg,
         float *d, float gX, float gY, float gZ,
         int nU, float **U, int nW, float **W, int nP, float **P,
         double *D, int shear,
@@ -383,7 +425,7 @@ void write_internal_forces(
 	float *Jx, 	/**< torsional moment of inertia 	         */
 	float *Iy, float *Iz,	/**< bending moment of inertia          */
 	float *E, float *G,	/**< elastic and shear modulii          */
-	float *p,	/**< roll angle, radians                        */
+	elem_geom *eg,	/**< element coordinate transformations         */
 	float *d,	/**< mass density                               */
 	float gX, float gY, float gZ,	/**< gravitational acceleration */
 	int nU,		/**< number of uniformly-distributed loads	*/
@@ -405,7 +447,7 @@ void write_internal_forces(
 void write_modal_results(
 	FILE *fp,
 	int nN, int nE, int nI, int DoF,
-	double **M, double *f, double **V,
+	mass_matrix *M, double *f, double **V,
 	double total_mass, double struct_mass,
 	int iter, int sumR, int nM,
 	double shift, int lump, double tol, int ok
@@ -422,7 +464,7 @@ void static_mesh(
 	char infcpath[], char meshpath[], char plotpath[],
 	char *title, int nN, int nE, int nL, int lc, int DoF,
 	vec3 *xyz, double *L,
-	int *N1, int *N2, float *p, double *D,
+	int *N1, int *N2, elem_geom *eg, double *D,
 	double exagg_static, int D3_flag, int anlyz, float dx, float scale
 );
 
@@ -437,8 +479,8 @@ void modal_mesh(
 	char plotpath[], char *title,
 	int nN, int nE, int DoF, int nM,
 	vec3 *xyz, double *L,
-	int *N1, int *N2, float *p,
-	double **M, double *f, double **V,
+	int *N1, int *N2, elem_geom *eg,
+	mass_matrix *M, double *f, double **V,
 	double exagg_modal, int D3_flag, int anlyz
 );
 
@@ -455,7 +497,7 @@ void animate(
 	char *title,
 	int anim[],
 	int nN, int nE, int DoF, int nM,
-	vec3 *xyz, double *L, float *p,
+	vec3 *xyz, double *L, elem_geom *eg,
 	int *N1, int *N2, double *f, double **V,
 	double exagg_modal, int D3_flag, float pan, float scale
 );
@@ -473,7 +515,7 @@ void cubic_bent_beam(
 	int n1, int n2,	/**< node 1 and node 2 of the frame element */
 	vec3 *xyz,	/**< node coordinates			*/
 	double L,	/**< frame element lengths		*/
-	float p,	/**< frame element local rotations	*/
+	elem_geom *g,	/**< frame element coordinate transformation */
 	double *D,	/**< node displacements		*/
 	double exagg	/**< mesh exaggeration factor		*/
 );
@@ -493,7 +535,7 @@ void force_bent_beam(
 	int n1, int n2,	/**< node 1 and node 2 of the frame element */
 	vec3 *xyz,	/**< node coordinates			*/
 	double L,	/**< frame element lengths		*/
-	float p,	/**< frame element local rotations	*/
+	elem_geom *g,	/**< frame element coordinate transformation */
 	double *D,	/**< node displacements		*/
 	double exagg	/**< mesh exaggeration factor		*/
 );
@@ -49,6 +49,8 @@ For compilation/installation, see README.txt.
 #include "common.h"
 #include "frame3dd.h"
 #include "frame3dd_io.h"
+#include "factor_cache.h"
+#include "memplan.h"
 #include "eig.h"
 #include "HPGmatrix.h"
 #include "HPGutil.h"
@@ -67,6 +69,7 @@ For compilation/installation, see README.txt.
 
 	char	IN_file[FILENMAX],	// the input  data filename
 		OUT_file[FILENMAX],	// the output data filename
+		cache_file[FILENMAX],	// the factor cache filename
 		title[MAXL],		// the title of the analysis
 		errMsg[MAXL],		// the text of an error message
 		meshpath[FRAME3DD_PATHMAX] = "EMPTY_MESH", // mesh data path
@@ -99,10 +102,22 @@ For compilation/installation, see README.txt.
 		scale=1.0,	// zoom scale for 3D plotting in Gnuplot
 		dx=1.0;		// x-increment for internal force data
 
-	double	**K=NULL,	// equilibrium stiffness matrix
+	sparse_ldl *S=NULL;	// sparse L D L' decomposition of K
+	ldl_factor *KF=NULL;	// L D L' decomposition of K, linear analysis
+	elem_geom *eg=NULL;	// element coordinate transformations
+	K_cache *KC=NULL;	// elastic and unit geometric stiffness matrices
+	NR_solver *NR=NULL;	// state of the iterations for geometric nonlin.
+	pcg_solver *PC=NULL;	// preconditioner of the conjugate gradient solver
+	factor_cache *FC=NULL;	// file holding the factored stiffness matrix
+	ooc_profile *OC=NULL;	// scratch file holding K and its L D L' decomp.
+	mass_matrix *M=NULL;	// global mass matrix, compact
+	stiffness_matrix Kp;	// skyline or sparse K of the modal analysis
+	mem_plan MP;		// bytes of memory of the analysis
+
+	double	*K=NULL,	// equilibrium stiffness matrix, skyline
+		**Kd=NULL,	// dynamic stiffness matrix, full
 		// **Ks=NULL,	// Broyden secant stiffness matrix	
 		traceK = 0.0,	// trace of the global stiffness matrix
-		**M = NULL,	// global mass matrix
 		traceM = 0.0,	// trace of the global mass matrix
 		***eqF_mech=NULL,// equivalent end forces from mech loads global
 		***eqF_temp=NULL,// equivalent end forces from temp loads global
@@ -113,6 +128,14 @@ For compilation/installation, see README.txt.
 		*dR = NULL,	// incremental reaction force vector 
 		*D  = NULL,	// displacement vector
 		*dD = NULL,	// incremental displacement vector
+		*Dt0 = NULL,	// initial {D_t} of conjugate gradient solutions
+		*Dm0 = NULL,	// initial {D_m} of conjugate gradient solutions
+		**Dtb = NULL,	// {D_t} of a block of load cases
+		**Rtb = NULL,	// {R_t} of a block of load cases
+		**Dmb = NULL,	// {D_m} of a block of load cases
+		**Rmb = NULL,	// {R_m} of a block of load cases
+		*rms_t = NULL,	// RMS residuals of {D_t} of a block
+		*rms_m = NULL,	// RMS residuals of {D_m} of a block
 		//dDdD = 0.0,	// dD' * dD
 		*dF = NULL,	// equilibrium error in nonlinear anlys
 		*L  = NULL,	// node-to-node length of each element
@@ -126,6 +149,9 @@ For compilation/installation, see README.txt.
 		**V = NULL,	// resonant mode-shapes
 		rms_resid=1.0,	// root mean square of residual displ. error
 		error = 1.0,	// rms equilibrium error and reactions
+		load_step = 0.0,// first load increment, 0: the whole load
+		mem_limit = 0.0,// memory limit in MB, 0: none
+		lambda = 1.0,	// load factor reached by load increments
 		Cfreq = 0.0,	// frequency used for Guyan condensation
 		**Kc, **Mc,	// condensed stiffness and mass matrices
 		exagg_static=10,// exaggerate static displ. in mesh data
@@ -151,12 +177,30 @@ For compilation/installation, see README.txt.
 		nX=0,		// number of elemts w/ extra mass
 		nC=0,		// number of condensed nodes
 		*N1, *N2,	// begin and end node numbers
+		*maxa=NULL,	// location of diagonal terms of skyline K
+		*dof=NULL,	// location of each coordinate in renumbered K
+		solver=1,	// 1: skyline L D L', 2: sparse L D L',
+				//   3: single-precision skyline L D L',
+				//   4: element-by-element conjugate gradient
+		solver_flag=-1,	//   over-ride default solver
+		pcg_precond=PCG_BLOCK, // preconditioner of the c.g. solver
+		pcg=0,		// 1: conjugate gradient solutions, no [K]
+		threads=1,	// number of threads for assembly of K
+		NR_method=NR_NEWTON, // iterations for geometric nonlinearity
+		NR_interval=5,	// iterations between factorizations of K
+		arc_length=0,	// 1: arc-length control of load increments
+		stepping=0,	// 1: geometric nonlinearity by load increments
+		blk=1,		// number of load cases solved together
+		lb0=0, lb=0,	// first and last load cases of the block
+		okb=1,		// status of the solutions of the block
+		mech[RHS_BLOCK+1], // 1: mechanical loads in the block
+		nK=0,		// number of terms in the skyline of K
 		shear=0,	// indicates shear deformation
 		geom=0,		// indicates  geometric nonlinearity
 		anlyz=1,	// 1: stiffness analysis, 0: data check	
 		*q=NULL,*r=NULL,sumR,	// reaction data, total no. of reactions
 		nM=0,		// number of desired modes
-		Mmethod,	// 1: Subspace Jacobi, 2: Stodola
+		Mmethod,	// 1: Subspace Jacobi, 2: Stodola, 3: Lanczos
 		nM_calc,	// number of modes to calculate
 		lump=1,		// 1: lumped, 0: consistent mass matrix
 		iter=0,		// number of iterations	
@@ -198,7 +242,8 @@ For compilation/installation, see README.txt.
 			&D3_flag, 
 			&lump_flag, &modal_flag, &tol_flag, &shift_flag, 
 			&pan_flag, &write_matrix, &axial_sign, &condense_flag,
-			&verbose, &debug);
+			&solver_flag, &pcg_precond, cache_file, &threads, &NR_method, &NR_interval,
+			&load_step, &arc_length, &mem_limit, &verbose, &debug);
 
 	if ( verbose ) { /*  display program name, version and license type */
 		textColor('w','b','b','x');
@@ -309,6 +354,11 @@ For compilation/installation, see README.txt.
 			&exagg_static, exagg_flag, &scale, &dx,
 			&anlyz, anlyz_flag, debug );
 
+	/* coordinate transformations and shear deformation coefficients */
+	eg = (elem_geom *) malloc ( sizeof(elem_geom)*(1+nE) );
+	element_geometry ( nE, xyz, L, Le, N1, N2, Asy, Asz, Iy, Iz, E, G, p,
+							shear, eg );
+
 	sfrv=fscanf(fp, "%d", &nL );	/* number of load cases		*/
 	if (sfrv != 1)	sferr("nL value for number of load cases");
 	if ( verbose ) {	/* display nL */
@@ -325,6 +375,55 @@ For compilation/installation, see README.txt.
 		errorMsg(errMsg); 
 		exit(102);
 	}
+	scan_mass_counts ( fp, nL, &nM, &Mmethod, modal_flag, &shift, shift_flag,
+							&nC, condense_flag );
+
+	/* connectivity and rigid-body motions, before [K] is allocated */
+	if ( check_supports ( nN, nE, xyz, N1, N2, r ) > 0 && anlyz ) {
+		if ( nM == 0 || shift == 0.0 || geom ) {
+			errorMsg("\n ERROR: make sure that all six rigid-body motions of every set of nodes are restrained,\n or, for a modal analysis only, that a frequency shift is given\n");
+			exit(84);
+		}
+		fprintf(stderr,"  the static displacements are not unique; the modes are found with frequency shift %g\n", shift );
+	}
+
+	dof  = ivector(1,DoF);		/* renumbered coordinates	*/
+	renumber_nodes ( nN, nE, N1, N2, dof );
+	maxa = ivector(1,DoF+1);	/* skyline profile of K		*/
+	nK  = skyline_profile ( DoF, nE, N1, N2, dof, maxa );
+	if ( verbose ) {	/* display nK */
+		fprintf(stdout," terms in stiffness matrix profile ");
+		dots(stdout,18);	fprintf(stdout," nK = %d \n",nK);
+	}
+	if ( solver_flag != -1 )	solver = solver_flag;
+
+	/* the memory of the analysis, and a strategy within the limit */
+	plan_memory ( &MP, mem_limit * 1048576.0, nN, nE, nL, DoF, maxa, dof,
+			N1, N2, q, &S, solver, solver_flag != -1, pcg_precond,
+			geom, anlyz, NR_method, NR_interval,
+			nM, Mmethod, modal_flag != -1, nC, write_matrix );
+	if ( !MP.fits ) {
+		write_memory_plan ( stderr, &MP );
+		sprintf(errMsg,"\n ERROR: the analysis needs %.2f MB, more than the memory limit of %.2f MB\n", MP.total/1048576.0, mem_limit );
+		errorMsg(errMsg);
+		exit(185);
+	}
+	if ( verbose && mem_limit > 0.0 )	write_memory_plan ( stdout, &MP );
+	else if ( verbose ) {
+		fprintf(stdout," memory of the analysis, MB ");
+		dots(stdout,25);	fprintf(stdout," %.2f \n", MP.total/1048576.0 );
+	}
+	solver = MP.solver;
+	if ( MP.ooc && anlyz ) {
+		/* K and its L D L' decomposition in a scratch file */
+		OC = new_ooc_profile ( DoF, maxa, MP.budget );
+		if ( verbose ) {
+			fprintf(stdout," out-of-core profile panels ");
+			dots(stdout,25);
+			fprintf(stdout," np = %d \n", OC->np );
+		}
+	}
+
 					/* allocate memory for loads ... */
 	U   =  D3matrix(1,nL,1,nE,1,4);    /* uniform load on each member */
 	W   =  D3matrix(1,nL,1,10*nE,1,13);/* trapezoidal load on each member */
@@ -340,7 +439,35 @@ For compilation/installation, see README.txt.
 	eqF_mech =  D3dmatrix(1,nL,1,nE,1,12); /* eqF due to mech loads */
 	eqF_temp =  D3dmatrix(1,nL,1,nE,1,12); /* eqF due to temp loads */
 
-	K   = dmatrix(1,DoF,1,DoF);	/* global stiffness matrix	*/
+	if ( solver == 2 && !S ) /* ordering and symbolic factorization */
+		S = sparse_analyze ( nN, nE, N1, N2, dof, q );
+
+	if ( cache_file[0] && anlyz && !geom && !OC &&
+	     ( solver == 1 || solver == 2 ) ) {
+		/* [K] and its L D L' decomposition from an earlier analysis */
+		FC = open_factor_cache ( cache_file,
+			stiffness_hash ( nN, nE, xyz, rj, N1, N2, Ax, Asy, Asz,
+					Jx, Iy, Iz, E, G, p, r, shear, geom, solver ),
+			solver, DoF, maxa, dof, S, q, r );
+		if ( FC->hit ) {
+			free_sparse_ldl ( S );	/* analyzed by the plan */
+			K  = FC->K;
+			S  = FC->S;
+			KF = FC->KF;
+			FC->KF = NULL;
+		}
+		if ( verbose ) {
+			fprintf(stdout," factored stiffness matrix ");
+			dots(stdout,26);
+			fprintf(stdout," %s \n", FC->hit ? "from cache" :
+				FC->base ? "updated from cache" : "cached" );
+		}
+	}
+	if ( solver == 2 && verbose ) {
+		fprintf(stdout," terms in sparse L D L' factor ");
+		dots(stdout,22);
+		fprintf(stdout," nS = %lu \n", S->lptr[S->ns+1]-1 );
+	}
 	Q   = dmatrix(1,nE,1,12);	/* end forces for each member	*/
 
 	D   = dvector(1,DoF);	/* displacments of each node		*/
@@ -373,9 +500,9 @@ For compilation/installation, see README.txt.
 	pkSy = dmatrix(1,nL,1,nE);
 	pkSz = dmatrix(1,nL,1,nE); 
 
-	read_and_assemble_loads( fp, nN, nE, nL, DoF, xyz, L, Le, N1, N2,
-			Ax,Asy,Asz, Iy,Iz, E, G, p,
-			d, gX, gY, gZ, r, shear,
+	read_and_assemble_loads( fp, nN, nE, nL, DoF, L, Le, N1, N2,
+			Ax,Iy,Iz, E, eg,
+			d, gX, gY, gZ, r,
 			nF, nU, nW, nP, nT, nD,
 			Q, F_temp, F_mech, F, U, W, P, T,
 			Dp, eqF_mech, eqF_temp, verbose );
@@ -392,6 +519,14 @@ For compilation/installation, see README.txt.
 			&lump, lump_flag, &tol, tol_flag, &shift, shift_flag,
 			&exagg_modal, modepath, anim, &pan, pan_flag, 
 			verbose, debug );
+	if ( nM > 0 && Mmethod != MP.Mmethod ) { /* the method does not fit */
+		Mmethod = MP.Mmethod;
+		if ( verbose ) {
+			fprintf(stdout," modal analysis method within memory limit ");
+			dots(stdout,10);
+			fprintf(stdout," %3d  (Subspace-Jacobi)\n", Mmethod );
+		}
+	}
 	if ( verbose ) {	/* display mass data complete */
 		fprintf(stdout,"                                                     ");
 		fprintf(stdout," mass data ... complete\n");
@@ -405,6 +540,15 @@ For compilation/installation, see README.txt.
 		fprintf(stdout," matrix condensation data ... complete\n");
 	}
 
+	/* the conjugate gradient solver needs no [K] for a linear analysis */
+	pcg = ( solver == 4 && !geom );
+	if ( OC )	K = OC->K;	/* global stiffness matrix, mapped */
+	if ( S )	nK = S->nK;	/* [K] in the columns of S	*/
+	if ( !K && ( !pcg || nM > 0 || nC > 0 || write_matrix ) ) {
+		K   = dvector(1,nK);	/* global stiffness matrix	*/
+		for (i=1; i<=nK; i++)	K[i] = 0.0;
+	}
+
 	fclose(fp);		/* close the input data file */
 
 	fp = fopen(OUT_file, "a"); /* open the output data file for appending */
@@ -424,6 +568,44 @@ For compilation/installation, see README.txt.
 
 	if ( anlyz ) {			/* solve the problem	*/
 	 srand(time(NULL));
+	 stepping = ( geom && load_step > 0.0 );
+
+	 if ( !geom ) {	/* linear analysis: [K] is the same for all load cases */
+		/*  elastic stiffness matrix [K], factored at its first solution */
+		if ( K && !( FC && FC->hit ) ) {
+		 assemble_K ( K, maxa, S, dof, DoF, nE, L, Le, N1, N2,
+					Ax, Jx,Iy,Iz, E, G, eg,
+					geom, Q, debug, threads );
+#ifdef MATRIX_DEBUG
+		 if ( S )	save_ut_sparse ( "Ku", S, K, dof, "w" );
+		 else	save_ut_sky ( "Ku", K, maxa, DoF, dof, "w" ); // unloaded stiffness matrix
+#endif
+		}
+		if ( FC && FC->base )	/* changed elements of the cached frame */
+		 KF = update_factor ( FC->KF, FC->K, K, q, r, &ok );
+		if ( pcg ) {	/* element matrices and the preconditioner */
+		 KC = cache_elements ( dof, DoF, nE, L, Le, N1, N2,
+					Ax, Jx,Iy,Iz, E, G, eg,
+					threads );
+		 PC = new_pcg_solver ( KC, dof, nN, nE, N1, N2, DoF, q, r,
+					pcg_precond );
+		 Dt0 = dvector(1,DoF);
+		 Dm0 = dvector(1,DoF);
+		 for (i=1; i<=DoF; i++)	Dt0[i] = Dm0[i] = 0.0;
+		}
+		if ( !pcg && MP.block > 1 ) {	/* blocks of load cases */
+		 blk = MP.block;
+		 Dtb = dmatrix(1,blk,1,DoF);	Rtb = dmatrix(1,blk,1,DoF);
+		 Dmb = dmatrix(1,blk,1,DoF);	Rmb = dmatrix(1,blk,1,DoF);
+		 rms_t = dvector(1,blk);	rms_m = dvector(1,blk);
+		}
+	 } else {  /* [Ke] and the unit [Kg] of each element, for update_K() */
+		KC = cache_K ( maxa, S, dof, DoF, nE, L, Le, N1, N2,
+					Ax, Jx,Iy,Iz, E, G, eg,
+					Q, debug, threads );
+		NR = new_NR_solver ( NR_method, NR_interval, DoF, OC );
+	 }
+
 	 for (lc=1; lc<=nL; lc++) {	/* begin load case analysis loop */
 
 		if ( verbose ) {	/* display the load case number  */
@@ -444,22 +626,64 @@ For compilation/installation, see README.txt.
 		/*  initialize internal element end forces Q = {0}	*/
 		for (i=1; i<=nE; i++)	for (j=1;j<=12;j++)	Q[i][j] = 0.0;
 
+		/*  solve the loads of the next blk load cases together	*/
+		if ( blk > 1 && lc > lb ) {
+			if ( !KF ) KF = factor_system(K,maxa,dof,S,OC,DoF,q,r,&okb);
+			lb0 = lc;
+			lb  = ( lc+blk-1 < nL ) ? lc+blk-1 : nL;
+			for (j=lc; j<=lb; j++) {
+				mech[j-lc+1] = ( nF[j]>0 || nU[j]>0 || nW[j]>0 ||
+					nP[j]>0 || nD[j]>0 ||
+					gX[j] != 0 || gY[j] != 0 || gZ[j] != 0 );
+				for (i=1; i<=DoF; i++) {
+					Dtb[j-lc+1][i] = Rtb[j-lc+1][i] = 0.0;
+					Dmb[j-lc+1][i] = r[i] ? Dp[j][i] : 0.0;
+					Rmb[j-lc+1][i] = 0.0;
+				}
+			}
+			solve_factored_block ( KF, K, Dtb, F_temp+lc-1, Rtb,
+				lb-lc+1, nT+lc-1, q, r, &okb, rms_t );
+			solve_factored_block ( KF, K, Dmb, F_mech+lc-1, Rmb,
+				lb-lc+1, mech, q, r, &okb, rms_m );
+		}
+
 		/*  elastic stiffness matrix  [K({D}^(i))], {D}^(0)={0} (i=0) */
-		assemble_K ( K, DoF, nE, xyz, rj, L, Le, N1, N2,
-					Ax, Asy, Asz, Jx,Iy,Iz, E, G, p,
-					shear, geom, Q, debug );
+		if ( geom ) {
+		 update_K ( KC, K, Q );
 
 #ifdef MATRIX_DEBUG
-		save_dmatrix ( "Ku", K, 1,DoF, 1,DoF, 0, "w" ); // unloaded stiffness matrix
+		 if ( S )	save_ut_sparse ( "Ku", S, K, dof, "w" );
+		 else	save_ut_sky ( "Ku", K, maxa, DoF, dof, "w" ); // unloaded stiffness matrix
 #endif
+		}
 
 		/* first apply temperature loads only, if there are any ... */
-		if (nT[lc] > 0) {
+		if (nT[lc] > 0 && !stepping) {
 			if ( verbose )
 				fprintf(stdout," Linear Elastic Analysis ... Temperature Loads\n");
 
 			/*  solve {F_t} = [K({D=0})] * {D_t} */
-			solve_system(K,dD,F_temp[lc],dR,DoF,q,r,&ok,verbose,&rms_resid);
+			if ( pcg ) {	/* from {D_t} of the last load case */
+			 if ( !pcg_solve(PC,dD,F_temp[lc],dR,Dt0,&rms_resid) ) {
+				fprintf(stderr," Conjugate gradient solution did not converge in %d iterations.\n", PC->iter );
+				ExitCode = 184;
+			 }
+			 if ( verbose )
+				fprintf(stdout," conjugate gradient iterations: %d\n", PC->iter );
+			} else
+			if ( blk > 1 ) {	/* solved with its block	*/
+			 for (i=1; i<=DoF; i++) {
+				dD[i] = Dtb[lc-lb0+1][i];  dR[i] = Rtb[lc-lb0+1][i];
+			 }
+			 rms_resid = rms_t[lc-lb0+1];	ok = okb;
+			} else
+			if ( !geom ) {	/* factor [K] once for all load cases */
+			 if ( !KF && solver == 3 )
+				KF = factor_single(K,maxa,dof,DoF,q,r,&ok);
+			 if ( !KF ) KF = factor_system(K,maxa,dof,S,OC,DoF,q,r,&ok);
+			 solve_factored(KF,K,dD,F_temp[lc],dR,q,r,&ok,verbose,&rms_resid);
+			} else
+			 solve_system(K,maxa,dof,S,OC,dD,F_temp[lc],dR,DoF,q,r,&ok,verbose,&rms_resid);
 
 			/* increment {D_t} = {0} + {D_t} temp.-induced displ */
 			for (i=1; i<=DoF; i++)	if (q[i]) D[i] += dD[i];
@@ -468,28 +692,47 @@ For compilation/installation, see README.txt.
 
 			if (geom) {	/* assemble K = Ke + Kg */
 			 /* compute   {Q}={Q_t} ... temp.-induced forces     */
-			 element_end_forces ( Q, nE, xyz, L, Le, N1,N2,
-				Ax, Asy,Asz, Jx,Iy,Iz, E,G, p,
-				eqF_temp[lc], eqF_mech[lc], D, shear, geom,
+			 element_end_forces ( Q, nE, L, Le, N1,N2,
+				Ax, Jx,Iy,Iz, E,G, eg,
+				eqF_temp[lc], eqF_mech[lc], D, geom,
 				&axial_strain_warning );
 
 			 /* assemble temp.-stressed stiffness [K({D_t})]     */
-			 assemble_K ( K, DoF, nE, xyz, rj, L, Le, N1, N2,
-						Ax,Asy,Asz, Jx,Iy,Iz, E, G, p,
-						shear,geom, Q, debug );
+			 update_K ( KC, K, Q );
 			}
 		}
 
 		/* ... then apply mechanical loads only, if there are any ... */
-		if ( nF[lc]>0 || nU[lc]>0 || nW[lc]>0 || nP[lc]>0 || nD[lc]>0 || 
-		     gX[lc] != 0 || gY[lc] != 0 || gZ[lc] != 0 ) {
+		if ( !stepping &&
+		    ( nF[lc]>0 || nU[lc]>0 || nW[lc]>0 || nP[lc]>0 || nD[lc]>0 || 
+		      gX[lc] != 0 || gY[lc] != 0 || gZ[lc] != 0 ) ) {
 			if ( verbose )
 				fprintf(stdout," Linear Elastic Analysis ... Mechanical Loads\n");
 			/* incremental displ at react'ns = prescribed displ */
 			for (i=1; i<=DoF; i++)	if (r[i]) dD[i] = Dp[lc][i];
 
 			/*  solve {F_m} = [K({D_t})] * {D_m}	*/
-			solve_system(K,dD,F_mech[lc],dR,DoF,q,r,&ok,verbose,&rms_resid);
+			if ( pcg ) {	/* from {D_m} of the last load case */
+			 if ( !pcg_solve(PC,dD,F_mech[lc],dR,Dm0,&rms_resid) ) {
+				fprintf(stderr," Conjugate gradient solution did not converge in %d iterations.\n", PC->iter );
+				ExitCode = 184;
+			 }
+			 if ( verbose )
+				fprintf(stdout," conjugate gradient iterations: %d\n", PC->iter );
+			} else
+			if ( blk > 1 ) {	/* solved with its block	*/
+			 for (i=1; i<=DoF; i++) {
+				dD[i] = Dmb[lc-lb0+1][i];  dR[i] = Rmb[lc-lb0+1][i];
+			 }
+			 rms_resid = rms_m[lc-lb0+1];	ok = okb;
+			} else
+			if ( !geom ) {	/* factor [K] once for all load cases */
+			 if ( !KF && solver == 3 )
+				KF = factor_single(K,maxa,dof,DoF,q,r,&ok);
+			 if ( !KF ) KF = factor_system(K,maxa,dof,S,OC,DoF,q,r,&ok);
+			 solve_factored(KF,K,dD,F_mech[lc],dR,q,r,&ok,verbose,&rms_resid);
+			} else
+			 solve_system(K,maxa,dof,S,OC,dD,F_mech[lc],dR,DoF,q,r,&ok,verbose,&rms_resid);
 
 			/* combine {D} = {D_t} + {D_m}	*/
 			for (i=1; i<=DoF; i++) {
@@ -505,13 +748,14 @@ For compilation/installation, see README.txt.
 		for (i=1; i<=DoF; i++)	F[i] = F_temp[lc][i] + F_mech[lc][i]; 
 
 		/*  element forces {Q} for displacements {D}	*/ 
-		element_end_forces ( Q, nE, xyz, L, Le, N1,N2,
-				Ax, Asy,Asz, Jx,Iy,Iz, E,G, p, 
-				eqF_temp[lc], eqF_mech[lc], D, shear, geom,
+		element_end_forces ( Q, nE, L, Le, N1,N2,
+				Ax, Jx,Iy,Iz, E,G, eg,
+				eqF_temp[lc], eqF_mech[lc], D, geom,
 				&axial_strain_warning );
 
 		/*  check the equilibrium error	*/
-		error = equilibrium_error ( dF, F, K, D, DoF, q,r );
+		error = equilibrium_error ( dF, F, K, maxa, S, dof, D, DoF, q,
+						pcg ? KC : NULL, NULL );
 
 		if ( geom && verbose )
 			fprintf(stdout,"\n Non-Linear Elastic Analysis ...\n");
@@ -529,25 +773,27 @@ For compilation/installation, see README.txt.
 
 		/* quasi Newton-Raphson iteration for geometric nonlinearity  */
 		if (geom) { error = 1.0; ok = 0; iter = 0; } /* re-initialize */
-		while ( geom && error > tol && iter < 500 && ok >= 0) {
+		if (geom)	reset_NR_solver ( NR );
+		while ( geom && !stepping && error > tol && iter < 500 && ok >= 0) {
 
 			++iter;
 
-			/*  assemble stiffness matrix [K({D}^(i))]	      */
-			assemble_K ( K, DoF, nE, xyz, rj, L, Le, N1, N2,
-				Ax,Asy,Asz, Jx,Iy,Iz, E, G, p,
-				shear,geom, Q, debug );
+			/*  stiffness matrix [K({D}^(i))] = [Ke] + [Kg(Q)]    */
+			update_K ( KC, K, Q );
 
 			/*  compute equilibrium error, {dF}, at iteration i   */
 			/*  {dF}^(i) = {F} - [K({D}^(i))]*{D}^(i)	      */
 			/*  convergence criteria = || {dF}^(i) ||  /  || F || */
-			error = equilibrium_error ( dF, F, K, D, DoF, q,r );
+			error = equilibrium_error ( dF, F, K, maxa, S, dof, D, DoF, q,
+								KC, Q );
 
 			/*  Powell-Symmetric-Broyden secant stiffness update  */
 			// PSB_update ( Ks, dF, dD, DoF );  /* not helpful?   */
 
 			/*  solve {dF}^(i) = [K({D}^(i))] * {dD}^(i)	      */
-			solve_system(K,dD,dF,dR,DoF,q,r,&ok,verbose,&rms_resid);
+			/*  with [K] factored now or at an earlier iteration  */
+			NR_solve ( NR, K, maxa, dof, S, dD, dF, dR, error,
+					q, r, &ok, verbose, &rms_resid );
 
 			if ( ok < 0 ) {	/*  K is not positive definite	      */
 				fprintf(stderr,"   The stiffness matrix is not pos-def. \n");
@@ -560,9 +806,9 @@ For compilation/installation, see README.txt.
 			for (i=1; i<=DoF; i++)	if ( q[i] )	D[i] += dD[i];
 
 			/*  element forces {Q} for displacements {D}^(i)      */ 
-			element_end_forces ( Q, nE, xyz, L, Le, N1,N2,
-				Ax, Asy,Asz, Jx,Iy,Iz, E,G, p, 
-				eqF_temp[lc], eqF_mech[lc], D, shear, geom,
+			element_end_forces ( Q, nE, L, Le, N1,N2,
+				Ax, Jx,Iy,Iz, E,G, eg,
+				eqF_temp[lc], eqF_mech[lc], D, geom,
 				&axial_strain_warning );
 
 			if ( verbose ) { /*  display equilibrium error        */
@@ -571,19 +817,41 @@ For compilation/installation, see README.txt.
 			}
 		}			/* end quasi Newton-Raphson iteration */
 
+		if ( stepping ) {	/* increments of the load from {D}={0} */
+			lambda = load_increments ( Q, nE, L, Le, N1,N2,
+				Ax, Jx,Iy,Iz, E,G, eg,
+				eqF_temp[lc], eqF_mech[lc],
+				&axial_strain_warning, KC, K, maxa, dof, S, NR,
+				F, Dp[lc], D, dF, DoF, q, r, tol, load_step,
+				arc_length, verbose, &error, &rms_resid,
+				&iter, &ok );
+			if ( lambda < 1.0 ) {
+				fprintf(stderr,"   The load increments reached %6.4f", lambda);
+				fprintf(stderr," of the loads.\n");
+				fprintf(stderr,"   Reduce loads and re-run the analysis.\n");
+				ExitCode = 181;
+			}
+		}
+
+		if ( geom && verbose ) 	/* display the cost of the iterations */
+			fprintf(stdout,"   %d NR iterations, %d factorizations of [K]\n",
+							iter, NR->n_factor );
+
 
 		/*   strain limit failure ... */
 		if (axial_strain_warning > 0 && ExitCode == 0)   ExitCode = 182;
 		/*   strain limit _and_ buckling failure ... */
 		if (axial_strain_warning > 0 && ExitCode == 181) ExitCode = 183;
 
- 		if ( geom )	compute_reaction_forces( R,F,K, D, DoF, r );
+ 		if ( geom )	compute_reaction_forces( R,F,K,maxa,S,dof, D, DoF, r );
 
 		/*  dealocate Broyden secant stiffness matrix, Ks */
 		// if ( geom )	free_dmatrix(Ks, 1, DoF, 1, DoF );
 
-		if ( write_matrix )	/* write static stiffness matrix */
-			save_ut_dmatrix ( "Ks", K, DoF, "w" );
+		if ( write_matrix && S ) /* write static stiffness matrix */
+			save_ut_sparse ( "Ks", S, K, dof, "w" );
+		else if ( write_matrix )
+			save_ut_sky ( "Ks", K, maxa, DoF, dof, "w" );
 
 		/*  display RMS equilibrium error */
 		if ( verbose && ok >= 0 ) evaluate ( error, rms_resid, tol, geom );
@@ -611,18 +879,36 @@ For compilation/installation, see README.txt.
 
 		write_internal_forces ( OUT_file, fp, infcpath, lc, nL, title, dx, xyz,
 					Q, nN, nE, L, N1, N2, 
-					Ax, Asy, Asz, Jx, Iy, Iz, E, G, p,
+					Ax, Asy, Asz, Jx, Iy, Iz, E, G, eg,
 					d, gX[lc], gY[lc], gZ[lc],
 					nU[lc],U[lc],nW[lc],W[lc],nP[lc],P[lc],
 					D, shear, error );
 
 		static_mesh ( IN_file, infcpath, meshpath, plotpath, title,
 					nN, nE, nL, lc, DoF,
-					xyz, L, N1,N2, p, D,
+					xyz, L, N1,N2, eg, D,
 					exagg_static, D3_flag, anlyz,
 					dx, scale );
 
 	 } /* end load case loop */
+
+	 if ( FC && KF )	save_factor_cache ( FC, KF, K, q, r );
+	 if ( KF )	free_factor ( KF );
+	 if ( PC ) {
+		free_pcg_solver ( PC );
+		free_dvector ( Dt0, 1, DoF );
+		free_dvector ( Dm0, 1, DoF );
+	 }
+	 if ( blk > 1 ) {
+		free_dmatrix ( Dtb, 1, blk, 1, DoF );
+		free_dmatrix ( Rtb, 1, blk, 1, DoF );
+		free_dmatrix ( Dmb, 1, blk, 1, DoF );
+		free_dmatrix ( Rmb, 1, blk, 1, DoF );
+		free_dvector ( rms_t, 1, blk );
+		free_dvector ( rms_m, 1, blk );
+	 }
+	 free_K_cache ( KC );
+	 free_NR_solver ( NR );
 	} else {		/*  data check only  */
 	
 	 if ( verbose ) {	/* display data check only */
@@ -631,54 +917,67 @@ For compilation/installation, see README.txt.
 	 }
 	 static_mesh ( IN_file, infcpath, meshpath, plotpath, title,
 			nN, nE, nL, lc, DoF,
-			xyz, L, N1,N2, p, D,
+			xyz, L, N1,N2, eg, D,
 			exagg_static, D3_flag, anlyz, dx, scale );
 	}
 
 
+	/* expand the skyline of K to a full matrix, for condensation;	*/
+	/* the condensation is not done in skyline or sparse storage	*/
+	if ( nC > 0 ) {
+		Kd  = dmatrix(1,DoF,1,DoF);
+		if ( S )	sparse_to_dmatrix ( S, K, dof, Kd );
+		else		sky_to_dmatrix ( K, maxa, DoF, dof, Kd );
+	}
+
 	if ( nM > 0 ) { /* carry out modal analysis */
 
 		if(verbose & anlyz) fprintf(stdout,"\n\n Modal Analysis ...\n");
 
 		nM_calc = (nM+8)<(2*nM) ? nM+8 : 2*nM;		/* Bathe */
 
-		M   = dmatrix(1,DoF,1,DoF);
+		M   = mass_analyze ( nN, nE, N1, N2, lump );
 		f   = dvector(1,nM_calc);
 		V   = dmatrix(1,DoF,1,nM_calc);
 
-		assemble_M ( M, DoF, nN, nE, xyz, rj, L, N1,N2,
-				Ax, Jx,Iy,Iz, p, d, EMs, NMs, NMx, NMy, NMz,
+		assemble_M ( M, DoF, nN, nE, L, N1,N2,
+				Ax, Jx,Iy,Iz, eg, d, EMs, NMs, NMx, NMy, NMz,
 				lump, debug );
 
 #ifdef MATRIX_DEBUG
-		save_dmatrix ( "Mf", M, 1,DoF, 1,DoF, 0, "w" ); /* free mass matrix */
+		save_ut_mass ( "Mf", M, "w" );	/* free mass matrix */
 #endif
 
-		for (j=1; j<=DoF; j++) { /*  compute traceK and traceM */
-			if ( !r[j] ) {
-				traceK += K[j][j];
-				traceM += M[j][j];
-			}
-		}
+		for (j=1; j<=DoF; j++) /*  compute traceM */
+			if ( !r[j] )	traceM += M->val[M->dg[j]];
+		/* reactions in the skyline or sparse K */
+		traceK = dynamic_K ( K, maxa, S, dof, DoF, r );
 		for (i=1; i<=DoF; i++) { /*  modify K and M for reactions    */
 			if ( r[i] ) {	/* apply reactions to upper triangle */
-				K[i][i] = traceK * 1e4;
-				M[i][i] = traceM;
+				mass_reaction ( M, i, traceM );
+				if ( !Kd )	continue;
+				Kd[i][i] = traceK * 1e4;
 				for (j=i+1; j<=DoF; j++)
-					K[j][i]=K[i][j]=M[j][i]=M[i][j] = 0.0;
+					Kd[j][i]=Kd[i][j] = 0.0;
 		    }
 		}
 
 		if ( write_matrix ) {	/* write Kd and Md matrices */
-			save_ut_dmatrix ( "Kd", K, DoF, "w" );/* dynamic stff matx */
-			save_ut_dmatrix ( "Md", M, DoF, "w" );/* dynamic mass matx */
+			if ( S )	/* dynamic stff matx */
+				save_ut_sparse ( "Kd", S, K, dof, "w" );
+			else	save_ut_sky ( "Kd", K, maxa, DoF, dof, "w" );
+			save_ut_mass ( "Md", M, "w" );	/* dynamic mass matx */
 		}
 
-		if ( anlyz ) {	/* subspace or stodola methods */
+		if ( anlyz ) {	/* subspace, stodola or lanczos methods */
+			Kp.K = K;	Kp.maxa = maxa;	Kp.S = S;
+			Kp.dof = dof;	Kp.r = r;	Kp.nK = nK;
 			if( Mmethod == 1 )
-				subspace( K, M, DoF, nM_calc, f, V, tol,shift,&iter,&ok, verbose );
+				subspace( &Kp, M, DoF, nM_calc, f, V, tol,shift,&iter,&ok, threads, verbose );
 			if( Mmethod == 2 )
-				stodola ( K, M, DoF, nM_calc, f, V, tol,shift,&iter,&ok, verbose );
+				stodola ( &Kp, M, DoF, nM_calc, f, V, tol,shift,&iter,&ok, threads, verbose );
+			if( Mmethod == 3 )
+				lanczos ( &Kp, M, DoF, nM_calc, f, V, tol,shift,&iter,&ok, threads, verbose );
 
 			for (j=1; j<=nM_calc; j++) f[j] = sqrt(f[j])/(2.0*PI);
 
@@ -694,11 +993,11 @@ For compilation/installation, see README.txt.
 	if ( nM > 0 && anlyz ) {	/* write modal analysis results */
 
 		modal_mesh ( IN_file, meshpath, modepath, plotpath, title,
-				nN,nE, DoF, nM, xyz, L, N1,N2, p,
+				nN,nE, DoF, nM, xyz, L, N1,N2, eg,
 				M, f, V, exagg_modal, D3_flag, anlyz );
 
 		animate ( IN_file, meshpath, modepath, plotpath, title,anim,
-				nN,nE, DoF, nM, xyz, L, p, N1,N2, f,
+				nN,nE, DoF, nM, xyz, L, eg, N1,N2, f,
 				V, exagg_modal, D3_flag, pan, scale );
 	}
 
@@ -721,19 +1020,19 @@ For compilation/installation, see README.txt.
 		if ( m[1] > 0 && nM > 0 )	Cfreq = f[m[1]];
 
 		if ( Cmethod == 1 && anlyz) {	/* static condensation only */
-			static_condensation(K, DoF, c, Cdof, Kc, 0 );
+			static_condensation(Kd, DoF, c, Cdof, Kc, 0 );
 			if ( verbose )
 				fprintf(stdout,"   static condensation of K complete\n");
 		}
 		if ( Cmethod == 2 && anlyz ) {  /*  dynamic condensation  */
-			paz_condensation(M, K, DoF, c, Cdof, Mc,Kc, Cfreq, 0 ); 
+			paz_condensation(M, Kd, DoF, c, Cdof, Mc,Kc, Cfreq, 0 ); 
 			if ( verbose ) {
 				fprintf(stdout,"   Paz condensation of K and M complete");
 				fprintf(stdout," ... dynamics matched at %f Hz.\n", Cfreq );
 			}
 		}
 		if ( Cmethod == 3 && nM > 0 && anlyz ) {
-			modal_condensation(M,K, DoF, r, c, Cdof, Mc,Kc, V,f, m, 0 );
+			modal_condensation(M, DoF, r, c, Cdof, Mc,Kc, V,f, m, 0 );
 			if ( verbose ) 
 				fprintf(stdout,"   modal condensation of K and M complete\n");
 		}
@@ -744,14 +1043,29 @@ For compilation/installation, see README.txt.
 		free_dmatrix(Mc, 1,Cdof,1,Cdof );
 	}
 
+	if ( Kd )	free_dmatrix(Kd, 1,DoF,1,DoF);
+	if ( nM > 0 ) {
+		free_mass_matrix ( M );
+		M = NULL;
+	}
+	if ( OC ) {	/* K is in the scratch file */
+		free_ooc_profile ( OC );
+		K = NULL;
+	}
+
+
+	if ( FC && FC->hit ) { K = NULL;  S = NULL; }	/* in the mapped file */
+	close_factor_cache ( FC );
+	free_sparse_ldl ( S );
+	free ( eg );
 
 	/* deallocate memory used for each frame analysis variable */
-	deallocate ( nN, nE, nL, nF, nU, nW, nP, nT, DoF, nM,
+	deallocate ( nN, nE, nL, DoF, nM,
 			xyz, rj, L, Le, N1, N2, q,r,
 			Ax, Asy, Asz, Jx, Iy, Iz, E, G, p,
 			U,W,P,T, Dp, F_mech, F_temp,
 			eqF_mech, eqF_temp, F, dF, 
-			K, Q, D, dD, R, dR, 
+			K, maxa, dof, Q, D, dD, R, dR, 
 			d,EMs,NMs,NMx,NMy,NMz, M,f,V, c, m, 
 			pkNx, pkVy, pkVz, pkTx, pkMy, pkMz,
 			pkDx, pkDy, pkDz, pkRx, pkSy, pkSz
@@ -0,0 +1,305 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//**
+	@file
+	Compact storage of the mass matrix, and the products of the eigen-
+	problem solvers with it.  Each product sums the terms of a row in
+	increasing order of column, as the products with the upper triangle
+	of a full matrix do, so that the results are the same.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "mass.h"
+#include "common.h"
+#include "NRutil.h"
+
+
+/*
+ * MASS_ANALYZE - the terms of each row of the mass matrix, from the frame
+ * element connectivity.  The nodes joined to each node, and the node
+ * itself, are listed in increasing order;  the row of each coordinate of
+ * a node has the six coordinates of each listed node.  A lumped mass
+ * matrix has the diagonal and the rotatory inertia of each node.
+ */
+mass_matrix *mass_analyze( int nN, int nE, int *N1, int *N2, int lump )
+{
+	mass_matrix *M;
+	int	**adj, *len, *cap,	/* nodes joined to each node	*/
+		n = 6*nN, nnz = 0, i, j, k, l, a, b, t;
+
+	M = (mass_matrix *) malloc(sizeof(mass_matrix));
+	M->n = n;
+	M->lump = lump;
+	M->rptr = ivector(1,n+1);
+	M->dg   = ivector(1,n);
+
+	if ( lump ) {	/* translational mass and 3-by-3 rotatory inertia */
+		M->col = ivector(1,12*nN);
+		M->rptr[1] = 1;
+		for (j=1; j<=nN; j++) {
+			k = 6*(j-1);
+			for (l=1; l<=3; l++) {
+				M->dg[k+l] = M->rptr[k+l];
+				M->col[M->rptr[k+l]] = k+l;
+				M->rptr[k+l+1] = M->rptr[k+l] + 1;
+			}
+			for (l=4; l<=6; l++) {
+				for (i=4; i<=6; i++) {
+					M->col[M->rptr[k+l]+i-4] = k+i;
+					if ( i == l )	M->dg[k+l] = M->rptr[k+l]+i-4;
+				}
+				M->rptr[k+l+1] = M->rptr[k+l] + 3;
+			}
+		}
+		nnz = 12*nN;
+		M->val = dvector(1,nnz);
+		for (i=1; i<=nnz; i++)	M->val[i] = 0.0;
+		return M;
+	}
+
+	len = ivector(1,nN);
+	cap = ivector(1,nN);
+	adj = (int **) malloc((size_t) (nN+1)*sizeof(int *));
+	for (j=1; j<=nN; j++) {
+		len[j] = 1;	cap[j] = 8;
+		adj[j] = (int *) malloc((size_t) cap[j]*sizeof(int));
+		adj[j][0] = j;
+	}
+
+	for (i=1; i<=nE; i++) {		/* nodes joined by an element */
+		a = N1[i];	b = N2[i];
+		for (k=0; k<len[a]; k++)	if ( adj[a][k] == b ) break;
+		if ( k < len[a] )	continue;	/* already joined */
+		for (l=0; l<2; l++) {	/* a --> b, then b --> a */
+			if ( len[a] == cap[a] ) {
+				cap[a] *= 2;
+				adj[a] = (int *) realloc(adj[a],(size_t) cap[a]*sizeof(int));
+			}
+			adj[a][len[a]++] = b;
+			a = N2[i];	b = N1[i];
+		}
+	}
+
+	for (j=1; j<=nN; j++) {		/* insertion sort of each list */
+		for (k=1; k<len[j]; k++) {
+			t = adj[j][k];
+			for (l=k; l > 0 && adj[j][l-1] > t; l--)
+				adj[j][l] = adj[j][l-1];
+			adj[j][l] = t;
+		}
+		nnz += 36*len[j];
+	}
+
+	M->col = ivector(1,nnz);
+	M->val = dvector(1,nnz);
+	M->rptr[1] = 1;
+	for (j=1; j<=nN; j++) {
+		for (l=1; l<=6; l++) {
+			i = 6*(j-1) + l;
+			t = M->rptr[i];
+			for (k=0; k<len[j]; k++)
+				for (a=1; a<=6; a++) {
+					M->col[t] = 6*(adj[j][k]-1) + a;
+					if ( M->col[t] == i )	M->dg[i] = t;
+					++t;
+				}
+			M->rptr[i+1] = t;
+		}
+		free(adj[j]);
+	}
+	for (i=1; i<=nnz; i++)	M->val[i] = 0.0;
+
+	free(adj);
+	free_ivector(len,1,nN);
+	free_ivector(cap,1,nN);
+
+	return M;
+}
+
+
+/*
+ * MASS_TERM - the location of term i,j of the mass matrix, by bisection of
+ * the columns of row i, or NULL if it is not stored
+ */
+double *mass_term( mass_matrix *M, int i, int j )
+{
+	int	lo = M->rptr[i], hi = M->rptr[i+1]-1, mid;
+
+	while ( lo <= hi ) {
+		mid = (lo+hi)/2;
+		if ( M->col[mid] == j )		return M->val + mid;
+		if ( M->col[mid] < j )	lo = mid+1;
+		else			hi = mid-1;
+	}
+	return NULL;
+}
+
+
+/*
+ * MASS_PRODAX - {y} = [M]{x}
+ */
+void mass_prodAx( mass_matrix *M, double *x, double *y )
+{
+	int	i, k;
+
+	for (i=1; i<=M->n; i++) {
+		y[i] = 0.0;
+		for (k=M->rptr[i]; k<M->rptr[i+1]; k++)
+			y[i] += M->val[k]*x[M->col[k]];
+	}
+	return;
+}
+
+
+/*
+ * MASS_PRODAX - [Y] = [M][X] for the nb vectors in the rows of
+ * X[1..n][1..nb]
+ */
+void mass_prodAX( mass_matrix *M, double **X, double **Y, int nb )
+{
+	double	a, *xj, *yi;
+	int	i, k, l;
+
+	for (i=1; i<=M->n; i++) {
+		yi = Y[i];
+		for (l=1; l<=nb; l++)	yi[l] = 0.0;
+		for (k=M->rptr[i]; k<M->rptr[i+1]; k++) {
+			a = M->val[k];	xj = X[M->col[k]];
+			for (l=1; l<=nb; l++)	yi[l] += a*xj[l];
+		}
+	}
+	return;
+}
+
+
+/*
+ * MASS_XTAY - {x}'[M]{y}, with {d} = [M]{y}
+ */
+double mass_xtAy( double *x, mass_matrix *M, double *y, double *d )
+{
+	double	xtAy = 0.0;
+	int	i;
+
+	mass_prodAx ( M, y, d );
+	for (i=1; i<=M->n; i++)	xtAy += x[i] * d[i];
+	return xtAy;
+}
+
+
+/*
+ * MASS_COLUMN - column j of the mass matrix, which is row j
+ */
+void mass_column( mass_matrix *M, int j, double *v )
+{
+	int	i, k;
+
+	for (i=1; i<=M->n; i++)	v[i] = 0.0;
+	for (k=M->rptr[j]; k<M->rptr[j+1]; k++)	v[M->col[k]] = M->val[k];
+	return;
+}
+
+
+/*
+ * MASS_REACTION - a reaction at coordinate i:  the terms of row i beyond
+ * the diagonal, and the same terms of column i, are zero, and the
+ * diagonal term is m
+ */
+void mass_reaction( mass_matrix *M, int i, double m )
+{
+	int	k;
+
+	M->val[M->dg[i]] = m;
+	for (k=M->dg[i]+1; k<M->rptr[i+1]; k++) {
+		M->val[k] = 0.0;
+		*mass_term ( M, M->col[k], i ) = 0.0;
+	}
+	return;
+}
+
+
+/*
+ * MASS_BYTES - the bytes of a consistent mass matrix with a 6-by-6 block
+ * for each node and two for each frame element, at most
+ */
+double mass_bytes( int nN, int nE )
+{
+	double	nnz = 36.0*(nN + 2.0*nE);
+
+	return nnz*(sizeof(double)+sizeof(int)) + (2.0*6*nN+1)*sizeof(int)
+		+ sizeof(mass_matrix);
+}
+
+
+/*
+ * SAVE_UT_MASS - save the mass matrix to the named file, row by row, in
+ * the format of save_ut_dmatrix()
+ */
+void save_ut_mass( char filename[], mass_matrix *M, const char *mode )
+{
+	FILE	*fp_m;
+	double	*v;
+	int	i, j;
+	time_t	now;
+
+	if ((fp_m = fopen (filename, mode)) == NULL) {
+		printf (" error: cannot open file: %s \n", filename );
+		exit(1016);
+	}
+	v = dvector(1,M->n);
+	(void) time(&now);
+	fprintf(fp_m,"%% filename: %s - %s\n", filename, ctime(&now));
+	fprintf(fp_m,"%% type: matrix \n");
+	fprintf(fp_m,"%% rows: %d\n", M->n );
+	fprintf(fp_m,"%% columns: %d\n", M->n );
+	for (i=1; i <= M->n; i++) {
+		mass_column ( M, i, v );
+		for (j=1; j <= M->n; j++) {
+			if (fabs(v[j]) > 1.e-99) fprintf(fp_m,"%21.12e", v[j] );
+			else		         fprintf(fp_m,"    0                ");
+		}
+		fprintf(fp_m,"\n");
+	}
+	free_dvector(v,1,M->n);
+	fclose ( fp_m);
+	return;
+}
+
+
+/*
+ * FREE_MASS_MATRIX - release the memory of a mass matrix
+ */
+void free_mass_matrix( mass_matrix *M )
+{
+	int	nnz;
+
+	if ( M == NULL )	return;
+	nnz = M->rptr[M->n+1]-1;
+	free_ivector(M->rptr,1,M->n+1);
+	free_ivector(M->dg,1,M->n);
+	free_ivector(M->col,1,nnz);
+	free_dvector(M->val,1,nnz);
+	free(M);
+}
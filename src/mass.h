@@ -0,0 +1,112 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//** @file
+	Compact storage of the mass matrix.
+
+	The terms of both triangles of [M] are held row by row, with the
+	columns of each row in increasing order.  A lumped mass matrix has
+	the diagonal and the 3-by-3 block of rotatory inertia of each node;
+	a consistent mass matrix has the 6-by-6 blocks of the nodes joined
+	by a frame element.
+*/
+#ifndef FRAME_MASS_H
+#define FRAME_MASS_H
+
+#include <stdio.h>
+
+
+/**
+	the terms of the mass matrix in compressed rows
+*/
+typedef struct {
+	int	n;		/**< number of structural coordinates	*/
+	int	lump;		/**< 1: lumped mass, 0: consistent mass	*/
+	int	*rptr;		/**< first term of each row, [1..n+1]	*/
+	int	*col;		/**< column of each term		*/
+	int	*dg;		/**< the diagonal term of each row, [1..n] */
+	double	*val;		/**< the terms of [M]			*/
+} mass_matrix;
+
+
+/**
+	MASS_ANALYZE - the terms of each row of the mass matrix, from the
+	frame element connectivity.  The terms are set to zero.
+*/
+mass_matrix *mass_analyze(
+	int nN,		/**< number of nodes				*/
+	int nE,		/**< number of frame elements			*/
+	int *N1, int *N2, /**< node connectivity			*/
+	int lump	/**< 1: lumped mass, 0: consistent mass		*/
+);
+
+/**
+	MASS_TERM - the location of term i,j of the mass matrix, or NULL if
+	it is not stored
+*/
+double *mass_term( mass_matrix *M, int i, int j );
+
+/**
+	MASS_PRODAX - {y} = [M]{x}, as prodABj() for a full [M]
+*/
+void mass_prodAx( mass_matrix *M, double *x, double *y );
+
+/**
+	MASS_PRODAX - [Y] = [M][X] for the nb vectors in the rows of
+	X[1..n][1..nb], as prodAX() for a full [M]
+*/
+void mass_prodAX( mass_matrix *M, double **X, double **Y, int nb );
+
+/**
+	MASS_XTAY - {x}'[M]{y}, with {d} = [M]{y}, as xtAy() for a full [M]
+*/
+double mass_xtAy( double *x, mass_matrix *M, double *y, double *d );
+
+/**
+	MASS_COLUMN - column j of the mass matrix, {v}
+*/
+void mass_column( mass_matrix *M, int j, double *v );
+
+/**
+	MASS_REACTION - a reaction at coordinate i: the terms of row and
+	column i beyond the diagonal are zero and the diagonal term is m,
+	as main() modifies the upper triangle of a full [M]
+*/
+void mass_reaction( mass_matrix *M, int i, double m );
+
+/**
+	MASS_BYTES - the bytes of a consistent mass matrix, at most, which
+	hold a lumped mass matrix as well
+*/
+double mass_bytes( int nN, int nE );
+
+/**
+	SAVE_UT_MASS - save the mass matrix to the named file, as
+	save_ut_dmatrix() saves a full matrix
+*/
+void save_ut_mass( char filename[], mass_matrix *M, const char *mode );
+
+/**
+	FREE_MASS_MATRIX - release the memory of a mass matrix
+*/
+void free_mass_matrix( mass_matrix *M );
+
+#endif /* FRAME_MASS_H */
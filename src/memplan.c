@@ -0,0 +1,349 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//**
+	@file
+	Memory plan of an analysis.  The bytes of each array are those
+	requested by the allocations of main() and of the solvers, with the
+	row pointers of the NRutil matrices.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memplan.h"
+#include "frame3dd.h"
+#include "frame3dd_io.h"
+#include "coordtrans.h"
+#include "eig.h"
+#include "NRutil.h"
+#include "microstran/vec3.h"
+
+#define MP_OOC	0	/* the profile solver, out of core		*/
+#define MB	1048576.0
+
+static double vec_bytes( double n, size_t s );
+static double mat_bytes( double nr, double nc, size_t s );
+static double d3_bytes( double n1, double n2, double n3, size_t s );
+
+
+/*
+ * PLAN_MEMORY - the bytes of memory of each part of an analysis, with each
+ * strategy in turn until one fits:  the selected solver, the other direct
+ * solver if -k is not given, and the profile solver out of core.  If none
+ * fits and -m L is not given, they are tried again with the subspace method.
+ */
+void plan_memory(
+	mem_plan *MP, double limit,
+	int nN, int nE, int nL, int DoF, int *maxa, int *dof,
+	int *N1, int *N2, int *q,
+	sparse_ldl **S, int solver, int forced, int pcg_precond,
+	int geom, int anlyz, int NR_method, int NR_interval,
+	int nM, int Mmethod, int Mforced, int nC, int write_matrix
+){
+	double	nK = maxa[DoF+1]-1,
+		col = 0.0,	/* bytes of the longest column of K	*/
+		fixed,		/* bytes of all but [K] and full matrices */
+		factor,		/* bytes of [K] and its decomposition	*/
+		work,		/* bytes of the eigen-problem work	*/
+		blk,		/* bytes of the blocks of load vectors	*/
+		nKo,		/* terms of [K] with each strategy	*/
+		elem,		/* bytes of the element matrices but [Ke] */
+		kp, ks,		/* bytes of the copies of [K] for modes	*/
+		kf, nnz;
+	int	opt[3], nopt = 0, pcg, need_K, nM_calc, cdof,
+		meth, o, f, nb, np, nl, j;
+
+	MP->limit = limit;
+	MP->scratch = 0.0;
+	MP->ooc = 0;
+	MP->budget = 0;
+
+	for (j=1; j <= DoF; j++)
+		if ( (maxa[j+1]-maxa[j])*sizeof(double) > col )
+			col = (maxa[j+1]-maxa[j])*sizeof(double);
+
+	/* node coordinates, rigid radii, reactions, renumbering, skyline */
+	MP->data  = vec_bytes(nN,sizeof(vec3)) + vec_bytes(nN,sizeof(float))
+		  + 5.0*vec_bytes(DoF,sizeof(int)) + vec_bytes(DoF+1,sizeof(int))
+		  + 5.0*vec_bytes(nN,sizeof(float));	/* node masses	*/
+	/* lengths, connectivity, sections, materials, masses, geometry */
+	MP->data += 2.0*vec_bytes(nE,sizeof(double))
+		  + 2.0*vec_bytes(nE,sizeof(int))
+		  + 11.0*vec_bytes(nE,sizeof(float))
+		  + vec_bytes(nE,sizeof(elem_geom));
+
+	/* U, W, P, T, Dp, F_mech, F_temp, F, dF, eqF_mech, eqF_temp	*/
+	MP->loads = d3_bytes(nL,nE,4,sizeof(float))
+		  + d3_bytes(nL,10.0*nE,13,sizeof(float))
+		  + d3_bytes(nL,10.0*nE,5,sizeof(float))
+		  + d3_bytes(nL,nE,8,sizeof(float))
+		  + mat_bytes(nL,DoF,sizeof(float))
+		  + 2.0*mat_bytes(nL,DoF,sizeof(double))
+		  + 2.0*vec_bytes(DoF,sizeof(double))
+		  + 2.0*d3_bytes(nL,nE,12,sizeof(double));
+
+	/* Q, D, dD, R, dR, and the twelve peak values of each element	*/
+	MP->results = mat_bytes(nE,12,sizeof(double))
+		    + 4.0*vec_bytes(DoF,sizeof(double))
+		    + 12.0*mat_bytes(nL,nE,sizeof(double));
+
+	pcg    = ( solver == 4 && !geom );
+	need_K = !pcg || nM > 0 || nC > 0 || write_matrix;
+	f      = ( geom && solver != 2 ) ? 1 : solver;  /* as factored */
+
+	/* Fk, Dk and Rk of the decomposition */
+	kf = anlyz ? 3.0*vec_bytes(DoF,sizeof(double)) : 0.0;
+
+	MP->elements = 0.0;
+	if ( anlyz && pcg ) {	/* element matrices, c.g. vectors, precond. */
+		MP->elements = mat_bytes(nE,78,sizeof(double))
+			     + mat_bytes(nE,12,sizeof(int))
+			     + 6.0*vec_bytes(DoF,sizeof(double))
+			     + 2.0*vec_bytes(DoF,sizeof(int));
+		if ( pcg_precond == PCG_JACOBI )
+			MP->elements += vec_bytes(36.0*nN,sizeof(double))
+				      + vec_bytes(DoF,sizeof(double));
+		else if ( pcg_precond == PCG_IC ) {  /* at most, in L */
+			nnz = 21.0*nN + 36.0*nE;
+			MP->elements += 2.0*vec_bytes(nnz,sizeof(double))
+				      + vec_bytes(nnz,sizeof(int))
+				      + vec_bytes(DoF+1,sizeof(int));
+		} else	MP->elements += vec_bytes(36.0*nN,sizeof(double));
+	}
+	if ( anlyz && geom ) {	/* unit [Kg] of each element, and [Ke]	*/
+		MP->elements = mat_bytes(nE,78,sizeof(double))
+			     + mat_bytes(nE,78,sizeof(int));
+		if ( NR_method == NR_LBFGS )
+			MP->elements += 2.0*mat_bytes(NR_interval,DoF,sizeof(double))
+				      + 2.0*vec_bytes(NR_interval,sizeof(double))
+				      + 2.0*vec_bytes(DoF,sizeof(double));
+	}
+	elem = MP->elements;
+
+	/* full [K] for condensation					*/
+	MP->dense = nC > 0 ? mat_bytes(DoF,DoF,sizeof(double)) : 0.0;
+	nM_calc = (nM+8)<(2*nM) ? nM+8 : 2*nM;
+	if ( nM_calc > DoF )	nM_calc = DoF;
+	np = ( nM_calc < RHS_BLOCK ) ? nM_calc : RHS_BLOCK;
+	cdof = 6*nC;
+
+	/* the strategies for [K] */
+	opt[nopt++] = f;
+	if ( limit > 0.0 && anlyz && !forced && f == 1 )  opt[nopt++] = 2;
+	if ( limit > 0.0 && anlyz && ( f == 1 || !forced ) && !pcg )
+		opt[nopt++] = MP_OOC;
+
+	MP->fits = 0;
+	for (meth = Mmethod; !MP->fits; meth = 1) {
+	 for (o=0; o < nopt && !MP->fits; o++) {
+
+		if ( opt[o] == 2 && !*S )	/* the size of sparse L	*/
+			*S = sparse_analyze ( nN, nE, N1, N2, dof, q );
+
+		/* [K] in the skyline, or in the columns of the sparse S */
+		nKo = ( opt[o] == 2 ) ? (*S)->nK : nK;
+		factor = need_K && opt[o] != MP_OOC ?
+					vec_bytes(nKo,sizeof(double)) : 0.0;
+		MP->elements = elem + ( anlyz && geom ?
+					vec_bytes(nKo,sizeof(double)) : 0.0 );
+		if ( anlyz ) switch ( opt[o] ) {
+		 case 1:	/* Kf, diag, qk, rk */
+			factor += vec_bytes(nK,sizeof(double)) + kf
+				+ vec_bytes(DoF,sizeof(double))
+				+ 2.0*vec_bytes(DoF,sizeof(int));
+			break;
+		 case 2:	/* S, and the panel work of the reduction */
+			factor += kf
+				+ vec_bytes(DoF+1,sizeof(int))
+				+ vec_bytes(nKo,sizeof(int))
+				+ vec_bytes(nKo,sizeof(unsigned long))
+				+ vec_bytes((*S)->lptr[(*S)->ns+1]-1,sizeof(double))
+				+ vec_bytes((*S)->rptr[(*S)->ns+1]-1,sizeof(int))
+				+ 3.0*vec_bytes((*S)->nq,sizeof(int))
+				+ 2.0*vec_bytes((*S)->ns+1,sizeof(int))
+				+ vec_bytes((*S)->ns+1,sizeof(unsigned long))
+				+ vec_bytes((*S)->nq,sizeof(double))
+				+ vec_bytes(4.0*(*S)->nq,sizeof(double))
+				+ vec_bytes((*S)->nq,sizeof(int));
+			break;
+		 case 3:	/* Kfs, diags, qk, rk */
+			factor += vec_bytes(nK,sizeof(float)) + kf
+				+ vec_bytes(DoF,sizeof(float))
+				+ 2.0*vec_bytes(DoF,sizeof(int));
+			break;
+		 case MP_OOC:	/* diag, qk, rk, and two one-column panels */
+			factor += kf + vec_bytes(DoF,sizeof(double))
+				+ 2.0*vec_bytes(DoF,sizeof(int)) + 2.0*col;
+			break;
+		}
+
+		work = 0.0;
+		if ( nM > 0 ) {		/* M, V, f, and the eigen-solver */
+			work = mass_bytes(nN,nE)
+			     + mat_bytes(DoF,nM_calc,sizeof(double))
+			     + vec_bytes(nM_calc,sizeof(double))
+			     + vec_bytes(DoF,sizeof(double));
+			/* the skyline copy of K + shift M, its decomposition
+			   and the vectors of a solution, or the copy of [K]
+			   of sturm(), which are not held together */
+			kp = ( opt[o] == 2 ? 0.0 : vec_bytes(nK,sizeof(double)) )
+			   + 5.0*vec_bytes(DoF,sizeof(double))
+			   + 3.0*vec_bytes(DoF,sizeof(int));
+			ks = vec_bytes(nKo,sizeof(double))
+			   + vec_bytes(DoF,sizeof(double))
+			   + vec_bytes(DoF,sizeof(int));
+			work += ( kp > ks ) ? kp : ks;
+			if ( meth == 2 ) {	/* six vectors, the trial flags */
+				work += 6.0*vec_bytes(DoF,sizeof(double))
+				      + vec_bytes(DoF,sizeof(int))
+				      + vec_bytes(nM_calc,sizeof(double));
+			} else if ( meth == 3 ) {	/* Q, MQ, T, Z, and R */
+				nl = lanczos_dim ( DoF, nM_calc );
+				work += 2.0*mat_bytes(nl+LANCZOS_BLOCK,DoF,sizeof(double))
+				      + mat_bytes(nl+LANCZOS_BLOCK,nl+LANCZOS_BLOCK,sizeof(double))
+				      + mat_bytes(nl,nl,sizeof(double))
+				      + 3.0*vec_bytes(nl+LANCZOS_BLOCK,sizeof(double))
+				      + vec_bytes(DoF,sizeof(double));
+			} else {	/* X, M X, K X, Kb, Mb, Qb, R, and the
+					   panels of solve_factored_block() */
+				work += vec_bytes(DoF,sizeof(double))
+				      + vec_bytes(DoF,sizeof(int))
+				      + 3.0*mat_bytes(nM_calc,DoF,sizeof(double))
+				      + 4.0*mat_bytes(nM_calc,nM_calc,sizeof(double))
+				      + 3.0*mat_bytes(DoF,np,sizeof(double))
+				      + 3.0*vec_bytes(nM_calc,sizeof(double))
+				      + 2.0*vec_bytes(nM_calc,sizeof(int));
+			}
+		}
+		if ( nC > 0 )		/* Kc and Mc, at most		*/
+			work += 2.0*mat_bytes(cdof,cdof,sizeof(double));
+
+		MP->stiffness = factor;
+		MP->modes = work;
+		fixed = MP->data + MP->loads + MP->results + MP->elements
+		      + MP->modes;
+		MP->total = fixed + MP->stiffness + MP->dense;
+
+		MP->solver  = ( opt[o] == MP_OOC ) ? 1 : solver;
+		if ( opt[o] == 2 )	MP->solver = 2;
+		MP->Mmethod = meth;
+		MP->ooc     = ( opt[o] == MP_OOC );
+		MP->scratch = MP->ooc ? 2.0*nK*sizeof(double) : 0.0;
+
+		MP->fits = ( limit <= 0.0 || MP->total <= limit );
+		if ( !MP->fits )	continue;
+
+		if ( MP->ooc ) {	/* the rest of the memory, for panels */
+			MP->budget = (size_t) ( limit - MP->total + 2.0*col );
+			MP->stiffness += MP->budget - 2.0*col;
+			MP->total = limit;
+		}
+	 }
+	 if ( MP->fits || meth == 1 || Mforced || nM < 1 )	break;
+	}
+
+	/* the load vectors of linear analyses solved RHS_BLOCK at a time, 
+	   with solve_factored_block(), if the room is left for them	*/
+	MP->block = 1;
+	if ( anlyz && !geom && nL > 1 && MP->solver == 1 && !MP->ooc ) {
+		nb = ( nL < RHS_BLOCK ) ? nL : RHS_BLOCK;
+		blk = 4.0*mat_bytes(nb,DoF,sizeof(double))
+		    + 2.0*vec_bytes(nb,sizeof(double))
+		    + 5.0*mat_bytes(DoF,nb,sizeof(double))
+		    + vec_bytes(nb,sizeof(double)) + vec_bytes(nb,sizeof(int));
+		if ( limit <= 0.0 || MP->total + blk <= limit ) {
+			MP->block  = nb;
+			MP->loads += blk;
+			MP->total += blk;
+		}
+	}
+
+	if ( MP->solver != 2 && *S ) {	/* analyzed only for its size	*/
+		free_sparse_ldl ( *S );
+		*S = NULL;
+	}
+}
+
+
+/*
+ * WRITE_MEMORY_PLAN - display the bytes of each part of the analysis, in MB,
+ * and the strategy of the plan
+ */
+void write_memory_plan( FILE *fp, mem_plan *MP )
+{
+	static const char *solver_name[] = { "", "profile L D L'",
+		"sparse L D L'", "single-precision profile L D L'",
+		"conjugate gradient" };
+
+	fprintf(fp,"\n M E M O R Y   P L A N %36s\n", "MB");
+	fprintf(fp,"   node, element and reaction data ");	dots(fp,13);
+	fprintf(fp," %10.2f\n", MP->data/MB );
+	fprintf(fp,"   load data and load vectors ");	dots(fp,18);
+	fprintf(fp," %10.2f\n", MP->loads/MB );
+	fprintf(fp,"   displacements, forces, peak values ");	dots(fp,10);
+	fprintf(fp," %10.2f\n", MP->results/MB );
+	fprintf(fp,"   stiffness matrix and L D L' decomposition ");	dots(fp,3);
+	fprintf(fp," %10.2f\n", MP->stiffness/MB );
+	fprintf(fp,"   element matrices and iteration state ");	dots(fp,8);
+	fprintf(fp," %10.2f\n", MP->elements/MB );
+	fprintf(fp,"   full stiffness matrix ");	dots(fp,23);
+	fprintf(fp," %10.2f\n", MP->dense/MB );
+	fprintf(fp,"   mass matrix, modes, eigen-problem work ");	dots(fp,6);
+	fprintf(fp," %10.2f\n", MP->modes/MB );
+	fprintf(fp,"   total ");	dots(fp,39);
+	fprintf(fp," %10.2f", MP->total/MB );
+	if ( MP->limit > 0.0 )	fprintf(fp,"  of %.2f", MP->limit/MB );
+	fprintf(fp,"\n");
+	if ( MP->scratch > 0.0 ) {
+		fprintf(fp,"   scratch files ");	dots(fp,31);
+		fprintf(fp," %10.2f\n", MP->scratch/MB );
+	}
+	if ( MP->solver >= 1 && MP->solver <= 4 )
+		fprintf(fp,"   %s solver", solver_name[MP->solver] );
+	if ( MP->ooc )	fprintf(fp,", out of core");
+	if ( MP->block > 1 )
+		fprintf(fp,", %d load cases at a time", MP->block );
+	if ( MP->Mmethod == 1 && MP->modes > 0.0 )
+		fprintf(fp,", subspace-Jacobi modes");
+	if ( MP->Mmethod == 2 && MP->modes > 0.0 )
+		fprintf(fp,", Stodola modes");
+	if ( MP->Mmethod == 3 && MP->modes > 0.0 )
+		fprintf(fp,", Lanczos modes");
+	fprintf(fp,"%s\n", MP->fits ? "" : " ... does not fit");
+}
+
+
+/* bytes of a vector, a matrix, and a 3D array of terms of s bytes, NRutil */
+static double vec_bytes( double n, size_t s )
+{
+	return ( n + 1.0 ) * s;
+}
+
+static double mat_bytes( double nr, double nc, size_t s )
+{
+	return ( nr + 1.0 ) * sizeof(void *) + ( nr*nc + 1.0 ) * s;
+}
+
+static double d3_bytes( double n1, double n2, double n3, size_t s )
+{
+	return n1 * sizeof(void *) + n1*n2 * sizeof(void *) + n1*n2*n3 * s;
+}
@@ -0,0 +1,99 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//** @file
+	Memory plan of an analysis.
+
+	The bytes of the arrays of an analysis are computed from the numbers
+	of nodes, elements, load cases and modes and from the skyline of the
+	stiffness matrix, before the arrays are allocated.  Under a memory
+	limit a strategy that fits is chosen:  the selected solver, the other
+	direct solver, or the profile solver out of core.
+*/
+#ifndef FRAME_MEMPLAN_H
+#define FRAME_MEMPLAN_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "sparse.h"
+
+
+/**
+	the bytes of memory of an analysis, and the strategy chosen to fit
+	them within a limit, from plan_memory()
+*/
+typedef struct {
+	double	data;		/**< node, element and reaction data	*/
+	double	loads;		/**< load data and load vectors		*/
+	double	results;	/**< displacements, end forces, peak values */
+	double	stiffness;	/**< [K] and its L D L' decomposition	*/
+	double	elements;	/**< element matrices and iteration state */
+	double	dense;		/**< full [K] in memory			*/
+	double	modes;		/**< [M], mode shapes, eigen-problem work */
+	double	total;		/**< the sum of the above		*/
+	double	scratch;	/**< bytes held in scratch files	*/
+	double	limit;		/**< the memory limit, 0: none		*/
+	int	solver;		/**< the solver, as in main()		*/
+	int	Mmethod;	/**< the modal analysis method		*/
+	int	ooc;		/**< 1: [K] and L D L' in a scratch file */
+	size_t	budget;		/**< bytes of L D L' in memory, if ooc	*/
+	int	block;		/**< load cases solved together, 1: one */
+	int	fits;		/**< 1: the analysis fits within the limit */
+} mem_plan;
+
+
+/**
+	PLAN_MEMORY - the bytes of memory of an analysis with each strategy,
+	in order, until one fits within the limit.  The sparse decomposition
+	is analyzed in *S if its size is needed, and is kept if it is chosen.
+*/
+void plan_memory(
+	mem_plan *MP,	/**< the plan					*/
+	double limit,	/**< memory limit in bytes, 0: none		*/
+	int nN,		/**< number of nodes				*/
+	int nE,		/**< number of frame elements			*/
+	int nL,		/**< number of load cases			*/
+	int DoF,	/**< number of degrees of freedom		*/
+	int *maxa,	/**< location of diagonal terms in K		*/
+	int *dof,	/**< location of each coordinate in K		*/
+	int *N1, int *N2, /**< node connectivity			*/
+	int *q,		/**< 1: not a reaction; 0: a reaction coordinate */
+	sparse_ldl **S,	/**< sparse L D L' decomposition, or NULL	*/
+	int solver,	/**< the selected solver, as in main()		*/
+	int forced,	/**< 1: the solver is given on the command line	*/
+	int pcg_precond, /**< preconditioner of the c.g. solver		*/
+	int geom,	/**< 1: include geometric stiffness, 0: don't	*/
+	int anlyz,	/**< 1: stiffness analysis, 0: data check	*/
+	int NR_method,	/**< iterations for geometric nonlinearity	*/
+	int NR_interval, /**< number of L-BFGS update pairs		*/
+	int nM,		/**< number of modes to find			*/
+	int Mmethod,	/**< modal analysis method			*/
+	int Mforced,	/**< 1: the method is given on the command line	*/
+	int nC,		/**< number of nodes with condensed DoF's	*/
+	int write_matrix /**< 1: write [K] and [M] to files		*/
+);
+
+
+/** WRITE_MEMORY_PLAN - display the plan, in MB */
+void write_memory_plan( FILE *fp, mem_plan *MP );
+
+#endif /* FRAME_MEMPLAN_H */
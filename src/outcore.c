@@ -0,0 +1,454 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//**
+	@file
+	Out-of-core skyline L D L' decomposition.
+
+	The scratch file holds the skyline matrix K, followed by a copy of K
+	that is replaced by its L D L' decomposition, column panel by column
+	panel.  K is mapped into memory as a whole, since it is assembled
+	element by element;  the pages of a mapped file are written back to
+	the file rather than to swap space when memory runs short.  Only the
+	panels of the decomposition in use are mapped.
+	Where mmap() is not available the file is read and written instead,
+	and K is held in memory.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#if !defined(WIN32) && !defined(DJGPP)
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "outcore.h"
+#include "common.h"
+#include "frame3dd_io.h"
+#include "HPGmatrix.h"
+#include "NRutil.h"
+
+/* a panel of columns of the decomposition, mapped into memory */
+typedef struct {
+	void	*map;		/* the mapped (or read) part of the file */
+	size_t	start, len;	/* its location and length in the file	*/
+	int	write;		/* 1: the terms are changed		*/
+	double	*A;		/* A[maxa[j]] is the diagonal of column j */
+} ooc_window;
+
+static FILE *scratch_file( size_t size );
+static void map_columns( ooc_profile *P, int j1, int j2, int write,
+							ooc_window *w );
+static void unmap_columns( ooc_window *w, FILE *fp );
+static void reduce_column( double *A, double *B, int *maxa, int *q,
+						int j, int i1, int i2 );
+static int  reduce_panels( ooc_profile *P, double *d, int *q, int *pd );
+static void solve_panels( ooc_profile *P, double *d, double *b, double *x,
+						double *c, int *q, int *r );
+
+
+/*
+ * NEW_OOC_PROFILE - create the scratch file of a skyline matrix of dimension
+ * n, map the matrix into memory, and divide the columns into panels of at
+ * most half of the budget each, the other half being for the panel of
+ * earlier columns that is streamed past it.  A single column larger than
+ * that is a panel by itself.
+ */
+ooc_profile *new_ooc_profile( int n, int *maxa, size_t budget )
+{
+	ooc_profile *P;
+	size_t	half = budget / 2, bytes;
+	int	j;
+
+	P = (ooc_profile *) malloc ( sizeof(ooc_profile) );
+	P->n      = n;
+	P->nK     = maxa[n+1]-1;
+	P->maxa   = maxa;
+	P->budget = budget;
+	P->offset = (size_t) P->nK * sizeof(double);
+	P->fp     = scratch_file ( 2*P->offset );
+
+	P->panel  = ivector ( 1, n+1 );
+	P->np = 0;
+	for (j=1; j <= n; ) {
+		P->panel[++P->np] = j;
+		bytes = 0;
+		do {
+			bytes += (maxa[j+1]-maxa[j]) * sizeof(double);
+			++j;
+		} while ( j <= n &&
+			  bytes + (maxa[j+1]-maxa[j])*sizeof(double) <= half );
+	}
+	P->panel[P->np+1] = n+1;
+
+#if !defined(WIN32) && !defined(DJGPP)
+	P->K = (double *) mmap ( NULL, P->offset, PROT_READ | PROT_WRITE,
+					MAP_SHARED, fileno(P->fp), 0 );
+	if ( P->K == (double *) MAP_FAILED ) {
+		fprintf(stderr," new_ooc_profile: can not map the scratch file\n");
+		exit(39);
+	}
+	P->K -= 1;
+#else
+	P->K = dvector ( 1, P->nK );
+	for (j=1; j <= P->nK; j++)	P->K[j] = 0.0;
+#endif
+	return P;
+}
+
+
+/*
+ * OOC_LDL_DCMP_PM_SKY - solve the partitioned matrix equations of
+ * ldl_dcmp_pm_sky() for the skyline matrix P->K, which is not changed.
+ * The reduction copies each panel of columns of K to the decomposition
+ * in the scratch file, reduces it with the earlier panels that reach
+ * its skyline, streamed through memory one at a time, and then within
+ * itself.  Each solution streams the decomposition through memory four
+ * times, panel by panel.  The terms are reduced in the order of
+ * ldl_dcmp_pm_sky(), so the results are the same.
+ */
+void ooc_ldl_dcmp_pm_sky (
+	ooc_profile *P, double *d, double *b, double *x, double *c,
+	int *q, int *r, int reduce, int solve, int *pd
+){
+	*pd = 0;	/* number of negative elements on the diagonal of D */
+
+	if ( reduce && !reduce_panels ( P, d, q, pd ) )	return;
+
+	if ( solve )	solve_panels ( P, d, b, x, c, q, r );
+}
+
+
+/*
+ * OOC_LDL_MPROVE_PM_SKY - improve a solution vector x[1..n] from
+ * ooc_ldl_dcmp_pm_sky() as ldl_mprove_pm_sky() does.  The residual is
+ * computed with the un-factored skyline matrix [K].
+ */
+void ooc_ldl_mprove_pm_sky (
+	double *K, ooc_profile *P, double *d, double *b, double *x, double *c,
+	int *q, int *r, double *rms_resid, int *ok
+){
+	double  *dx,		// the residual error
+		*dc,		// update to partial r.h.s. vector, c
+		rms_resid_new=0.0; // the RMS error of the mprvd solution
+	int	i, n = P->n;
+
+	dx  = dvector(1,n);
+	dc  = dvector(1,n);
+
+	prodAx_sky ( K, P->maxa, n, x, dx );
+	for (i=1;i<=n;i++) {
+		if ( q[i] )	dx[i] = b[i] - dx[i];
+		else		dx[i] = 0.0;
+	}
+
+	solve_panels ( P, d, dx, dx, dc, q, r );
+
+	for (i=1;i<=n;i++) if ( q[i] )	rms_resid_new += dx[i]*dx[i];
+
+	rms_resid_new = sqrt ( rms_resid_new / (double) n );
+
+	*ok = 0;
+	if ( rms_resid_new / *rms_resid < 0.90 ) { /*  enough improvement    */
+		for (i=1;i<=n;i++) {	/*  update the solution */
+		    	if ( q[i] )	x[i] += dx[i];
+			if ( r[i] )	c[i] += dc[i];
+		}
+		*rms_resid = rms_resid_new;	/* return the new residual   */
+		*ok = 1;			/* the solution has improved */
+	}
+
+	free_dvector(dx,1,n);
+	free_dvector(dc,1,n);
+}
+
+
+/*
+ * FREE_OOC_PROFILE - release the mapping of P->K and the scratch file,
+ * which has no name and is removed when it is closed
+ */
+void free_ooc_profile( ooc_profile *P )
+{
+	if ( !P )	return;
+#if !defined(WIN32) && !defined(DJGPP)
+	munmap ( P->K+1, P->offset );
+#else
+	free_dvector ( P->K, 1, P->nK );
+#endif
+	fclose ( P->fp );
+	free_ivector ( P->panel, 1, P->n+1 );
+	free ( P );
+}
+
+
+/*
+ * SCRATCH_FILE - open a scratch file of size bytes, of zeros, in the
+ * directory of the temporary files.  The file is removed as it is opened,
+ * so it is gone when it is closed, even if the analysis stops.
+ */
+static FILE *scratch_file( size_t size )
+{
+	FILE	*fp = NULL;
+#if !defined(WIN32) && !defined(DJGPP)
+	char	path[FRAME3DD_PATHMAX];
+	int	fd;
+
+	output_path ( "frame3dd-XXXXXX", path, FRAME3DD_PATHMAX, NULL );
+	fd = mkstemp ( path );
+	if ( fd >= 0 ) {
+		unlink ( path );
+		if ( ftruncate ( fd, (off_t) size ) == 0 )
+			fp = fdopen ( fd, "w+b" );
+		else	close ( fd );
+	}
+#else
+	fp = tmpfile();
+	if ( fp && size > 0 &&
+	     ( fseek ( fp, (long) size-1, SEEK_SET ) || fputc ( 0, fp ) == EOF ) ) {
+		fclose ( fp );
+		fp = NULL;
+	}
+#endif
+	if ( !fp ) {
+		fprintf(stderr," scratch_file: can not create a scratch file of");
+		fprintf(stderr," %.0f MB for an out-of-core matrix\n",
+						(double) size / 1048576.0 );
+		exit(39);
+	}
+	return fp;
+}
+
+
+/*
+ * MAP_COLUMNS - map columns j1 to j2 of the decomposition into memory,
+ * so that w->A[k] is the term P->K[k] of those columns
+ */
+static void map_columns(
+	ooc_profile *P, int j1, int j2, int write, ooc_window *w
+){
+	size_t	first = P->offset + (size_t)(P->maxa[j1]-1)*sizeof(double),
+		last  = P->offset + (size_t)(P->maxa[j2+1]-1)*sizeof(double);
+	int	io = 0;
+
+#if !defined(WIN32) && !defined(DJGPP)
+	size_t	page = (size_t) sysconf ( _SC_PAGESIZE );
+
+	w->start = first - first % page;
+	w->len   = last - w->start;
+	w->map   = mmap ( NULL, w->len, write ? PROT_READ|PROT_WRITE : PROT_READ,
+				MAP_SHARED, fileno(P->fp), (off_t) w->start );
+	io = ( w->map == MAP_FAILED );
+#else
+	w->start = first;
+	w->len   = last - first;
+	w->map   = malloc ( w->len );
+	io = ( !w->map || fseek ( P->fp, (long) first, SEEK_SET ) ||
+		fread ( w->map, 1, w->len, P->fp ) != w->len );
+#endif
+	if ( io ) {
+		fprintf(stderr," map_columns: can not map columns %d to %d", j1,j2);
+		fprintf(stderr," of the out-of-core matrix\n");
+		exit(39);
+	}
+	w->write = write;
+	w->A = (double *) ( (char *) w->map + (first - w->start) ) - P->maxa[j1];
+}
+
+
+/*
+ * UNMAP_COLUMNS - release a panel from map_columns(), writing its changes
+ * to the scratch file
+ */
+static void unmap_columns( ooc_window *w, FILE *fp )
+{
+#if !defined(WIN32) && !defined(DJGPP)
+	(void) fp;
+	munmap ( w->map, w->len );
+#else
+	if ( w->write && ( fseek ( fp, (long) w->start, SEEK_SET ) ||
+			   fwrite ( w->map, 1, w->len, fp ) != w->len ) ) {
+		fprintf(stderr," unmap_columns: can not write the scratch file\n");
+		exit(39);
+	}
+	free ( w->map );
+#endif
+}
+
+
+/*
+ * REDUCE_COLUMN - reduce the terms of rows i1 to i2 of column j of A with
+ * the reduced columns i1 to i2 of B, as in ldl_reduce_pm_sky()
+ */
+static void reduce_column(
+	double *A, double *B, int *maxa, int *q, int j, int i1, int i2
+){
+	double	*Aj = A + maxa[j] + j, *Bi, s;	/* Aj[-i] is A[i][j] */
+	int	i, k, k0, mi, mj = j - (maxa[j+1] - maxa[j]) + 1;
+
+	if ( i1 < mj )	i1 = mj;
+	for (i=i1; i <= i2; i++) {
+		if ( !q[i] )	continue;
+		Bi = B + maxa[i] + i;
+		mi = i - (maxa[i+1] - maxa[i]) + 1;
+		k0 = ( mi > mj ) ? mi : mj;
+		s = 0.0;
+		for (k=k0; k < i; k++)
+			if ( q[k] )	s += Aj[-k]*Bi[-k];
+		Aj[-i] -= s;
+	}
+}
+
+
+/*
+ * REDUCE_PANELS - the forward column-wise reduction of [A_qq], panel by
+ * panel.  Returns 0 if a zero is found on the diagonal of D, 1 otherwise.
+ */
+static int reduce_panels( ooc_profile *P, double *d, int *q, int *pd )
+{
+	ooc_window wp, wi;
+	double	*A, *Aj;
+	int	*maxa = P->maxa, p, pp, i, i1, i2, j, j1, j2, mj, top;
+
+	for (p=1; p <= P->np; p++) {
+		j1 = P->panel[p];
+		j2 = P->panel[p+1]-1;
+		map_columns ( P, j1, j2, 1, &wp );
+		A = wp.A;
+		for (i=maxa[j1]; i < maxa[j2+1]; i++)	A[i] = P->K[i];
+
+		top = j1;	/* the highest skyline of the panel */
+		for (j=j1; j <= j2; j++) {
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			if ( q[j] && mj < top )	top = mj;
+		}
+
+		/* the earlier panels, from the highest skyline down */
+		for (pp=1; pp < p; pp++) {
+			i2 = P->panel[pp+1]-1;
+			if ( i2 < top )	continue;
+			i1 = ( P->panel[pp] > top ) ? P->panel[pp] : top;
+			map_columns ( P, i1, i2, 0, &wi );
+			for (j=j1; j <= j2; j++)
+				if ( q[j] ) reduce_column ( A, wi.A, maxa, q,
+								j, i1, i2 );
+			unmap_columns ( &wi, P->fp );
+		}
+
+		/* the columns of this panel */
+		for (j=j1; j <= j2; j++) {
+			d[j] = 0.0;
+			if ( !q[j] ) continue;	/* columns of A_qr are not reduced */
+
+			reduce_column ( A, A, maxa, q, j, j1, j-1 );
+
+			Aj = A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			d[j] = Aj[-j];
+			for (i=mj; i < j; i++) if ( q[i] ) d[j] -= Aj[-i]*Aj[-i]/d[i];
+			for (i=mj; i < j; i++) if ( q[i] ) Aj[-i] /= d[i];
+
+			if ( d[j] == 0.0 ) {
+			 fprintf(stderr," ooc_ldl_dcmp_pm_sky(): zero found on diagonal ...\n");
+			 fprintf(stderr," d[%d] = %11.4e\n", j, d[j] );
+			 unmap_columns ( &wp, P->fp );
+			 return 0;
+			}
+			if ( d[j] < 0.0 ) (*pd)--;
+		}
+		unmap_columns ( &wp, P->fp );
+	}
+	return 1;
+}
+
+
+/*
+ * SOLVE_PANELS - the back substitution of ldl_dcmp_pm_sky() with the
+ * decomposition in the scratch file.  The diagonal of A is that of K.
+ */
+static void solve_panels(
+	ooc_profile *P, double *d, double *b, double *x, double *c,
+	int *q, int *r
+){
+	ooc_window w;
+	double	*Aj;
+	int	*maxa = P->maxa, n = P->n, p, i, j, mj;
+
+	/*  {x_q} = {b_q} - [A_qr]{x_r}, sweeping the columns of [A]  */
+	for (i=1; i <= n; i++)	if ( q[i] )	x[i] = b[i];
+	for (p=1; p <= P->np; p++) {
+		map_columns ( P, P->panel[p], P->panel[p+1]-1, 0, &w );
+		for (j=P->panel[p]; j < P->panel[p+1]; j++) {
+			Aj = w.A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			for (i=mj; i < j; i++) {
+				if ( q[i] && r[j] )	x[i] -= Aj[-i]*x[j];
+				if ( r[i] && q[j] )	x[j] -= Aj[-i]*x[i];
+			}
+		}
+		unmap_columns ( &w, P->fp );
+	}
+
+	/* {x} is run through the same forward reduction as was [A] */
+	for (p=1; p <= P->np; p++) {
+		map_columns ( P, P->panel[p], P->panel[p+1]-1, 0, &w );
+		for (j=P->panel[p]; j < P->panel[p+1]; j++) {
+			if ( !q[j] )	continue;
+			Aj = w.A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			for (i=mj; i < j; i++) if ( q[i] ) x[j] -= Aj[-i]*x[i];
+		}
+		unmap_columns ( &w, P->fp );
+	}
+
+	for (i=1; i <= n; i++)	if ( q[i] )	x[i] /= d[i];
+
+	/* back substitution on {x} */
+	for (p=P->np; p >= 1; p--) {
+		map_columns ( P, P->panel[p], P->panel[p+1]-1, 0, &w );
+		for (j=P->panel[p+1]-1; j >= P->panel[p]; j--) {
+			if ( !q[j] )	continue;
+			Aj = w.A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			for (i=mj; i < j; i++) if ( q[i] ) x[i] -= Aj[-i]*x[j];
+		}
+		unmap_columns ( &w, P->fp );
+	}
+
+	/* finally, evaluate c_r = [A_rq]{x_q} + [A_rr]{x_r} - {b_r} */
+	for (i=1; i<=n; i++) {
+		c[i] = 0.0;
+		if ( r[i] )	c[i] = P->K[maxa[i]]*x[i] - b[i];
+	}
+	for (p=1; p <= P->np; p++) {
+		map_columns ( P, P->panel[p], P->panel[p+1]-1, 0, &w );
+		for (j=P->panel[p]; j < P->panel[p+1]; j++) {
+			Aj = w.A + maxa[j] + j;
+			mj = j - (maxa[j+1] - maxa[j]) + 1;
+			for (i=mj; i < j; i++) {
+				if ( r[i] )	c[i] += Aj[-i]*x[j];
+				if ( r[j] )	c[j] += Aj[-i]*x[i];
+			}
+		}
+		unmap_columns ( &w, P->fp );
+	}
+}
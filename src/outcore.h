@@ -0,0 +1,105 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//** @file
+	Out-of-core skyline L D L' decomposition.
+
+	A skyline (profile) matrix and its L D L' decomposition are held in
+	a scratch file.  The decomposition is reduced and solved in panels
+	of consecutive columns, mapped into memory at most two at a time,
+	so that the terms of the decomposition in memory stay within a
+	budget.
+*/
+#ifndef FRAME_OUTCORE_H
+#define FRAME_OUTCORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+
+/**
+	a skyline matrix and its L D L' decomposition in a scratch file,
+	from new_ooc_profile()
+*/
+typedef struct {
+	int	n;		/**< dimension of the matrix		*/
+	int	nK;		/**< number of terms in the skyline	*/
+	int	*maxa;		/**< location of diagonal terms, [1..n+1] */
+	size_t	budget;		/**< bytes of the decomposition in memory */
+	int	np;		/**< number of panels of columns	*/
+	int	*panel;		/**< first column of each panel, [1..np+1] */
+	FILE	*fp;		/**< the scratch file			*/
+	size_t	offset;		/**< location of L D L' in the file	*/
+	double	*K;		/**< the skyline matrix, mapped from the file */
+} ooc_profile;
+
+
+/**
+	NEW_OOC_PROFILE - create the scratch file of a skyline matrix and
+	plan the panels of its decomposition; the matrix P->K is zero
+*/
+ooc_profile *new_ooc_profile(
+	int n,		/**< dimension of the matrix			*/
+	int *maxa,	/**< location of diagonal terms, [1..n+1]	*/
+	size_t budget	/**< bytes of the decomposition in memory	*/
+);
+
+
+/**
+	OOC_LDL_DCMP_PM_SKY - ldl_dcmp_pm_sky() for the matrix P->K, with
+	its decomposition in the scratch file instead of in place
+*/
+void ooc_ldl_dcmp_pm_sky(
+	ooc_profile *P,	/**< the skyline matrix, from new_ooc_profile()	*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	int reduce,	/**< 1: do a forward reduction of A; 0: don't   */
+	int solve,	/**< 1: do a back substitution for {x}; 0: don't */
+	int *pd		/**< number of negative terms of D		*/
+);
+
+
+/**
+	OOC_LDL_MPROVE_PM_SKY - ldl_mprove_pm_sky() with the decomposition
+	from ooc_ldl_dcmp_pm_sky()
+*/
+void ooc_ldl_mprove_pm_sky(
+	double *K,	/**< the skyline matrix, not factored		*/
+	ooc_profile *P,	/**< L D L' decomposition of K			*/
+	double *d,	/**< diagonal of D in the  L D L' - decomp'n    */
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	double *rms_resid, /**< root-mean-square of residual error	*/
+	int *ok		/**< 1: >10% reduction in rms_resid; 0: not	*/
+);
+
+
+/** FREE_OOC_PROFILE - release the mapping of P->K and the scratch file */
+void free_ooc_profile( ooc_profile *P );
+
+#endif /* FRAME_OUTCORE_H */
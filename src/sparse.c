@@ -0,0 +1,757 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//**
+	@file
+	Sparse supernodal L D L' decomposition of the stiffness matrix
+
+	The graph of the free nodes is ordered by minimum degree.  The
+	elimination graph gives the sparsity of each node-column of L.
+	Consecutive nodes whose columns of L are nested form a supernode,
+	which is stored and factored as a dense panel of columns.  Each
+	factored panel updates the panels of its ancestors with a dense
+	rank-k product before they are factored (right-looking).
+
+	The upper triangle of [K] itself is held by columns, from the node
+	connectivity, and each of its terms in [K_qq] is mapped to its place
+	in the panels, so the panels are loaded from [K] without a search.
+
+	A. George and J. W. H. Liu, Computer Solution of Large Sparse Positive
+	Definite Systems, Prentice-Hall, 1981
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sparse.h"
+#include "common.h"
+#include "HPGmatrix.h"
+#include "NRutil.h"
+
+
+/* forward declarations */
+
+static void heap_push( int **key, int **node, int *nh, int *mh, int k, int v );
+static int  heap_pop( int *key, int *node, int *nh, int *k );
+static int  icompare( const void *a, const void *b );
+static void sparse_K_columns( sparse_ldl *S, int nN, int nE, int *N1, int *N2,
+				int *dof );
+static void prod_Kx( sparse_ldl *S, double *K, int *dof, double *x, double *y );
+
+
+/*
+ * SPARSE_ANALYZE - order the free nodes by minimum degree and find the
+ * supernodes and the sparsity of L from the frame element connectivity.
+ * Nodes with no free coordinates are left out of the graph.
+ * The degree of a node is the number of free coordinates adjacent to it.
+ * The columns of the upper triangle of [K] are found by sparse_K_columns().
+ */
+sparse_ldl *sparse_analyze( int nN, int nE, int *N1, int *N2, int *dof, int *q )
+{
+	sparse_ldl *S;
+	int	*w,		/* number of free coordinates at each node */
+		**adj, *len, *cap, /* adjacency lists of the elimination graph */
+		*deg,		/* weighted degree of each node		*/
+		*mark,		/* marker for merging adjacency lists	*/
+		*order,		/* nodes in order of elimination	*/
+		*pos,		/* position of each node in the order	*/
+		*sptr, *slist,	/* positions of the nodes in each column of L */
+		*rstart,	/* first row of L for each node position */
+		*kfirst,	/* first node position of each supernode */
+		*hkey=NULL, *hnode=NULL, nh=0, mh=0,	/* degree heap	*/
+		nn=0, nq=0, ns=0, ms, stamp=0, k, v, u, x, i, j, l, n1, n2,
+		nrow, ncol, nrows;
+	unsigned long	nL;
+
+	w    = ivector(1,nN);
+	len  = ivector(1,nN);
+	cap  = ivector(1,nN);
+	deg  = ivector(1,nN);
+	mark = ivector(1,nN);
+	pos  = ivector(1,nN);
+	adj  = (int **) malloc((size_t) (nN+1)*sizeof(int *));
+
+	for (j=1; j<=nN; j++) {
+		w[j] = 0;
+		for (l=1; l<=6; l++)	if ( q[6*j-6+l] )	++w[j];
+		if ( w[j] )	++nn;
+		nq += w[j];
+		len[j] = 0;	cap[j] = 8;	mark[j] = 0;	pos[j] = 0;
+		adj[j] = (int *) malloc((size_t) cap[j]*sizeof(int));
+	}
+
+	for (i=1; i<=nE; i++) {		/* graph of the free nodes */
+		n1 = N1[i];	n2 = N2[i];
+		if ( n1 == n2 || !w[n1] || !w[n2] )	continue;
+		for (k=0; k<len[n1]; k++)	if ( adj[n1][k] == n2 ) break;
+		if ( k < len[n1] )	continue;	/* already connected */
+		for (l=0; l<2; l++) {	/* n1 --> n2, then n2 --> n1 */
+			if ( len[n1] == cap[n1] ) {
+				cap[n1] *= 2;
+				adj[n1] = (int *) realloc(adj[n1],(size_t) cap[n1]*sizeof(int));
+			}
+			adj[n1][len[n1]++] = n2;
+			n1 = N2[i];	n2 = N1[i];
+		}
+	}
+
+	for (j=1; j<=nN; j++) {
+		if ( !w[j] )	continue;
+		deg[j] = 0;
+		for (k=0; k<len[j]; k++)	deg[j] += w[adj[j][k]];
+		heap_push ( &hkey, &hnode, &nh, &mh, deg[j], j );
+	}
+
+	order = ivector(1,nn);
+	sptr  = ivector(1,nn+1);
+	ms    = 2*nN + 16;
+	slist = (int *) malloc((size_t) ms*sizeof(int));
+	sptr[1] = 0;
+
+	for (k=1; k<=nn; k++) {		/* minimum degree elimination */
+
+		do {
+			v = heap_pop ( hkey, hnode, &nh, &x );
+		} while ( pos[v] || x != deg[v] );
+
+		order[k] = v;	pos[v] = k;
+
+		/* the neighbors of v form the sparsity of node-column k of L */
+		if ( sptr[k] + len[v] > ms ) {
+			while ( sptr[k] + len[v] > ms )	ms *= 2;
+			slist = (int *) realloc(slist,(size_t) ms*sizeof(int));
+		}
+		for (i=0; i<len[v]; i++)	slist[sptr[k]+i] = adj[v][i];
+		sptr[k+1] = sptr[k] + len[v];
+
+		/* eliminate v: its neighbors become a clique */
+		for (i=0; i<len[v]; i++) {
+			u = adj[v][i];
+			++stamp;
+			for (l=0; l<len[u]; l++) {
+				if ( adj[u][l] == v ) adj[u][l--] = adj[u][--len[u]];
+				else	mark[adj[u][l]] = stamp;
+			}
+			for (j=0; j<len[v]; j++) {
+				x = adj[v][j];
+				if ( x == u || mark[x] == stamp )	continue;
+				if ( len[u] == cap[u] ) {
+					cap[u] *= 2;
+					adj[u] = (int *) realloc(adj[u],(size_t) cap[u]*sizeof(int));
+				}
+				adj[u][len[u]++] = x;
+			}
+			deg[u] = 0;
+			for (l=0; l<len[u]; l++)	deg[u] += w[adj[u][l]];
+			heap_push ( &hkey, &hnode, &nh, &mh, deg[u], u );
+		}
+		len[v] = 0;
+	}
+
+	for (k=1; k<=nn; k++) {		/* node-columns of L, by position */
+		for (i=sptr[k]; i<sptr[k+1]; i++)	slist[i] = pos[slist[i]];
+		qsort ( slist+sptr[k], (size_t) (sptr[k+1]-sptr[k]), sizeof(int), icompare );
+	}
+
+	/* fundamental supernodes: chains of node-columns with nested sparsity */
+	kfirst = ivector(1,nn+1);
+	for (k=1; k<=nn; k++) {
+		if ( k == 1 || sptr[k]-sptr[k-1] != sptr[k+1]-sptr[k] + 1 ||
+		     slist[sptr[k-1]] != k )
+			kfirst[++ns] = k;
+	}
+	kfirst[ns+1] = nn+1;
+
+	rstart = ivector(1,nn+1);
+	rstart[1] = 1;
+	for (k=1; k<=nn; k++)	rstart[k+1] = rstart[k] + w[order[k]];
+
+	S = (sparse_ldl *) malloc(sizeof(sparse_ldl));
+	S->n  = 6*nN;
+	S->nq = nq;
+	S->ns = ns;
+	S->perm  = ivector(1,nq);
+	S->first = ivector(1,ns+1);
+	S->sup   = ivector(1,nq);
+	S->rptr  = ivector(1,ns+1);
+	S->lptr  = lvector(1,ns+1);
+	S->d     = dvector(1,nq);
+
+	for (k=1, i=1; k<=nn; k++) {
+		v = order[k];
+		for (l=1; l<=6; l++)	if ( q[6*v-6+l] )  S->perm[i++] = 6*v-6+l;
+	}
+
+	nrows = 0;	nL = 0;
+	for (j=1; j<=ns; j++) {
+		k = kfirst[j+1]-1;	/* last node position of supernode j */
+		S->first[j] = rstart[kfirst[j]];
+		ncol = rstart[k+1] - rstart[kfirst[j]];
+		nrow = ncol;
+		for (i=sptr[k]; i<sptr[k+1]; i++)
+			nrow += rstart[slist[i]+1] - rstart[slist[i]];
+		for (i=S->first[j]; i<S->first[j]+ncol; i++)	S->sup[i] = j;
+		S->rptr[j] = nrows + 1;
+		S->lptr[j] = nL + 1;
+		nrows += nrow;
+		nL += (unsigned long) nrow * ncol;
+	}
+	S->first[ns+1] = nq+1;
+	S->rptr[ns+1] = nrows + 1;
+	S->lptr[ns+1] = nL + 1;
+
+	S->rows = ivector(1,nrows);
+	S->L    = NULL;		/* allocated by the first decomposition */
+
+	for (j=1; j<=ns; j++) {		/* row indices of each supernode */
+		k = kfirst[j+1]-1;
+		x = S->rptr[j];
+		for (i=S->first[j]; i<S->first[j+1]; i++)	S->rows[x++] = i;
+		for (i=sptr[k]; i<sptr[k+1]; i++)
+			for (l=rstart[slist[i]]; l<rstart[slist[i]+1]; l++)
+				S->rows[x++] = l;
+	}
+
+	for (j=1; j<=nN; j++)	free(adj[j]);
+	free(adj);
+	free(slist);
+	free(hkey);
+	free(hnode);
+	free_ivector(w,1,nN);
+	free_ivector(len,1,nN);
+	free_ivector(cap,1,nN);
+	free_ivector(deg,1,nN);
+	free_ivector(mark,1,nN);
+	free_ivector(pos,1,nN);
+	free_ivector(order,1,nn);
+	free_ivector(sptr,1,nn+1);
+	free_ivector(kfirst,1,nn+1);
+	free_ivector(rstart,1,nn+1);
+
+	sparse_K_columns ( S, nN, nE, N1, N2, dof );
+
+	return S;
+}
+
+
+/*
+ * SPARSE_K_COLUMNS - the rows of each column of the upper triangle of [K],
+ * in the numbering of [K], from the nodes joined to each node by the frame
+ * elements, and the location in the panels of L of each term of [K_qq]
+ */
+static void sparse_K_columns( sparse_ldl *S, int nN, int nE, int *N1,
+				int *N2, int *dof )
+{
+	int	*eptr, *elist,	/* the elements at each node		*/
+		*nbr,		/* the nodes joined to a node		*/
+		*mark,		/* marker for the nodes joined to a node */
+		*row,		/* row of L of each row of [K], or 0	*/
+		n = S->n, nb, nK, i, j, k, l, m, a, b, c, sn, ri, rj, lo, hi;
+
+	eptr  = ivector(1,nN+1);
+	elist = ivector(1,2*nE);
+	nbr   = ivector(1,nN);
+	mark  = ivector(1,nN);
+
+	for (j=1; j<=nN+1; j++)	eptr[j] = 0;
+	for (i=1; i<=nE; i++) { ++eptr[N1[i]];  ++eptr[N2[i]]; }
+	for (j=1, k=1; j<=nN+1; j++) { l = eptr[j];  eptr[j] = k;  k += l; }
+	for (i=1; i<=nE; i++) {
+		elist[eptr[N1[i]]++] = i;
+		elist[eptr[N2[i]]++] = i;
+	}
+	for (j=nN; j>=1; j--)	eptr[j+1] = eptr[j];
+	eptr[1] = 1;
+	for (j=1; j<=nN; j++)	mark[j] = 0;
+
+	S->kptr = ivector(1,n+1);
+	for (j=1; j<=n+1; j++)	S->kptr[j] = 0;
+
+	for (m=1; m<=2; m++) {	/* count the rows, then list them */
+	    for (j=1; j<=nN; j++) {
+		nb = 0;
+		nbr[++nb] = j;	mark[j] = j;
+		for (k=eptr[j]; k<eptr[j+1]; k++) {
+			i = ( N1[elist[k]] == j ) ? N2[elist[k]] : N1[elist[k]];
+			if ( mark[i] != j ) { nbr[++nb] = i;  mark[i] = j; }
+		}
+		for (l=1; l<=6; l++) {
+			a = dof[6*j-6+l];	/* column of [K] */
+			for (k=1; k<=nb; k++) {
+			    for (c=1; c<=6; c++) {
+				b = dof[6*nbr[k]-6+c];
+				if ( b > a )	continue;
+				if ( m == 1 )	++S->kptr[a];
+				else	S->krow[S->kptr[a]++] = b;
+			    }
+			}
+		}
+	    }
+	    for (j=1; j<=nN; j++)	mark[j] = 0;
+	    if ( m == 1 ) {
+		for (j=1, k=1; j<=n+1; j++) { l = S->kptr[j]; S->kptr[j] = k; k += l; }
+		S->nK = nK = S->kptr[n+1] - 1;
+		S->krow = ivector(1,nK);
+	    } else {
+		for (j=n; j>=1; j--)	S->kptr[j+1] = S->kptr[j];
+		S->kptr[1] = 1;
+	    }
+	}
+	for (j=1; j<=n; j++)
+		qsort ( S->krow+S->kptr[j], (size_t) (S->kptr[j+1]-S->kptr[j]),
+							sizeof(int), icompare );
+
+	/* the location in L of each term of [K_qq], by row and column of L */
+	row = ivector(1,n);
+	for (i=1; i<=n; i++)	row[i] = 0;
+	for (k=1; k<=S->nq; k++)	row[dof[S->perm[k]]] = k;
+	S->kmap = lvector(1,S->nK);
+	for (j=1; j<=n; j++) {
+		for (k=S->kptr[j]; k<S->kptr[j+1]; k++) {
+			ri = row[S->krow[k]];	rj = row[j];
+			S->kmap[k] = 0;
+			if ( !ri || !rj )	continue;
+			if ( ri < rj ) { c = ri;  ri = rj;  rj = c; }
+			sn = S->sup[rj];	/* column rj, row ri of L */
+			lo = S->rptr[sn];	hi = S->rptr[sn+1]-1;
+			while ( lo < hi ) {	/* rows of sn are ascending */
+				c = (lo+hi)/2;
+				if ( S->rows[c] < ri )	lo = c+1;
+				else			hi = c;
+			}
+			S->kmap[k] = S->lptr[sn] +
+				(unsigned long) (rj - S->first[sn]) *
+				(S->rptr[sn+1] - S->rptr[sn]) + lo - S->rptr[sn];
+		}
+	}
+
+	free_ivector(eptr,1,nN+1);
+	free_ivector(elist,1,2*nE);
+	free_ivector(nbr,1,nN);
+	free_ivector(mark,1,nN);
+	free_ivector(row,1,n);
+}
+
+
+/*
+ * SPARSE_K_LOC - the location of the term i,j of [K], i <= j, in the
+ * columns of S, by bisection of the rows of column j, or 0 if not held
+ */
+int sparse_K_loc( sparse_ldl *S, int i, int j )
+{
+	int	lo = S->kptr[j], hi = S->kptr[j+1]-1, c;
+
+	while ( lo < hi ) {
+		c = (lo+hi)/2;
+		if ( S->krow[c] < i )	lo = c+1;
+		else			hi = c;
+	}
+	return ( lo <= hi && S->krow[lo] == i ) ? lo : 0;
+}
+
+
+/*
+ * SPARSE_PRODAX - {y} = [K]{x} for [K] held in the columns of S
+ */
+void sparse_prodAx( sparse_ldl *S, double *K, double *x, double *y )
+{
+	double	yj, Kij;
+	int	i, j, k;
+
+	for (j=1; j<=S->n; j++)	y[j] = 0.0;
+	for (j=1; j<=S->n; j++) {
+		yj = 0.0;
+		for (k=S->kptr[j]; k<S->kptr[j+1]; k++) {
+			i = S->krow[k];
+			Kij = K[k];
+			yj += Kij * x[i];		/* upper triangle */
+			if ( i < j )	y[i] += Kij * x[j];	/* lower */
+		}
+		y[j] += yj;
+	}
+}
+
+
+/*
+ * SPARSE_TO_DMATRIX - expand [K] held in the columns of S into a full
+ * matrix B[1..n][1..n];  row and column i of B is row and column p[i] of [K]
+ */
+void sparse_to_dmatrix( sparse_ldl *S, double *K, int *p, double **B )
+{
+	int	*ip, n = S->n, i, j, k;
+
+	ip = ivector(1,n);	/* row of B for each row of K */
+	for (i=1; i<=n; i++)	ip[p[i]] = i;
+
+	for (i=1; i<=n; i++)	for (j=1; j<=n; j++)	B[i][j] = 0.0;
+
+	for (j=1; j<=n; j++)
+		for (k=S->kptr[j]; k<S->kptr[j+1]; k++)
+			B[ip[S->krow[k]]][ip[j]] = B[ip[j]][ip[S->krow[k]]] = K[k];
+
+	free_ivector(ip,1,n);
+}
+
+
+/*
+ * SAVE_UT_SPARSE - save [K] held in the columns of S to the named file,
+ * as save_ut_sky() does;  row and column i of the file is row and column
+ * p[i] of [K]
+ */
+void save_ut_sparse( char filename[], sparse_ldl *S, double *K, int *p,
+			const char *mode )
+{
+	FILE	*fp_m;
+	int	n = S->n, i, j, k, ii, jj;
+	double	Aij;
+	time_t	now;
+
+	if ((fp_m = fopen (filename, mode)) == NULL) {
+		printf (" error: cannot open file: %s \n", filename );
+		exit(1016);
+	}
+	(void) time(&now);
+	fprintf(fp_m,"%% filename: %s - %s\n", filename, ctime(&now));
+	fprintf(fp_m,"%% type: matrix \n");
+	fprintf(fp_m,"%% rows: %d\n", n );
+	fprintf(fp_m,"%% columns: %d\n", n );
+	for (i=1; i <= n; i++) {
+	  for (j=1; j <= n; j++) {
+		ii = p[i];
+		jj = p[j];
+		if ( ii > jj ) { k = ii; ii = jj; jj = k; }
+		k = sparse_K_loc ( S, ii, jj );
+		Aij = k ? K[k] : 0.0;
+		if (fabs(Aij) > 1.e-99) fprintf(fp_m,"%21.12e", Aij );
+		else		        fprintf(fp_m,"    0                ");
+	  }
+	  fprintf(fp_m,"\n");
+	}
+	fclose ( fp_m);
+}
+
+
+/*
+ * SPARSE_LDL_PM - L D L' decomposition of [K_qq] into the supernode panels
+ * of S, and solution of [K_qq]{x_q} = {b_q} - [K_qr]{x_r} for {x_q} and of
+ * {c_r} = [K_rq]{x_q} + [K_rr]{x_r} - {b_r}.   {b} and {x} may be the same.
+ * The terms of [K_qq] are loaded into the panels through S->kmap.
+ */
+void sparse_ldl_pm(
+	sparse_ldl *S, double *K, int *dof,
+	double *b, double *x, double *c, int *r,
+	int reduce, int solve, int *pd
+){
+	double	*P, *Pj, *Pk, *Pt, *col, *xk, *y, s, dj, dk, wk, w0,w1,w2,w3;
+	int	*map,		/* row of each row of L in a target panel */
+		nq = S->nq, n = S->n,
+		sn, t, tcur, c0, ncol, nrow, nrow_t, m, nb, i, j, k, ii, jj, gi, gj;
+	unsigned long	nL = S->lptr[S->ns+1]-1, l;
+
+	*pd = 0;	/* number of negative elements on the diagonal of D */
+
+	if ( reduce ) {		/* supernodal L D L' decomposition */
+
+	    if ( !S->L )	S->L = dvector(1,nL);
+	    col = dvector(0,4*nq);
+	    map = ivector(1,nq);
+
+	    /* load [K_qq] into the panels */
+	    for (l=1; l<=nL; l++)	S->L[l] = 0.0;
+	    for (k=1; k<=S->nK; k++)	if ( S->kmap[k] )  S->L[S->kmap[k]] = K[k];
+
+	    for (sn=1; sn<=S->ns; sn++) {
+
+		P    = S->L + S->lptr[sn];
+		c0   = S->first[sn];
+		ncol = S->first[sn+1] - c0;
+		nrow = S->rptr[sn+1] - S->rptr[sn];
+
+		/* dense L D L' decomposition of the panel, column by column */
+		for (j=0; j<ncol; j++) {
+			Pj = P + j*nrow;
+			dj = Pj[j];
+			for (k=0; k<j; k++) {
+				Pk = P + k*nrow;
+				wk = Pk[j] * S->d[c0+k];
+				dj -= Pk[j] * wk;
+				for (i=j+1; i<nrow; i++)	Pj[i] -= Pk[i] * wk;
+			}
+			S->d[c0+j] = dj;
+			if ( dj == 0.0 ) {
+			 fprintf(stderr," sparse_ldl_pm(): zero found on diagonal ...\n");
+			 fprintf(stderr," d[%d] = %11.4e\n", S->perm[c0+j], dj );
+			 free_dvector(col,0,4*nq);
+			 free_ivector(map,1,nq);
+			 return;
+			}
+			if ( dj < 0.0 ) (*pd)--;
+			for (i=j+1; i<nrow; i++)	Pj[i] /= dj;
+		}
+
+		/* update the ancestor panels with  L21 D L21' ,
+		 * four columns at a time, column-major, as in dsyrk  */
+		m = nrow - ncol;
+		tcur = 0;
+		nrow_t = 0;
+		for (jj=0; jj<m; jj += 4) {
+			nb = ( m-jj < 4 ) ? m-jj : 4;
+			for (ii=jj; ii<m; ii++)
+				col[ii] = col[m+ii] = col[2*m+ii] = col[3*m+ii] = 0.0;
+			for (k=0; k<ncol; k++) {
+				Pk = P + k*nrow + ncol;
+				dk = S->d[c0+k];
+				w0 = Pk[jj] * dk;
+				w1 = ( nb > 1 ) ? Pk[jj+1] * dk : 0.0;
+				w2 = ( nb > 2 ) ? Pk[jj+2] * dk : 0.0;
+				w3 = ( nb > 3 ) ? Pk[jj+3] * dk : 0.0;
+				if ( w0 == 0.0 && w1 == 0.0 && w2 == 0.0 && w3 == 0.0 )
+					continue;
+				for (ii=jj; ii<m; ii++) {
+					s = Pk[ii];
+					col[ii]     += s * w0;
+					col[m+ii]   += s * w1;
+					col[2*m+ii] += s * w2;
+					col[3*m+ii] += s * w3;
+				}
+			}
+			for (j=0; j<nb; j++) {	/* scatter into the ancestors */
+				gj = S->rows[S->rptr[sn]+ncol+jj+j];
+				t  = S->sup[gj];
+				if ( t != tcur ) {	/* relative row indices in t */
+					nrow_t = S->rptr[t+1] - S->rptr[t];
+					for (i=0; i<nrow_t; i++)
+						map[S->rows[S->rptr[t]+i]] = i;
+					tcur = t;
+				}
+				Pt = S->L + S->lptr[t] +
+					(unsigned long) (gj - S->first[t]) * nrow_t;
+				for (ii=jj+j; ii<m; ii++) {
+					gi = S->rows[S->rptr[sn]+ncol+ii];
+					Pt[map[gi]] -= col[j*m+ii];
+				}
+			}
+		}
+	    }
+
+	    free_dvector(col,0,4*nq);
+	    free_ivector(map,1,nq);
+	}
+
+	if ( solve ) {		/* back substitution to solve for {x}   */
+
+	    xk = dvector(1,nq);
+	    y  = dvector(1,n);
+
+	    /*  {x_q} = {b_q} - [K_qr]{x_r}  */
+	    for (i=1; i<=n; i++)	y[i] = ( r[i] ) ? x[i] : 0.0;
+	    prod_Kx ( S, K, dof, y, y );
+	    for (k=1; k<=nq; k++)	xk[k] = b[S->perm[k]] - y[S->perm[k]];
+
+	    for (sn=1; sn<=S->ns; sn++) {	/* forward reduction */
+		P    = S->L + S->lptr[sn];
+		c0   = S->first[sn];
+		ncol = S->first[sn+1] - c0;
+		nrow = S->rptr[sn+1] - S->rptr[sn];
+		for (j=0; j<ncol; j++) {
+			Pj = P + j*nrow;
+			s = xk[c0+j];
+			for (i=j+1; i<nrow; i++)
+				xk[S->rows[S->rptr[sn]+i]] -= Pj[i] * s;
+		}
+	    }
+
+	    for (k=1; k<=nq; k++)	xk[k] /= S->d[k];
+
+	    for (sn=S->ns; sn>=1; sn--) {	/* back substitution */
+		P    = S->L + S->lptr[sn];
+		c0   = S->first[sn];
+		ncol = S->first[sn+1] - c0;
+		nrow = S->rptr[sn+1] - S->rptr[sn];
+		for (j=ncol-1; j>=0; j--) {
+			Pj = P + j*nrow;
+			s = xk[c0+j];
+			for (i=j+1; i<nrow; i++)
+				s -= Pj[i] * xk[S->rows[S->rptr[sn]+i]];
+			xk[c0+j] = s;
+		}
+	    }
+
+	    for (k=1; k<=nq; k++)	x[S->perm[k]] = xk[k];
+
+	    /* finally, evaluate c_r = [K_rq]{x_q} + [K_rr]{x_r} - {b_r} */
+	    prod_Kx ( S, K, dof, x, y );
+	    for (i=1; i<=n; i++) {
+		c[i] = 0.0;
+		if ( r[i] )	c[i] = y[i] - b[i];
+	    }
+
+	    free_dvector(xk,1,nq);
+	    free_dvector(y,1,n);
+	}
+	return;
+}
+
+
+/*
+ * SPARSE_MPROVE_PM - improve the solution {x} and {c} from sparse_ldl_pm()
+ * The residual is computed with [K] in the columns of S and the correction
+ * is solved with the sparse L D L' decomposition in S.
+ * {x} and {c} are updated only if the rms correction is reduced by 10%.
+ */
+void sparse_mprove_pm(
+	sparse_ldl *S, double *K, int *dof,
+	double *b, double *x, double *c, int *q, int *r,
+	double *rms_resid, int *ok
+){
+	double  *dx,		// the residual error
+		*dc,		// update to partial r.h.s. vector, c
+		rms_resid_new=0.0; // the RMS error of the mprvd solution
+	int	i, pd, n = S->n;
+
+	dx  = dvector(1,n);
+	dc  = dvector(1,n);
+
+	// calculate the r.h.s. of ...
+	//  [K_qq]{dx_q} = {b_q} - [K_qq]*{x_q} - [K_qr]*{x_r}
+	//  {dx_r} is left unchanged at 0.0;
+	prod_Kx ( S, K, dof, x, dx );
+	for (i=1;i<=n;i++) {
+		if ( q[i] )	dx[i] = b[i] - dx[i];
+		else		dx[i] = 0.0;
+	}
+
+	// solve for the residual error term, K is already factored
+	sparse_ldl_pm ( S, K, dof, dx, dx, dc, r, 0, 1, &pd );
+
+	for (i=1;i<=n;i++) if ( q[i] )	rms_resid_new += dx[i]*dx[i];
+
+	rms_resid_new = sqrt ( rms_resid_new / (double) n );
+
+	*ok = 0;
+	if ( rms_resid_new / *rms_resid < 0.90 ) { /*  enough improvement    */
+		for (i=1;i<=n;i++) {	/*  update the solution */
+		    	if ( q[i] )	x[i] += dx[i];
+			if ( r[i] )	c[i] += dc[i];
+		}
+		*rms_resid = rms_resid_new;	/* return the new residual   */
+		*ok = 1;			/* the solution has improved */
+	}
+
+	free_dvector(dx,1,n);
+	free_dvector(dc,1,n);
+	return;
+}
+
+
+/*
+ * FREE_SPARSE_LDL - release the memory of a sparse L D L' decomposition
+ */
+void free_sparse_ldl( sparse_ldl *S )
+{
+	if ( S == NULL )	return;
+	free_ivector(S->perm,1,S->nq);
+	free_ivector(S->first,1,S->ns+1);
+	free_ivector(S->sup,1,S->nq);
+	free_ivector(S->rows,1,S->rptr[S->ns+1]-1);
+	free_ivector(S->rptr,1,S->ns+1);
+	if ( S->L )	free_dvector(S->L,1,S->lptr[S->ns+1]-1);
+	free_lvector(S->lptr,1,S->ns+1);
+	free_dvector(S->d,1,S->nq);
+	free_ivector(S->kptr,1,S->n+1);
+	free_ivector(S->krow,1,S->nK);
+	free_lvector(S->kmap,1,S->nK);
+	free(S);
+}
+
+
+/*
+ * PROD_KX - {y} = [K]{x} for [K] held in the columns of S, in which
+ * structural coordinate i is row dof[i];  {x} and {y} may be the same
+ */
+static void prod_Kx( sparse_ldl *S, double *K, int *dof, double *x, double *y )
+{
+	double	*xk, *yk;
+	int	i, n = S->n;
+
+	xk = dvector(1,n);
+	yk = dvector(1,n);
+	for (i=1; i<=n; i++)	xk[dof[i]] = x[i];
+	sparse_prodAx ( S, K, xk, yk );
+	for (i=1; i<=n; i++)	y[i] = yk[dof[i]];
+	free_dvector(xk,1,n);
+	free_dvector(yk,1,n);
+}
+
+
+/*
+ * HEAP_PUSH - add node v with degree k to a binary heap of (degree,node)
+ */
+static void heap_push( int **key, int **node, int *nh, int *mh, int k, int v )
+{
+	int	i, p;
+
+	if ( *nh + 1 >= *mh ) {
+		*mh = ( *mh ) ? 2 * *mh : 64;
+		*key  = (int *) realloc(*key, (size_t) *mh*sizeof(int));
+		*node = (int *) realloc(*node,(size_t) *mh*sizeof(int));
+	}
+	i = ++(*nh);
+	while ( i > 1 ) {
+		p = i/2;
+		if ( (*key)[p] < k || ( (*key)[p] == k && (*node)[p] < v ) ) break;
+		(*key)[i] = (*key)[p];	(*node)[i] = (*node)[p];
+		i = p;
+	}
+	(*key)[i] = k;	(*node)[i] = v;
+}
+
+
+/*
+ * HEAP_POP - remove the node of least degree from the heap
+ * ties are broken by the lowest node number
+ */
+static int heap_pop( int *key, int *node, int *nh, int *k )
+{
+	int	v = node[1], kl, vl, i, c;
+
+	*k = key[1];
+	kl = key[*nh];	vl = node[*nh];
+	--(*nh);
+	i = 1;
+	while ( (c = 2*i) <= *nh ) {
+		if ( c < *nh && ( key[c+1] < key[c] ||
+		    ( key[c+1] == key[c] && node[c+1] < node[c] ) ) )	c++;
+		if ( kl < key[c] || ( kl == key[c] && vl < node[c] ) )	break;
+		key[i] = key[c];	node[i] = node[c];
+		i = c;
+	}
+	key[i] = kl;	node[i] = vl;
+	return v;
+}
+
+
+static int icompare( const void *a, const void *b )
+{
+	return *(const int *) a - *(const int *) b;
+}
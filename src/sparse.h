@@ -0,0 +1,168 @@
+/*
+ This file is part of FRAME3DD:
+ Static and dynamic structural analysis of 2D and 3D frames and trusses with
+ elastic and geometric stiffness.
+ ---------------------------------------------------------------------------
+ http://frame3dd.sourceforge.net/
+ ---------------------------------------------------------------------------
+ Copyright (C) 1992-2009  Henri P. Gavin
+
+    FRAME3DD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FRAME3DD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FRAME3DD.  If not, see <http://www.gnu.org/licenses/>.
+*//** @file
+	Sparse supernodal L D L' decomposition of the free-coordinate
+	partition [K_qq] of the stiffness matrix.
+
+	The upper triangle of [K] is held by columns, with the rows of
+	each column in ascending order, in the numbering of the skyline
+	solver, and the element stiffness matrices are assembled into it.
+
+	The nodes are ordered by minimum degree, the six coordinates of
+	each node are kept together, and chains of nodes with nested
+	sparsity are merged into supernodes, which are factored as dense
+	column panels.
+*/
+#ifndef FRAME_SPARSE_H
+#define FRAME_SPARSE_H
+
+
+/**
+	symbolic and numeric sparse L D L' decomposition of [K_qq]
+*/
+typedef struct {
+	int	n;		/**< number of structural coordinates	*/
+	int	nq;		/**< number of free coordinates; rows of L */
+	int	ns;		/**< number of supernodes		*/
+	int	*perm;		/**< coordinate of each row of L, [1..nq] */
+	int	*first;		/**< first row of each supernode, [1..ns+1] */
+	int	*sup;		/**< supernode of each row of L, [1..nq] */
+	int	*rptr;		/**< start of rows of each supernode [1..ns+1]*/
+	int	*rows;		/**< rows of L in each supernode	*/
+	unsigned long *lptr;	/**< start of each supernode in L [1..ns+1] */
+	double	*L;		/**< supernode column panels of L, from the
+					first decomposition		*/
+	double	*d;		/**< diagonal of D, [1..nq]		*/
+	int	nK;		/**< number of terms in the upper triangle of [K] */
+	int	*kptr;		/**< start of each column of [K], [1..n+1] */
+	int	*krow;		/**< row of each term of [K], [1..nK]	*/
+	unsigned long *kmap;	/**< location in L of each term of [K_qq],
+					or 0 for a term of [K_qr] or [K_rr] */
+} sparse_ldl;
+
+
+/**
+	SPARSE_ANALYZE - order the free nodes by minimum degree and find the
+	supernodes and the sparsity of L, from the frame element connectivity
+	and the free coordinates q, and the columns of the upper triangle of [K]
+*/
+sparse_ldl *sparse_analyze(
+	int nN,		/**< number of nodes				*/
+	int nE,		/**< number of frame elements			*/
+	int *N1, int *N2, /**< node connectivity			*/
+	int *dof,	/**< location of each coordinate in K		*/
+	int *q		/**< 1: not a reaction; 0: a reaction coordinate */
+);
+
+
+/**
+	SPARSE_K_LOC - the location of the term i,j of [K], i <= j, in the
+	columns of S, or 0 if it is not held
+*/
+int sparse_K_loc(
+	sparse_ldl *S,	/**< symbolic factorization, from sparse_analyze */
+	int i, int j	/**< row and column of [K], i <= j		*/
+);
+
+
+/**
+	SPARSE_PRODAX - {y} = [K]{x} for [K] held in the columns of S,
+	in the numbering of [K]
+*/
+void sparse_prodAx(
+	sparse_ldl *S,	/**< symbolic factorization, from sparse_analyze */
+	double *K,	/**< sparse stiffness matrix			*/
+	double *x,	/**< the vector to be multiplied		*/
+	double *y	/**< the product, not the same as x		*/
+);
+
+
+/**
+	SPARSE_TO_DMATRIX - expand [K] held in the columns of S into a full
+	matrix;  row and column i of B is row and column p[i] of [K]
+*/
+void sparse_to_dmatrix(
+	sparse_ldl *S,	/**< symbolic factorization, from sparse_analyze */
+	double *K,	/**< sparse stiffness matrix			*/
+	int *p,		/**< location of each coordinate in K		*/
+	double **B	/**< the full matrix, [1..n][1..n]		*/
+);
+
+
+/**
+	SAVE_UT_SPARSE - save [K] held in the columns of S to the named file,
+	as save_ut_sky() does
+*/
+void save_ut_sparse(
+	char filename[], /**< name of the file				*/
+	sparse_ldl *S,	/**< symbolic factorization, from sparse_analyze */
+	double *K,	/**< sparse stiffness matrix			*/
+	int *p,		/**< location of each coordinate in K		*/
+	const char *mode /**< "w" to write, "a" to append		*/
+);
+
+
+/**
+	SPARSE_LDL_PM - L D L' decomposition of [K_qq] and solution of the
+	partitioned equations [K_qq]{x_q} + [K_qr]{x_r} = {b_q} for {x_q}
+	and {c_r} = [K_rq]{x_q} + [K_rr]{x_r} - {b_r}, as ldl_dcmp_pm() does.
+	[K] is held in the columns of S, and coordinate i is its row dof[i].
+	{b}, {x}, {c} and r are indexed by structural coordinate.
+*/
+void sparse_ldl_pm(
+	sparse_ldl *S,	/**< symbolic factorization, from sparse_analyze */
+	double *K,	/**< sparse stiffness matrix			*/
+	int *dof,	/**< location of each coordinate in K		*/
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	int reduce,	/**< 1: do a forward reduction of K; 0: don't   */
+	int solve,	/**< 1: do a back substitution for {x}; 0: don't */
+	int *pd		/**< 1: definite matrix and successful L D L' decomp'n*/
+);
+
+
+/**
+	SPARSE_MPROVE_PM - improve the solution {x} and {c} from sparse_ldl_pm()
+	by one step of iterative refinement, as ldl_mprove_pm() does.
+*/
+void sparse_mprove_pm(
+	sparse_ldl *S,	/**< L D L' decomposition, from sparse_ldl_pm	*/
+	double *K,	/**< sparse stiffness matrix			*/
+	int *dof,	/**< location of each coordinate in K		*/
+	double *b,	/**< the right hand side vector			*/
+	double *x,	/**< part of the solution vector		*/
+	double *c,	/**< the part of the solution vector in the rhs */
+	int *q,		/**< q[j]=1 if  b[j] is known; q[j]=0 otherwise	*/
+	int *r,		/**< r[j]=1 if  x[j] is known; r[j]=0 otherwise	*/
+	double *rms_resid, /**< root-mean-square of residual error	*/
+	int *ok		/**< 1: >10% reduction in rms_resid; 0: not	*/
+);
+
+
+/**
+	FREE_SPARSE_LDL - release the memory of a sparse L D L' decomposition
+*/
+void free_sparse_ldl( sparse_ldl *S );
+
+#endif /* FRAME_SPARSE_H */